@@ -131,6 +131,24 @@ IFace *RISCV_get_class(const char *name);
 IFace *RISCV_create_service(IFace *iclass, const char *name,
                                         AttributeType *args);
 
+/**
+ * @brief Mark the service index as outdated.
+ * @details Called when a service instance or its interface was added or
+ *          removed. The name and interface lookups rebuild the index on
+ *          the next request.
+ */
+void RISCV_invalidate_service_index();
+
+/**
+ * @brief Service registers one more interface.
+ * @details Adds attributes of the standard interfaces (IMemoryOperation
+ *          address map) to the service and marks the service index as
+ *          outdated.
+ * @param [in] iservice Service owning the interface.
+ * @param [in] iface Registered interface.
+ */
+void RISCV_register_interface(IFace *iservice, IFace *iface);
+
 /**
  * @brief Get IService interface by its name.
  * @details This method is used for interaction of different services in a
@@ -297,6 +315,31 @@ void* RISCV_memshare_map(sharemem_def h, int sz);
 void RISCV_memshare_unmap(void *buf, int sz);
 void RISCV_memshare_delete(sharemem_def h);
 
+/**
+ * Reserve address space for the memory model. Pages are zero-filled and
+ * committed on the first access so that gigabyte-sized banks cost only
+ * what the software actually touches. Mapping is private, forking of the
+ * running multi-threaded simulator isn't supported: instances share the
+ * booted state by restoring it from the same snapshot file.
+ */
+void *RISCV_memory_reserve(uint64_t sz);
+/**
+ * Private copy-on-write mapping of the file into the reserved region.
+ * Clean pages are shared through the page cache between all simulator
+ * instances that map the same image. sz = 0 maps the whole file.
+ */
+void *RISCV_memory_map_file(const char *filename, uint64_t sz,
+                            uint64_t *filesz);
+/**
+ * Replace pages of the reserved region with the private copy-on-write
+ * mapping of the file starting at offset, or with zero pages if filename
+ * is NULL. Address, size and offset must be aligned to the host page.
+ * Returns 0 when the region cannot be remapped, data must be copied then.
+ */
+int RISCV_memory_remap(void *addr, uint64_t sz, const char *filename,
+                       uint64_t offset);
+void RISCV_memory_release(void *ptr, uint64_t sz);
+
 /** Memory allocator/de-allocator */
 void *RISCV_malloc(uint64_t sz);
 void RISCV_free(void *p);
@@ -305,6 +348,12 @@ void RISCV_free(void *p);
 int RISCV_get_core_folder(char *out, int sz);
 int RISCV_get_core_folderw(wchar_t* out, int sz);
 
+/**
+ * Absolute path of the existing file or directory. Returns 0 when the
+ * path cannot be resolved.
+ */
+int RISCV_get_full_path(const char *path, char *out, int sz);
+
 /** Set $(pwd) directory equals to executable location */
 void RISCV_set_current_dir();
 
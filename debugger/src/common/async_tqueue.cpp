@@ -73,8 +73,11 @@ void AsyncTQueueType::initProc() {
 
 /** Clock queue */
 ClockAsyncTQueueType::ClockAsyncTQueueType() {
-    size_ = 1;
-    queue_ = new StepQueueItemType[size_];
+    size_ = 16;
+    heap_ = new StepQueueItemType[size_];
+    index_size_ = 4*size_;
+    index_ = new IndexItemType[index_size_];
+    memset(index_, 0, index_size_*sizeof(IndexItemType));
 
     RISCV_mutex_init(&mutex_);
     hardReset();
@@ -82,90 +85,243 @@ ClockAsyncTQueueType::ClockAsyncTQueueType() {
 
 ClockAsyncTQueueType::~ClockAsyncTQueueType() {
     RISCV_mutex_destroy(&mutex_);
-    delete [] queue_;
+    delete [] heap_;
+    delete [] index_;
 }
 
 void ClockAsyncTQueueType::hardReset() {
+    RISCV_mutex_lock(&mutex_);
     item_total_ = 0;
-    precnt_ = 0;
-    item_cnt_ = 0;
+    seq_ = 0;
+    proc_seq_ = 0;
+    memset(index_, 0, index_size_*sizeof(IndexItemType));
+    next_time_ = ~0ull;
+    RISCV_mutex_unlock(&mutex_);
 }
 
+void ClockAsyncTQueueType::initProc() {
+    RISCV_mutex_lock(&mutex_);
+    proc_seq_ = seq_;
+    RISCV_mutex_unlock(&mutex_);
+}
 
 void ClockAsyncTQueueType::put(uint64_t time, IFace *cb) {
     RISCV_mutex_lock(&mutex_);
-    if (precnt_ >= 1024) {
-        RISCV_mutex_unlock(&mutex_);
-        RISCV_printf(0, 0, "clock pre-queue overflow: %d", precnt_);
-        return;
+    if (item_total_ == size_) {
+        reallocate();
     }
-    prequeue_[precnt_].left = 0;
-    prequeue_[precnt_].right = 0;
-    prequeue_[precnt_].time = time;
-    prequeue_[precnt_++].iface = cb;
+    unsigned pos = item_total_++;
+    heap_[pos].time = time;
+    heap_[pos].seq = seq_++;
+    heap_[pos].iface = cb;
+    indexInsert(pos);
+    siftUp(pos);
+    updateNextTime();
     RISCV_mutex_unlock(&mutex_);
 }
 
 bool ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
     RISCV_mutex_lock(&mutex_);
-    for (int i = 0; i < precnt_; i++) {
-        if (prequeue_[i].iface == cb) {
-            prequeue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
-        }
+    int hidx = indexFind(cb);
+    if (hidx < 0) {
+        RISCV_mutex_unlock(&mutex_);
+        return false;
     }
-    for (int i = 0; i < item_total_; i++) {
-        if (queue_[i].iface == cb) {
-            queue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
-        }
+    unsigned pos = index_[hidx].pos;
+    uint64_t prev = heap_[pos].time;
+    heap_[pos].time = time;
+    if (time < prev) {
+        siftUp(pos);
+    } else {
+        siftDown(pos);
     }
+    updateNextTime();
     RISCV_mutex_unlock(&mutex_);
-    return false;
+    return true;
 }
 
-void ClockAsyncTQueueType::pushPreQueued() {
-    if (precnt_ == 0) {
-        return;
-    }
+bool ClockAsyncTQueueType::remove(IFace *cb) {
     RISCV_mutex_lock(&mutex_);
-    while ((precnt_ + item_total_) > size_) {
-        int t1 = 2*size_;
-        StepQueueItemType *p1 = new StepQueueItemType[t1];
-        memcpy(p1, queue_, item_total_*sizeof(StepQueueItemType));
-        delete [] queue_;
-        queue_ = p1;
-        size_ = t1;
-    }
-    memcpy(&queue_[item_total_], prequeue_, precnt_*sizeof(StepQueueItemType));
-    item_total_ += precnt_;
-    precnt_ = 0;
+    int hidx = indexFind(cb);
+    if (hidx < 0) {
+        RISCV_mutex_unlock(&mutex_);
+        return false;
+    }
+    removeAt(index_[hidx].pos);
+    updateNextTime();
     RISCV_mutex_unlock(&mutex_);
+    return true;
 }
 
-
 IFace *ClockAsyncTQueueType::getNext(uint64_t step_cnt) {
     IFace *ret = 0;
-    if (item_cnt_ >= item_total_) {
+    if (step_cnt < next_time_) {
         return ret;
     }
-    for (; item_cnt_ < item_total_; item_cnt_++) {
-        if (step_cnt < queue_[item_cnt_].time) {
-            continue;
+    RISCV_mutex_lock(&mutex_);
+    int pos = -1;
+    findDue(0, step_cnt, &pos);
+    if (pos >= 0) {
+        ret = heap_[pos].iface;
+        removeAt(static_cast<unsigned>(pos));
+    }
+    updateNextTime();
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
+
+unsigned ClockAsyncTQueueType::copyItems(uint64_t *time, IFace **cb,
+                                         unsigned max) {
+    RISCV_mutex_lock(&mutex_);
+    unsigned total = item_total_;
+    StepQueueItemType *tmp = new StepQueueItemType[total + 1];
+    memcpy(tmp, heap_, total*sizeof(StepQueueItemType));
+    RISCV_mutex_unlock(&mutex_);
+
+    // Insertion sort by the sequence number: queue is short
+    for (unsigned i = 1; i < total; i++) {
+        StepQueueItemType t = tmp[i];
+        unsigned n = i;
+        while (n > 0 && tmp[n - 1].seq > t.seq) {
+            tmp[n] = tmp[n - 1];
+            n--;
         }
-        ret = queue_[item_cnt_].iface;
+        tmp[n] = t;
+    }
+    for (unsigned i = 0; i < total && i < max; i++) {
+        time[i] = tmp[i].time;
+        cb[i] = tmp[i].iface;
+    }
+    delete [] tmp;
+    return total;
+}
+
+void ClockAsyncTQueueType::setPos(unsigned pos,
+                                  const StepQueueItemType &item) {
+    heap_[pos] = item;
+    index_[item.hidx].pos = pos;
+}
 
-        // remove item from list using swap function to avoid usage
-        // of allocation/deallocation calls.
-        if (item_cnt_ < (item_total_ - 1)) {
-            queue_[item_cnt_] = queue_[item_total_ - 1];
+void ClockAsyncTQueueType::siftUp(unsigned pos) {
+    StepQueueItemType item = heap_[pos];
+    while (pos > 0) {
+        unsigned parent = (pos - 1) >> 1;
+        if (!less(item, heap_[parent])) {
+            break;
         }
-        item_total_--;
-        break;
+        setPos(pos, heap_[parent]);
+        pos = parent;
+    }
+    setPos(pos, item);
+}
+
+void ClockAsyncTQueueType::siftDown(unsigned pos) {
+    StepQueueItemType item = heap_[pos];
+    unsigned child;
+    while ((child = 2*pos + 1) < item_total_) {
+        if (child + 1 < item_total_ && less(heap_[child + 1], heap_[child])) {
+            child++;
+        }
+        if (!less(heap_[child], item)) {
+            break;
+        }
+        setPos(pos, heap_[child]);
+        pos = child;
+    }
+    setPos(pos, item);
+}
+
+/**
+ * The earliest due item registered before initProc(). Callback registered
+ * during the processing can be on top of the heap with an earlier time
+ * than other due items, so only the due part of the heap is searched.
+ * Descendants of a suitable item are never earlier than it.
+ */
+void ClockAsyncTQueueType::findDue(unsigned pos, uint64_t step_cnt,
+                                   int *best) {
+    if (pos >= item_total_ || heap_[pos].time > step_cnt) {
+        return;
+    }
+    if (heap_[pos].seq < proc_seq_) {
+        if (*best < 0 || less(heap_[pos], heap_[*best])) {
+            *best = static_cast<int>(pos);
+        }
+        return;
+    }
+    findDue(2*pos + 1, step_cnt, best);
+    findDue(2*pos + 2, step_cnt, best);
+}
+
+void ClockAsyncTQueueType::removeAt(unsigned pos) {
+    indexRemove(heap_[pos].hidx);
+    item_total_--;
+    if (pos == item_total_) {
+        return;
+    }
+    setPos(pos, heap_[item_total_]);
+    if (pos > 0 && less(heap_[pos], heap_[(pos - 1) >> 1])) {
+        siftUp(pos);
+    } else {
+        siftDown(pos);
+    }
+}
+
+void ClockAsyncTQueueType::indexInsert(unsigned pos) {
+    unsigned mask = index_size_ - 1;
+    unsigned i = hashIndex(heap_[pos].iface);
+    while (index_[i].iface) {
+        i = (i + 1) & mask;
+    }
+    index_[i].iface = heap_[pos].iface;
+    index_[i].pos = pos;
+    heap_[pos].hidx = i;
+}
+
+int ClockAsyncTQueueType::indexFind(IFace *cb) {
+    unsigned mask = index_size_ - 1;
+    unsigned i = hashIndex(cb);
+    while (index_[i].iface) {
+        if (index_[i].iface == cb) {
+            return static_cast<int>(i);
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/** Linear probing deletion without tombstones (backward shift) */
+void ClockAsyncTQueueType::indexRemove(unsigned hidx) {
+    unsigned mask = index_size_ - 1;
+    unsigned i = hidx;
+    unsigned j = (i + 1) & mask;
+    while (index_[j].iface) {
+        unsigned k = hashIndex(index_[j].iface);
+        bool shift = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+        if (shift) {
+            index_[i] = index_[j];
+            heap_[index_[i].pos].hidx = i;
+            i = j;
+        }
+        j = (j + 1) & mask;
+    }
+    index_[i].iface = 0;
+}
+
+void ClockAsyncTQueueType::reallocate() {
+    unsigned t1 = 2*size_;
+    StepQueueItemType *p1 = new StepQueueItemType[t1];
+    memcpy(p1, heap_, item_total_*sizeof(StepQueueItemType));
+    delete [] heap_;
+    heap_ = p1;
+    size_ = t1;
+
+    delete [] index_;
+    index_size_ = 4*size_;
+    index_ = new IndexItemType[index_size_];
+    memset(index_, 0, index_size_*sizeof(IndexItemType));
+    for (unsigned i = 0; i < item_total_; i++) {
+        indexInsert(i);
     }
-    return ret;
 }
 
 
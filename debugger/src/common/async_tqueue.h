@@ -51,6 +51,13 @@ class AsyncTQueueType {
 };
 
 
+/**
+ * Clock events scheduler.
+ *
+ * Callbacks are stored in a binary min-heap ordered by the step counter
+ * and registration order. Additional open-addressing index (interface
+ * pointer to heap position) makes move() and remove() O(log n).
+ */
 class ClockAsyncTQueueType {
  public:
     ClockAsyncTQueueType();
@@ -62,34 +69,79 @@ class ClockAsyncTQueueType {
     /** Thread safe method of the callbacks registration */
     void put(uint64_t time, IFace *cb);
 
-    /** push registered to the main queue */
-    void pushPreQueued();
-
-    /** Reset proccessed counter at the begining of each iteration */
-    void initProc() { item_cnt_ = 0; }
+    /**
+     * Reset proccessed counter at the begining of each iteration.
+     * Callbacks registered after this call are processed on the next
+     * iteration even if its time is already reached.
+     */
+    void initProc();
 
     /** move previously regsiterd callbacks: true: moved; false: not found */
     bool move(IFace *cb, uint64_t time);
 
+    /** remove previously registered callback: true: removed */
+    bool remove(IFace *cb);
+
     /**
      * Get next registered interface with counter less or equal to 'step_cnt'
      */
     IFace *getNext(uint64_t step_cnt);
 
+    /**
+     * Earliest registered time. Queue processing could be skipped while
+     * step counter is less than this value.
+     */
+    uint64_t getNextTime() { return next_time_; }
+
+    /**
+     * Copy registered callbacks in the registration order to save them
+     * into snapshot. Returns total number of the items, only 'max' of
+     * them are copied.
+     */
+    unsigned copyItems(uint64_t *time, IFace **cb, unsigned max);
+
  private:
     struct StepQueueItemType {
-        StepQueueItemType *left;
-        StepQueueItemType *right;
         uint64_t time;
+        uint64_t seq;
+        IFace *iface;
+        unsigned hidx;      // position in the index table
+    };
+    struct IndexItemType {
         IFace *iface;
+        unsigned pos;       // position in the heap
     };
-    StepQueueItemType *queue_;
-    int size_;
-    int item_total_;
-    int item_cnt_;
 
-    int precnt_;
-    StepQueueItemType prequeue_[1024];
+    bool less(const StepQueueItemType &a, const StepQueueItemType &b) {
+        return a.time < b.time || (a.time == b.time && a.seq < b.seq);
+    }
+    unsigned hashIndex(IFace *cb) {
+        uint64_t h = reinterpret_cast<uint64_t>(cb) >> 3;
+        h *= 0x9E3779B97F4A7C15ull;
+        return static_cast<unsigned>(h >> 32) & (index_size_ - 1);
+    }
+    void setPos(unsigned pos, const StepQueueItemType &item);
+    void siftUp(unsigned pos);
+    void siftDown(unsigned pos);
+    void removeAt(unsigned pos);
+    void findDue(unsigned pos, uint64_t step_cnt, int *best);
+    void indexInsert(unsigned pos);
+    int indexFind(IFace *cb);
+    void indexRemove(unsigned hidx);
+    void reallocate();
+    void updateNextTime() {
+        next_time_ = item_total_ ? heap_[0].time : ~0ull;
+    }
+
+ private:
+    StepQueueItemType *heap_;
+    unsigned size_;
+    unsigned item_total_;
+    IndexItemType *index_;
+    unsigned index_size_;       // always power of 2 and > 2*size_
+    uint64_t seq_;
+    uint64_t proc_seq_;
+    volatile uint64_t next_time_;
 
     mutex_def mutex_;
 };
@@ -23,11 +23,211 @@
 
 namespace debugger {
 
-static const int64_t MIN_ALLOC_BYTES = 1 << 12;
+static const unsigned MIN_CAPACITY = 4;
+static const size_t ARENA_CHUNK_MIN = 1 << 12;
+static const size_t ARENA_CHUNK_MAX = 1 << 20;
 static AttributeType NilAttribute;
 
+/**
+ * Header placed before the items of the list or dictionary. Dictionary
+ * index keeps (pair index + 1) of the open addressing table, 0 is empty.
+ */
+struct AttributeStorageType {
+    unsigned capacity;
+    unsigned hash_size;
+    uint32_t *hash;
+    AttributeArena *arena;      // set only in the root of from_config()
+};
+
+/**
+ * Bump allocator of the tree built by from_config(). Child nodes don't
+ * free their arena storage, it is released with the root attribute.
+ */
+class AttributeArena {
+ public:
+    AttributeArena() : chunks_(0), next_size_(ARENA_CHUNK_MIN) {}
+    ~AttributeArena() {
+        while (chunks_) {
+            ChunkType *p = chunks_;
+            chunks_ = p->next;
+            RISCV_free(p);
+        }
+    }
+
+    void *alloc(size_t sz) {
+        sz = (sz + 7) & ~static_cast<size_t>(7);
+        if (!chunks_ || chunks_->used + sz > chunks_->size) {
+            size_t chunksz = next_size_;
+            if (chunksz < sz) {
+                chunksz = sz;
+            }
+            ChunkType *p = static_cast<ChunkType *>(
+                    RISCV_malloc(sizeof(ChunkType) + chunksz));
+            p->next = chunks_;
+            p->used = 0;
+            p->size = chunksz;
+            chunks_ = p;
+            if (next_size_ < ARENA_CHUNK_MAX) {
+                next_size_ <<= 1;
+            }
+        }
+        void *ret = reinterpret_cast<char *>(chunks_->data) + chunks_->used;
+        chunks_->used += sz;
+        return ret;
+    }
+
+    bool empty() const { return chunks_ == 0; }
+
+ private:
+    struct ChunkType {
+        ChunkType *next;
+        size_t used;
+        size_t size;
+        uint64_t data[1];
+    };
+    ChunkType *chunks_;
+    size_t next_size_;
+};
+
 void attribute_to_string(const AttributeType *attr, AutoBuffer *buf);
-int string_to_attribute(const char *cfg, int &off, AttributeType *out);
+int string_to_attribute(const char *cfg, int &off, AttributeType *out,
+                        AttributeArena *arena);
+
+static AttributeStorageType *storage_of(const void *items) {
+    return reinterpret_cast<AttributeStorageType *>(
+        const_cast<char *>(static_cast<const char *>(items))
+        - sizeof(AttributeStorageType));
+}
+
+static void *storage_alloc(size_t sz, AttributeArena *arena) {
+    if (arena) {
+        return arena->alloc(sz);
+    }
+    return RISCV_malloc(sz);
+}
+
+/**
+ * Grow items array of the list or dictionary to hold 'size' items.
+ * Capacity is doubled, so appending is amortized O(1).
+ */
+static void *storage_reserve(AttributeType *attr, void *items,
+                             unsigned size, size_t item_sz,
+                             AttributeArena *arena) {
+    unsigned capacity = items ? storage_of(items)->capacity : 0;
+    if (size <= capacity) {
+        return items;
+    }
+    unsigned newcap = MIN_CAPACITY;
+    while (newcap < size) {
+        newcap <<= 1;
+    }
+    char *mem = static_cast<char *>(storage_alloc(
+            sizeof(AttributeStorageType) + newcap * item_sz, arena));
+    AttributeStorageType *hdr = reinterpret_cast<AttributeStorageType *>(mem);
+    char *pnew = mem + sizeof(AttributeStorageType);
+    if (items) {
+        AttributeStorageType *old = storage_of(items);
+        *hdr = *old;
+        RISCV_free(old->hash);      // rebuilt by the dictionary
+        memcpy(pnew, items, attr->size_ * item_sz);
+        if (!(attr->flags_ & AttrFlag_Arena)) {
+            RISCV_free(old);
+        }
+    } else {
+        memset(hdr, 0, sizeof(AttributeStorageType));
+    }
+    hdr->capacity = newcap;
+    hdr->hash_size = 0;
+    hdr->hash = 0;
+    memset(&pnew[attr->size_ * item_sz], 0,
+           (newcap - attr->size_) * item_sz);
+    if (arena) {
+        attr->flags_ |= AttrFlag_Arena;
+    } else {
+        attr->flags_ &= ~AttrFlag_Arena;
+    }
+    return pnew;
+}
+
+static void string_assign(AttributeType *attr, const char *str,
+                          unsigned len, AttributeArena *arena) {
+    attr->attr_free();
+    attr->kind_ = Attr_String;
+    attr->size_ = len;
+    attr->u_.string = static_cast<char *>(storage_alloc(len + 1, arena));
+    memcpy(attr->u_.string, str, len);
+    attr->u_.string[len] = '\0';
+    if (arena) {
+        attr->flags_ |= AttrFlag_Arena;
+    }
+}
+
+/** Keys shorter than 8 bytes are stored without allocation */
+static void key_assign(AttributeType *attr, const char *key,
+                       AttributeArena *arena) {
+    unsigned len = static_cast<unsigned>(strlen(key));
+    if (len < sizeof(attr->u_.data_bytes)) {
+        attr->attr_free();
+        attr->kind_ = Attr_String;
+        attr->size_ = len;
+        attr->flags_ = AttrFlag_Inline;
+        memcpy(attr->u_.data_bytes, key, len + 1);
+    } else {
+        string_assign(attr, key, len, arena);
+    }
+}
+
+static uint32_t key_hash(const char *key) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    while (*key) {
+        h = (h ^ static_cast<uint8_t>(*key++)) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Add pair 'idx' into the index when the keys [0, idx] are valid. The
+ * index is rebuilt after the storage was re-allocated.
+ */
+static void dict_index(AttributeType *attr, unsigned idx) {
+    if (idx + 1 <= AttributeType::DICT_HASH_THRESHOLD) {
+        return;
+    }
+    AttributeStorageType *hdr = storage_of(attr->u_.dict);
+    unsigned start = idx;
+    if (!hdr->hash) {
+        hdr->hash_size = 2 * hdr->capacity;
+        hdr->hash = static_cast<uint32_t *>(
+                RISCV_malloc(hdr->hash_size * sizeof(uint32_t)));
+        memset(hdr->hash, 0, hdr->hash_size * sizeof(uint32_t));
+        start = 0;
+    }
+    uint32_t mask = hdr->hash_size - 1;
+    for (unsigned i = start; i <= idx; i++) {
+        uint32_t n = key_hash(attr->u_.dict[i].key_.to_string()) & mask;
+        while (hdr->hash[n]) {
+            n = (n + 1) & mask;
+        }
+        hdr->hash[n] = i + 1;
+    }
+}
+
+/** Find the value or append the pair with the Nil value */
+static AttributeType &dict_lookup(AttributeType *attr, const char *key,
+                                  AttributeArena *arena) {
+    int idx = attr->dict_find(key);
+    if (idx >= 0) {
+        return attr->u_.dict[idx].value_;
+    }
+    unsigned sz = attr->size_;
+    attr->u_.dict = static_cast<AttributePairType *>(storage_reserve(attr,
+            attr->u_.dict, sz + 1, sizeof(AttributePairType), arena));
+    attr->size_ = sz + 1;
+    key_assign(&attr->u_.dict[sz].key_, key, arena);
+    attr->u_.dict[sz].value_.make_nil();
+    dict_index(attr, sz);
+    return attr->u_.dict[sz].value_;
+}
 
 void AttributeType::allocAttrName(const char *name) {
     size_t len = strlen(name) + 1;
@@ -54,25 +254,42 @@ void AttributeType::freeAttrDescription() {
 }
 
 void AttributeType::attr_free() {
+    bool owned = !(flags_ & (AttrFlag_Arena | AttrFlag_Inline));
     if (size()) {
         if (is_string()) {
-            RISCV_free(u_.string);
+            if (owned) {
+                RISCV_free(u_.string);
+            }
         } else if (is_data() && size() > 8) {
-            RISCV_free(u_.data);
+            if (owned) {
+                RISCV_free(u_.data);
+            }
         } else if (is_list()) {
+            AttributeStorageType *hdr = storage_of(u_.list);
+            AttributeArena *arena = hdr->arena;
             for (unsigned i = 0; i < size(); i++) {
                 u_.list[i].attr_free();
             }
-            RISCV_free(u_.list);
+            if (owned) {
+                RISCV_free(hdr);
+            }
+            delete arena;
         } else if (is_dict()) {
+            AttributeStorageType *hdr = storage_of(u_.dict);
+            AttributeArena *arena = hdr->arena;
             for (unsigned i = 0; i < size(); i++) {
                 u_.dict[i].key_.attr_free();
                 u_.dict[i].value_.attr_free();
             }
-            RISCV_free(u_.dict);
+            RISCV_free(hdr->hash);
+            if (owned) {
+                RISCV_free(hdr);
+            }
+            delete arena;
         }
     }
     kind_ = Attr_Invalid;
+    flags_ = 0;
     size_ = 0;
     u_.integer = 0;
 }
@@ -93,8 +310,9 @@ void AttributeType::clone(const AttributeType *v) {
         make_dict();
         realloc_dict(v->size());
         for (unsigned i = 0; i < v->size(); i++) {
-            u_.dict[i].key_.make_string(v->dict_key(i)->to_string());
+            key_assign(&u_.dict[i].key_, v->dict_key(i)->to_string(), 0);
             u_.dict[i].value_.clone(v->dict_value(i));
+            dict_index(this, i);
         }
     } else {
         this->kind_ = v->kind_;
@@ -142,28 +360,11 @@ AttributeType &AttributeType::operator[](unsigned idx) {
 }
 
 const AttributeType &AttributeType::operator[](const char *key) const {
-    for (unsigned i = 0; i < size(); i++) {
-        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
-            return u_.dict[i].value_;
-        }
-    }
-    AttributeType *pthis = const_cast<AttributeType*>(this);
-    pthis->realloc_dict(size()+1);
-    pthis->u_.dict[size()-1].key_.make_string(key);
-    pthis->u_.dict[size()-1].value_.make_nil();
-    return u_.dict[size()-1].value_;
+    return dict_lookup(const_cast<AttributeType *>(this), key, 0);
 }
 
 AttributeType &AttributeType::operator[](const char *key) {
-    for (unsigned i = 0; i < size(); i++) {
-        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
-            return u_.dict[i].value_;
-        }
-    }
-    realloc_dict(size()+1);
-    u_.dict[size()-1].key_.make_string(key);
-    u_.dict[size()-1].value_.make_nil();
-    return u_.dict[size()-1].value_;
+    return dict_lookup(this, key, 0);
 }
 
 const uint8_t &AttributeType::operator()(unsigned idx) const {
@@ -189,6 +390,10 @@ void AttributeType::make_string(const char *value) {
     }
 }
 
+void AttributeType::make_string(const char *value, unsigned len) {
+    string_assign(this, value, len, 0);
+}
+
 void AttributeType::make_data(unsigned size) {
     attr_free();
     kind_ = Attr_Data;
@@ -218,7 +423,10 @@ void AttributeType::realloc_data(unsigned size) {
         if (size_ > 8) {
             uint8_t *pold = u_.data;
             memcpy(u_.data_bytes, u_.data, size);
-            RISCV_free(pold);
+            if (!(flags_ & AttrFlag_Arena)) {
+                RISCV_free(pold);
+            }
+            flags_ &= ~AttrFlag_Arena;
         }
         size_ = size;
         return;
@@ -230,10 +438,13 @@ void AttributeType::realloc_data(unsigned size) {
     }
     if (sz > 8) {
         memcpy(pnew, u_.data, sz);
-        RISCV_free(u_.data);
+        if (!(flags_ & AttrFlag_Arena)) {
+            RISCV_free(u_.data);
+        }
     } else {
         memcpy(pnew, u_.data_bytes, sz);
     }
+    flags_ &= ~AttrFlag_Arena;
     u_.data = pnew;
     size_ = size;
 }
@@ -252,21 +463,8 @@ void AttributeType::make_list(unsigned size) {
 }
 
 void AttributeType::realloc_list(unsigned size) {
-    size_t req_sz = (size * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                   / MIN_ALLOC_BYTES;
-    size_t cur_sz = (size_ * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    if (req_sz > cur_sz) {
-        AttributeType * t1 = static_cast<AttributeType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * req_sz));
-        memcpy(static_cast<void*>(t1), u_.list, size_ * sizeof(AttributeType));
-        memset(static_cast<void*>(&t1[size_]), 0,
-                (MIN_ALLOC_BYTES * req_sz) - size_ * sizeof(AttributeType));
-        if (size_) {
-            RISCV_free(u_.list);
-        }
-        u_.list = t1;
-    }
+    u_.list = static_cast<AttributeType *>(storage_reserve(this, u_.list,
+                                    size, sizeof(AttributeType), 0));
     size_ = size;
 }
 
@@ -275,23 +473,13 @@ void AttributeType::insert_to_list(unsigned idx, const AttributeType *item) {
         RISCV_printf(NULL, LOG_ERROR, "%s", "Insert index out of bound");
         return;
     }
-    size_t new_sz = ((size_ + 1) * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    AttributeType * t1 = static_cast<AttributeType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * new_sz));
-    memset(static_cast<void*>(t1 + idx), 0,
+    u_.list = static_cast<AttributeType *>(storage_reserve(this, u_.list,
+                                    size_ + 1, sizeof(AttributeType), 0));
+    memmove(static_cast<void*>(&u_.list[idx + 1]), &u_.list[idx],
+            (size_ - idx) * sizeof(AttributeType));
+    memset(static_cast<void*>(&u_.list[idx]), 0,
            sizeof(AttributeType));  // Fix bug request #4
-
-    memcpy(static_cast<void*>(t1), u_.list, idx * sizeof(AttributeType));
-    t1[idx].clone(item);
-    memcpy(static_cast<void*>(&t1[idx + 1]), &u_.list[idx],
-           (size_ - idx) * sizeof(AttributeType));
-    memset(static_cast<void*>(&t1[size_ + 1]), 0,
-           (MIN_ALLOC_BYTES * new_sz) - (size_ + 1) * sizeof(AttributeType));
-    if (size_) {
-        RISCV_free(u_.list);
-    }
-    u_.list = t1;
+    u_.list[idx].clone(item);
     size_++;
 }
 
@@ -323,12 +511,15 @@ void AttributeType::swap_list_item(unsigned n, unsigned m) {
     }
     unsigned tsize = u_.list[n].size_;
     KindType tkind = u_.list[n].kind_;
+    uint8_t tflags = u_.list[n].flags_;
     int64_t tinteger = u_.list[n].u_.integer;
     u_.list[n].size_ = u_.list[m].size_;
     u_.list[n].kind_ = u_.list[m].kind_;
+    u_.list[n].flags_ = u_.list[m].flags_;
     u_.list[n].u_.integer = u_.list[m].u_.integer;
     u_.list[m].size_ = tsize;
     u_.list[m].kind_ = tkind;
+    u_.list[m].flags_ = tflags;
     u_.list[m].u_.integer = tinteger;
 }
 
@@ -425,13 +616,32 @@ void AttributeType::sort(int idx) {
 }
 
 bool AttributeType::has_key(const char *key) const {
-    for (unsigned i = 0; i < size(); i++) {
-        AttributePairType &pair = u_.dict[i];
-        if (pair.key_.is_equal(key) && !pair.value_.is_nil()) {
-            return true;
+    int idx = dict_find(key);
+    return idx >= 0 && !u_.dict[idx].value_.is_nil();
+}
+
+int AttributeType::dict_find(const char *key) const {
+    if (!is_dict() || size_ == 0) {
+        return -1;
+    }
+    AttributeStorageType *hdr = storage_of(u_.dict);
+    if (hdr->hash) {
+        uint32_t mask = hdr->hash_size - 1;
+        for (uint32_t n = key_hash(key) & mask; hdr->hash[n];
+             n = (n + 1) & mask) {
+            unsigned i = hdr->hash[n] - 1;
+            if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    for (unsigned i = 0; i < size_; i++) {
+        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
+            return static_cast<int>(i);
         }
     }
-    return false;
+    return -1;
 }
 
 const AttributeType *AttributeType::dict_key(unsigned idx) const {
@@ -456,22 +666,8 @@ void AttributeType::make_dict() {
 }
 
 void AttributeType::realloc_dict(unsigned size) {
-    size_t req_sz = (size * sizeof(AttributePairType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    size_t cur_sz = (size_ * sizeof(AttributePairType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    if (req_sz > cur_sz) {
-        AttributePairType * t1 = static_cast<AttributePairType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * req_sz));
-        memcpy(static_cast<void*>(t1), u_.dict,
-               size_ * sizeof(AttributePairType));
-        memset(static_cast<void*>(&t1[size_]), 0,
-                (MIN_ALLOC_BYTES * req_sz) - size_ * sizeof(AttributePairType));
-        if (size_) {
-            RISCV_free(u_.dict);
-        }
-        u_.dict = t1;
-    }
+    u_.dict = static_cast<AttributePairType *>(storage_reserve(this, u_.dict,
+                                    size, sizeof(AttributePairType), 0));
     size_ = size;
 }
 
@@ -482,9 +678,23 @@ const AttributeType& AttributeType::to_config() {
     return (*this);
 }
 
+/**
+ * All nodes of the parsed tree are allocated from the arena, it is owned
+ * by the root list or dictionary.
+ */
 void AttributeType::from_config(const char *str) {
     int off = 0;
-    string_to_attribute(str, off, this);
+    AttributeArena *arena = new AttributeArena;
+    string_to_attribute(str, off, this, arena);
+    if ((is_list() || is_dict()) && size_) {
+        storage_of(is_list() ? static_cast<void *>(u_.list)
+                             : static_cast<void *>(u_.dict))->arena = arena;
+    } else {
+        if (is_string() && (flags_ & AttrFlag_Arena)) {
+            string_assign(this, to_string(), size_, 0);
+        }
+        delete arena;
+    }
 }
 
 void attribute_to_string(const AttributeType *attr, AutoBuffer *buf) {
@@ -572,12 +782,11 @@ int skip_special_symbols(const char *cfg, int off) {
     return off;
 }
 
-int string_to_attribute(const char *cfg, int &off,
-                         AttributeType *out) {
+int string_to_attribute(const char *cfg, int &off, AttributeType *out,
+                        AttributeArena *arena) {
     off = skip_special_symbols(cfg, off);
     int checkstart = off;
     if (cfg[off] == '\'' || cfg[off] == '"') {
-        AutoBuffer buf;
         uint8_t t1 = cfg[off];
         int str_sz = 0;
         const char *pcur = &cfg[++off];
@@ -585,8 +794,7 @@ int string_to_attribute(const char *cfg, int &off,
             pcur++;
             str_sz++;
         }
-        buf.write_bin(&cfg[off], str_sz);
-        out->make_string(buf.getBuffer());
+        string_assign(out, &cfg[off], str_sz, arena);
         off += str_sz;
         if (cfg[off] != t1) {
             RISCV_printf(NULL, LOG_ERROR,
@@ -597,16 +805,18 @@ int string_to_attribute(const char *cfg, int &off,
         off = skip_special_symbols(cfg, off + 1);
     } else if (cfg[off] == '[') {
         off = skip_special_symbols(cfg, off + 1);
-        AttributeType new_item;
         out->make_list(0);
         while (cfg[off] != ']' && cfg[off] != '\0') {
-            if (string_to_attribute(cfg, off, &new_item)) {
+            // Item is parsed in place without copying
+            unsigned sz = out->size_;
+            out->u_.list = static_cast<AttributeType *>(storage_reserve(out,
+                    out->u_.list, sz + 1, sizeof(AttributeType), arena));
+            out->size_ = sz + 1;
+            if (string_to_attribute(cfg, off, &out->u_.list[sz], arena)) {
                 /* error handling */
                 out->attr_free();
                 return -1;
             }
-            out->realloc_list(out->size() + 1);
-            (*out)[out->size() - 1] = new_item;
 
             off = skip_special_symbols(cfg, off);
             if (cfg[off] == ',') {
@@ -622,11 +832,10 @@ int string_to_attribute(const char *cfg, int &off,
         off = skip_special_symbols(cfg, off + 1);
     } else if (cfg[off] == '{') {
         AttributeType new_key;
-        AttributeType new_value;
         out->make_dict();
         off = skip_special_symbols(cfg, off + 1);
         while (cfg[off] != '}' && cfg[off] != '\0') {
-            if (string_to_attribute(cfg, off, &new_key)) {
+            if (string_to_attribute(cfg, off, &new_key, 0)) {
                 RISCV_printf(NULL, LOG_ERROR,
                             "JSON parser error: Wrong dictionary key");
                 out->attr_free();
@@ -640,15 +849,22 @@ int string_to_attribute(const char *cfg, int &off,
                 return -1;
             }
             off = skip_special_symbols(cfg, off + 1);
-            if (string_to_attribute(cfg, off, &new_value)) {
+            if (!new_key.is_string()) {
+                RISCV_printf(NULL, LOG_ERROR,
+                            "JSON parser error: Wrong dictionary key");
+                out->attr_free();
+                return -1;
+            }
+            AttributeType &new_value =
+                    dict_lookup(out, new_key.to_string(), arena);
+            new_value.attr_free();
+            if (string_to_attribute(cfg, off, &new_value, arena)) {
                 RISCV_printf(NULL, LOG_ERROR,
                             "JSON parser error: Wrong dictionary value");
                 out->attr_free();
                 return -1;
             }
 
-            (*out)[new_key.to_string()] = new_value;
-
             off = skip_special_symbols(cfg, off);
             if (cfg[off] == ',') {
                 off = skip_special_symbols(cfg, off + 1);
@@ -23,7 +23,7 @@
 
 namespace debugger {
 
-enum KindType {
+enum KindType : uint8_t {
         Attr_Invalid,
         Attr_String,
         Attr_Integer,
@@ -38,11 +38,27 @@ enum KindType {
         Attr_PyObject,
 };
 
+/** Storage flags of the attribute */
+enum AttrFlagType {
+    AttrFlag_Inline = 0x1,  // short dictionary key stored in data_bytes
+    AttrFlag_Arena = 0x2,   // storage is owned by the arena of from_config()
+};
+
 class AttributePairType;
+class AttributeArena;
 
+/**
+ * Lists and dictionaries grow geometrically. Dictionaries larger than
+ * DICT_HASH_THRESHOLD items are searched by the hash index, smaller ones
+ * with the linear scan. Trees built by from_config() allocate child nodes
+ * from the arena released with the root attribute.
+ */
 class AttributeType : public IAttribute {
  public:
+    static const unsigned DICT_HASH_THRESHOLD = 8;
+
     KindType kind_;
+    uint8_t flags_;
     unsigned size_;
     union {
         char *string;
@@ -59,12 +75,15 @@ class AttributeType : public IAttribute {
     } u_;
 
     AttributeType(const AttributeType& other) {
+        kind_ = Attr_Invalid;
+        flags_ = 0;
         size_ = 0;
         clone(&other);
     }
 
     AttributeType() {
         kind_ = Attr_Invalid;
+        flags_ = 0;
         size_ = 0;
         u_.integer = 0;
     }
@@ -81,27 +100,36 @@ class AttributeType : public IAttribute {
     void attr_free();
 
     explicit AttributeType(const char *str) {
+        kind_ = Attr_Invalid;
+        flags_ = 0;
+        size_ = 0;
         make_string(str);
     }
 
     explicit AttributeType(IFace *mod) {
         kind_ = Attr_Interface;
+        flags_ = 0;
+        size_ = 0;
         u_.iface = mod;
     }
 
     explicit AttributeType(KindType type) {
         kind_ = type;
+        flags_ = 0;
         size_ = 0;
         u_.integer = 0;
     }
 
     explicit AttributeType(bool val) {
         kind_ = Attr_Boolean;
+        flags_ = 0;
         size_ = 0;
         u_.boolean = val;
     }
 
     AttributeType(KindType type, uint64_t v) {
+        flags_ = 0;
+        size_ = 0;
         if (type == Attr_Integer) {
             make_int64(static_cast<int64_t>(v));
         } else if (type == Attr_UInteger) {
@@ -158,6 +186,9 @@ class AttributeType : public IAttribute {
     }
 
     const char * to_string() const {
+        if (flags_ & AttrFlag_Inline) {
+            return reinterpret_cast<const char *>(u_.data_bytes);
+        }
         return u_.string;
     }
 
@@ -168,14 +199,14 @@ class AttributeType : public IAttribute {
         if (kind_ != Attr_String) {
             return 0;
         }
-        char *p = u_.string;
+        char *p = const_cast<char *>(to_string());
         while (*p) {
             if (p[0] >= 'a' && p[0] <= 'z') {
                 p[0] = p[0] - 'a' + 'A';
             }
             p++;
         }
-        return u_.string;
+        return to_string();
     }
 
     bool is_list() const {
@@ -250,6 +281,9 @@ class AttributeType : public IAttribute {
 
     void make_string(const char *value);
 
+    /** String slice which isn't terminated by zero */
+    void make_string(const char *value, unsigned len);
+
     void make_data(unsigned size);
 
     void make_data(unsigned size, const void *data);
@@ -288,7 +322,7 @@ class AttributeType : public IAttribute {
 
     int64_t integer() const { return u_.integer; }
 
-    const char *string() const { return u_.string; }
+    const char *string() const { return to_string(); }
 
     bool boolean() const { return u_.boolean; }
 
@@ -303,6 +337,8 @@ class AttributeType : public IAttribute {
     void sort(int idx = 0);
 
     bool has_key(const char *key) const;
+    /** Index of the key or -1 */
+    int dict_find(const char *key) const;
 
     const AttributeType *dict_key(unsigned idx) const;
     AttributeType *dict_key(unsigned idx);
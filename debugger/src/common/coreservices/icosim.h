@@ -0,0 +1,69 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_ICOSIM_H__
+#define __DEBUGGER_COMMON_CORESERVICES_ICOSIM_H__
+
+#include <inttypes.h>
+#include <iface.h>
+#include "generic/trace_bin.h"
+
+namespace debugger {
+
+static const char *const IFACE_COSIMULATION = "ICoSimulation";
+
+/**
+ * Lock-step co-simulation of the functional model with the reference
+ * model (RTL Tracer). Reference retires instructions into the per-hart
+ * queue. Functional model takes the next record before execution, gets
+ * load data from it instead of the system bus and checks own result
+ * after the execution. The first mismatch stops both models.
+ * Asynchronous interrupts are taken by the functional model only at the
+ * instruction where the reference record leaves the sequential flow.
+ */
+class ICoSimulation : public IFace {
+ public:
+    ICoSimulation() : IFace(IFACE_COSIMULATION) {}
+
+    /** Functional model of the hart joins/leaves co-simulation */
+    virtual void attachHart(uint32_t hartid) = 0;
+    virtual void detachHart(uint32_t hartid) = 0;
+
+    /**
+     * Instruction retired by the reference model, blocks while the queue
+     * is full. Returns false if co-simulation was stopped or the
+     * functional model didn't attach in time, and the reference model
+     * should be stopped too.
+     */
+    virtual bool retireReference(uint32_t hartid,
+                                 const TraceBinRecordType *rec) = 0;
+
+    /** Next reference record or 0 if nothing was retired in timeout */
+    virtual const TraceBinRecordType *nextReference(uint32_t hartid,
+                                                    int timeout_ms) = 0;
+
+    /**
+     * Compare the functional model result with the record returned by
+     * nextReference() and remove it from the queue. Returns false on
+     * mismatch.
+     */
+    virtual bool checkRetired(uint32_t hartid,
+                              const TraceBinRecordType *rec) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_ICOSIM_H__
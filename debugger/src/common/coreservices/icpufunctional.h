@@ -81,6 +81,12 @@ class ICpuFunctional : public IFace {
     virtual void halt(uint32_t cause, const char *descr) = 0;
     virtual void flush(uint64_t addr) = 0;
     virtual void doNotCache(uint64_t addr) = 0;
+    /**
+     * Translation of the debugger request address in the current address
+     * space of the instruction fetch. No TLB, page table or counters are
+     * modified.
+     */
+    virtual bool translateDebug(uint64_t vaddr, uint64_t *paddr) = 0;
 
   protected:
     virtual uint64_t getResetAddress() = 0;
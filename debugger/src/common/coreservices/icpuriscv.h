@@ -134,6 +134,20 @@ public:
     static const uint64_t PRV_M       = 3;
     /// @}
 
+    /**
+     * @name Sv39/Sv48 page table entry flags:
+     */
+    /// @{
+    static const uint64_t PTE_V       = 1ull << 0;
+    static const uint64_t PTE_R       = 1ull << 1;
+    static const uint64_t PTE_W       = 1ull << 2;
+    static const uint64_t PTE_X       = 1ull << 3;
+    static const uint64_t PTE_U       = 1ull << 4;
+    static const uint64_t PTE_G       = 1ull << 5;
+    static const uint64_t PTE_A       = 1ull << 6;
+    static const uint64_t PTE_D       = 1ull << 7;
+    /// @}
+
     enum EExceptions {
         // Instruction address misaligned
         EXCEPTION_InstrMisalign,
@@ -180,6 +194,21 @@ public:
         INTERRUPT_XExternal,
         INTERRUPT_Total
     };
+
+    /** Performance monitor events selected by mhpmevent, same as in RTL */
+    enum EHpmEvents {
+        HpmEvent_None,
+        HpmEvent_ICacheMiss,
+        HpmEvent_DCacheMiss,
+        HpmEvent_BranchMispredict,
+        HpmEvent_Load,
+        HpmEvent_Store,
+        HpmEvent_Stall,
+        HpmEvent_TlbMiss,
+        HpmEvent_Exception,
+        HpmEvent_Interrupt,
+        HpmEvent_Total
+    };
     /** Exceptions */
     enum ESignals {
         SIGNAL_Exception = 0,
@@ -216,11 +245,34 @@ public:
     static const uint16_t CSR_mie            = 0x304;
     /** The base address of the M-mode trap vector. */
     static const uint16_t CSR_mtvec          = 0x305;
+    /** Counters readable from S-mode (and U-mode if scounteren allows) */
+    static const uint16_t CSR_mcounteren     = 0x306;
     /** Scratch register for machine trap handlers. */
     static const uint16_t CSR_mscratch       = 0x340;
+    /** Machine counter-inhibit register */
+    static const uint16_t CSR_mcountinhibit  = 0x320;
+    /** Machine performance-monitoring event selectors 3..31 */
+    static const uint16_t CSR_mhpmevent3     = 0x323;
+    static const uint16_t CSR_mhpmevent31    = 0x33F;
+    /** Supervisor status, restricted view of mstatus */
+    static const uint16_t CSR_sstatus        = 0x100;
+    /** Supervisor interrupt enable, delegated bits of mie */
+    static const uint16_t CSR_sie            = 0x104;
+    /** The base address of the S-mode trap vector. */
+    static const uint16_t CSR_stvec          = 0x105;
+    /** Counters readable from U-mode */
+    static const uint16_t CSR_scounteren     = 0x106;
+    /** Scratch register for supervisor trap handlers. */
+    static const uint16_t CSR_sscratch       = 0x140;
     /** Exception program counters. */
     static const uint16_t CSR_uepc           = 0x041;
     static const uint16_t CSR_sepc           = 0x141;
+    /** Supervisor trap cause */
+    static const uint16_t CSR_scause         = 0x142;
+    /** Supervisor bad address or instruction. */
+    static const uint16_t CSR_stval          = 0x143;
+    /** Supervisor interrupt pending, delegated bits of mip */
+    static const uint16_t CSR_sip            = 0x144;
     /** Supervisor Address Translation and Protection */
     static const uint16_t CSR_satp           = 0x180;
     static const uint16_t CSR_hepc           = 0x241;
@@ -266,6 +318,9 @@ public:
     static const uint16_t CSR_mcycle         = 0xB00;
     /** Machine Instructions-retired counter */
     static const uint16_t CSR_minsret        = 0xB02;
+    /** Machine performance-monitoring counters 3..31 */
+    static const uint16_t CSR_mhpmcounter3   = 0xB03;
+    static const uint16_t CSR_mhpmcounter31  = 0xB1F;
 
     // Non-standard machine mode CSR
     /** Stack overflow. */
@@ -285,7 +340,9 @@ public:
     static const uint16_t CSR_time           = 0xC01;
     /** User Instructions-retired counter for RDINSTRET pseudo-instruction */
     static const uint16_t CSR_insret         = 0xC02;
-    /** 0xC00 to 0xC1F reserved for counters */
+    /** User read-only shadows of the mhpmcounter3..31 */
+    static const uint16_t CSR_hpmcounter3    = 0xC03;
+    static const uint16_t CSR_hpmcounter31   = 0xC1F;
     /** Vendor ID. */
     static const uint16_t CSR_mvendorid         = 0xf11;
     /** Architecture ID. */
@@ -17,18 +17,51 @@
 #ifndef __DEBUGGER_COMMON_CORESERVICES_IDPI_H__
 #define __DEBUGGER_COMMON_CORESERVICES_IDPI_H__
 
+#include <inttypes.h>
 #include <iface.h>
 
 namespace debugger {
 
 static const char *IFACE_DPI = "IDpi";
 
+/**
+ * Binary frame of the batched mode. JSON messages start with '[' so the
+ * both formats can be mixed in one TCP stream. Little-endian fields,
+ * write request and read response are followed by 'beats' 64-bits words.
+ * Writes are posted: simulator answers only on error.
+ */
+static const uint8_t DPI_BIN_MAGIC = 0xA5;
+static const int DPI_BURST_BEATS_MAX = 32;
+
+enum EDpiBinaryCmd {
+    DpiCmd_Write,
+    DpiCmd_Read,
+    DpiCmd_ReadResp,
+    DpiCmd_Error
+};
+
+#pragma pack(1)
+struct DpiPacketHeaderType {
+    uint8_t magic;
+    uint8_t cmd;        // EDpiBinaryCmd
+    uint8_t bytes;      // bytes in beat: 1..8
+    uint8_t beats;      // 1..DPI_BURST_BEATS_MAX
+    uint32_t seqid;     // transaction ID
+    uint64_t addr;
+};
+#pragma pack()
+
 class IDpi : public IFace {
  public:
     IDpi() : IFace(IFACE_DPI) {}
 
     virtual void axi4_write(uint64_t addr, int bytes, uint64_t data) = 0;
     virtual void axi4_read(uint64_t addr, int bytes, uint64_t *data) = 0;
+    /** Read and compare with the expected value, report mismatch */
+    virtual void axi4_compare(uint64_t addr, int bytes,
+                              uint64_t expected) = 0;
+    /** Send posted transactions and wait responses on all reads */
+    virtual void axi4_flush() = 0;
     virtual bool is_irq() = 0;
     virtual int get_irq() = 0;
 };
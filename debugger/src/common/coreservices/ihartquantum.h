@@ -0,0 +1,68 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_IHARTQUANTUM_H__
+#define __DEBUGGER_COMMON_CORESERVICES_IHARTQUANTUM_H__
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_HART_QUANTUM = "IHartQuantum";
+
+/**
+ * Synchronization of the harts running in own threads. Each hart executes
+ * the quantum of instructions freely and then waits all others on barrier.
+ * Running harts are the barrier members, halted harts must leave it.
+ */
+class IHartQuantum : public IFace {
+ public:
+    IHartQuantum() : IFace(IFACE_HART_QUANTUM) {}
+
+    /** Quantum length in steps */
+    virtual uint64_t getQuantumSteps() = 0;
+
+    /** Allocate the hart slot, returns -1 if all slots are busy */
+    virtual int registerHart(IFace *icpu) = 0;
+
+    /** Barrier membership */
+    virtual void attachHart(int slot) = 0;
+    virtual void detachHart(int slot) = 0;
+
+    /** Quantum end: returns barrier generation to wait */
+    virtual uint64_t arrive(int slot) = 0;
+    virtual bool isReleased(uint64_t generation) = 0;
+
+    /** LR/SC reservation visible to all harts (physical address) */
+    virtual void reserveAddress(int slot, uint64_t paddr) = 0;
+    virtual bool releaseAddress(int slot) = 0;
+
+    /** Store from the hart breaks reservations of the others */
+    virtual void storeNotify(int slot, uint64_t paddr, uint32_t sz) = 0;
+
+    /**
+     * AMO read-modify-write and SC check-and-store of all harts are
+     * serialized by the lock of the reservation set. Lock is selected by
+     * the page offset bits, so the virtual address may be used.
+     */
+    virtual void lockReservation(uint64_t addr) = 0;
+    virtual void unlockReservation(uint64_t addr) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_IHARTQUANTUM_H__
@@ -44,6 +44,64 @@ class IJtagTap : public IFace {
     virtual void resetTAP(char trst, char srst) = 0;
     virtual void setPins(char tck, char tms, char tdi) = 0;
     virtual bool getTDO() = 0;
+
+    /**
+     * Execute a run of remote_bitbang symbols '0'..'7' and 'R'. Sampled
+     * TDO values are written into tdo[] as '0'/'1' characters.
+     * @return Number of written TDO symbols.
+     * Pin-accurate implementation is used by default, functional TAP may
+     * override it to shift the whole bit sequence at once.
+     */
+    virtual int bitbang(const char *cmd, int cnt, char *tdo) {
+        int tsz = 0;
+        for (int i = 0; i < cnt; i++) {
+            if (cmd[i] == 'R') {
+                tdo[tsz++] = getTDO() ? '1' : '0';
+            } else {
+                int pins = cmd[i] - '0';
+                setPins((pins >> 2) & 0x1, (pins >> 1) & 0x1, pins & 0x1);
+            }
+        }
+        return tsz;
+    }
+
+    /**
+     * Full IR or DR scan of 'len' bits (1..64) starting and finishing
+     * in the Run-Test/Idle state.
+     * @return Captured TDO vector, LSB is shifted out first.
+     */
+    virtual uint64_t scanIR(uint64_t tdi, int len) {
+        clockTMS(1);
+        clockTMS(1);
+        return scanBits(tdi, len);
+    }
+
+    virtual uint64_t scanDR(uint64_t tdi, int len) {
+        clockTMS(1);
+        return scanBits(tdi, len);
+    }
+
+ protected:
+    void clockTMS(char tms, char tdi = 0) {
+        setPins(0, tms, tdi);
+        setPins(1, tms, tdi);
+    }
+
+    uint64_t scanBits(uint64_t tdi, int len) {
+        uint64_t tdo = 0;
+        clockTMS(0);                        // capture
+        clockTMS(0);                        // shift
+        for (int i = 0; i < len; i++) {
+            char tms = i == (len - 1) ? 1 : 0;
+            char bit = static_cast<char>((tdi >> i) & 0x1);
+            setPins(0, tms, bit);
+            tdo |= static_cast<uint64_t>(getTDO()) << i;
+            setPins(1, tms, bit);
+        }
+        clockTMS(1);                        // update
+        clockTMS(0);                        // idle
+        return tdo;
+    }
 };
 
 }  // namespace debugger
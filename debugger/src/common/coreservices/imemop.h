@@ -27,6 +27,7 @@ class IService;
 static const char *const IFACE_MEMORY_OPERATION = "IMemoryOperation";
 static const char *const IFACE_AXI4_NB_RESPONSE = "IAxi4NbResponse";
 static const char *const IFACE_ADDRESS_TRANSLATOR = "IAddressTranslator";
+static const char *const IFACE_DIRECT_MEM_INVALIDATE = "IDirectMemInvalidate";
 
 static const int PAYLOAD_MAX_BYTES = 8;
 
@@ -72,6 +73,42 @@ class IAxi4NbResponse : public IFace {
     virtual void nb_response(Axi4TransactionType *trans) = 0;
 };
 
+/**
+ * Direct memory region granted by a target device
+ */
+typedef struct DirectMemRegionType {
+    uint64_t addr;              // bus address of the first byte
+    uint64_t length;            // region size in bytes
+    uint8_t *ptr;               // host pointer of the first byte
+    bool rdena;                 // plain read access allowed
+    bool wrena;                 // plain write access allowed
+} DirectMemRegionType;
+
+/**
+ * Initiator/Master interface to revoke previously granted direct memory pointers
+ */
+class IDirectMemInvalidate : public IFace {
+ public:
+    IDirectMemInvalidate() : IFace(IFACE_DIRECT_MEM_INVALIDATE) {}
+
+    /** Pointers to the range [start, end] must not be used anymore */
+    virtual void invalidate_direct_mem_ptr(uint64_t start, uint64_t end) = 0;
+
+    /**
+     * Range [start, end] was written through the bus by the master
+     * 'source_idx'. Initiators caching decoded instructions drop them.
+     */
+    virtual void write_notify(int source_idx, uint64_t start, uint64_t end) {}
+
+    /**
+     * Accesses through the granted pointers bypass the bus. Holder adds
+     * its reads and writes of the master 'source_idx' to the counters, so
+     * that they are included into the bus utilization.
+     */
+    virtual void direct_mem_counters(int source_idx, uint64_t *rcnt,
+                                     uint64_t *wcnt) {}
+};
+
 /**
  * Slave/Targer interface
  */
@@ -113,6 +150,32 @@ class IMemoryOperation : public IFace {
         return ret;
     }
 
+    /**
+     * Direct memory pointer
+     *
+     * Request host pointer to the region containing trans->addr for the
+     * master trans->source_idx. Initiator may use the pointer instead of
+     * b_transport() until invalidate_direct_mem_ptr() is called on 'cb'.
+     * Default implementation doesn't grant access.
+     */
+    virtual bool get_direct_mem_ptr(Axi4TransactionType *trans,
+                                    DirectMemRegionType *region,
+                                    IDirectMemInvalidate *cb) {
+        return false;
+    }
+
+    /**
+     * Call write_notify() of 'cb' on every write transaction passed
+     * through this device. Default implementation doesn't notify.
+     */
+    virtual void register_write_notify(IDirectMemInvalidate *cb) {}
+
+    /**
+     * Device handles transactions of several threads itself (plain memory),
+     * otherwise the bus serializes accesses to it.
+     */
+    virtual bool isThreadSafe() { return false; }
+
     virtual uint64_t getBaseAddress() { return baseAddress_.to_uint64(); }
     virtual void setBaseAddress(uint64_t addr) {
         baseAddress_.make_uint64(addr);
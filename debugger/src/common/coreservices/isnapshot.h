@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
+#define __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
+
+#include <inttypes.h>
+#include <iface.h>
+#include <atomic>
+
+namespace debugger {
+
+/**
+ * Pages of the memory image written since the image was saved into or
+ * restored from the snapshot getSnapshotId(). Owner of the image marks
+ * pages on every write path. Pages that aren't marked are equal to that
+ * snapshot and aren't compared when it is the base of the next one.
+ */
+class SnapshotWriteTracker {
+ public:
+    static const uint64_t PAGE_SIZE = 4096;
+
+    SnapshotWriteTracker() : pages_(0), written_(0), snapshotId_(0) {}
+    ~SnapshotWriteTracker() {
+        delete [] written_;
+    }
+
+    void init(uint64_t sz) {
+        delete [] written_;
+        pages_ = (sz + PAGE_SIZE - 1) / PAGE_SIZE;
+        written_ = new std::atomic<uint8_t>[pages_ + 1];
+        reset(0);
+    }
+
+    /** Zero means that the image isn't tracked yet */
+    uint64_t getSnapshotId() const { return snapshotId_; }
+
+    void setWritten(uint64_t off, uint64_t sz) {
+        uint64_t last = (off + sz - 1) / PAGE_SIZE;
+        for (uint64_t i = off / PAGE_SIZE; i <= last && i < pages_; i++) {
+            if (!written_[i].load(std::memory_order_relaxed)) {
+                written_[i].store(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool isWritten(uint64_t pageidx) const {
+        return pageidx >= pages_
+            || written_[pageidx].load(std::memory_order_relaxed) != 0;
+    }
+
+    /** Image is equal to the snapshot 'id' now */
+    void reset(uint64_t id) {
+        for (uint64_t i = 0; i < pages_; i++) {
+            written_[i].store(0, std::memory_order_relaxed);
+        }
+        snapshotId_ = id;
+    }
+
+ private:
+    uint64_t pages_;
+    std::atomic<uint8_t> *written_;
+    uint64_t snapshotId_;
+};
+
+/**
+ * Section of the snapshot file that belongs to one service or port.
+ * Data is read back in the same order as it was written.
+ */
+class ISnapshotStream {
+ public:
+    virtual void write(const void *buf, uint64_t sz) = 0;
+    /** Returns false when the section is shorter than requested */
+    virtual bool read(void *buf, uint64_t sz) = 0;
+
+    /** Unique identifier of the snapshot being saved or restored */
+    virtual uint64_t getSnapshotId() = 0;
+
+    /**
+     * Memory image is stored page by page: only pages that differ from
+     * the base snapshot (or from zeros without base) go into the file.
+     * Pages not written since the base, according to the optional
+     * tracker, aren't compared.
+     */
+    virtual void writeImage(const uint8_t *mem, uint64_t sz,
+                            const SnapshotWriteTracker *tracker) = 0;
+    virtual bool readImage(uint8_t *mem, uint64_t sz) = 0;
+    /**
+     * Same as readImage() for the region allocated by RISCV_memory_reserve():
+     * pages are mapped from the snapshot file copy-on-write, so simulators
+     * restored from one snapshot share its clean pages.
+     */
+    virtual bool mapImage(uint8_t *mem, uint64_t sz) = 0;
+
+    void writeUInt64(uint64_t v) { write(&v, sizeof(v)); }
+    uint64_t readUInt64() {
+        uint64_t v = 0;
+        read(&v, sizeof(v));
+        return v;
+    }
+};
+
+static const char *const IFACE_SNAPSHOT = "ISnapshot";
+
+/**
+ * State of the service or its registers port. The simulation is halted
+ * while the snapshot is saved or restored.
+ */
+class ISnapshot : public IFace {
+ public:
+    ISnapshot() : IFace(IFACE_SNAPSHOT) {}
+
+    virtual void saveSnapshot(ISnapshotStream *s) = 0;
+    /** Returns false when the stored state doesn't fit configuration */
+    virtual bool restoreSnapshot(ISnapshotStream *s) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
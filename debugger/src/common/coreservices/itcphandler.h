@@ -0,0 +1,59 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_ITCPHANDLER_H__
+#define __DEBUGGER_COMMON_CORESERVICES_ITCPHANDLER_H__
+
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_TCP_HANDLER = "ITcpHandler";
+
+/**
+ * Transmit side of the connection owned by the TCP server. Data is queued
+ * without blocking, so the methods may be called from any thread.
+ */
+class ITcpConnection {
+ public:
+    virtual void sendData(const char *buf, int sz) = 0;
+    virtual void closeConnection() = 0;
+    /** Client closed its side or the connection is closing */
+    virtual bool isPeerClosed() = 0;
+    /**
+     * Remove the out-of-band byte (GDB interrupt) from the received data
+     * while the handler is busy with the previous request.
+     */
+    virtual bool takeByte(char c) = 0;
+};
+
+/**
+ * Protocol handler of the connection served by the TCP server event loop.
+ * Received data is passed by the worker thread, only one call per
+ * connection at a time.
+ */
+class ITcpHandler : public IFace {
+ public:
+    ITcpHandler() : IFace(IFACE_TCP_HANDLER) {}
+
+    /** Connection is detached (0) before the handler is deleted */
+    virtual void attachConnection(ITcpConnection *conn) = 0;
+    virtual void processData(const char *buf, int sz) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_ITCPHANDLER_H__
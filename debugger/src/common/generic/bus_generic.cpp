@@ -17,44 +17,106 @@
 #include <api_core.h>
 #include "bus_generic.h"
 #include "debug/dsumap.h"
+#include <algorithm>
 
 namespace debugger {
 
+BusUtilRegBank::BusUtilRegBank(BusGeneric *parent, const char *name,
+                               uint64_t addr, int len)
+    : GenericReg64Bank(static_cast<IService *>(parent), name, addr, len) {
+    bus_ = 0;       // list of the direct pointers holders isn't created yet
+    reset();
+    bus_ = parent;
+}
+
+void BusUtilRegBank::reset() {
+    GenericReg64Bank::reset();
+    for (int i = 0; i < 2*MASTERS_MAX; i++) {
+        write(i, 0);
+    }
+}
+
+Reg64Type BusUtilRegBank::read(int idx) {
+    Reg64Type ret;
+    int mst = idx >> 1;
+    uint64_t rcnt = 0;
+    uint64_t wcnt = 0;
+    ret.val = 0;
+    if (mst < MASTERS_MAX) {
+        if (bus_) {
+            bus_->directMemCounters(mst, &rcnt, &wcnt);
+        }
+        if (idx & 0x1) {
+            ret.val = cnt_[mst].r_cnt.load(std::memory_order_relaxed) + rcnt;
+        } else {
+            ret.val = cnt_[mst].w_cnt.load(std::memory_order_relaxed) + wcnt;
+        }
+    }
+    regs_[idx] = ret;
+    return ret;
+}
+
+/** Direct accesses can't be cleared, the bus counter compensates them */
+void BusUtilRegBank::write(int idx, uint64_t val) {
+    int mst = idx >> 1;
+    uint64_t rcnt = 0;
+    uint64_t wcnt = 0;
+    regs_[idx].val = val;
+    if (mst < MASTERS_MAX) {
+        if (bus_) {
+            bus_->directMemCounters(mst, &rcnt, &wcnt);
+        }
+        if (idx & 0x1) {
+            cnt_[mst].r_cnt.store(val - rcnt, std::memory_order_relaxed);
+        } else {
+            cnt_[mst].w_cnt.store(val - wcnt, std::memory_order_relaxed);
+        }
+    }
+}
+
 BusGeneric::BusGeneric(const char *name) : IService(name),
     IHap(HAP_ConfigDone),
-    busUtil_(static_cast<IService *>(this), "bus_util",
+    busUtil_(this, "bus_util",
             DSUREG(ulocal.v.bus_util[0]),
             sizeof(DsuMapType::local_regs_type::\
                    local_region_type::mst_bus_util_type)) {
     registerInterface(static_cast<IMemoryOperation *>(this));
     registerAttribute("AddrWidth", &addrWidth_);
-    RISCV_mutex_init(&mutexBAccess_);
-    RISCV_mutex_init(&mutexNBAccess_);
+    RISCV_mutex_init(&mutexMap_);
+    RISCV_mutex_init(&mutexDevice_);
     RISCV_register_hap(static_cast<IHap *>(this));
     busUtil_.setPriority(10);     // Overmap DSU registers
-    imaphash_ = 0;
+    dmemHolders_.make_list(0);
+    map_.store(0);
+    listeners_.store(0);
 
-    memset(imemtbl_, 0, sizeof(imemtbl_));
-    for (int i = 0; i < HASH_TBL_SIZE; i++) {
-        imemtbl_[i].devlist.make_list(0);
-    }
     addrWidth_.make_int64(39);      // 39-bits address width for FU740
 }
 
 BusGeneric::~BusGeneric() {
-    RISCV_mutex_destroy(&mutexBAccess_);
-    RISCV_mutex_destroy(&mutexNBAccess_);
-    if (imaphash_) {
-        delete [] imaphash_;
+    RISCV_mutex_destroy(&mutexMap_);
+    RISCV_mutex_destroy(&mutexDevice_);
+    ListenerListType *l = listeners_.load();
+    while (l) {
+        ListenerListType *retired = l->retired;
+        delete [] l->cb;
+        delete l;
+        l = retired;
+    }
+    MapType *m = map_.load();
+    while (m) {
+        MapType *retired = m->retired;
+        if (m->seg) {
+            delete [] m->seg;
+        }
+        delete m;
+        m = retired;
     }
 }
 
 void BusGeneric::postinitService() {
     ADDR_MASK_ = (1ull << addrWidth_.to_int()) - 1;
-    HASH_MASK_ = (1ull << HASH_ADDR_WIDTH) - 1;
-
     HASH_LVL1_OFFSET_ = addrWidth_.to_int() - HASH_ADDR_WIDTH;
-    HASH_LVL2_OFFSET_ = addrWidth_.to_int() - 2*HASH_ADDR_WIDTH;
 
     IMemoryOperation *imem;
     for (unsigned i = 0; i < listMap_.size(); i++) {
@@ -89,57 +151,54 @@ void BusGeneric::postinitService() {
 void BusGeneric::hapTriggered(EHapType type,
                               uint64_t param,
                               const char *descr) {
-    RISCV_mutex_lock(&mutexNBAccess_);
-    RISCV_mutex_lock(&mutexBAccess_);
+    RISCV_mutex_lock(&mutexMap_);
     maphash();
-    RISCV_mutex_unlock(&mutexBAccess_);
-    RISCV_mutex_unlock(&mutexNBAccess_);
+    invalidateDirectMem();
+    RISCV_mutex_unlock(&mutexMap_);
 }
 
+/**
+ * Map lookup is lock-free, devices not declared thread-safe are accessed
+ * under the common lock as with the single bus mutex before.
+ */
 ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
     ETransStatus ret = TRANS_OK;
-    uint32_t sz;
-    IMemoryOperation *memdev = 0;
+    const MapSegmentType *seg = getMapedSegment(trans->addr);
 
-    RISCV_mutex_lock(&mutexBAccess_);
-
-    getMapedDevice(trans, &memdev, &sz);
-
-    if (memdev == 0) {
+    if (seg == 0) {
         RISCV_error("Blocking request to unmapped address "
                     "%08" RV_PRI64 "x", trans->addr);
         memset(trans->rpayload.b8, 0xFF, trans->xsize);
         ret = TRANS_ERROR;
     } else {
-        memdev->b_transport(trans);
+        if (seg->serialize) {
+            RISCV_mutex_lock(&mutexDevice_);
+        }
+        seg->idev->b_transport(trans);
+        if (seg->serialize) {
+            RISCV_mutex_unlock(&mutexDevice_);
+        }
         RISCV_debug("[%08" RV_PRI64 "x] => [%08x %08x]",
             trans->addr,
             trans->rpayload.b32[1], trans->rpayload.b32[0]);
     }
 
-    // Update Bus utilization counters:
-    if (trans->source_idx >= 0 && trans->source_idx < 8) {
-        if (trans->action == MemAction_Read) {
-            busUtil_.getpR64()[2*trans->source_idx + 1]++;
-        } else if (trans->action == MemAction_Write) {
-            busUtil_.getpR64()[2*trans->source_idx]++;
-        }
+    const ListenerListType *l = listeners_.load(std::memory_order_acquire);
+    if (trans->action == MemAction_Write && l) {
+        writeNotify(l, trans);
     }
-    RISCV_mutex_unlock(&mutexBAccess_);
+
+    // Update Bus utilization counters:
+    busUtil_.incrementCounter(trans->source_idx, trans->action);
     return ret;
 }
 
 ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
                                IAxi4NbResponse *cb) {
     ETransStatus ret = TRANS_OK;
-    IMemoryOperation *memdev = 0;
-    uint32_t sz;
-
-    RISCV_mutex_lock(&mutexNBAccess_);
+    const MapSegmentType *seg = getMapedSegment(trans->addr);
 
-    getMapedDevice(trans, &memdev, &sz);
-
-    if (memdev == 0) {
+    if (seg == 0) {
         RISCV_error("Non-blocking request from %d to unmapped address "
                     "%08" RV_PRI64 "x", trans->source_idx, trans->addr);
         memset(trans->rpayload.b8, 0xFF, trans->xsize);
@@ -147,72 +206,229 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
         cb->nb_response(trans);
         ret = TRANS_ERROR;
     } else {
-        memdev->nb_transport(trans, cb);
+        if (seg->serialize) {
+            RISCV_mutex_lock(&mutexDevice_);
+        }
+        seg->idev->nb_transport(trans, cb);
+        if (seg->serialize) {
+            RISCV_mutex_unlock(&mutexDevice_);
+        }
         RISCV_debug("Non-blocking request to [%08" RV_PRI64 "x]",
                     trans->addr);
     }
 
+    const ListenerListType *l = listeners_.load(std::memory_order_acquire);
+    if (trans->action == MemAction_Write && l) {
+        writeNotify(l, trans);
+    }
+
     // Update Bus utilization counters:
-    if (trans->source_idx >= 0 && trans->source_idx < 8) {
-        if (trans->action == MemAction_Read) {
-            busUtil_.getpR64()[2*trans->source_idx + 1]++;
-        } else if (trans->action == MemAction_Write) {
-            busUtil_.getpR64()[2*trans->source_idx]++;
+    busUtil_.incrementCounter(trans->source_idx, trans->action);
+    return ret;
+}
+
+/**
+ * Granted region is limited by the map segment, so it never intersects
+ * any other device.
+ */
+bool BusGeneric::get_direct_mem_ptr(Axi4TransactionType *trans,
+                                    DirectMemRegionType *region,
+                                    IDirectMemInvalidate *cb) {
+    const MapSegmentType *seg = getMapedSegment(trans->addr);
+    uint64_t start, end;
+
+    if (seg == 0 || !seg->idev->get_direct_mem_ptr(trans, region, cb)) {
+        return false;
+    }
+
+    // Intersection with the device memory range:
+    start = seg->start;
+    end = seg->end;
+    if (start < region->addr) {
+        start = region->addr;
+    }
+    if (end > region->addr + region->length - 1) {
+        end = region->addr + region->length - 1;
+    }
+    region->ptr += start - region->addr;
+    region->addr = start;
+    region->length = end - start + 1;
+
+    RISCV_mutex_lock(&mutexMap_);
+    bool registered = false;
+    for (unsigned i = 0; i < dmemHolders_.size(); i++) {
+        if (dmemHolders_[i].to_iface() == cb) {
+            registered = true;
+            break;
         }
     }
-    RISCV_mutex_unlock(&mutexNBAccess_);
-    return ret;
+    if (!registered) {
+        AttributeType t1(cb);
+        dmemHolders_.add_to_list(&t1);
+    }
+    RISCV_mutex_unlock(&mutexMap_);
+    return true;
 }
 
-void BusGeneric::getMapedDevice(Axi4TransactionType *trans,
-                         IMemoryOperation **pdev, uint32_t *sz) {
-    IMemoryOperation *imem;
-    uint64_t bar, barsz;
-    *pdev = 0;
-    *sz = 0;
-
-    uint64_t hashidx = (trans->addr & ADDR_MASK_) >> HASH_LVL1_OFFSET_;
-    HashTableItemType &item = imemtbl_[hashidx];
-    if (item.idev) {
-        *pdev = item.idev;
-    } else if (item.nxtlvlena) {
-        for (unsigned i = 0; i < item.devlist.size(); i++) {
-            imem = static_cast<IMemoryOperation *>(item.devlist[i].to_iface());
-            bar = imem->getBaseAddress();
-            barsz = imem->getLength();
-            if (bar <= trans->addr && trans->addr < (bar + barsz)) {
-                if (!(*pdev) || imem->getPriority() > (*pdev)->getPriority()) {
-                    *pdev = imem;
-                }
-            }
+/**
+ * Listeners list is copied with the new item and published, transport
+ * path reads it without locking. Previous versions are released in
+ * destructor.
+ */
+void BusGeneric::register_write_notify(IDirectMemInvalidate *cb) {
+    RISCV_mutex_lock(&mutexMap_);
+    ListenerListType *prev = listeners_.load(std::memory_order_relaxed);
+    ListenerListType *l = new ListenerListType;
+    l->total = prev ? prev->total + 1 : 1;
+    l->cb = new IDirectMemInvalidate *[l->total];
+    for (unsigned i = 0; i + 1 < l->total; i++) {
+        l->cb[i] = prev->cb[i];
+    }
+    l->cb[l->total - 1] = cb;
+    l->retired = prev;
+    listeners_.store(l, std::memory_order_release);
+    RISCV_mutex_unlock(&mutexMap_);
+}
+
+void BusGeneric::writeNotify(const ListenerListType *l,
+                             Axi4TransactionType *trans) {
+    for (unsigned i = 0; i < l->total; i++) {
+        l->cb[i]->write_notify(trans->source_idx, trans->addr,
+                               trans->addr + trans->xsize - 1);
+    }
+}
+
+void BusGeneric::directMemCounters(int mst, uint64_t *rcnt, uint64_t *wcnt) {
+    RISCV_mutex_lock(&mutexMap_);
+    for (unsigned i = 0; i < dmemHolders_.size(); i++) {
+        IDirectMemInvalidate *cb =
+            static_cast<IDirectMemInvalidate *>(dmemHolders_[i].to_iface());
+        cb->direct_mem_counters(mst, rcnt, wcnt);
+    }
+    RISCV_mutex_unlock(&mutexMap_);
+}
+
+/** Memory map was changed: revoke all granted pointers */
+void BusGeneric::invalidateDirectMem() {
+    for (unsigned i = 0; i < dmemHolders_.size(); i++) {
+        IDirectMemInvalidate *cb =
+            static_cast<IDirectMemInvalidate *>(dmemHolders_[i].to_iface());
+        cb->invalidate_direct_mem_ptr(0, ~0ull);
+    }
+}
+
+/**
+ * Lock-free lookup: hash item selects the segments crossing it, most of
+ * items contain at most one segment, otherwise binary search is used.
+ */
+const BusGeneric::MapSegmentType *
+BusGeneric::getMapedSegment(uint64_t addr) {
+    const MapType *m = map_.load(std::memory_order_acquire);
+    if (m == 0) {
+        return 0;
+    }
+    addr &= ADDR_MASK_;
+    const MapType::HashItemType &item = m->tbl[addr >> HASH_LVL1_OFFSET_];
+    const MapSegmentType *seg = &m->seg[item.first];
+    uint32_t cnt = item.cnt;
+    while (cnt > 1) {
+        uint32_t half = cnt >> 1;
+        if (seg[half].start <= addr) {
+            seg += half;
+            cnt -= half;
+        } else {
+            cnt = half;
         }
     }
+    if (cnt == 0 || addr < seg->start || addr > seg->end) {
+        return 0;
+    }
+    return seg;
 }
 
+/**
+ * Build new map from the list of mapped devices and publish it. Device
+ * with the highest priority (or the first in the list) owns each address.
+ */
 void BusGeneric::maphash() {
     IMemoryOperation *imem;
-    uint64_t first, last;
-    uint64_t bar;
-    for (unsigned i = 0; i < imap_.size(); i++) {
+    unsigned devtotal = imap_.size();
+    uint64_t *bound = new uint64_t[2*devtotal + 1];
+    unsigned boundtotal = 0;
+    uint64_t bar, last;
+
+    for (unsigned i = 0; i < devtotal; i++) {
         imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
-        bar = imem->getBaseAddress();
-        first = (bar >> HASH_LVL1_OFFSET_) & HASH_MASK_;
-        last = ((bar + imem->getLength()) >> HASH_LVL1_OFFSET_) & HASH_MASK_;
+        if (imem->getLength() == 0) {
+            continue;
+        }
+        bar = imem->getBaseAddress() & ADDR_MASK_;
+        last = bar + imem->getLength() - 1;
+        if (last > ADDR_MASK_ || last < bar) {
+            last = ADDR_MASK_;
+        }
+        bound[boundtotal++] = bar;
+        if (last != ADDR_MASK_) {
+            bound[boundtotal++] = last + 1;
+        }
+    }
+    std::sort(bound, bound + boundtotal);
+    boundtotal = static_cast<unsigned>(
+        std::unique(bound, bound + boundtotal) - bound);
+
+    MapType *m = new MapType;
+    memset(m->tbl, 0, sizeof(m->tbl));
+    m->seg = new MapSegmentType[boundtotal + 1];
+    m->segtotal = 0;
+    for (unsigned n = 0; n < boundtotal; n++) {
+        uint64_t start = bound[n];
+        uint64_t end = n + 1 < boundtotal ? bound[n + 1] - 1 : ADDR_MASK_;
+        IMemoryOperation *pdev = 0;
+        for (unsigned i = 0; i < devtotal; i++) {
+            imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
+            if (imem->getLength() == 0) {
+                continue;
+            }
+            bar = imem->getBaseAddress() & ADDR_MASK_;
+            last = bar + imem->getLength() - 1;
+            if (last > ADDR_MASK_ || last < bar) {
+                last = ADDR_MASK_;
+            }
+            if (bar <= start && end <= last) {
+                if (!pdev || imem->getPriority() > pdev->getPriority()) {
+                    pdev = imem;
+                }
+            }
+        }
+        if (pdev == 0) {
+            continue;
+        }
+        MapSegmentType *prev = m->segtotal ? &m->seg[m->segtotal - 1] : 0;
+        if (prev && prev->idev == pdev && prev->end + 1 == start) {
+            prev->end = end;
+            continue;
+        }
+        m->seg[m->segtotal].start = start;
+        m->seg[m->segtotal].end = end;
+        m->seg[m->segtotal].idev = pdev;
+        m->seg[m->segtotal].serialize = !pdev->isThreadSafe();
+        m->segtotal++;
+    }
+    delete [] bound;
 
+    for (uint32_t i = 0; i < m->segtotal; i++) {
+        uint64_t first = m->seg[i].start >> HASH_LVL1_OFFSET_;
+        last = m->seg[i].end >> HASH_LVL1_OFFSET_;
         for (uint64_t n = first; n <= last; n++) {
-            HashTableItemType &item = imemtbl_[n];
-            if (!item.nxtlvlena && !item.idev) {
-                item.idev = imem;
-            } else if (item.idev) {
-                item.nxtlvlena = true;
-                item.devlist.new_list_item().make_iface(item.idev);
-                item.devlist.new_list_item().make_iface(imem);
-                item.idev = 0;
-            } else {
-                item.devlist.new_list_item().make_iface(imem);
+            if (m->tbl[n].cnt == 0) {
+                m->tbl[n].first = i;
             }
+            m->tbl[n].cnt++;
         }
     }
+
+    m->retired = map_.load(std::memory_order_relaxed);
+    map_.store(m, std::memory_order_release);
 }
 
 }  // namespace debugger
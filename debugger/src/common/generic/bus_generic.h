@@ -22,9 +22,51 @@
 #include <ihap.h>
 #include "coreservices/imemop.h"
 #include "generic/mapreg.h"
+#include <atomic>
 
 namespace debugger {
 
+class BusGeneric;
+
+/**
+ * Bus utilization registers. Every master owns its own pair of counters
+ * (placed into separate cache lines) that are incremented without locking,
+ * register bank read gathers the current values together with accesses
+ * done through the direct memory pointers.
+ */
+class BusUtilRegBank : public GenericReg64Bank {
+ public:
+    BusUtilRegBank(BusGeneric *parent, const char *name,
+                   uint64_t addr, int len);
+
+    /** GenericReg64Bank methods */
+    virtual void reset();
+    virtual Reg64Type read(int idx);
+    virtual void write(int idx, Reg64Type val) { write(idx, val.val); }
+    virtual void write(int idx, uint64_t val);
+
+    /** Relaxed increment, called from the bus transport methods */
+    void incrementCounter(int mst, EAxi4Action action) {
+        if (mst < 0 || mst >= MASTERS_MAX) {
+            return;
+        }
+        if (action == MemAction_Read) {
+            cnt_[mst].r_cnt.fetch_add(1, std::memory_order_relaxed);
+        } else if (action == MemAction_Write) {
+            cnt_[mst].w_cnt.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+ protected:
+    static const int MASTERS_MAX = 8;
+    struct MasterCounterType {
+        std::atomic<uint64_t> w_cnt;
+        std::atomic<uint64_t> r_cnt;
+        uint8_t rsrv[64 - 2*sizeof(uint64_t)];
+    } cnt_[MASTERS_MAX];
+    BusGeneric *bus_;
+};
+
 class BusGeneric : public IService,
                    public IMemoryOperation,
                    public IHap {
@@ -39,40 +81,76 @@ class BusGeneric : public IService,
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
     virtual ETransStatus nb_transport(Axi4TransactionType *trans,
                                       IAxi4NbResponse *cb);
+    virtual bool get_direct_mem_ptr(Axi4TransactionType *trans,
+                                    DirectMemRegionType *region,
+                                    IDirectMemInvalidate *cb);
+    virtual void register_write_notify(IDirectMemInvalidate *cb);
+
+    /** Accesses of the master done without the bus */
+    void directMemCounters(int mst, uint64_t *rcnt, uint64_t *wcnt);
 
     /** IHap */
     virtual void hapTriggered(EHapType type, uint64_t param,
                               const char *descr);
 
  protected:
+    static const int HASH_ADDR_WIDTH = 14;
+    static const int HASH_TBL_SIZE = 1 << HASH_ADDR_WIDTH;
+
+    /** Address range [start, end] owned by a single device */
+    struct MapSegmentType {
+        uint64_t start;
+        uint64_t end;
+        IMemoryOperation *idev;
+        bool serialize;         // device isn't thread-safe
+    };
+
+    /**
+     * Immutable address map. Overlapped devices are resolved by priority
+     * when the map is built so that segments never intersect and sorted
+     * by address. Hash table item points to the segments crossing it.
+     */
+    struct MapType {
+        MapSegmentType *seg;
+        uint32_t segtotal;
+        struct HashItemType {
+            uint32_t first;
+            uint32_t cnt;
+        } tbl[HASH_TBL_SIZE];
+        MapType *retired;       // previous map version
+    };
+
+    /** Write listeners, replaced as a whole the same way as the map */
+    struct ListenerListType {
+        unsigned total;
+        IDirectMemInvalidate **cb;
+        ListenerListType *retired;
+    };
+
     /** Speed-optimized mapping */
     virtual void maphash();
-    void getMapedDevice(Axi4TransactionType *trans,
-                        IMemoryOperation **pdev, uint32_t *sz);
+    const MapSegmentType *getMapedSegment(uint64_t addr);
+    void invalidateDirectMem();
+    void writeNotify(const ListenerListType *l, Axi4TransactionType *trans);
 
  protected:
-    static const int HASH_ADDR_WIDTH = 14;
-    static const int HASH_TBL_SIZE = 1 << HASH_ADDR_WIDTH;
     AttributeType addrWidth_;       // address bits (39 bits for FU740). [63:39] must be equal to [38]
-    mutex_def mutexBAccess_;
-    mutex_def mutexNBAccess_;
-    Axi4TransactionType b_tr_;
-    Axi4TransactionType nb_tr_;
+    mutex_def mutexMap_;            // map rebuild and direct pointers holders
+    mutex_def mutexDevice_;         // accesses to not thread-safe devices
 
-    GenericReg64Bank busUtil_;    // per master read/write access statistic
-    IMemoryOperation **imaphash_;
+    BusUtilRegBank busUtil_;    // per master read/write access statistic
+    AttributeType dmemHolders_;    // masters with granted direct pointers
 
-    struct HashTableItemType {
-        bool nxtlvlena;
-        IMemoryOperation *idev;
-        HashTableItemType *tbl;
-        AttributeType devlist;
-    } imemtbl_[HASH_TBL_SIZE];
+    /**
+     * Published map is only read on the transport path. The map is replaced
+     * as a whole and previous versions are released in destructor, so that
+     * a master still using an old pointer never touches released memory.
+     */
+    std::atomic<MapType *> map_;
+    std::atomic<ListenerListType *> listeners_;  // notified about bus writes
 
     uint64_t ADDR_MASK_;
-    uint64_t HASH_MASK_;
     uint64_t HASH_LVL1_OFFSET_;
-    uint64_t HASH_LVL2_OFFSET_;
 };
 
 DECLARE_CLASS(BusGeneric)
@@ -25,7 +25,8 @@ CpuGeneric::CpuGeneric(const char *name)
     portCSR_(this,  "csr",  0,     1<<12),
     portRegs_(this, "regs", 1<<12, 0x1000),
     stackTraceCnt_(this, "stack_trace_cnt", 0),
-    stackTraceBuf_(this, "stack_trace_buf", 0, 0) {
+    stackTraceBuf_(this, "stack_trace_buf", 0, 0),
+    quantumEvent_(this) {
     registerInterface(static_cast<IThread *>(this));
     registerInterface(static_cast<IClock *>(this));
     registerInterface(static_cast<ICpuFunctional *>(this));
@@ -33,6 +34,7 @@ CpuGeneric::CpuGeneric(const char *name)
     registerInterface(static_cast<IPower *>(this));
     registerInterface(static_cast<IResetListener *>(this));
     registerInterface(static_cast<IHap *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("SysBus", &sysBus_);
     registerAttribute("SysBusWidthBytes", &sysBusWidthBytes_);
@@ -42,6 +44,7 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("StackTraceSize", &stackTraceSize_);
     registerAttribute("FreqHz", &freqHz_);
     registerAttribute("GenerateTraceFile", &generateTraceFile_);
+    registerAttribute("TraceFormat", &traceFormat_);
     registerAttribute("ResetVector", &resetVector_);
     registerAttribute("SysBusMasterID", &sysBusMasterID_);
     registerAttribute("CacheBaseAddress", &cacheBaseAddr_);
@@ -50,11 +53,16 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("TriggersTotal", &triggersTotal_);
     registerAttribute("McontrolMaskmax", &mcontrolMaskmax_);
     registerAttribute("ResetState", &resetState_);
+    registerAttribute("BasicBlockCache", &basicBlockCache_);
+    registerAttribute("DirectMemPtr", &directMemPtr_);
+    registerAttribute("HartQuantum", &hartQuantum_);
+    registerAttribute("CoSimulation", &coSimulation_);
 
     char tstr[256];
     RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
     RISCV_event_create(&eventConfigDone_, tstr);
     RISCV_mutex_init(&mutex_csr_);
+    RISCV_mutex_init(&mutexWrNotify_);
     RISCV_register_hap(static_cast<IHap *>(this));
 
     isysbus_ = 0;
@@ -71,6 +79,9 @@ CpuGeneric::CpuGeneric(const char *name)
 
     ptriggers_ = 0;
     trace_file_ = 0;
+    trace_bin_ = 0;
+    trace_ena_ = false;
+    traceFormat_.make_string("text");
     memset(&trace_data_, 0, sizeof(trace_data_));
     icache_ = 0;
     memcache_sz_ = 0;
@@ -80,6 +91,29 @@ CpuGeneric::CpuGeneric(const char *name)
     CACHE_BASE_ADDR_ = 0;
     CACHE_MASK_ = 0;
     oplen_ = 0;
+    bblocks_ = 0;
+    bblockMask_ = 0;
+    bblockExit_ = false;
+    memset(bblockPageTag_, 0xFF, sizeof(bblockPageTag_));
+    memset(bblockPageGen_, 0, sizeof(bblockPageGen_));
+    wrNotifyPending_.store(false);
+    wrNotifyStart_ = ~0ull;
+    wrNotifyEnd_ = 0;
+    directMemPtr_.make_boolean(true);
+    memset(dmem_, 0xFF, sizeof(dmem_));
+    dmemEnabled_ = false;
+    dmemRdCnt_.store(0);
+    dmemWrCnt_.store(0);
+    hartQuantum_.make_string("");
+    iquantum_ = 0;
+    quantumSlot_ = -1;
+    quantumAttached_ = false;
+    memop_paddr_ = 0;
+    coSimulation_.make_string("");
+    icosim_ = 0;
+    cosimRef_ = 0;
+    cosimFeed_ = false;
+    cosimUsed_ = 0;
     RISCV_set_default_clock(static_cast<IClock *>(this));
 
     R = portRegs_.getpR64();
@@ -93,16 +127,24 @@ CpuGeneric::~CpuGeneric() {
     RISCV_set_default_clock(0);
     RISCV_event_close(&eventConfigDone_);
     RISCV_mutex_destroy(&mutex_csr_);
+    RISCV_mutex_destroy(&mutexWrNotify_);
     if (icache_) {
         delete [] icache_;
     }
     if (ptriggers_) {
         delete [] ptriggers_;
     }
+    if (bblocks_) {
+        delete [] bblocks_;
+    }
     if (trace_file_) {
         trace_file_->close();
         delete trace_file_;
     }
+    if (trace_bin_) {
+        trace_bin_->close();
+        delete trace_bin_;
+    }
 }
 
 void CpuGeneric::postinitService() {
@@ -147,6 +189,36 @@ void CpuGeneric::postinitService() {
         return;
     }
 
+    dmemEnabled_ = directMemPtr_.to_bool();
+
+    if (hartQuantum_.size()) {
+        iquantum_ = static_cast<IHartQuantum *>(
+            RISCV_get_service_iface(hartQuantum_.to_string(),
+                                    IFACE_HART_QUANTUM));
+        if (!iquantum_) {
+            RISCV_error("IHartQuantum interface '%s' not found",
+                        hartQuantum_.to_string());
+        } else {
+            quantumSlot_ = iquantum_->registerHart(
+                                static_cast<IService *>(this));
+            if (quantumSlot_ < 0) {
+                RISCV_error("No free slots in '%s'",
+                            hartQuantum_.to_string());
+                iquantum_ = 0;
+            }
+        }
+    }
+
+    if (coSimulation_.size()) {
+        icosim_ = static_cast<ICoSimulation *>(
+            RISCV_get_service_iface(coSimulation_.to_string(),
+                                    IFACE_COSIMULATION));
+        if (!icosim_) {
+            RISCV_error("ICoSimulation interface '%s' not found",
+                        coSimulation_.to_string());
+        }
+    }
+
     stackTraceBuf_.setRegTotal(2 * stackTraceSize_.to_int());
 
     ptriggers_ = new TriggerStorageType[triggersTotal_.to_int()];
@@ -160,6 +232,26 @@ void CpuGeneric::postinitService() {
         memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
     }
 
+    if (basicBlockCache_.is_integer() && basicBlockCache_.to_int() > 0) {
+        // Round up to the power of 2 to use the address bits as an index
+        unsigned bbtotal = 1;
+        while (bbtotal < basicBlockCache_.to_uint32()) {
+            bbtotal <<= 1;
+        }
+        bblockMask_ = bbtotal - 1;
+        bblocks_ = new BasicBlockType[bbtotal];
+        for (unsigned i = 0; i < bbtotal; i++) {
+            bblocks_[i].addr = ~0ull;
+            bblocks_[i].size = 0;
+        }
+    }
+
+    if (icache_ || bblocks_) {
+        // Code loaded by debugger or DMA while running
+        isysbus_->register_write_notify(
+            static_cast<IDirectMemInvalidate *>(this));
+    }
+
     // Get global settings:
     const AttributeType *glb = RISCV_get_global_settings();
     if ((*glb)["SimEnable"].to_bool() && isEnable_.to_bool()) {
@@ -167,9 +259,20 @@ void CpuGeneric::postinitService() {
             RISCV_error("Can't create thread.", NULL);
             return;
         }
-        if (generateTraceFile_.is_string() && generateTraceFile_.size()) {
+        if (!generateTraceFile_.is_string() || !generateTraceFile_.size()) {
+            // trace disabled
+        } else if (traceFormat_.is_equal("binary")) {
+            trace_bin_ = new TraceBinWriter();
+            if (!trace_bin_->open(generateTraceFile_.to_string())) {
+                RISCV_error("Can't open trace file %s",
+                            generateTraceFile_.to_string());
+                delete trace_bin_;
+                trace_bin_ = 0;
+            }
+        } else {
             trace_file_ = new std::ofstream(generateTraceFile_.to_string());
         }
+        trace_ena_ = trace_file_ != 0 || trace_bin_ != 0 || icosim_ != 0;
     }
 
     setPC(getResetAddress());
@@ -185,10 +288,25 @@ void CpuGeneric::hapTriggered(EHapType type,
 
 void CpuGeneric::busyLoop() {
     RISCV_event_wait(&eventConfigDone_);
+    if (icosim_) {
+        // Reference model runs from reset without debugger
+        icosim_->attachHart(getHartId());
+        estate_ = CORE_Normal;
+    }
 
     while (isEnabled()) {
+        if (iquantum_) {
+            updateQuantumMember();
+        }
         updatePipeline();
     }
+    if (quantumAttached_) {
+        quantumAttached_ = false;
+        iquantum_->detachHart(quantumSlot_);
+    }
+    if (icosim_) {
+        icosim_->detachHart(getHartId());
+    }
 }
 
 void CpuGeneric::updatePipeline() {
@@ -196,13 +314,37 @@ void CpuGeneric::updatePipeline() {
         return;
     }
 
+    if (wrNotifyPending_.load(std::memory_order_acquire)) {
+        applyWriteNotify();
+    }
+
+    if (icosim_ && estate_ == CORE_Normal) {
+        cosimRef_ = icosim_->nextReference(getHartId(), 10);
+        if (!cosimRef_) {
+            // Reference model hasn't retired the instruction yet
+            step_cnt_--;
+            return;
+        }
+        if (cosimRef_->pc != getNPC() && isInterruptPending()) {
+            // Reference entered the interrupt handler before this instruction
+            handleInterrupts();
+        }
+    }
+
+    if (bblocks_ && isBlockExecEnabled() && executeBasicBlock()) {
+        return;
+    }
+
     setPC(getNPC());
     branch_ = false;
     oplen_ = 0;
 
     if (!isTriggerInstruction()) {
         fetchILine();
-        instr_ = decodeInstruction(cacheline_);
+        if (!instr_) {
+            // Not found in the decoded instructions cache
+            instr_ = decodeInstruction(cacheline_);
+        }
 
         trackContextStart();
         if (instr_) {
@@ -223,8 +365,8 @@ void CpuGeneric::updatePipeline() {
 
     handleTrap();
 
-    if (trace_file_) {
-        traceOutput();
+    if (trace_ena_) {
+        traceInstruction();
     }
 }
 
@@ -268,10 +410,195 @@ bool CpuGeneric::updateState() {
     return upd;
 }
 
+/**
+ * Basic blocks are used only in the normal run mode without the coverage
+ * tracker, co-simulation, stepping or armed triggers. These features require checks
+ * after each instruction.
+ */
+bool CpuGeneric::isBlockExecEnabled() {
+    return estate_ == CORE_Normal
+        && icovtracker_ == 0
+        && icosim_ == 0
+        && !haltreq_
+        && !isStepEnabled()
+        && !isTriggerArmed();
+}
+
+/**
+ * Execute cached basic block starting from the next instruction pointer.
+ * The first step was already counted by updateState(). Block is left on
+ * taken branch, exception, flush request or when the clock queue has the
+ * pending event. When stack protection or interrupts are armed the block
+ * is also left after the instruction that raised them, so traps are taken
+ * at the same instruction as in the step-by-step mode. Return false if
+ * the block cannot be translated, so the instruction is executed as usual.
+ */
+bool CpuGeneric::executeBasicBlock() {
+    uint64_t addr;
+    if (!translateFetch(getNPC(), &addr)) {
+        return false;
+    }
+    BasicBlockType *bb = &bblocks_[(addr >> 1) & bblockMask_];
+    unsigned pgidx = pageIndex(addr);
+    if (bb->addr != addr
+        || bb->gen != bblockPageGen_[pgidx]
+        || bblockPageTag_[pgidx] != (addr >> BBLOCK_PAGE_SHIFT)) {
+        translateBasicBlock(bb, addr);
+        if (bb->size == 0) {
+            return false;
+        }
+    }
+
+    BasicBlockInstrType *p = bb->ilist;
+    bool trapcheck = isTrapCheckRequired();
+    bblockExit_ = false;
+    for (int i = 0; i < bb->size; i++, p++) {
+        if (i != 0) {
+            step_cnt_++;
+        }
+        setPC(getNPC());
+        branch_ = false;
+        cacheline_[0] = p->payload;     // halt message compatibility
+        if (trace_ena_) {
+            trackContextStart();
+        }
+        oplen_ = p->instr->exec(&p->payload);
+        pc_z_ = getPC();
+        if (!branch_) {
+            setNPC(getPC() + oplen_);
+        }
+        if (trapcheck) {
+            checkStackProtection();
+        }
+        if (branch_ || exceptions_ || bblockExit_
+            || step_cnt_ >= queue_.getNextTime()
+            || i == bb->size - 1
+            || (trapcheck && isInterruptPending())) {
+            break;
+        }
+        if (trace_ena_) {
+            traceInstruction();
+        }
+    }
+    do_not_cache_ = false;
+
+    updateQueue();
+
+    handleTrap();
+
+    // The last instruction is traced after trap as in the step mode
+    if (trace_ena_) {
+        traceInstruction();
+    }
+    return true;
+}
+
+void CpuGeneric::translateBasicBlock(BasicBlockType *bb, uint64_t addr) {
+    Axi4TransactionType tr;
+    GenericInstruction *instr;
+    BasicBlockInstrType *p;
+    uint64_t page = addr >> BBLOCK_PAGE_SHIFT;
+    unsigned pgidx = pageIndex(addr);
+
+    if (bblockPageTag_[pgidx] != page) {
+        // Page slot is re-used: discard blocks of the previous page
+        bblockPageTag_[pgidx] = page;
+        bblockPageGen_[pgidx]++;
+    }
+    bb->addr = addr;
+    bb->gen = bblockPageGen_[pgidx];
+    bb->size = 0;
+
+    tr.action = MemAction_Read;
+    tr.xsize = 4;
+    tr.wstrb = 0;
+    while (bb->size < BBLOCK_INSTR_MAX
+        && (addr >> BBLOCK_PAGE_SHIFT) == page) {
+        tr.addr = addr;
+        if (CpuGeneric::dma_memop(&tr) == TRANS_ERROR) {
+            break;
+        }
+        p = &bb->ilist[bb->size];
+        p->payload.val = tr.rpayload.b64[0];
+        if (((addr + instructionLength(&p->payload) - 1)
+                >> BBLOCK_PAGE_SHIFT) != page) {
+            // Next virtual page could be mapped anywhere
+            break;
+        }
+        instr = decodeInstruction(&p->payload);
+        if (instr == 0) {
+            break;
+        }
+        p->instr = instr;
+        bb->size++;
+        if (isBlockTerminator(&p->payload)) {
+            break;
+        }
+        // Instruction length depends only on the opcode
+        addr += instructionLength(&p->payload);
+    }
+}
+
+void CpuGeneric::invalidateBlockPage(uint64_t addr) {
+    unsigned pgidx = pageIndex(addr);
+    if (bblockPageTag_[pgidx] == (addr >> BBLOCK_PAGE_SHIFT)) {
+        bblockPageTag_[pgidx] = ~0ull;
+        bblockPageGen_[pgidx]++;
+        bblockExit_ = true;
+    }
+}
+
+void CpuGeneric::invalidateBlockPages() {
+    for (int i = 0; i < BBLOCK_PAGE_TOTAL; i++) {
+        bblockPageTag_[i] = ~0ull;
+        bblockPageGen_[i]++;
+    }
+    bblockExit_ = true;
+}
+
+/**
+ * Only running hart takes part in the barrier, otherwise halted by
+ * debugger hart would stop all others.
+ */
+void CpuGeneric::updateQuantumMember() {
+    bool run = estate_ == CORE_Normal;
+    if (run == quantumAttached_) {
+        return;
+    }
+    quantumAttached_ = run;
+    if (run) {
+        iquantum_->attachHart(quantumSlot_);
+        moveStepCallback(&quantumEvent_,
+                         step_cnt_ + iquantum_->getQuantumSteps());
+    } else {
+        iquantum_->detachHart(quantumSlot_);
+    }
+}
+
+/**
+ * Harts drift is limited by one quantum: shared peripherals driven by a
+ * single clock and interrupts requested by other harts are observed at
+ * least at the quantum boundary.
+ */
+void CpuGeneric::quantumBoundary(uint64_t t) {
+    if (quantumAttached_) {
+        uint64_t gen = iquantum_->arrive(quantumSlot_);
+        int spin = 0;
+        while (!iquantum_->isReleased(gen) && isEnabled()) {
+            if (++spin > QUANTUM_SPIN_MAX) {
+                RISCV_sleep_ms(0);
+            }
+        }
+    }
+    registerStepCallback(&quantumEvent_, t + iquantum_->getQuantumSteps());
+}
+
 void CpuGeneric::updateQueue() {
     IFace *cb;
+    if (step_cnt_ < queue_.getNextTime()) {
+        return;
+    }
     queue_.initProc();
-    queue_.pushPreQueued();
 
     while ((cb = queue_.getNext(step_cnt_)) != 0) {
         static_cast<IClockListener *>(cb)->stepCallback(step_cnt_);
@@ -290,9 +617,11 @@ void CpuGeneric::fetchILine() {
         return;
     }
 
-    if ((fetch_addr_ & CACHE_MASK_) == CACHE_BASE_ADDR_) {
+    uint64_t paddr;
+    if (translateFetch(fetch_addr_, &paddr)
+        && (paddr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
         cachable_pc_ = true;
-        cache_offset_ = fetch_addr_ - CACHE_BASE_ADDR_;
+        cache_offset_ = paddr - CACHE_BASE_ADDR_;
         instr_ = icache_[cache_offset_].instr;
         cacheline_[0].buf32[0] = icache_[cache_offset_].buf;  // for tracer
     }
@@ -303,7 +632,7 @@ void CpuGeneric::fetchILine() {
         trans_.addr = getPC();
         trans_.xsize = 4;
         trans_.wstrb = 0;
-        if (dma_memop(&trans_) == TRANS_ERROR) {
+        if (ifetch_memop(&trans_) == TRANS_ERROR) {
             generateExceptionLoadInstruction(trans_.addr);
             handleTrap();
             setPC(getNPC());
@@ -325,12 +654,28 @@ void CpuGeneric::handleTrap() {
         }
         exceptions_ &= ~(1ull << e);
         handleException(e);
-    } else {
+    } else if (icosim_ == 0) {
+        // Co-simulation takes interrupts where the reference model did
         handleInterrupts();
     }
 }
 
+/**
+ * Breakpoints and CSR flushi give the virtual address, decoded instructions
+ * are tagged by the physical one. Unmapped address flushes everything.
+ */
 void CpuGeneric::flush(uint64_t addr) {
+    uint64_t paddr;
+    if (addr != ~0ull) {
+        addr = translateDebug(addr, &paddr) ? paddr : ~0ull;
+    }
+    if (bblocks_) {
+        if (addr == ~0ull) {
+            invalidateBlockPages();
+        } else {
+            invalidateBlockPage(addr);
+        }
+    }
     if (icache_ == 0) {
         return;
     }
@@ -344,14 +689,38 @@ void CpuGeneric::flush(uint64_t addr) {
     }
 }
 
+/**
+ * Flash programming or self-modifying code: discard decoded instructions
+ * that overlap written bytes, instruction may start up to 3 bytes before.
+ */
+void CpuGeneric::invalidateICache(uint64_t addr, unsigned sz) {
+    uint64_t start = addr >= 3 ? addr - 3 : 0;
+    uint64_t end = addr + sz;
+    if (end <= CACHE_BASE_ADDR_
+        || start >= CACHE_BASE_ADDR_ + static_cast<uint64_t>(memcache_sz_)) {
+        return;
+    }
+    if (start < CACHE_BASE_ADDR_) {
+        start = CACHE_BASE_ADDR_;
+    }
+    if (end > CACHE_BASE_ADDR_ + static_cast<uint64_t>(memcache_sz_)) {
+        end = CACHE_BASE_ADDR_ + static_cast<uint64_t>(memcache_sz_);
+    }
+    for (uint64_t a = start; a < end; a++) {
+        icache_[a - CACHE_BASE_ADDR_].instr = 0;
+    }
+}
+
 void CpuGeneric::trackContextStart() {
-    if (!trace_file_) {
+    if (!trace_ena_) {
         return;
     }
     trace_data_.action_cnt = 0;
     trace_data_.step_cnt = step_cnt_;
     trace_data_.pc = getPC();
     trace_data_.instr = cacheline_[0].buf32[0];
+    cosimFeed_ = cosimRef_ != 0;
+    cosimUsed_ = 0;
 }
 
 void CpuGeneric::trackContextEnd() {
@@ -382,6 +751,25 @@ void CpuGeneric::traceRegister(int idx, uint64_t v) {
     p->wdata = v;
 }
 
+void CpuGeneric::traceBinOutput() {
+    Reg64Type payload;
+    payload.val = trace_data_.instr;
+    trace_bin_->beginRecord(trace_data_.step_cnt,
+                            trace_data_.pc,
+                            trace_data_.instr,
+                            instructionLength(&payload),
+                            trace_data_.action_cnt);
+    for (int i = 0; i < trace_data_.action_cnt; i++) {
+        trace_action_type *pa = &trace_data_.action[i];
+        if (!pa->memop) {
+            trace_bin_->putRegister(pa->waddr, pa->wdata);
+        } else {
+            trace_bin_->putMemop(pa->memop_addr, pa->memop_write != 0,
+                                 pa->memop_data.val, pa->memop_size);
+        }
+    }
+}
+
 void CpuGeneric::traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz) {
     if (trace_data_.action_cnt >= 64) {
         return;
@@ -394,6 +782,65 @@ void CpuGeneric::traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz) {
     p->memop_size = sz;
 }
 
+/**
+ * Memory access of the co-simulated instruction: load returns data seen
+ * by the reference model, store was already done by it on the shared
+ * system bus. Unmatched access goes to the bus and fails the check.
+ */
+bool CpuGeneric::cosimMemop(Axi4TransactionType *tr) {
+    bool we = tr->action == MemAction_Write;
+    for (int i = 0; i < cosimRef_->action_cnt; i++) {
+        const TraceBinRecordType::ActionType *pa = &cosimRef_->action[i];
+        if (!pa->memop || pa->write != we || pa->addr != tr->addr
+            || (cosimUsed_ & (1ull << i))) {
+            continue;
+        }
+        cosimUsed_ |= 1ull << i;
+        if (!we) {
+            tr->rpayload.b64[0] = 0;
+            memcpy(tr->rpayload.b8, &pa->data,
+                   tr->xsize < sizeof(pa->data) ? tr->xsize
+                                                : sizeof(pa->data));
+        }
+        return true;
+    }
+    return false;
+}
+
+void CpuGeneric::cosimCheck() {
+    TraceBinRecordType rec;
+    Reg64Type payload;
+    if (!cosimFeed_) {
+        // Instruction wasn't executed, keep reference for the next step
+        return;
+    }
+    cosimFeed_ = false;
+    cosimRef_ = 0;
+
+    payload.val = trace_data_.instr;
+    rec.step_cnt = trace_data_.step_cnt;
+    rec.pc = trace_data_.pc;
+    rec.instr = trace_data_.instr;
+    rec.isize = instructionLength(&payload);
+    rec.action_cnt = trace_data_.action_cnt;
+    for (int i = 0; i < trace_data_.action_cnt; i++) {
+        trace_action_type *pa = &trace_data_.action[i];
+        rec.action[i].memop = pa->memop;
+        rec.action[i].write = pa->memop_write != 0;
+        rec.action[i].waddr = pa->waddr;
+        if (pa->memop) {
+            rec.action[i].addr = pa->memop_addr;
+            rec.action[i].data = pa->memop_data.val;
+            rec.action[i].size = pa->memop_size;
+        } else {
+            rec.action[i].data = pa->wdata;
+        }
+    }
+    if (!icosim_->checkRetired(getHartId(), &rec)) {
+        halt(HALT_CAUSE_HALTREQ, "Co-simulation mismatch");
+    }
+}
+
 void CpuGeneric::registerStepCallback(IClockListener *cb,
                                                uint64_t t) {
     if (!isEnabled() && t <= step_cnt_) {
@@ -413,7 +860,7 @@ bool CpuGeneric::moveStepCallback(IClockListener *cb, uint64_t t) {
 
 void CpuGeneric::setReg(int idx, uint64_t val) {
     R[idx] = val;
-    if (trace_file_) {
+    if (trace_ena_) {
         traceRegister(idx, val);
     }
 }
@@ -443,7 +890,12 @@ void CpuGeneric::popStackTrace() {
 ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
     ETransStatus ret = TRANS_OK;
     tr->source_idx = sysBusMasterID_.to_int();
-    if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
+    memop_paddr_ = tr->addr;
+    if (cosimFeed_ && cosimMemop(tr)) {
+        // Reference model has already done this access
+    } else if (dmemEnabled_ && directMemAccess(tr)) {
+        // Plain memory access without the system bus
+    } else if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
         ret = isysbus_->b_transport(tr);
     } else {
         // 1-byte access for HC08
@@ -463,7 +915,21 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
         }
     }
 
-    if (trace_file_) {
+    if (bblocks_ && tr->action == MemAction_Write) {
+        // Self-modifying code: discard translated blocks of the page
+        invalidateBlockPage(tr->addr);
+        invalidateBlockPage(tr->addr + tr->xsize - 1);
+    }
+
+    if (icache_ && tr->action == MemAction_Write) {
+        invalidateICache(tr->addr, tr->xsize);
+    }
+
+    if (iquantum_ && tr->action == MemAction_Write) {
+        iquantum_->storeNotify(quantumSlot_, tr->addr, tr->xsize);
+    }
+
+    if (trace_ena_) {
         int we = tr->action == MemAction_Write ? 1 : 0;
         Reg64Type memop_data;
         memop_data.val = 0;
@@ -477,10 +943,256 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
     return ret;
 }
 
+bool CpuGeneric::directMemAccess(Axi4TransactionType *tr) {
+    uint64_t off = tr->addr & ((1ull << DMEM_PAGE_SHIFT) - 1);
+    if (off + tr->xsize > (1ull << DMEM_PAGE_SHIFT)) {
+        return false;
+    }
+    DirectMemPageType *p =
+        &dmem_[(tr->addr >> DMEM_PAGE_SHIFT) & (DMEM_PAGE_TOTAL - 1)];
+    if (p->tag != (tr->addr >> DMEM_PAGE_SHIFT)) {
+        requestDirectMem(tr->addr, MemAction_Read, p);
+    }
+
+    if (tr->action == MemAction_Read) {
+        if (!p->rdptr) {
+            return false;
+        }
+        tr->rpayload.b64[0] = 0;
+        memcpy(tr->rpayload.b8, &p->rdptr[off], tr->xsize);
+        dmemRdCnt_.store(dmemRdCnt_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    } else {
+        if (!p->wrptr && p->rdptr) {
+            // Memory may grant writes separately to track written pages
+            requestDirectMem(tr->addr, MemAction_Write, p);
+        }
+        if (!p->wrptr) {
+            return false;
+        }
+        if (((1ul << tr->xsize) - 1) == tr->wstrb) {
+            memcpy(&p->wrptr[off], tr->wpayload.b8, tr->xsize);
+        } else {
+            for (uint32_t i = 0; i < tr->xsize; i++) {
+                if ((tr->wstrb >> i) & 0x1) {
+                    p->wrptr[off + i] = tr->wpayload.b8[i];
+                }
+            }
+        }
+        dmemWrCnt_.store(dmemWrCnt_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    }
+    tr->response = MemResp_Valid;
+    return true;
+}
+
+void CpuGeneric::requestDirectMem(uint64_t addr, EAxi4Action action,
+                                  DirectMemPageType *p) {
+    Axi4TransactionType tr;
+    DirectMemRegionType region;
+    uint64_t page = addr & ~((1ull << DMEM_PAGE_SHIFT) - 1);
+    uint64_t page_end = page + (1ull << DMEM_PAGE_SHIFT) - 1;
+
+    p->tag = addr >> DMEM_PAGE_SHIFT;
+    p->rdptr = 0;
+    p->wrptr = 0;
+
+    memset(&tr, 0, sizeof(tr));
+    tr.action = action;
+    tr.addr = page;
+    tr.xsize = 4;
+    tr.source_idx = sysBusMasterID_.to_int();
+    if (!isysbus_->get_direct_mem_ptr(&tr, &region,
+                                      static_cast<IDirectMemInvalidate *>(this))
+        || page < region.addr
+        || page_end > region.addr + region.length - 1) {
+        return;
+    }
+    uint8_t *ptr = region.ptr + (page - region.addr);
+    if (region.rdena) {
+        p->rdptr = ptr;
+    }
+    if (region.wrena) {
+        p->wrptr = ptr;
+    }
+}
+
+void CpuGeneric::invalidate_direct_mem_ptr(uint64_t start, uint64_t end) {
+    for (int i = 0; i < DMEM_PAGE_TOTAL; i++) {
+        uint64_t page = dmem_[i].tag << DMEM_PAGE_SHIFT;
+        if (dmem_[i].tag != ~0ull && page <= end
+            && start <= page + (1ull << DMEM_PAGE_SHIFT) - 1) {
+            dmem_[i].tag = ~0ull;
+        }
+    }
+}
+
+void CpuGeneric::direct_mem_counters(int source_idx, uint64_t *rcnt,
+                                     uint64_t *wcnt) {
+    if (source_idx == sysBusMasterID_.to_int()) {
+        *rcnt += dmemRdCnt_.load(std::memory_order_relaxed);
+        *wcnt += dmemWrCnt_.load(std::memory_order_relaxed);
+    }
+}
+
+/** Own writes are handled in dma_memop() */
+void CpuGeneric::write_notify(int source_idx, uint64_t start, uint64_t end) {
+    if (source_idx == sysBusMasterID_.to_int()) {
+        return;
+    }
+    if (!bblocks_ && !icache_) {
+        return;
+    }
+    RISCV_mutex_lock(&mutexWrNotify_);
+    if (start < wrNotifyStart_) {
+        wrNotifyStart_ = start;
+    }
+    if (end > wrNotifyEnd_) {
+        wrNotifyEnd_ = end;
+    }
+    wrNotifyPending_.store(true, std::memory_order_release);
+    RISCV_mutex_unlock(&mutexWrNotify_);
+}
+
+/** Merged range of the distant writes drops all translated blocks */
+void CpuGeneric::applyWriteNotify() {
+    RISCV_mutex_lock(&mutexWrNotify_);
+    uint64_t start = wrNotifyStart_;
+    uint64_t end = wrNotifyEnd_;
+    wrNotifyStart_ = ~0ull;
+    wrNotifyEnd_ = 0;
+    wrNotifyPending_.store(false, std::memory_order_relaxed);
+    RISCV_mutex_unlock(&mutexWrNotify_);
+
+    if (bblocks_) {
+        if ((end >> BBLOCK_PAGE_SHIFT) - (start >> BBLOCK_PAGE_SHIFT) > 1) {
+            invalidateBlockPages();
+        } else {
+            invalidateBlockPage(start);
+            invalidateBlockPage(end);
+        }
+    }
+    if (icache_) {
+        if (end - start >= static_cast<uint64_t>(memcache_sz_)) {
+            memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
+        } else {
+            invalidateICache(start, static_cast<unsigned>(end - start + 1));
+        }
+    }
+}
+
+/**
+ * Registers banks are saved by the snapshot service as ports. Clock
+ * events are stored with the name of the listener service, events of the
+ * temporary listeners (debug requests) are dropped.
+ */
+void CpuGeneric::saveSnapshot(ISnapshotStream *s) {
+    s->writeUInt64(step_cnt_);
+    s->writeUInt64(cur_prv_level);
+    s->writeUInt64(pc_z_);
+    s->writeUInt64(exceptions_);
+    s->writeUInt64(interrupt_pending_[0]);
+    s->writeUInt64(interrupt_pending_[1]);
+    s->write(ctxregs_, sizeof(ctxregs_));
+    s->writeUInt64(triggersTotal_.to_uint64());
+    if (ptriggers_) {
+        s->write(ptriggers_,
+                 triggersTotal_.to_int()*sizeof(TriggerStorageType));
+    }
+
+    unsigned total = queue_.copyItems(0, 0, 0);
+    uint64_t *times = new uint64_t[total + 1];
+    IFace **cbs = new IFace *[total + 1];
+    const char **names = new const char *[total + 1];
+    unsigned cnt = 0;
+    total = queue_.copyItems(times, cbs, total);
+    for (unsigned i = 0; i < total; i++) {
+        names[i] = clockListenerName(cbs[i]);
+        if (names[i] == 0) {
+            RISCV_info("Clock event at %" RV_PRI64 "d isn't saved", times[i]);
+            continue;
+        }
+        cnt++;
+    }
+    s->writeUInt64(cnt);
+    for (unsigned i = 0; i < total; i++) {
+        if (names[i] == 0) {
+            continue;
+        }
+        uint32_t namelen = static_cast<uint32_t>(strlen(names[i]));
+        s->writeUInt64(times[i]);
+        s->write(&namelen, sizeof(namelen));
+        s->write(names[i], namelen);
+    }
+    delete [] times;
+    delete [] cbs;
+    delete [] names;
+}
+
+bool CpuGeneric::restoreSnapshot(ISnapshotStream *s) {
+    step_cnt_ = s->readUInt64();
+    cur_prv_level = s->readUInt64();
+    pc_z_ = s->readUInt64();
+    exceptions_ = s->readUInt64();
+    interrupt_pending_[0] = s->readUInt64();
+    interrupt_pending_[1] = s->readUInt64();
+    s->read(ctxregs_, sizeof(ctxregs_));
+    if (s->readUInt64() != triggersTotal_.to_uint64()) {
+        return false;
+    }
+    if (ptriggers_) {
+        s->read(ptriggers_,
+                triggersTotal_.to_int()*sizeof(TriggerStorageType));
+    }
+
+    queue_.hardReset();
+    uint64_t cnt = s->readUInt64();
+    char name[256];
+    for (uint64_t i = 0; i < cnt; i++) {
+        uint64_t t = s->readUInt64();
+        uint32_t namelen = 0;
+        if (!s->read(&namelen, sizeof(namelen)) || namelen >= sizeof(name)
+            || !s->read(name, namelen)) {
+            return false;
+        }
+        name[namelen] = '\0';
+        IFace *cb = static_cast<IClockListener *>(&quantumEvent_);
+        if (namelen) {
+            cb = RISCV_get_service_iface(name, IFACE_CLOCK_LISTENER);
+        }
+        if (cb == 0) {
+            RISCV_error("Clock listener %s not found", name);
+            continue;
+        }
+        queue_.put(t, cb);
+    }
+    flush(~0ull);
+    return true;
+}
+
+/** Own quantum event has empty name */
+const char *CpuGeneric::clockListenerName(IFace *cb) {
+    if (cb == static_cast<IClockListener *>(&quantumEvent_)) {
+        return "";
+    }
+    AttributeType list;
+    RISCV_get_services_with_iface(IFACE_CLOCK_LISTENER, &list);
+    for (unsigned i = 0; i < list.size(); i++) {
+        IService *iserv = static_cast<IService *>(list[i].to_iface());
+        if (iserv->getInterface(IFACE_CLOCK_LISTENER) == cb) {
+            return iserv->getObjName();
+        }
+    }
+    return 0;
+}
+
 void CpuGeneric::resume() {
     if (estate_ == CORE_OFF) {
         RISCV_error("CPU is turned-off", 0);
     }
+    // Memory could be modified by debugger while CPU was halted, including
+    // direct pointer writes that aren't seen by the bus
+    flush(~0ull);
     estate_ = CORE_Normal;
 }
 
@@ -574,6 +1286,21 @@ void CpuGeneric::reset(IFace *isource) {
     do_not_cache_ = false;
 }
 
+bool CpuGeneric::isTriggerArmed() {
+    TriggerData1Type::bits_type2 *pt;
+    for (int i = 0; i < triggersTotal_.to_int(); i++) {
+        pt = &ptriggers_[i].data1.mcontrol_bits;
+        if (pt->type == TriggerType_InstrCountMatch) {
+            return true;
+        }
+        if (pt->type == TriggerType_AddrDataMatch
+            && (pt->m | pt->s | pt->u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool CpuGeneric::isTriggerInstruction() {
     uint64_t pc = getPC();
 
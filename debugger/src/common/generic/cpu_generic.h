@@ -31,9 +31,14 @@
 #include "coreservices/icmdexec.h"
 #include "coreservices/itap.h"
 #include "coreservices/icoveragetracker.h"
+#include "coreservices/ihartquantum.h"
+#include "coreservices/icosim.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
+#include "generic/trace_bin.h"
 #include <riscv-isa.h>
 #include <fstream>
+#include <atomic>
 
 namespace debugger {
 
@@ -44,7 +49,9 @@ class CpuGeneric : public IService,
                    public IClock,
                    public IPower,
                    public IResetListener,
-                   public IHap {
+                   public IDirectMemInvalidate,
+                   public IHap,
+                   public ISnapshot {
  public:
     explicit CpuGeneric(const char *name);
     virtual ~CpuGeneric();
@@ -73,6 +80,10 @@ class CpuGeneric : public IService,
     virtual void halt(uint32_t cause, const char *descr);
     virtual void flush(uint64_t addr);
     virtual void doNotCache(uint64_t addr) { do_not_cache_ = true; }
+    virtual bool translateDebug(uint64_t vaddr, uint64_t *paddr) {
+        *paddr = vaddr;
+        return true;
+    }
 
     /** IDPort interface */
     virtual void resumereq() {resumereq_ = true; }
@@ -99,9 +110,38 @@ class CpuGeneric : public IService,
     virtual void traceRegister(int idx, uint64_t v);
     virtual void traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz);
     virtual void traceOutput() {}
+    virtual void traceBinOutput();
+    void traceInstruction() {
+        if (icosim_) {
+            cosimCheck();
+        }
+        if (trace_bin_) {
+            traceBinOutput();
+        } else if (trace_file_) {
+            traceOutput();
+        }
+    }
     virtual bool isStepEnabled() { return false; }
     virtual bool isTriggerICount();
     virtual bool isTriggerInstruction();
+    virtual bool isTriggerArmed();
+    /**
+     * Instruction address translation without exception generation.
+     * Physical address is used by the instruction caches.
+     */
+    virtual bool translateFetch(uint64_t vaddr, uint64_t *paddr) {
+        *paddr = vaddr;
+        return true;
+    }
+    /** Instruction fetch from the virtual address */
+    virtual ETransStatus ifetch_memop(Axi4TransactionType *tr) {
+        return dma_memop(tr);
+    }
+    /** Instruction that must be the last one in a basic block */
+    virtual bool isBlockTerminator(Reg64Type *payload) { return true; }
+    virtual int instructionLength(Reg64Type *payload) { return 4; }
+    /** Hart index used to pair with the reference model in co-simulation */
+    virtual uint32_t getHartId() { return 0; }
 
  public:
     /** IClock */
@@ -126,6 +166,16 @@ class CpuGeneric : public IService,
     virtual void hapTriggered(EHapType type, uint64_t param,
                               const char *descr);
 
+    /** IDirectMemInvalidate */
+    virtual void invalidate_direct_mem_ptr(uint64_t start, uint64_t end);
+    virtual void write_notify(int source_idx, uint64_t start, uint64_t end);
+    virtual void direct_mem_counters(int source_idx, uint64_t *rcnt,
+                                     uint64_t *wcnt);
+
+    /** ISnapshot */
+    virtual void saveSnapshot(ISnapshotStream *s);
+    virtual bool restoreSnapshot(ISnapshotStream *s);
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
@@ -138,6 +188,28 @@ class CpuGeneric : public IService,
     virtual void enterProgbufExec();
     virtual void exitProgbufExec();
 
+    virtual bool isBlockExecEnabled();
+    virtual bool executeBasicBlock();
+    /**
+     * Stack protection or interrupts are armed, so they are checked after
+     * each instruction of the next basic block.
+     */
+    virtual bool isTrapCheckRequired() { return false; }
+    /** Interrupt will be taken after the current instruction */
+    virtual bool isInterruptPending() { return false; }
+    void invalidateBlockPage(uint64_t addr);
+    void invalidateBlockPages();
+    void invalidateICache(uint64_t addr, unsigned sz);
+
+    void updateQuantumMember();
+    void quantumBoundary(uint64_t t);
+
+    bool cosimMemop(Axi4TransactionType *tr);
+    void cosimCheck();
+
+    /** Name of the service that owns clock event or 0 */
+    const char *clockListenerName(IFace *cb);
+
  protected:
     AttributeType isEnable_;
     AttributeType freqHz_;
@@ -148,6 +220,7 @@ class CpuGeneric : public IService,
     AttributeType sourceCode_;
     AttributeType stackTraceSize_;
     AttributeType generateTraceFile_;
+    AttributeType traceFormat_;
     AttributeType resetVector_;
     AttributeType sysBusMasterID_;
     AttributeType cacheBaseAddr_;
@@ -156,6 +229,10 @@ class CpuGeneric : public IService,
     AttributeType resetState_;
     AttributeType triggersTotal_;
     AttributeType mcontrolMaskmax_;
+    AttributeType basicBlockCache_;
+    AttributeType directMemPtr_;
+    AttributeType hartQuantum_;
+    AttributeType coSimulation_;
 
     ISourceCode *isrc_;
     ICoverageTracker *icovtracker_;
@@ -246,6 +323,97 @@ class CpuGeneric : public IService,
 
     uint64_t cur_prv_level;
 
+    /**
+     * Translation cache of the straight-line instruction sequences keyed
+     * by the physical address of the first instruction. Every page that
+     * contains translated code has a generation counter, so that a write
+     * into this page discards all its blocks without the table scan.
+     */
+    static const int BBLOCK_INSTR_MAX = 32;
+    static const int BBLOCK_PAGE_SHIFT = 12;
+    static const int BBLOCK_PAGE_TOTAL = 1 << 12;
+
+    struct BasicBlockInstrType {
+        GenericInstruction *instr;
+        Reg64Type payload;
+    };
+
+    struct BasicBlockType {
+        uint64_t addr;
+        uint32_t gen;
+        int size;
+        BasicBlockInstrType ilist[BBLOCK_INSTR_MAX];
+    } *bblocks_;
+    unsigned bblockMask_;
+    uint64_t bblockPageTag_[BBLOCK_PAGE_TOTAL];
+    uint32_t bblockPageGen_[BBLOCK_PAGE_TOTAL];
+    bool bblockExit_;           // leave current block after instruction
+
+    /**
+     * Other bus masters write from their own threads. Written range is
+     * accumulated under the mutex and the decoded instructions are dropped
+     * by the CPU thread before the next instruction.
+     */
+    mutex_def mutexWrNotify_;
+    std::atomic<bool> wrNotifyPending_;
+    uint64_t wrNotifyStart_;
+    uint64_t wrNotifyEnd_;
+    void applyWriteNotify();
+
+    void translateBasicBlock(BasicBlockType *bb, uint64_t addr);
+    unsigned pageIndex(uint64_t addr) {
+        return static_cast<unsigned>(addr >> BBLOCK_PAGE_SHIFT)
+                & (BBLOCK_PAGE_TOTAL - 1);
+    }
+
+    /**
+     * Host pointers of the plain memory pages granted by the system bus.
+     * Page without direct access keeps zero pointers, so that it is
+     * requested only once.
+     */
+    static const int DMEM_PAGE_SHIFT = 12;
+    static const int DMEM_PAGE_TOTAL = 1 << 10;
+
+    struct DirectMemPageType {
+        uint64_t tag;
+        uint8_t *rdptr;
+        uint8_t *wrptr;
+    } dmem_[DMEM_PAGE_TOTAL];
+    bool dmemEnabled_;
+    // Written only by the CPU thread, read by the bus utilization
+    std::atomic<uint64_t> dmemRdCnt_;
+    std::atomic<uint64_t> dmemWrCnt_;
+
+    bool directMemAccess(Axi4TransactionType *tr);
+    void requestDirectMem(uint64_t addr, EAxi4Action action,
+                          DirectMemPageType *p);
+
+    /**
+     * Multi-hart synchronization: the end of the quantum is the regular
+     * clock event, so that basic blocks are interrupted by it as usual.
+     */
+    class QuantumEventType : public IClockListener {
+     public:
+        explicit QuantumEventType(CpuGeneric *parent) : parent_(parent) {}
+        virtual void stepCallback(uint64_t t) {
+            parent_->quantumBoundary(t);
+        }
+     private:
+        CpuGeneric *parent_;
+    } quantumEvent_;
+
+    static const int QUANTUM_SPIN_MAX = 1000;   // then yield while waiting
+
+    IHartQuantum *iquantum_;
+    int quantumSlot_;
+    bool quantumAttached_;      // running hart is the barrier member
+    uint64_t memop_paddr_;      // physical address of the last memory access
+
+    ICoSimulation *icosim_;
+    const TraceBinRecordType *cosimRef_;    // reference of the instruction
+    bool cosimFeed_;            // memory accesses are taken from reference
+    uint64_t cosimUsed_;        // reference memops already matched
+
     struct trace_action_type {
         bool memop;             // 0=register; 1=memop
         int waddr;              // register addr
@@ -266,6 +434,8 @@ class CpuGeneric : public IService,
         int action_cnt;
     } trace_data_;
     std::ofstream *trace_file_;
+    TraceBinWriter *trace_bin_;
+    bool trace_ena_;            // trace or co-simulation record is generated
 };
 
 }  // namespace debugger
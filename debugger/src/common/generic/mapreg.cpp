@@ -27,6 +27,8 @@ MappedReg64Type::MappedReg64Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -73,6 +75,8 @@ MappedReg32Type::MappedReg32Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -124,6 +128,8 @@ MappedReg16Type::MappedReg16Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -180,6 +186,8 @@ MappedReg8Type::MappedReg8Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -225,6 +233,19 @@ void GenericReg64Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+/** Raw values without side effects of the write() method */
+void GenericReg64Bank::saveSnapshot(ISnapshotStream *s) {
+    s->writeUInt64(length_.to_uint64());
+    s->write(regs_, length_.to_uint64());
+}
+
+bool GenericReg64Bank::restoreSnapshot(ISnapshotStream *s) {
+    if (s->readUInt64() != length_.to_uint64()) {
+        return false;
+    }
+    return s->read(regs_, length_.to_uint64());
+}
+
 void GenericReg64Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg64Type)) == length_.to_int()) {
         return;
@@ -252,6 +273,19 @@ void GenericReg32Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+/** Raw values without side effects of the write() method */
+void GenericReg32Bank::saveSnapshot(ISnapshotStream *s) {
+    s->writeUInt64(length_.to_uint64());
+    s->write(regs_, length_.to_uint64());
+}
+
+bool GenericReg32Bank::restoreSnapshot(ISnapshotStream *s) {
+    if (s->readUInt64() != length_.to_uint64()) {
+        return false;
+    }
+    return s->read(regs_, length_.to_uint64());
+}
+
 void GenericReg32Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg32Type)) == length_.to_int()) {
         return;
@@ -296,6 +330,19 @@ void GenericReg16Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+/** Raw values without side effects of the write() method */
+void GenericReg16Bank::saveSnapshot(ISnapshotStream *s) {
+    s->writeUInt64(length_.to_uint64());
+    s->write(regs_, length_.to_uint64());
+}
+
+bool GenericReg16Bank::restoreSnapshot(ISnapshotStream *s) {
+    if (s->readUInt64() != length_.to_uint64()) {
+        return false;
+    }
+    return s->read(regs_, length_.to_uint64());
+}
+
 void GenericReg16Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg16Type)) == length_.to_int()) {
         return;
@@ -21,23 +21,34 @@ namespace debugger {
 
 MemoryGeneric::MemoryGeneric(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("ReadOnly", &readOnly_);
     registerAttribute("DpiClient", &dpiClient_);
     registerAttribute("DpiRoutes", &dpiRoutes_);
 
     readOnly_.make_boolean(false);
     mem_ = NULL;
+    memsize_ = 0;
     idpi_ = 0;
+    dmemHolders_.make_list(0);
+    RISCV_mutex_init(&mutexDmem_);
 }
 
 MemoryGeneric::~MemoryGeneric() {
-    if (mem_) {
-        delete mem_;
-    }
+    RISCV_memory_release(mem_, memsize_);
+    RISCV_mutex_destroy(&mutexDmem_);
 }
 
+/**
+ * Inherited class may map an image file before calling this method,
+ * otherwise the zero-filled region is reserved.
+ */
 void MemoryGeneric::postinitService() {
-    mem_ = new uint8_t[static_cast<unsigned>(length_.to_uint64())];
+    if (mem_ == NULL) {
+        memsize_ = length_.to_uint64();
+        mem_ = static_cast<uint8_t *>(RISCV_memory_reserve(memsize_));
+    }
+    written_.init(memsize_);
 
     if (dpiClient_.is_string() && dpiClient_.size()) {
         idpi_ = static_cast<IDpi *>(
@@ -49,9 +60,10 @@ void MemoryGeneric::postinitService() {
 }
 
 ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
-    uint64_t off = (trans->addr - getBaseAddress()) % length_.to_int();
+    uint64_t off = (trans->addr - getBaseAddress()) % length_.to_uint64();
     trans->response = MemResp_Valid;
     if (trans->action == MemAction_Write) {
+        written_.setWritten(off, trans->xsize);
         if (readOnly_.to_bool()) {
             RISCV_error("Write to READ ONLY memory", NULL);
             trans->response = MemResp_Error;
@@ -77,16 +89,8 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
 
         /** Access to SystemVerilog and auto-comparision */
         if (idpi_ && dpiRoutes_[trans->source_idx].to_bool()) {
-            Reg64Type t1;
-            idpi_->axi4_read(off, static_cast<int>(trans->xsize), &t1.val);
-
-            if (t1.val != trans->rpayload.b64[0]) {
-                RISCV_error("DPI diff [%08x]: %016" RV_PRI64 "x != %016" RV_PRI64 "x",
-                    static_cast<unsigned>(off),
-                    t1.val,
-                    trans->rpayload.b64[0]
-                    );
-            }
+            idpi_->axi4_compare(off, static_cast<int>(trans->xsize),
+                                trans->rpayload.b64[0]);
         }
     }
 
@@ -99,4 +103,79 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+/**
+ * Whole memory is granted to the master unless its transactions are
+ * routed into SystemVerilog model. When writes are tracked for the
+ * snapshot, the whole memory is granted for reading only and the write
+ * access is granted page by page marking it as written.
+ */
+bool MemoryGeneric::get_direct_mem_ptr(Axi4TransactionType *trans,
+                                       DirectMemRegionType *region,
+                                       IDirectMemInvalidate *cb) {
+    if (mem_ == 0 || (idpi_ && dpiRoutes_[trans->source_idx].to_bool())) {
+        return false;
+    }
+    region->addr = getBaseAddress();
+    region->length = length_.to_uint64();
+    region->ptr = mem_;
+    region->rdena = true;
+    region->wrena = !readOnly_.to_bool();
+
+    RISCV_mutex_lock(&mutexDmem_);
+    if (written_.getSnapshotId() && region->wrena) {
+        if (trans->action == MemAction_Write) {
+            uint64_t off = (trans->addr - getBaseAddress()) % memsize_;
+            off &= ~(SnapshotWriteTracker::PAGE_SIZE - 1);
+            region->addr += off;
+            region->length = SnapshotWriteTracker::PAGE_SIZE;
+            region->ptr += off;
+            written_.setWritten(off, SnapshotWriteTracker::PAGE_SIZE);
+        } else {
+            region->wrena = false;
+        }
+    }
+    bool registered = false;
+    for (unsigned i = 0; i < dmemHolders_.size(); i++) {
+        if (dmemHolders_[i].to_iface() == cb) {
+            registered = true;
+            break;
+        }
+    }
+    if (!registered) {
+        AttributeType t1(cb);
+        dmemHolders_.add_to_list(&t1);
+    }
+    RISCV_mutex_unlock(&mutexDmem_);
+    return true;
+}
+
+/**
+ * Memory is equal to the snapshot now. Granted write pointers are revoked,
+ * so that masters request them again and the written pages are tracked.
+ */
+void MemoryGeneric::startWriteTracking(uint64_t snapshotid) {
+    RISCV_mutex_lock(&mutexDmem_);
+    written_.reset(snapshotid);
+    for (unsigned i = 0; i < dmemHolders_.size(); i++) {
+        IDirectMemInvalidate *cb =
+            static_cast<IDirectMemInvalidate *>(dmemHolders_[i].to_iface());
+        cb->invalidate_direct_mem_ptr(getBaseAddress(),
+                                      getBaseAddress() + memsize_ - 1);
+    }
+    RISCV_mutex_unlock(&mutexDmem_);
+}
+
+void MemoryGeneric::saveSnapshot(ISnapshotStream *s) {
+    s->writeImage(mem_, memsize_, &written_);
+    startWriteTracking(s->getSnapshotId());
+}
+
+bool MemoryGeneric::restoreSnapshot(ISnapshotStream *s) {
+    if (!s->mapImage(mem_, memsize_)) {
+        return false;
+    }
+    startWriteTracking(s->getSnapshotId());
+    return true;
+}
+
 }  // namespace debugger
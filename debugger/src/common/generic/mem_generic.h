@@ -21,11 +21,13 @@
 #include "iservice.h"
 #include "coreservices/imemop.h"
 #include <coreservices/idpi.h>
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class MemoryGeneric : public IService, 
-                      public IMemoryOperation {
+                      public IMemoryOperation,
+                      public ISnapshot {
  public:
     MemoryGeneric(const char *name);
     ~MemoryGeneric();
@@ -35,6 +37,18 @@ class MemoryGeneric : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual bool get_direct_mem_ptr(Axi4TransactionType *trans,
+                                    DirectMemRegionType *region,
+                                    IDirectMemInvalidate *cb);
+    /** DPI client isn't re-entrant */
+    virtual bool isThreadSafe() { return idpi_ == 0; }
+
+    /** ISnapshot */
+    virtual void saveSnapshot(ISnapshotStream *s);
+    virtual bool restoreSnapshot(ISnapshotStream *s);
+
+ protected:
+    void startWriteTracking(uint64_t snapshotid);
 
  protected:
     AttributeType readOnly_;
@@ -43,7 +57,11 @@ class MemoryGeneric : public IService,
 
     IDpi *idpi_;
 
-    uint8_t *mem_;
+    uint8_t *mem_;              // reserved or mapped region, see api_core.h
+    uint64_t memsize_;          // size of the region to release
+    SnapshotWriteTracker written_;
+    mutex_def mutexDmem_;
+    AttributeType dmemHolders_;
 };
 
 }  // namespace debugger
@@ -0,0 +1,415 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <string.h>
+#include <riscv-isa.h>
+#include "riscv_disasm.h"
+#include "trace_bin.h"
+
+namespace debugger {
+
+static uint64_t zigzag_encode(uint64_t v) {
+    return (v << 1) ^ (0 - (v >> 63));
+}
+
+static uint64_t zigzag_decode(uint64_t v) {
+    return (v >> 1) ^ (0 - (v & 1));
+}
+
+static const int REG_NAMES_TOTAL =
+    sizeof(RISCV_IREGS_NAMES) / sizeof(RISCV_IREGS_NAMES[0]);
+
+static int log2_size(int size) {
+    int ret = 0;
+    while ((1 << ret) < size && ret < 3) {
+        ret++;
+    }
+    return ret;
+}
+
+TraceBinWriter::TraceBinWriter() : IThread() {
+    fl_ = 0;
+    buf_[0] = 0;
+    buf_[1] = 0;
+    bufcnt_[0] = 0;
+    bufcnt_[1] = 0;
+    pending_[0].store(false);
+    pending_[1].store(false);
+    cur_ = 0;
+    wridx_ = 0;
+    p_ = 0;
+    memset(&state_, 0, sizeof(state_));
+    RISCV_event_create(&eventFull_, "TraceBinWriter_full");
+    RISCV_event_create(&eventFree_, "TraceBinWriter_free");
+}
+
+TraceBinWriter::~TraceBinWriter() {
+    close();
+    RISCV_event_close(&eventFull_);
+    RISCV_event_close(&eventFree_);
+}
+
+bool TraceBinWriter::open(const char *filename) {
+    fl_ = fopen(filename, "wb");
+    if (!fl_) {
+        return false;
+    }
+    buf_[0] = new uint8_t[BUF_SIZE];
+    buf_[1] = new uint8_t[BUF_SIZE];
+    cur_ = 0;
+    wridx_ = 0;
+    p_ = buf_[0];
+    memcpy(p_, TRACE_BIN_SIGNATURE, sizeof(TRACE_BIN_SIGNATURE));
+    p_ += sizeof(TRACE_BIN_SIGNATURE);
+    memset(&state_, 0, sizeof(state_));
+    state_.isize = 4;
+    return run();
+}
+
+void TraceBinWriter::close() {
+    if (!fl_) {
+        return;
+    }
+    swapBuffers();
+    stop();
+    writePending();     // thread could be stopped before the last buffer
+    fclose(fl_);
+    fl_ = 0;
+    delete [] buf_[0];
+    delete [] buf_[1];
+    buf_[0] = 0;
+    buf_[1] = 0;
+}
+
+bool TraceBinWriter::run() {
+    // Loop should be enabled before the thread checks it the first time
+    RISCV_event_set(&loopEnable_);
+    return IThread::run() && threadInit_.Handle != 0;
+}
+
+void TraceBinWriter::busyLoop() {
+    while (isEnabled()) {
+        RISCV_event_wait_ms(&eventFull_, 100);
+        RISCV_event_clear(&eventFull_);
+        writePending();
+    }
+}
+
+void TraceBinWriter::writePending() {
+    while (pending_[wridx_].load(std::memory_order_acquire)) {
+        fwrite(buf_[wridx_], 1, bufcnt_[wridx_], fl_);
+        pending_[wridx_].store(false, std::memory_order_release);
+        RISCV_event_set(&eventFree_);
+        wridx_ ^= 1;
+    }
+}
+
+void TraceBinWriter::swapBuffers() {
+    int nxt = cur_ ^ 1;
+    while (pending_[nxt].load(std::memory_order_acquire)) {
+        // Writer is still busy with the previous buffer
+        RISCV_event_wait_ms(&eventFree_, 10);
+        RISCV_event_clear(&eventFree_);
+    }
+    bufcnt_[cur_] = static_cast<int>(p_ - buf_[cur_]);
+    pending_[cur_].store(true, std::memory_order_release);
+    RISCV_event_set(&eventFull_);
+    cur_ = nxt;
+    p_ = buf_[cur_];
+}
+
+void TraceBinWriter::putVarint(uint64_t v) {
+    while (v >= 0x80) {
+        *p_++ = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
+    }
+    *p_++ = static_cast<uint8_t>(v);
+}
+
+void TraceBinWriter::beginRecord(uint64_t step_cnt, uint64_t pc,
+                                 uint32_t instr, int isize,
+                                 int action_cnt) {
+    if (p_ + RECORD_SIZE_MAX > buf_[cur_] + BUF_SIZE) {
+        swapBuffers();
+    }
+    uint8_t hdr = isize == 2 ? 0 : TRACE_BIN_HDR_I32;
+    bool jump = pc != state_.pc + state_.isize;
+    bool skip = step_cnt != state_.step_cnt + 1;
+    if (jump) {
+        hdr |= TRACE_BIN_HDR_PC_JUMP;
+    }
+    if (skip) {
+        hdr |= TRACE_BIN_HDR_STEP_SKIP;
+    }
+    if (action_cnt < TRACE_BIN_HDR_ACT_EXT) {
+        hdr |= action_cnt << TRACE_BIN_HDR_ACT_SHIFT;
+    } else {
+        hdr |= TRACE_BIN_HDR_ACT_EXT << TRACE_BIN_HDR_ACT_SHIFT;
+    }
+    *p_++ = hdr;
+    if (jump) {
+        putVarint(zigzag_encode(pc - state_.pc));
+    }
+    if (skip) {
+        putVarint(step_cnt - state_.step_cnt);
+    }
+    if (action_cnt >= TRACE_BIN_HDR_ACT_EXT) {
+        putVarint(action_cnt);
+    }
+    *p_++ = static_cast<uint8_t>(instr);
+    *p_++ = static_cast<uint8_t>(instr >> 8);
+    if (isize != 2) {
+        *p_++ = static_cast<uint8_t>(instr >> 16);
+        *p_++ = static_cast<uint8_t>(instr >> 24);
+    }
+    state_.step_cnt = step_cnt;
+    state_.pc = pc;
+    state_.isize = isize == 2 ? 2 : 4;
+}
+
+void TraceBinWriter::putRegister(int idx, uint64_t val) {
+    idx &= (TRACE_BIN_REGS_MAX - 1);
+    *p_++ = static_cast<uint8_t>(idx);
+    putVarint(val ^ state_.regs[idx]);
+    state_.regs[idx] = val;
+}
+
+void TraceBinWriter::putMemop(uint64_t addr, bool write, uint64_t val,
+                              int size) {
+    uint8_t t = TRACE_BIN_ACT_MEMOP | static_cast<uint8_t>(log2_size(size));
+    if (write) {
+        t |= TRACE_BIN_ACT_WRITE;
+    }
+    *p_++ = t;
+    putVarint(zigzag_encode(addr - state_.memaddr));
+    putVarint(val);
+    state_.memaddr = addr;
+}
+
+
+TraceBinReader::TraceBinReader() {
+    fl_ = 0;
+    memset(&state_, 0, sizeof(state_));
+}
+
+TraceBinReader::~TraceBinReader() {
+    close();
+}
+
+bool TraceBinReader::open(const char *filename) {
+    char sig[sizeof(TRACE_BIN_SIGNATURE)];
+    fl_ = fopen(filename, "rb");
+    if (!fl_) {
+        return false;
+    }
+    if (fread(sig, 1, sizeof(sig), fl_) != sizeof(sig)
+        || memcmp(sig, TRACE_BIN_SIGNATURE, sizeof(sig)) != 0) {
+        close();
+        return false;
+    }
+    memset(&state_, 0, sizeof(state_));
+    state_.isize = 4;
+    return true;
+}
+
+void TraceBinReader::close() {
+    if (fl_) {
+        fclose(fl_);
+        fl_ = 0;
+    }
+}
+
+bool TraceBinReader::getByte(uint8_t *v) {
+    int c = fgetc(fl_);
+    if (c == EOF) {
+        return false;
+    }
+    *v = static_cast<uint8_t>(c);
+    return true;
+}
+
+bool TraceBinReader::getVarint(uint64_t *v) {
+    uint8_t t;
+    int shift = 0;
+    *v = 0;
+    do {
+        if (shift > 63 || !getByte(&t)) {
+            return false;
+        }
+        *v |= static_cast<uint64_t>(t & 0x7F) << shift;
+        shift += 7;
+    } while (t & 0x80);
+    return true;
+}
+
+bool TraceBinReader::read(TraceBinRecordType *rec) {
+    uint8_t hdr, t;
+    uint64_t v;
+    if (!fl_ || !getByte(&hdr)) {
+        return false;
+    }
+    rec->pc = state_.pc + state_.isize;
+    if (hdr & TRACE_BIN_HDR_PC_JUMP) {
+        if (!getVarint(&v)) {
+            return false;
+        }
+        rec->pc = state_.pc + zigzag_decode(v);
+    }
+    rec->step_cnt = state_.step_cnt + 1;
+    if (hdr & TRACE_BIN_HDR_STEP_SKIP) {
+        if (!getVarint(&v)) {
+            return false;
+        }
+        rec->step_cnt = state_.step_cnt + v;
+    }
+    rec->action_cnt = hdr >> TRACE_BIN_HDR_ACT_SHIFT;
+    if (rec->action_cnt == TRACE_BIN_HDR_ACT_EXT) {
+        if (!getVarint(&v) || v > 64) {
+            return false;
+        }
+        rec->action_cnt = static_cast<int>(v);
+    }
+    rec->isize = (hdr & TRACE_BIN_HDR_I32) ? 4 : 2;
+    rec->instr = 0;
+    for (int i = 0; i < rec->isize; i++) {
+        if (!getByte(&t)) {
+            return false;
+        }
+        rec->instr |= static_cast<uint32_t>(t) << (8 * i);
+    }
+    state_.pc = rec->pc;
+    state_.step_cnt = rec->step_cnt;
+    state_.isize = rec->isize;
+
+    for (int i = 0; i < rec->action_cnt; i++) {
+        TraceBinRecordType::ActionType *pa = &rec->action[i];
+        if (!getByte(&t)) {
+            return false;
+        }
+        pa->memop = (t & TRACE_BIN_ACT_MEMOP) != 0;
+        if (!pa->memop) {
+            if (!getVarint(&v)) {
+                return false;
+            }
+            pa->waddr = t;
+            pa->data = v ^ state_.regs[t];
+            state_.regs[t] = pa->data;
+            continue;
+        }
+        pa->write = (t & TRACE_BIN_ACT_WRITE) != 0;
+        pa->size = 1 << (t & 0x3);
+        if (!getVarint(&v)) {
+            return false;
+        }
+        pa->addr = state_.memaddr + zigzag_decode(v);
+        state_.memaddr = pa->addr;
+        if (!getVarint(&pa->data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool trace_action_match(const TraceBinRecordType::ActionType *a,
+                               const TraceBinRecordType::ActionType *b,
+                               int flags) {
+    if (a->memop != b->memop) {
+        return false;
+    }
+    if (!a->memop) {
+        return a->waddr == b->waddr && a->data == b->data;
+    }
+    if (a->write != b->write || a->addr != b->addr) {
+        return false;
+    }
+    if (!(flags & TRACE_MATCH_MEMDATA)) {
+        return true;
+    }
+    uint64_t mask = ~0ull;
+    int size = a->size;
+    if (size == 0 || (b->size != 0 && b->size < size)) {
+        size = b->size;
+    }
+    if (size > 0 && size < 8) {
+        mask = (1ull << (8 * size)) - 1;
+    }
+    return ((a->data ^ b->data) & mask) == 0;
+}
+
+bool trace_record_match(const TraceBinRecordType *a,
+                        const TraceBinRecordType *b,
+                        int flags) {
+    uint64_t used = 0;
+    if (a->pc != b->pc || a->action_cnt != b->action_cnt) {
+        return false;
+    }
+    if ((flags & TRACE_MATCH_STEPS) && a->step_cnt != b->step_cnt) {
+        return false;
+    }
+    if (a->isize && b->isize && a->instr != b->instr) {
+        return false;
+    }
+    for (int i = 0; i < a->action_cnt; i++) {
+        bool found = false;
+        for (int n = 0; n < b->action_cnt; n++) {
+            if (!(used & (1ull << n))
+                && trace_action_match(&a->action[i], &b->action[n], flags)) {
+                used |= 1ull << n;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void trace_record_to_text(const TraceBinRecordType *rec,
+                          char *out, size_t outsz) {
+    char disasm[256] = "";
+    int pos;
+    if (rec->isize) {
+        riscv_disassembler(rec->instr, disasm, sizeof(disasm));
+    }
+    pos = RISCV_sprintf(out, outsz,
+        "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \r\n",
+            rec->step_cnt, rec->pc, disasm);
+
+    for (int i = 0; i < rec->action_cnt; i++) {
+        const TraceBinRecordType::ActionType *pa = &rec->action[i];
+        if (!pa->memop) {
+            pos += RISCV_sprintf(&out[pos], outsz - pos,
+                "%20s %10s <= %016" RV_PRI64 "x\r\n",
+                    "",
+                    pa->waddr < REG_NAMES_TOTAL
+                        ? RISCV_IREGS_NAMES[pa->waddr] : "?",
+                    pa->data);
+        } else if (pa->write) {
+            pos += RISCV_sprintf(&out[pos], outsz - pos,
+                "%20s [%08" RV_PRI64 "x] <= %016" RV_PRI64 "x\r\n",
+                    "", pa->addr, pa->data);
+        } else {
+            pos += RISCV_sprintf(&out[pos], outsz - pos,
+                "%20s [%08" RV_PRI64 "x] => %016" RV_PRI64 "x\r\n",
+                    "", pa->addr, pa->data);
+        }
+    }
+}
+
+}  // namespace debugger
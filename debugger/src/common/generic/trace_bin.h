@@ -0,0 +1,166 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_GENERIC_TRACE_BIN_H__
+#define __DEBUGGER_COMMON_GENERIC_TRACE_BIN_H__
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <atomic>
+#include "coreservices/ithread.h"
+
+namespace debugger {
+
+/**
+ * Binary instruction trace.
+ *
+ * File starts with the 8-bytes signature followed by the instruction
+ * records. Every record begins with the header byte:
+ *      [0]   instruction size: 0 = 16 bits; 1 = 32 bits
+ *      [1]   non-sequential pc: zigzag varint pc delta follows
+ *      [2]   step delta is not 1: varint step delta follows
+ *      [3]   reserved
+ *      [7:4] actions total, 15 = varint actions total follows
+ * then the instruction word (2 or 4 bytes, little endian) and actions:
+ *      register: byte [7]=0, [6:0] index; varint value XOR previous value
+ *      memop:    byte [7]=1, [6] write, [1:0] log2(size);
+ *                zigzag varint address delta; varint data
+ * All the deltas are computed relative to the previous record.
+ */
+static const char TRACE_BIN_SIGNATURE[8] = {'R','V','T','R','A','C','E','1'};
+
+static const uint8_t TRACE_BIN_HDR_I32       = 0x01;
+static const uint8_t TRACE_BIN_HDR_PC_JUMP   = 0x02;
+static const uint8_t TRACE_BIN_HDR_STEP_SKIP = 0x04;
+static const int TRACE_BIN_HDR_ACT_SHIFT     = 4;
+static const int TRACE_BIN_HDR_ACT_EXT       = 15;
+
+static const uint8_t TRACE_BIN_ACT_MEMOP     = 0x80;
+static const uint8_t TRACE_BIN_ACT_WRITE     = 0x40;
+
+static const int TRACE_BIN_REGS_MAX          = 128;
+
+/** Decoded record, used by the tools */
+struct TraceBinRecordType {
+    uint64_t step_cnt;
+    uint64_t pc;
+    uint32_t instr;
+    int isize;
+    int action_cnt;
+    struct ActionType {
+        bool memop;
+        bool write;
+        int waddr;
+        uint64_t addr;
+        uint64_t data;
+        int size;
+    } action[64];
+};
+
+/** Previous values used to compute deltas by encoder and decoder */
+struct TraceBinStateType {
+    uint64_t step_cnt;
+    uint64_t pc;
+    int isize;
+    uint64_t memaddr;
+    uint64_t regs[TRACE_BIN_REGS_MAX];
+};
+
+/**
+ * Records are encoded into one of two buffers, while the other one is
+ * written into the file by the separate thread. Execution thread waits
+ * only when the writer is slower than the trace generation.
+ */
+class TraceBinWriter : public IThread {
+ public:
+    TraceBinWriter();
+    virtual ~TraceBinWriter();
+
+    bool open(const char *filename);
+    void close();
+
+    void beginRecord(uint64_t step_cnt, uint64_t pc, uint32_t instr,
+                     int isize, int action_cnt);
+    void putRegister(int idx, uint64_t val);
+    void putMemop(uint64_t addr, bool write, uint64_t val, int size);
+
+ protected:
+    /** IThread interface */
+    virtual bool run();
+    virtual void busyLoop();
+
+ private:
+    void putVarint(uint64_t v);
+    void swapBuffers();
+    void writePending();
+
+ private:
+    static const int BUF_SIZE = 1 << 20;
+    static const int RECORD_SIZE_MAX = 32 + 64 * 21;
+
+    FILE *fl_;
+    uint8_t *buf_[2];
+    int bufcnt_[2];
+    std::atomic<bool> pending_[2];
+    int cur_;           // buffer being filled
+    int wridx_;         // next buffer to write
+    uint8_t *p_;
+    event_def eventFull_;
+    event_def eventFree_;
+    TraceBinStateType state_;
+};
+
+/** Sequential reader of the binary trace */
+class TraceBinReader {
+ public:
+    TraceBinReader();
+    ~TraceBinReader();
+
+    bool open(const char *filename);
+    void close();
+    /** Return false at the end of file or on the broken record */
+    bool read(TraceBinRecordType *rec);
+
+ private:
+    bool getByte(uint8_t *v);
+    bool getVarint(uint64_t *v);
+
+ private:
+    FILE *fl_;
+    TraceBinStateType state_;
+};
+
+/** trace_record_match() flags */
+static const int TRACE_MATCH_STEPS   = 0x1;     // compare step counters
+static const int TRACE_MATCH_MEMDATA = 0x2;     // compare memops data
+
+/**
+ * Compare records: pc, instruction when it is known in both records
+ * (isize != 0) and actions in any order. Memop data is compared in the
+ * bytes of the access size, so that the sign extended load value is
+ * equal to the raw memory data.
+ */
+bool trace_record_match(const TraceBinRecordType *a,
+                        const TraceBinRecordType *b,
+                        int flags);
+
+/** Output the record in the functional model text format */
+void trace_record_to_text(const TraceBinRecordType *rec,
+                          char *out, size_t outsz);
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_GENERIC_TRACE_BIN_H__
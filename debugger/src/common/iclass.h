@@ -37,6 +37,9 @@ class IClass : public IFace {
         for (unsigned i = 0; i < listInstances_.size(); i++) {
             delete static_cast<IService *>(listInstances_[i].to_iface());
         }
+        if (listInstances_.size()) {
+            RISCV_invalidate_service_index();
+        }
     }
 
     virtual IService *createService(const char *nspace,
@@ -48,6 +51,7 @@ class IClass : public IFace {
             isrv =  static_cast<IService *>(listInstances_[i].to_iface());
             if (strcmp(isrv->getObjName(), obj_name) == 0) {
                 listInstances_.remove_from_list(i);
+                RISCV_invalidate_service_index();
                 delete isrv;
                 break;
             }
@@ -117,6 +121,7 @@ class name ## Class : public IClass { \
         serv->setNamespace(nspace); \
         AttributeType item(static_cast<IService *>(serv)); \
         listInstances_.add_to_list(&item); \
+        RISCV_invalidate_service_index(); \
         return serv; \
     } \
 };
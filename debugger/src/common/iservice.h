@@ -81,13 +81,15 @@ class IService : public IFace {
     virtual void registerInterface(IFace *iface) {
         AttributeType item(iface);
         listInterfaces_.add_to_list(&item);
-        if (strcmp(iface->getFaceName(), IFACE_MEMORY_OPERATION) == 0) {
-            IMemoryOperation *imemop = static_cast<IMemoryOperation *>(iface);
-            registerAttribute("MapList", &imemop->listMap_);
-            registerAttribute("BaseAddress", &imemop->baseAddress_);
-            registerAttribute("Length", &imemop->length_);
-            registerAttribute("Priority", &imemop->priority_);
-        }
+        RISCV_register_interface(static_cast<IService *>(this), iface);
+    }
+
+    /** Called by RISCV_register_interface() */
+    void registerMemoryAttributes(IMemoryOperation *imemop) {
+        registerAttribute("MapList", &imemop->listMap_);
+        registerAttribute("BaseAddress", &imemop->baseAddress_);
+        registerAttribute("Length", &imemop->length_);
+        registerAttribute("Priority", &imemop->priority_);
     }
     virtual void registerPortInterface(const char *portname, IFace *iface) {
         AttributeType item;
@@ -95,12 +97,14 @@ class IService : public IFace {
         item[0u].make_string(portname);
         item[1].make_iface(iface);
         listPorts_.add_to_list(&item);
+        RISCV_invalidate_service_index();
     }
 
     virtual void unregisterInterface(IFace *iface) {
         for (unsigned i = 0; i < listInterfaces_.size(); i++) {
             if (listInterfaces_[i].to_iface() == iface) {
                 listInterfaces_.remove_from_list(i);
+                RISCV_invalidate_service_index();
                 break;
             }
         }
@@ -108,15 +112,22 @@ class IService : public IFace {
 
     virtual IFace *getInterface(const char *name) {
         IFace *tmp;
+        const char *fname;
         for (unsigned i = 0; i < listInterfaces_.size(); i++) {
             tmp = listInterfaces_[i].to_iface();
-            if (strcmp(name, tmp->getFaceName()) == 0) {
+            fname = tmp->getFaceName();
+            // Usually the same IFACE_* constant so pointers are equal
+            if (name == fname || strcmp(name, fname) == 0) {
                 return tmp;
             }
         }
         return NULL;
     }
 
+    virtual const AttributeType *getInterfaceList() {
+        return &listInterfaces_;
+    }
+
     virtual IFace *getPortInterface(const char *portname,
                                     const char *facename) {
         IFace *tmp;
@@ -154,6 +165,9 @@ class IService : public IFace {
 
     virtual const char *getObjName() { return obj_name_.to_string(); }
 
+    /** Direct access without the attribute lookup on each message */
+    int getLogLevel() { return static_cast<int>(logLevel_.to_int64()); }
+
     virtual AttributeType getConfiguration() {
         AttributeType ret(Attr_Dict);
         ret["Name"] = AttributeType(getObjName());
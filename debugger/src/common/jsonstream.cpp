@@ -0,0 +1,680 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <iservice.h>
+#include <cstdlib>
+#include "jsonstream.h"
+
+namespace debugger {
+
+static bool is_number_symbol(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')
+        || (c >= 'A' && c <= 'F') || c == 'x' || c == 'X'
+        || c == '-' || c == '.';
+}
+
+static bool is_literal_symbol(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int skip_spaces(const char *s, int off, int len) {
+    while (off < len && (s[off] == ' ' || s[off] == '\r'
+                      || s[off] == '\n' || s[off] == '\t')) {
+        off++;
+    }
+    return off;
+}
+
+/**
+ * Integer part is converted by strtoull(base=0) and the fraction digits
+ * are accumulated separately exactly as from_config() does.
+ */
+static bool number_to_handler(const char *s, int len, JsonHandler *h) {
+    // Fast path for hex and decimal integers without conversion copy
+    int off = s[0] == '-' ? 1 : 0;
+    uint64_t v = 0;
+    int i = off;
+    if (len > off + 2 && s[off] == '0' && (s[off + 1] == 'x')) {
+        for (i = off + 2; i < len && hex_digit(s[i]) >= 0; i++) {
+            v = (v << 4) | static_cast<uint64_t>(hex_digit(s[i]));
+        }
+    } else if (len > off && (s[off] != '0' || len == off + 1)) {
+        for (; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+            v = 10 * v + static_cast<uint64_t>(s[i] - '0');
+        }
+    }
+    if (i == len && len - off <= 16) {
+        int64_t t1 = static_cast<int64_t>(v);
+        h->onInteger(off ? -t1 : t1);
+        return true;
+    }
+
+    char digits[64];
+    if (len <= 0 || len >= static_cast<int>(sizeof(digits))) {
+        return false;
+    }
+    memcpy(digits, s, len);
+    digits[len] = '\0';
+
+    char *p = digits;
+    bool negative = false;
+    if (*p == '-') {
+        negative = true;
+        p++;
+    }
+    char *frac = strchr(p, '.');
+    if (frac) {
+        *frac++ = '\0';
+    }
+    int64_t t1 = strtoull(p, NULL, 0);
+    if (!frac) {
+        h->onInteger(negative ? -t1 : t1);
+        return true;
+    }
+
+    double divrate = 1.0;
+    double d1 = static_cast<double>(t1);
+    while (*frac == '0') {
+        frac++;
+        divrate *= 10.0;
+    }
+    int cnt = 0;
+    while (frac[cnt] >= '0' && frac[cnt] <= '9') {
+        divrate *= 10.0;
+        cnt++;
+    }
+    frac[cnt] = '\0';
+    d1 += static_cast<double>(strtoull(frac, NULL, 10)) / divrate;
+    h->onFloating(negative ? -d1 : d1);
+    return true;
+}
+
+/** Bytes are decoded in place, returns -1 on wrong format */
+static int data_decode(char *s, int len) {
+    int cnt = 0;
+    int off = skip_spaces(s, 0, len);
+    while (off < len) {
+        if (s[off] == '0' && off + 1 < len && s[off + 1] == 'x') {
+            off += 2;
+        }
+        if (off + 2 > len) {
+            return -1;
+        }
+        int hi = hex_digit(s[off]);
+        int lo = hex_digit(s[off + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        s[cnt++] = static_cast<char>((hi << 4) | lo);
+        off = skip_spaces(s, off + 2, len);
+        if (off == len) {
+            break;
+        }
+        if (s[off] != ',') {
+            return -1;
+        }
+        off = skip_spaces(s, off + 1, len);
+    }
+    return cnt;
+}
+
+JsonStreamParser::JsonStreamParser(JsonHandler *handler) {
+    handler_ = handler;
+    carrysz_ = 256;
+    carry_ = new char[carrysz_];
+    stop_ = false;
+    reset();
+}
+
+JsonStreamParser::~JsonStreamParser() {
+    delete [] carry_;
+}
+
+void JsonStreamParser::reset() {
+    depth_ = 0;
+    expect_ = Expect_Value;
+    token_ = Token_None;
+    carrycnt_ = 0;
+}
+
+int JsonStreamParser::parse(const char *buf, int sz) {
+    int i = 0;
+    stop_ = false;
+    while (i < sz && !stop_) {
+        if (token_ != Token_None) {
+            i = continueToken(buf, i, sz);
+            continue;
+        }
+        char c = buf[i];
+        if (expect_ == Expect_Skip) {
+            i++;
+            if (c == '\0') {
+                reset();
+            }
+            continue;
+        }
+        if (c == ' ' || c == '\r' || c == '\n' || c == '\t') {
+            i++;
+            continue;
+        }
+        if (c == '\0') {
+            if (depth_ == 0) {
+                i++;        // messages delimiter
+            } else {
+                error("Unexpected end of message");
+            }
+            continue;
+        }
+
+        switch (expect_) {
+        case Expect_Colon:
+            if (c == ':') {
+                expect_ = Expect_Value;
+                i++;
+            } else {
+                error("Wrong dictionary delimiter");
+            }
+            break;
+        case Expect_CommaOrEnd:
+            if (c == ',') {
+                i++;
+                expect_ = stack_[depth_ - 1] == 'L' ? Expect_ValueOrEnd
+                                                    : Expect_KeyOrEnd;
+            } else if (c == ']' || c == '}') {
+                i++;
+                closeContainer(c);
+            } else {
+                // Missing comma is accepted as from_config() does
+                expect_ = stack_[depth_ - 1] == 'L' ? Expect_Value
+                                                    : Expect_KeyOrEnd;
+            }
+            break;
+        case Expect_KeyOrEnd:
+            if (c == '}') {
+                i++;
+                closeContainer(c);
+            } else if (c == '\'' || c == '"') {
+                i++;
+                quote_ = c;
+                token_ = Token_Key;
+            } else {
+                error("Wrong dictionary key");
+            }
+            break;
+        case Expect_ValueOrEnd:
+            if (c == ']') {
+                i++;
+                closeContainer(c);
+                break;
+            }
+            // fallthrough
+        default:
+            if (c == '[') {
+                i++;
+                openContainer('L');
+            } else if (c == '{') {
+                i++;
+                openContainer('D');
+            } else if (c == '\'' || c == '"') {
+                i++;
+                quote_ = c;
+                token_ = Token_String;
+            } else if (c == '(') {
+                i++;
+                token_ = Token_Data;
+            } else if ((c >= '0' && c <= '9') || c == '-') {
+                token_ = Token_Number;
+            } else if (is_literal_symbol(c)) {
+                token_ = Token_Literal;
+            } else {
+                error("Can't detect format");
+            }
+        }
+    }
+    return i;
+}
+
+void JsonStreamParser::finish() {
+    if (token_ == Token_Number || token_ == Token_Literal) {
+        completeToken(carry_, carrycnt_);
+    } else if (token_ != Token_None || depth_ != 0) {
+        error("Unexpected end of data");
+    }
+}
+
+/**
+ * String is passed as a slice of the input buffer when it isn't split
+ * between frames, otherwise it is accumulated in the carry buffer.
+ */
+int JsonStreamParser::continueToken(const char *buf, int i, int sz) {
+    int j = i;
+    switch (token_) {
+    case Token_String:
+    case Token_Key:
+        while (j < sz && buf[j] != quote_ && buf[j] != '\0') {
+            j++;
+        }
+        if (j < sz && buf[j] == '\0') {
+            error("Wrong string format");
+            return j;
+        }
+        break;
+    case Token_Number:
+        while (j < sz && is_number_symbol(buf[j])) {
+            j++;
+        }
+        break;
+    case Token_Literal:
+        while (j < sz && is_literal_symbol(buf[j])) {
+            j++;
+        }
+        break;
+    default:
+        while (j < sz && buf[j] != ')' && buf[j] != '\0') {
+            j++;
+        }
+        if (j < sz && buf[j] == '\0') {
+            error("Wrong data format");
+            return j;
+        }
+        // Bytes are always decoded in the carry buffer
+        carry(&buf[i], j - i);
+        if (j < sz) {
+            completeToken(carry_, carrycnt_);
+            j++;
+        }
+        return j;
+    }
+
+    if (j == sz) {
+        carry(&buf[i], sz - i);
+        return sz;
+    }
+    bool quoted = token_ == Token_String || token_ == Token_Key;
+    if (carrycnt_) {
+        carry(&buf[i], j - i);
+        completeToken(carry_, carrycnt_);
+    } else {
+        completeToken(&buf[i], j - i);
+    }
+    // Closing quote is consumed, the number or literal delimiter isn't
+    return quoted ? j + 1 : j;
+}
+
+void JsonStreamParser::completeToken(const char *s, int len) {
+    EToken token = token_;
+    token_ = Token_None;
+    switch (token) {
+    case Token_Key:
+        handler_->onKey(s, len);
+        expect_ = Expect_Colon;
+        break;
+    case Token_String:
+        handler_->onString(s, len);
+        valueDone();
+        break;
+    case Token_Number:
+        if (!number_to_handler(s, len, handler_)) {
+            error("Wrong number format");
+            return;
+        }
+        valueDone();
+        break;
+    case Token_Literal:
+        if (len == 4 && memcmp(s, "None", 4) == 0) {
+            handler_->onNil();
+        } else if (len == 4 && (memcmp(s, "true", 4) == 0
+                             || memcmp(s, "True", 4) == 0)) {
+            handler_->onBoolean(true);
+        } else if (len == 5 && (memcmp(s, "false", 5) == 0
+                             || memcmp(s, "False", 5) == 0)) {
+            handler_->onBoolean(false);
+        } else {
+            error("Can't detect format");
+            return;
+        }
+        valueDone();
+        break;
+    case Token_Data:
+        len = data_decode(carry_, carrycnt_);
+        if (len < 0) {
+            error("Wrong data dytes delimiter");
+            return;
+        }
+        handler_->onData(reinterpret_cast<uint8_t *>(carry_), len);
+        valueDone();
+        break;
+    default:;
+    }
+    carrycnt_ = 0;
+}
+
+void JsonStreamParser::openContainer(char type) {
+    if (depth_ >= JSON_DEPTH_MAX) {
+        error("Too deep nesting");
+        return;
+    }
+    stack_[depth_++] = type;
+    if (type == 'L') {
+        handler_->onListBegin();
+        expect_ = Expect_ValueOrEnd;
+    } else {
+        handler_->onDictBegin();
+        expect_ = Expect_KeyOrEnd;
+    }
+}
+
+void JsonStreamParser::closeContainer(char c) {
+    char type = c == ']' ? 'L' : 'D';
+    if (depth_ == 0 || stack_[depth_ - 1] != type) {
+        error(type == 'L' ? "Wrong list format" : "Wrong dictionary format");
+        return;
+    }
+    depth_--;
+    if (type == 'L') {
+        handler_->onListEnd();
+    } else {
+        handler_->onDictEnd();
+    }
+    valueDone();
+}
+
+void JsonStreamParser::valueDone() {
+    if (depth_ == 0) {
+        handler_->onDocument();
+        expect_ = Expect_Value;
+        stop_ = true;
+    } else {
+        expect_ = Expect_CommaOrEnd;
+    }
+}
+
+void JsonStreamParser::error(const char *descr) {
+    reset();
+    expect_ = Expect_Skip;
+    stop_ = true;
+    handler_->onError(descr);
+}
+
+void JsonStreamParser::carry(const char *s, int len) {
+    if (carrycnt_ + len > carrysz_) {
+        while (carrycnt_ + len > carrysz_) {
+            carrysz_ <<= 1;
+        }
+        char *t = new char[carrysz_];
+        memcpy(t, carry_, carrycnt_);
+        delete [] carry_;
+        carry_ = t;
+    }
+    memcpy(&carry_[carrycnt_], s, len);
+    carrycnt_ += len;
+}
+
+JsonAttributeBuilder::JsonAttributeBuilder() {
+    depth_ = 0;
+    keysz_ = 64;
+    key_ = new char[keysz_];
+    key_[0] = '\0';
+    ready_ = false;
+    error_ = false;
+}
+
+JsonAttributeBuilder::~JsonAttributeBuilder() {
+    delete [] key_;
+}
+
+void JsonAttributeBuilder::reset() {
+    doc_.attr_free();
+    doc_.make_nil();
+    depth_ = 0;
+    ready_ = false;
+    error_ = false;
+}
+
+AttributeType *JsonAttributeBuilder::newValue() {
+    if (depth_ == 0) {
+        doc_.attr_free();
+        return &doc_;
+    }
+    AttributeType *top = stack_[depth_ - 1];
+    if (top->is_list()) {
+        return &top->new_list_item();
+    }
+    AttributeType &value = (*top)[key_];
+    value.attr_free();
+    return &value;
+}
+
+void JsonAttributeBuilder::onListBegin() {
+    AttributeType *v = newValue();
+    v->make_list(0);
+    stack_[depth_++] = v;
+}
+
+void JsonAttributeBuilder::onListEnd() {
+    depth_--;
+}
+
+void JsonAttributeBuilder::onDictBegin() {
+    AttributeType *v = newValue();
+    v->make_dict();
+    stack_[depth_++] = v;
+}
+
+void JsonAttributeBuilder::onDictEnd() {
+    AttributeType *v = stack_[--depth_];
+    if (!v->has_key("Type")) {
+        return;
+    }
+    if (strcmp((*v)["Type"].to_string(), IFACE_SERVICE) == 0) {
+        IService *iserv = static_cast<IService *>(
+                RISCV_get_service((*v)["ModuleName"].to_string()));
+        v->attr_free();
+        *v = AttributeType(iserv);
+    } else {
+        RISCV_printf(NULL, LOG_ERROR,
+                    "Not implemented string to dict. attribute");
+    }
+}
+
+void JsonAttributeBuilder::onKey(const char *s, int len) {
+    if (len >= keysz_) {
+        delete [] key_;
+        keysz_ = len + 64;
+        key_ = new char[keysz_];
+    }
+    memcpy(key_, s, len);
+    key_[len] = '\0';
+}
+
+void JsonAttributeBuilder::onString(const char *s, int len) {
+    newValue()->make_string(s, static_cast<unsigned>(len));
+}
+
+void JsonAttributeBuilder::onInteger(int64_t v) {
+    newValue()->make_int64(v);
+}
+
+void JsonAttributeBuilder::onFloating(double v) {
+    newValue()->make_floating(v);
+}
+
+void JsonAttributeBuilder::onBoolean(bool v) {
+    newValue()->make_boolean(v);
+}
+
+void JsonAttributeBuilder::onNil() {
+    newValue()->make_nil();
+}
+
+void JsonAttributeBuilder::onData(const uint8_t *p, int len) {
+    newValue()->make_data(static_cast<unsigned>(len), p);
+}
+
+void JsonAttributeBuilder::onDocument() {
+    ready_ = true;
+}
+
+void JsonAttributeBuilder::onError(const char *descr) {
+    RISCV_printf(NULL, LOG_ERROR, "JSON parser error: %s", descr);
+    doc_.attr_free();
+    doc_.make_nil();
+    depth_ = 0;
+    error_ = true;
+}
+
+/** Output is written while there's space, the length is counted anyway */
+struct JsonOutputType {
+    char *buf;
+    int size;
+    int pos;
+};
+
+static void json_put(JsonOutputType *out, char c) {
+    if (out->pos < out->size) {
+        out->buf[out->pos] = c;
+    }
+    out->pos++;
+}
+
+static void json_put(JsonOutputType *out, const char *s, int len) {
+    int avail = out->size - out->pos;
+    if (avail > 0) {
+        memcpy(&out->buf[out->pos], s, len < avail ? len : avail);
+    }
+    out->pos += len;
+}
+
+static void json_put_hex(JsonOutputType *out, uint64_t v) {
+    static const char HEX[] = "0123456789abcdef";
+    char tmp[20];
+    int n = sizeof(tmp);
+    do {
+        tmp[--n] = HEX[v & 0xf];
+        v >>= 4;
+    } while (v);
+    tmp[--n] = 'x';
+    tmp[--n] = '0';
+    json_put(out, &tmp[n], static_cast<int>(sizeof(tmp)) - n);
+}
+
+static void json_put_byte(JsonOutputType *out, uint8_t v) {
+    static const char HEX[] = "0123456789ABCDEF";
+    char tmp[4] = {'0', 'x', HEX[v >> 4], HEX[v & 0xf]};
+    json_put(out, tmp, 4);
+}
+
+static void json_put_quoted(JsonOutputType *out, const char *s, int len) {
+    json_put(out, '\"');
+    json_put(out, s, len);
+    json_put(out, '\"');
+}
+
+static void json_write(JsonOutputType *out, const AttributeType *attr) {
+    if (attr->is_nil()) {
+        json_put(out, "None", 4);
+    } else if (attr->is_int64() || attr->is_uint64()) {
+        json_put_hex(out, attr->to_uint64());
+    } else if (attr->is_string()) {
+        json_put_quoted(out, attr->to_string(), attr->size());
+    } else if (attr->is_bool()) {
+        if (attr->to_bool()) {
+            json_put(out, "True", 4);
+        } else {
+            json_put(out, "False", 5);
+        }
+    } else if (attr->is_list()) {
+        unsigned list_sz = attr->size();
+        json_put(out, '[');
+        for (unsigned i = 0; i < list_sz; i++) {
+            if (i) {
+                json_put(out, ',');
+            }
+            json_write(out, &(*attr)[i]);
+        }
+        json_put(out, ']');
+    } else if (attr->is_dict()) {
+        unsigned dict_sz = attr->size();
+        json_put(out, '{');
+        for (unsigned i = 0; i < dict_sz; i++) {
+            const AttributeType *key = attr->dict_key(i);
+            if (i) {
+                json_put(out, ',');
+            }
+            json_put_quoted(out, key->to_string(), key->size());
+            json_put(out, ':');
+            json_write(out, attr->dict_value(i));
+        }
+        json_put(out, '}');
+    } else if (attr->is_data()) {
+        unsigned data_sz = attr->size();
+        json_put(out, '(');
+        for (unsigned n = 0; n < data_sz; n++) {
+            if (n) {
+                json_put(out, ',');
+            }
+            json_put_byte(out, (*attr)(n));
+        }
+        json_put(out, ')');
+    } else if (attr->is_iface()) {
+        IFace *iface = attr->to_iface();
+        if (strcmp(iface->getFaceName(), IFACE_SERVICE) == 0) {
+            IService *iserv = static_cast<IService *>(iface);
+            const char *name = iserv->getObjName();
+            json_put(out, "{\"Type\":", 8);
+            json_put_quoted(out, iface->getFaceName(),
+                            static_cast<int>(strlen(iface->getFaceName())));
+            json_put(out, ",\"ModuleName\":", 14);
+            json_put_quoted(out, name, static_cast<int>(strlen(name)));
+            json_put(out, '}');
+        } else {
+            RISCV_printf(NULL, LOG_ERROR,
+                        "Not implemented interface to dict. method");
+        }
+    } else if (attr->is_floating()) {
+        char fstr[64];
+        int sz = RISCV_sprintf(fstr, sizeof(fstr), "%.4f", attr->to_float());
+        json_put(out, fstr, sz);
+    }
+}
+
+int attribute_to_json(const AttributeType *attr, char *buf, int bufsz) {
+    JsonOutputType out;
+    out.buf = buf;
+    out.size = bufsz;
+    out.pos = 0;
+    json_write(&out, attr);
+    if (out.pos < bufsz) {
+        buf[out.pos] = '\0';
+    } else if (bufsz > 0) {
+        buf[bufsz - 1] = '\0';
+    }
+    return out.pos;
+}
+
+}  // namespace debugger
@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_JSONSTREAM_H__
+#define __DEBUGGER_COMMON_JSONSTREAM_H__
+
+#include <stdint.h>
+#include "attribute.h"
+
+namespace debugger {
+
+static const int JSON_DEPTH_MAX = 64;
+
+/**
+ * @brief Callbacks of the streaming JSON parser.
+ * @details String slices point into the input buffer when the token isn't
+ *          split between frames, they aren't terminated by zero and are
+ *          valid only during the call.
+ */
+class JsonHandler {
+ public:
+    virtual ~JsonHandler() {}
+
+    virtual void onListBegin() = 0;
+    virtual void onListEnd() = 0;
+    virtual void onDictBegin() = 0;
+    virtual void onDictEnd() = 0;
+    virtual void onKey(const char *s, int len) = 0;
+    virtual void onString(const char *s, int len) = 0;
+    virtual void onInteger(int64_t v) = 0;
+    virtual void onFloating(double v) = 0;
+    virtual void onBoolean(bool v) = 0;
+    virtual void onNil() = 0;
+    virtual void onData(const uint8_t *p, int len) = 0;
+    /** Top level value is completed */
+    virtual void onDocument() = 0;
+    virtual void onError(const char *descr) = 0;
+};
+
+/**
+ * @brief Incremental SAX parser of the configuration JSON dialect.
+ * @details Accepts the same format as AttributeType::from_config(): single
+ *          or double quoted strings, None/True/False, hex and floating
+ *          numbers and data bytes (0x01,0x02). Input may be split at any
+ *          byte, only the token crossing the frame boundary is copied.
+ *          Zero byte between top level values is skipped, after an error
+ *          the input is dropped up to the next zero byte, so the parser
+ *          re-synchronizes on the next message of the TCP stream.
+ */
+class JsonStreamParser {
+ public:
+    explicit JsonStreamParser(JsonHandler *handler);
+    ~JsonStreamParser();
+
+    void reset();
+
+    /**
+     * @return Number of consumed bytes. Parsing stops after the completed
+     *         top level value or detected error.
+     */
+    int parse(const char *buf, int sz);
+
+    /** End of input completes the pending number or literal */
+    void finish();
+
+    /** Nothing is pending, the next byte starts a new top level value */
+    bool isIdle() {
+        return depth_ == 0 && token_ == Token_None && expect_ == Expect_Value;
+    }
+
+ private:
+    int continueToken(const char *buf, int i, int sz);
+    void completeToken(const char *s, int len);
+    void openContainer(char type);
+    void closeContainer(char type);
+    void valueDone();
+    void error(const char *descr);
+    void carry(const char *s, int len);
+
+ private:
+    enum EExpect {
+        Expect_Value,
+        Expect_ValueOrEnd,
+        Expect_KeyOrEnd,
+        Expect_Colon,
+        Expect_CommaOrEnd,
+        Expect_Skip
+    };
+    enum EToken {
+        Token_None,
+        Token_String,
+        Token_Key,
+        Token_Number,
+        Token_Literal,
+        Token_Data
+    };
+
+    JsonHandler *handler_;
+    char stack_[JSON_DEPTH_MAX];
+    int depth_;
+    EExpect expect_;
+    EToken token_;
+    char quote_;
+    bool stop_;
+    char *carry_;
+    int carrycnt_;
+    int carrysz_;
+};
+
+/**
+ * @brief Builds AttributeType tree from the parser callbacks.
+ * @details Dictionary {"Type":"IService","ModuleName":"name"} is converted
+ *          into the interface attribute the same way as from_config() does.
+ */
+class JsonAttributeBuilder : public JsonHandler {
+ public:
+    JsonAttributeBuilder();
+    virtual ~JsonAttributeBuilder();
+
+    void reset();
+    bool isReady() { return ready_; }
+    bool isError() { return error_; }
+    AttributeType *getDocument() { return &doc_; }
+
+    /** JsonHandler */
+    virtual void onListBegin();
+    virtual void onListEnd();
+    virtual void onDictBegin();
+    virtual void onDictEnd();
+    virtual void onKey(const char *s, int len);
+    virtual void onString(const char *s, int len);
+    virtual void onInteger(int64_t v);
+    virtual void onFloating(double v);
+    virtual void onBoolean(bool v);
+    virtual void onNil();
+    virtual void onData(const uint8_t *p, int len);
+    virtual void onDocument();
+    virtual void onError(const char *descr);
+
+ private:
+    AttributeType *newValue();
+
+ private:
+    AttributeType doc_;
+    AttributeType *stack_[JSON_DEPTH_MAX];
+    int depth_;
+    char *key_;
+    int keysz_;
+    bool ready_;
+    bool error_;
+};
+
+/**
+ * @brief Serialize attribute into the caller buffer.
+ * @details Output format is the same as of AttributeType::to_config().
+ * @return Length of the whole output without terminating zero like
+ *         snprintf() does, output is truncated if it exceeds the buffer.
+ */
+int attribute_to_json(const AttributeType *attr, char *buf, int bufsz);
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_JSONSTREAM_H__
@@ -284,9 +284,10 @@ union csr_mstatus_type {
         uint64_t FS     : 2;    // [14:13]: RW: FPU context status
         uint64_t XS     : 2;    // [16:15]: RW: extension context status
         uint64_t MPRV   : 1;    // [17] Memory privilege bit
-        uint64_t PUM    : 1;    // [18]
-        uint64_t MXR    : 1;    // [19]
-        uint64_t rsrv1  : 4;    // [23:20]
+        uint64_t SUM    : 1;    // [18] permit Supervisor User Memory access
+        uint64_t MXR    : 1;    // [19] Make eXecutable Readable
+        uint64_t TVM    : 1;    // [20] Trap Virtual Memory
+        uint64_t rsrv1  : 3;    // [23:21]
         uint64_t VM     : 5;    // [28:24] Virtualization management field
         uint64_t rsv2 : 64-30;  // [62:29]
         uint64_t SD     : 1;    // RO: [63] Bit summarizes FS/XS bits
@@ -450,6 +451,23 @@ static const char *const RISCV_IREGS_NAMES[] = {
 static const ECpuRegMapping RISCV_DEBUG_REG_MAP[] = {
     {"npc",   8, 0x7b1}, //CSR_dpc},
     {"steps", 8, 0xC02}, //CSR_insret},
+    {"mcountinhibit", 8, 0x320},
+    {"mhpmevent3",    8, 0x323},
+    {"mhpmevent4",    8, 0x324},
+    {"mhpmevent5",    8, 0x325},
+    {"mhpmevent6",    8, 0x326},
+    {"mhpmevent7",    8, 0x327},
+    {"mhpmevent8",    8, 0x328},
+    {"mhpmevent9",    8, 0x329},
+    {"mhpmevent10",   8, 0x32A},
+    {"mhpmcounter3",  8, 0xB03},
+    {"mhpmcounter4",  8, 0xB04},
+    {"mhpmcounter5",  8, 0xB05},
+    {"mhpmcounter6",  8, 0xB06},
+    {"mhpmcounter7",  8, 0xB07},
+    {"mhpmcounter8",  8, 0xB08},
+    {"mhpmcounter9",  8, 0xB09},
+    {"mhpmcounter10", 8, 0xB0A},
     {"zero",  8, 0x1000},
     {"ra",    8, 0x1001},
     {"sp",    8, 0x1002},
@@ -612,6 +612,20 @@ EIsaArmV7 decoder_arm(uint32_t ti, char *errmsg, size_t errsz);
 EIsaArmV7 decoder_thumb(uint32_t ti, uint32_t *tio,
                         char *errmsg, size_t errsz);
 
+/** Halfword with bits [15:11] = 0b11101, 0b11110, 0b11111 is 32-bit */
+inline bool isThumb32(uint32_t ti) {
+    return (ti & 0xF800) >= 0xE800;
+}
+
+struct ThumbDecodeRuleType {
+    uint32_t mask;
+    uint32_t value;
+    EIsaArmV7 instr;        // ARMV7_Total if not implemented
+};
+
+/** Ordered list of 32-bit encodings used to generate decoding tables */
+const ThumbDecodeRuleType *decoder_thumb32_rules(unsigned *total);
+
 /** Internal simulation bits only */
 static const uint64_t Interrupt_SoftwareIdx = 0;
 
@@ -29,9 +29,22 @@ CpuCortex_Functional::CpuCortex_Functional(const char *name) :
     p_psr_ = reinterpret_cast<ProgramStatusRegsiterType *>(
             &R[Reg_cpsr]);
     PC_ = &R[Reg_pc];   // redefine location of PC register in bank
+    memset(isaTableArmV7_, 0, sizeof(isaTableArmV7_));
+    thumb16_ = 0;
+    thumb32_ = 0;
+    thumb32pool_ = 0;
 }
 
 CpuCortex_Functional::~CpuCortex_Functional() {
+    if (thumb16_) {
+        delete [] thumb16_;
+    }
+    if (thumb32_) {
+        delete [] thumb32_;
+    }
+    if (thumb32pool_) {
+        delete [] thumb32pool_;
+    }
 }
 
 void CpuCortex_Functional::postinitService() {
@@ -41,6 +54,7 @@ void CpuCortex_Functional::postinitService() {
     }
     addArm7tmdiIsa();
     addThumb2Isa();
+    buildDecodeTables();
 
     CpuGeneric::postinitService();
 
@@ -91,6 +105,73 @@ unsigned CpuCortex_Functional::addSupportedInstruction(
     return 0;
 }
 
+/**
+ * Build Thumb lookup tables from the decoder rules. Candidates of each
+ * 32-bit bucket keep the rules order so that the decoding result is the
+ * same as the linear search returns.
+ */
+void CpuCortex_Functional::buildDecodeTables() {
+    char errmsg[256];
+    uint32_t tio;
+    EIsaArmV7 etype;
+
+    thumb16_ = new GenericInstruction *[THUMB16_TABLE_SIZE];
+    for (uint32_t val = 0; val < THUMB16_TABLE_SIZE; val++) {
+        thumb16_[val] = NULL;
+        if (isThumb32(val)) {
+            continue;
+        }
+        etype = decoder_thumb(val, &tio, errmsg, sizeof(errmsg));
+        if (etype < ARMV7_Total) {
+            thumb16_[val] = isaTableArmV7_[etype];
+        }
+    }
+
+    unsigned rulecnt;
+    const ThumbDecodeRuleType *rules = decoder_thumb32_rules(&rulecnt);
+    unsigned total = 0;
+    thumb32_ = new DecodeBucketType[THUMB32_TABLE_SIZE];
+    for (int i = 0; i < THUMB32_TABLE_SIZE; i++) {
+        uint32_t hw = 0xE800 + i;
+        thumb32_[i].size = 0;
+        for (unsigned n = 0; n < rulecnt; n++) {
+            if ((hw & rules[n].mask & 0xFFFF) == (rules[n].value & 0xFFFF)) {
+                thumb32_[i].size++;
+            }
+        }
+        total += thumb32_[i].size;
+    }
+
+    thumb32pool_ = new const ThumbDecodeRuleType *[total + 1];
+    total = 0;
+    for (int i = 0; i < THUMB32_TABLE_SIZE; i++) {
+        uint32_t hw = 0xE800 + i;
+        thumb32_[i].rule = &thumb32pool_[total];
+        for (unsigned n = 0; n < rulecnt; n++) {
+            if ((hw & rules[n].mask & 0xFFFF) == (rules[n].value & 0xFFFF)) {
+                thumb32pool_[total++] = &rules[n];
+            }
+        }
+    }
+}
+
+GenericInstruction *CpuCortex_Functional::decodeThumb(uint32_t ti) {
+    if (!isThumb32(ti)) {
+        return thumb16_[ti & 0xFFFF];
+    }
+    DecodeBucketType *pbucket = &thumb32_[(ti & 0xFFFF) - 0xE800];
+    for (unsigned i = 0; i < pbucket->size; i++) {
+        const ThumbDecodeRuleType *rule = pbucket->rule[i];
+        if ((ti & rule->mask) == rule->value) {
+            if (rule->instr == ARMV7_Total) {
+                return NULL;
+            }
+            return isaTableArmV7_[rule->instr];
+        }
+    }
+    return NULL;
+}
+
 /*void CpuCortex_Functional::handleTrap() {
     // Check software before checking I-bit
     if (interrupt_pending_[0] & (1ull << Interrupt_SoftwareIdx)) {
@@ -320,18 +401,23 @@ GenericInstruction *CpuCortex_Functional::decodeInstruction(Reg64Type *cache) {
     GenericInstruction *instr = NULL;
     uint32_t ti = cacheline_[0].buf32[0];
 
-    EIsaArmV7 etype;
+    EIsaArmV7 etype = ARMV7_Total;
     if (getInstrMode() == THUMB_mode) {
-        uint32_t tio;
-        etype = decoder_thumb(ti, &tio, errmsg_, sizeof(errmsg_));
-        //cacheline_[0].buf32[0] = tio;
+        instr = decodeThumb(ti);
+        if (instr == NULL) {
+            // Slow path only to get the error description
+            uint32_t tio;
+            etype = decoder_thumb(ti, &tio, errmsg_, sizeof(errmsg_));
+            //cacheline_[0].buf32[0] = tio;
+        }
     } else {
         etype = decoder_arm(ti, errmsg_, sizeof(errmsg_));
+        if (etype < ARMV7_Total) {
+            instr = isaTableArmV7_[etype];
+        }
     }
 
-    if (etype < ARMV7_Total) {
-        instr = isaTableArmV7_[etype];
-    } else {
+    if (instr == NULL && etype >= ARMV7_Total) {
         RISCV_error("ARM decoder error [%08" RV_PRI64 "x] %08x",
                     getPC(), ti);
     }
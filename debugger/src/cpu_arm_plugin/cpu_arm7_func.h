@@ -53,6 +53,10 @@ class CpuCortex_Functional : public CpuGeneric,
     /** ICpuArm */
     virtual void setInstrMode(EInstructionModes mode) {
         const uint32_t MODE[InstrModes_Total] = {0u, 1u};
+        if (icache_ && p_psr_->u.T != MODE[mode]) {
+            // Decoded instructions cache doesn't store the instruction set
+            flush(~0ull);
+        }
         p_psr_->u.T = MODE[mode];
     }
     virtual EInstructionModes getInstrMode() {
@@ -98,6 +102,8 @@ class CpuCortex_Functional : public CpuGeneric,
     
     void addArm7tmdiIsa();
     void addThumb2Isa();
+    void buildDecodeTables();
+    GenericInstruction *decodeThumb(uint32_t ti);
     unsigned addSupportedInstruction(ArmInstruction *instr);
     uint32_t hash32(uint32_t val) { return (val >> 24) & 0xf; }
 
@@ -110,6 +116,22 @@ class CpuCortex_Functional : public CpuGeneric,
     AttributeType listInstr_[INSTR_HASH_TABLE_SIZE];
     GenericInstruction *isaTableArmV7_[ARMV7_Total];
 
+    /**
+     * Thumb decoding tables generated from the decoder masks at start-up.
+     * Every 16-bit halfword resolves to a single instruction, 32-bit
+     * encodings are checked against the short list of rules selected by
+     * the first halfword.
+     */
+    static const int THUMB16_TABLE_SIZE = 1 << 16;
+    static const int THUMB32_TABLE_SIZE = 3 << 11;  // halfwords 0xE800..0xFFFF
+    struct DecodeBucketType {
+        const ThumbDecodeRuleType **rule;   // candidates in priority order
+        unsigned size;
+    };
+    GenericInstruction **thumb16_;
+    DecodeBucketType *thumb32_;
+    const ThumbDecodeRuleType **thumb32pool_;
+
     ProgramStatusRegsiterType *p_psr_;
 
     char errmsg_[256];
@@ -0,0 +1,170 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "cosim.h"
+
+namespace debugger {
+
+CoSimulator::CoSimulator(const char *name) : IService(name) {
+    registerInterface(static_cast<ICoSimulation *>(this));
+    registerAttribute("QueueSize", &queueSize_);
+    registerAttribute("CompareMemData", &compareMemData_);
+    registerAttribute("AttachTimeout", &attachTimeout_);
+
+    queueSize_.make_int64(16);
+    compareMemData_.make_boolean(true);
+    attachTimeout_.make_int64(10000);
+    stopped_.store(false);
+    qsize_ = 0;
+    flags_ = 0;
+    char tstr[256];
+    for (int i = 0; i < HART_MAX; i++) {
+        HartQueueType *q = &hart_[i];
+        q->rec = 0;
+        q->wcnt.store(0);
+        q->rcnt.store(0);
+        q->state.store(Hart_Idle);
+        q->checked = 0;
+        RISCV_sprintf(tstr, sizeof(tstr), "%s_ready%d", name, i);
+        RISCV_event_create(&q->eventReady, tstr);
+        RISCV_sprintf(tstr, sizeof(tstr), "%s_free%d", name, i);
+        RISCV_event_create(&q->eventFree, tstr);
+    }
+}
+
+CoSimulator::~CoSimulator() {
+    for (int i = 0; i < HART_MAX; i++) {
+        if (hart_[i].rec) {
+            delete [] hart_[i].rec;
+        }
+        RISCV_event_close(&hart_[i].eventReady);
+        RISCV_event_close(&hart_[i].eventFree);
+    }
+}
+
+void CoSimulator::postinitService() {
+    qsize_ = queueSize_.to_int();
+    if (qsize_ < 1) {
+        qsize_ = 1;
+    }
+    flags_ = compareMemData_.to_bool() ? TRACE_MATCH_MEMDATA : 0;
+    for (int i = 0; i < HART_MAX; i++) {
+        hart_[i].rec = new TraceBinRecordType[qsize_];
+    }
+}
+
+void CoSimulator::attachHart(uint32_t hartid) {
+    if (hartid < HART_MAX) {
+        hart_[hartid].state.store(Hart_Attached);
+    }
+}
+
+/** Unblock reference model waiting for the free slot */
+void CoSimulator::detachHart(uint32_t hartid) {
+    if (hartid < HART_MAX) {
+        hart_[hartid].state.store(Hart_Detached);
+        RISCV_event_set(&hart_[hartid].eventFree);
+    }
+}
+
+bool CoSimulator::retireReference(uint32_t hartid,
+                                  const TraceBinRecordType *rec) {
+    if (hartid >= HART_MAX || !qsize_) {
+        return true;
+    }
+    HartQueueType *q = &hart_[hartid];
+    uint32_t wcnt = q->wcnt.load(std::memory_order_relaxed);
+    uint64_t t_start = RISCV_get_time_ms();
+    while (wcnt - q->rcnt.load(std::memory_order_acquire)
+            >= static_cast<uint32_t>(qsize_)) {
+        if (stopped_.load() || q->state.load() == Hart_Detached) {
+            return false;
+        }
+        if (q->state.load() == Hart_Idle
+            && RISCV_get_time_ms() - t_start
+                > static_cast<uint64_t>(attachTimeout_.to_int64())) {
+            RISCV_error("Hart%d functional model isn't attached in %d ms",
+                        hartid, attachTimeout_.to_int());
+            stopped_.store(true);
+            return false;
+        }
+        RISCV_event_clear(&q->eventFree);
+        if (wcnt - q->rcnt.load(std::memory_order_acquire)
+                >= static_cast<uint32_t>(qsize_)) {
+            RISCV_event_wait_ms(&q->eventFree, 10);
+        }
+    }
+    if (stopped_.load()) {
+        return false;
+    }
+    q->rec[wcnt % qsize_] = *rec;
+    q->wcnt.store(wcnt + 1, std::memory_order_release);
+    RISCV_event_set(&q->eventReady);
+    return true;
+}
+
+const TraceBinRecordType *CoSimulator::nextReference(uint32_t hartid,
+                                                     int timeout_ms) {
+    if (hartid >= HART_MAX || stopped_.load()) {
+        return 0;
+    }
+    HartQueueType *q = &hart_[hartid];
+    uint32_t rcnt = q->rcnt.load(std::memory_order_relaxed);
+    if (rcnt == q->wcnt.load(std::memory_order_acquire)) {
+        RISCV_event_clear(&q->eventReady);
+        if (rcnt == q->wcnt.load(std::memory_order_acquire)) {
+            RISCV_event_wait_ms(&q->eventReady, timeout_ms);
+        }
+        if (rcnt == q->wcnt.load(std::memory_order_acquire)) {
+            return 0;
+        }
+    }
+    return &q->rec[rcnt % qsize_];
+}
+
+bool CoSimulator::checkRetired(uint32_t hartid,
+                               const TraceBinRecordType *rec) {
+    if (hartid >= HART_MAX) {
+        return true;
+    }
+    HartQueueType *q = &hart_[hartid];
+    uint32_t rcnt = q->rcnt.load(std::memory_order_relaxed);
+    const TraceBinRecordType *ref = &q->rec[rcnt % qsize_];
+    bool ret = trace_record_match(ref, rec, flags_);
+    if (!ret) {
+        stopped_.store(true);
+        reportMismatch(hartid, ref, rec);
+    }
+    q->checked++;
+    q->rcnt.store(rcnt + 1, std::memory_order_release);
+    RISCV_event_set(&q->eventFree);
+    return ret;
+}
+
+void CoSimulator::reportMismatch(uint32_t hartid,
+                                 const TraceBinRecordType *ref,
+                                 const TraceBinRecordType *rec) {
+    char tref[4096];
+    char trec[4096];
+    trace_record_to_text(ref, tref, sizeof(tref));
+    trace_record_to_text(rec, trec, sizeof(trec));
+    RISCV_error("Hart%d mismatch after %" RV_PRI64 "d checked instructions\n"
+                "Reference:\n%sFunctional:\n%s",
+                hartid, hart_[hartid].checked, tref, trec);
+}
+
+}  // namespace debugger
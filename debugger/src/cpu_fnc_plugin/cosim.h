@@ -0,0 +1,87 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_COSIM_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_COSIM_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icosim.h"
+#include <atomic>
+
+namespace debugger {
+
+/**
+ * Per-hart single producer (RTL Tracer) single consumer (functional
+ * model) queues of the retired instructions. Reference model runs ahead
+ * at most QueueSize instructions and stops after the first mismatch.
+ */
+class CoSimulator : public IService,
+                    public ICoSimulation {
+ public:
+    explicit CoSimulator(const char *name);
+    virtual ~CoSimulator();
+
+    /** IService interface */
+    virtual void postinitService() override;
+
+    /** ICoSimulation */
+    virtual void attachHart(uint32_t hartid) override;
+    virtual void detachHart(uint32_t hartid) override;
+    virtual bool retireReference(uint32_t hartid,
+                                 const TraceBinRecordType *rec) override;
+    virtual const TraceBinRecordType *nextReference(uint32_t hartid,
+                                                    int timeout_ms) override;
+    virtual bool checkRetired(uint32_t hartid,
+                              const TraceBinRecordType *rec) override;
+
+ private:
+    void reportMismatch(uint32_t hartid,
+                        const TraceBinRecordType *ref,
+                        const TraceBinRecordType *rec);
+
+ private:
+    static const int HART_MAX = 8;
+
+    enum EHartState {
+        Hart_Idle,          // reference could retire before attaching
+        Hart_Attached,
+        Hart_Detached
+    };
+
+    AttributeType queueSize_;
+    AttributeType compareMemData_;
+    AttributeType attachTimeout_;
+
+    std::atomic<bool> stopped_;
+    int qsize_;
+    int flags_;
+    struct HartQueueType {
+        TraceBinRecordType *rec;
+        std::atomic<uint32_t> wcnt;
+        std::atomic<uint32_t> rcnt;
+        std::atomic<int> state;
+        uint64_t checked;
+        event_def eventReady;
+        event_def eventFree;
+    } hart_[HART_MAX];
+};
+
+DECLARE_CLASS(CoSimulator)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_COSIM_H__
@@ -32,12 +32,40 @@ CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     registerAttribute("ListExtISA", &listExtISA_);
     registerAttribute("CLINT", &clint_);
     registerAttribute("PLIC", &plic_);
+    registerAttribute("HpmCounters", &hpmCounters_);
+    registerAttribute("MprvHighAddrOnly", &mprvHighAddr_);
+
+    hpmCounters_.make_uint64(8);
+    mprvHighAddr_.make_boolean(false);
+    trapValue_ = 0;
+    stackProtection_ = false;
+    memset(hpmEventMask_, 0, sizeof(hpmEventMask_));
+    memset(hpmITag_, 0, sizeof(hpmITag_));
+    memset(hpmDTag_, 0, sizeof(hpmDTag_));
 
     mmuReservatedAddr_ = 0;
     mmuReservedAddrWatchdog_ = 0;
+    mmuMode_ = SATP_MODE_BARE;
+    mmuAsid_ = 0;
+    mmuRootAddr_ = 0;
+    mmuPageFault_ = false;
+    memset(&itlb_, 0, sizeof(itlb_));
+    memset(&dtlb_, 0, sizeof(dtlb_));
+    decode32_ = 0;
+    decode32pool_ = 0;
+    decode16_ = 0;
 }
 
 CpuRiver_Functional::~CpuRiver_Functional() {
+    if (decode32_) {
+        delete [] decode32_;
+    }
+    if (decode32pool_) {
+        delete [] decode32pool_;
+    }
+    if (decode16_) {
+        delete [] decode16_;
+    }
 }
 
 void CpuRiver_Functional::postinitService() {
@@ -60,6 +88,12 @@ void CpuRiver_Functional::postinitService() {
             addIsaExtensionM();
         }
     }
+    buildDecodeTables();
+
+    if (hpmCounters_.to_uint64() > 29) {
+        RISCV_error("Not more than %d performance counters", 29);
+        hpmCounters_.make_uint64(29);
+    }
 
     // Power-on
     reset(0);
@@ -105,8 +139,72 @@ unsigned CpuRiver_Functional::addSupportedInstruction(
     return 0;
 }
 
+/**
+ * Build lookup tables from the registered instruction set. Candidates
+ * of each 32-bit bucket keep the order of the hash lists so that the
+ * decoding result is the same as the linear search returns.
+ */
+void CpuRiver_Functional::buildDecodeTables() {
+    RiscvInstruction *instr;
+    uint32_t keymask;
+    uint32_t keyop;
+    unsigned total = 0;
+
+    decode32_ = new DecodeBucketType[DECODE32_TABLE_SIZE];
+    for (uint32_t key = 0; key < DECODE32_TABLE_SIZE; key++) {
+        AttributeType &lst = listInstr_[key & 0x1F];
+        decode32_[key].size = 0;
+        for (unsigned i = 0; i < lst.size(); i++) {
+            instr = static_cast<RiscvInstruction *>(lst[i].to_iface());
+            keymask = decodeKey32(instr->mask());
+            keyop = decodeKey32(instr->opcode());
+            if ((key & keymask) == keyop) {
+                decode32_[key].size++;
+            }
+        }
+        total += decode32_[key].size;
+    }
+
+    decode32pool_ = new RiscvInstruction *[total + 1];
+    total = 0;
+    for (uint32_t key = 0; key < DECODE32_TABLE_SIZE; key++) {
+        AttributeType &lst = listInstr_[key & 0x1F];
+        decode32_[key].instr = &decode32pool_[total];
+        for (unsigned i = 0; i < lst.size(); i++) {
+            instr = static_cast<RiscvInstruction *>(lst[i].to_iface());
+            keymask = decodeKey32(instr->mask());
+            keyop = decodeKey32(instr->opcode());
+            if ((key & keymask) == keyop) {
+                decode32pool_[total++] = instr;
+            }
+        }
+    }
+
+    // Compressed instructions depend only on the lower halfword:
+    uint32_t payload[2] = {0};
+    decode16_ = new RiscvInstruction *[DECODE16_TABLE_SIZE];
+    for (uint32_t val = 0; val < DECODE16_TABLE_SIZE; val++) {
+        decode16_[val] = NULL;
+        if ((val & 0x3) == 0x3) {
+            continue;
+        }
+        AttributeType &lst = listInstr_[hash16(static_cast<uint16_t>(val))];
+        payload[0] = val;
+        for (unsigned i = 0; i < lst.size(); i++) {
+            instr = static_cast<RiscvInstruction *>(lst[i].to_iface());
+            if (instr->parse(payload)) {
+                decode16_[val] = instr;
+                break;
+            }
+        }
+    }
+}
+
 /** Check stack protection exceptions: */
 void CpuRiver_Functional::checkStackProtection() {
+    if (!stackProtection_) {
+        return;
+    }
     uint64_t mstackovr = readCSR(CSR_mstackovr);
     uint64_t mstackund = readCSR(CSR_mstackund);
     uint64_t sp = portRegs_.read(Reg_sp).val;
@@ -119,17 +217,25 @@ void CpuRiver_Functional::checkStackProtection() {
     }
 }
 
+/**
+ * Exceptions in U and S modes are taken in S-mode when delegated by
+ * medeleg, otherwise and in M-mode they are taken in M-mode.
+ */
 void CpuRiver_Functional::handleException(int e) {
     if (e == EXCEPTION_Breakpoint && estate_ == CORE_ProgbufExec) {
         exitProgbufExec();
         return;
     }
 
-    if (estate_ != CORE_ProgbufExec) {
+    bool delegated = estate_ != CORE_ProgbufExec
+                  && cur_prv_level <= PRV_S
+                  && ((readCSR(CSR_medeleg) >> e) & 0x1);
+    if (estate_ != CORE_ProgbufExec && !delegated) {
         csr_mcause_type mcause;
         mcause.bits.irq = 0;
         mcause.bits.code = e;
         writeCSR(CSR_mcause, mcause.value);
+        writeCSR(CSR_mtval, trapValue_);
     }
 
     DCSR_TYPE::ValueType dcsr;
@@ -140,19 +246,34 @@ void CpuRiver_Functional::handleException(int e) {
         return;
     }
 
+    hpmEvent(HpmEvent_Exception);
+    if (delegated) {
+        writeCSR(CSR_scause, static_cast<uint64_t>(e));
+        writeCSR(CSR_stval, trapValue_);
+        switchContext(PRV_S);
+        setNPC(readCSR(CSR_stvec) & ~0x3ull);
+        return;
+    }
     switchContext(PRV_M);
 
     uint64_t mtvec = readCSR(CSR_mtvec) & ~0x3ull;
     setNPC(mtvec);
 }
 
-void CpuRiver_Functional::handleInterrupts() {
+/**
+ * Machine interrupts are taken in M-mode. Supervisor interrupts go to
+ * S-mode when delegated by mideleg, then they never interrupt M-mode.
+ */
+bool CpuRiver_Functional::selectInterrupt(uint64_t *cause, uint32_t *prvnxt) {
     int ctx = 0;
     csr_mcause_type mcause;
     csr_mstatus_type mstatus;
     mstatus.value = readCSR(CSR_mstatus);
-    if (mstatus.bits.MIE == 0) {
-        return;
+    bool mena = cur_prv_level != PRV_M || mstatus.bits.MIE;
+    bool sena = cur_prv_level == PRV_U
+             || (cur_prv_level == PRV_S && mstatus.bits.SIE);
+    if (!mena && !sena) {
+        return false;
     }
 
     csr_mie_type mie;
@@ -160,7 +281,7 @@ void CpuRiver_Functional::handleInterrupts() {
 
     // Check software interrupt
     mcause.value = 0;
-    if (mie.bits.MSIE == 1) {
+    if (mena && mie.bits.MSIE == 1) {
         if (iirqloc_->getPendingRequest(2*hartid_.to_int())) {
             mcause.bits.irq = 1;
             mcause.bits.code = 3;
@@ -168,7 +289,7 @@ void CpuRiver_Functional::handleInterrupts() {
     }
 
     // Check mtimer interrupt
-    if (!mcause.bits.irq && mie.bits.MTIE == 1) {
+    if (mena && !mcause.bits.irq && mie.bits.MTIE == 1) {
         if (iirqloc_->getPendingRequest(2*hartid_.to_int() + 1)) {
             mcause.bits.irq = 1;
             mcause.bits.code = 7;
@@ -176,7 +297,7 @@ void CpuRiver_Functional::handleInterrupts() {
     }
 
     // Check PLIC interrupt request
-    if (!mcause.bits.irq && mie.bits.MEIE == 1) {
+    if (mena && !mcause.bits.irq && mie.bits.MEIE == 1) {
         // external interrupt disabled
         int irqidx = iirqext_->getPendingRequest(ctx);
         if (irqidx != IRQ_REQUEST_NONE) {
@@ -185,32 +306,109 @@ void CpuRiver_Functional::handleInterrupts() {
         }
     }
 
-    if (mcause.bits.irq) {
-        writeCSR(CSR_mcause, mcause.value);
+    // Supervisor interrupts in priority order SEI, SSI, STI
+    *prvnxt = PRV_M;
+    uint64_t pending = 0;
+    if (!mcause.bits.irq && (mie.value & MIP_S_MASK)) {
+        pending = readPendingS(mie.value);
+    }
+    if (pending) {
+        static const unsigned SIRQ_ORDER[3] = {9, 1, 5};
+        uint64_t mideleg = readCSR(CSR_mideleg);
+        for (int i = 0; i < 3; i++) {
+            unsigned code = SIRQ_ORDER[i];
+            if (((pending >> code) & 0x1) == 0) {
+                continue;
+            }
+            bool todeleg = ((mideleg >> code) & 0x1) != 0;
+            if (todeleg ? sena : mena) {
+                mcause.bits.irq = 1;
+                mcause.bits.code = code;
+                *prvnxt = todeleg ? PRV_S : PRV_M;
+                break;
+            }
+        }
+    }
+    *cause = mcause.value;
+    return mcause.bits.irq != 0;
+}
+
+void CpuRiver_Functional::handleInterrupts() {
+    csr_mcause_type mcause;
+    uint32_t prvnxt;
+    if (!selectInterrupt(&mcause.value, &prvnxt)) {
+        return;
+    }
 
+    uint64_t xtvec;
+    if (prvnxt == PRV_S) {
+        writeCSR(CSR_scause, mcause.value);
+        hpmEvent(HpmEvent_Interrupt);
+        switchContext(PRV_S);
+        xtvec = readCSR(CSR_stvec);
+    } else {
+        writeCSR(CSR_mcause, mcause.value);
+        hpmEvent(HpmEvent_Interrupt);
         switchContext(PRV_M);
+        xtvec = readCSR(CSR_mtvec);
+    }
 
-        uint64_t mtvec = readCSR(CSR_mtvec);
-        uint64_t mtvecmode = mtvec & 0x3;
-        mtvec &= ~0x3ull;
-        // Vector table only for interrupts (not for exceptions):
-        if (mtvecmode == 0x1) {
-            setNPC(mtvec + 4 * mcause.bits.code);
-        } else {
-            setNPC(mtvec);
-        }
+    uint64_t xtvecmode = xtvec & 0x3;
+    xtvec &= ~0x3ull;
+    // Vector table only for interrupts (not for exceptions):
+    if (xtvecmode == 0x1) {
+        setNPC(xtvec + 4 * mcause.bits.code);
+    } else {
+        setNPC(xtvec);
+    }
+}
+
+/**
+ * Interrupts are enabled only by CSR writes and xRET that end the basic
+ * block, so the check is done once at the block start.
+ */
+bool CpuRiver_Functional::isTrapCheckRequired() {
+    if (stackProtection_) {
+        return true;
     }
+    csr_mstatus_type mstatus;
+    mstatus.value = readCSR(CSR_mstatus);
+    return cur_prv_level != PRV_M || mstatus.bits.MIE;
 }
 
+/**
+ * SSIP, STIP and SEIP are set by M-mode software through mip, SEIP is also
+ * raised by PLIC context of S-mode.
+ */
+uint64_t CpuRiver_Functional::readPendingS(uint64_t mie) {
+    RISCV_mutex_lock(&mutex_csr_);
+    uint64_t ret = portCSR_.read(CSR_mip).val & MIP_S_MASK;
+    RISCV_mutex_unlock(&mutex_csr_);
+    csr_mip_type mip;
+    mip.value = 0;
+    mip.bits.SEIP = 1;
+    if ((mie & mip.value) && contextid_.is_list() && contextid_.size() > PRV_S
+        && iirqext_->getPendingRequest(
+            contextid_[static_cast<unsigned>(PRV_S)].to_int())
+            != IRQ_REQUEST_NONE) {
+        ret |= mip.value;
+    }
+    return ret & mie;
+}
+
+/** Trap entry: xPP, xPIE and xIE fields of mstatus and xepc */
 void CpuRiver_Functional::switchContext(uint32_t prvnxt) {
-    // All traps handle via machine mode while CSR mdelegate
-    // doesn't setup other.
-    // @todo delegating
     csr_mstatus_type mstatus;
     mstatus.value = readCSR(CSR_mstatus);
-    mstatus.bits.MPP = cur_prv_level;
-    mstatus.bits.MPIE = (mstatus.value >> cur_prv_level) & 0x1;
-    mstatus.bits.MIE = 0;
+    if (prvnxt == PRV_S) {
+        mstatus.bits.SPP = cur_prv_level;
+        mstatus.bits.SPIE = mstatus.bits.SIE;
+        mstatus.bits.SIE = 0;
+    } else {
+        mstatus.bits.MPP = cur_prv_level;
+        mstatus.bits.MPIE = mstatus.bits.MIE;
+        mstatus.bits.MIE = 0;
+    }
     cur_prv_level = prvnxt;
     writeCSR(CSR_mstatus, mstatus.value);
 
@@ -232,35 +430,440 @@ void CpuRiver_Functional::reset(IFace *isource) {
 
     cur_prv_level = PRV_M;           // Current privilege level
     mmuReservedAddrWatchdog_ = 0;
+    mmuMode_ = SATP_MODE_BARE;
+    mmuAsid_ = 0;
+    mmuRootAddr_ = 0;
+    mmuPageFault_ = false;
+    memset(&itlb_, 0, sizeof(itlb_));
+    memset(&dtlb_, 0, sizeof(dtlb_));
+    memset(hpmITag_, 0, sizeof(hpmITag_));
+    memset(hpmDTag_, 0, sizeof(hpmDTag_));
+    hpmUpdateEvents();
+    updateStackProtection();
+}
+
+/** LR/SC reservation is kept, so that SC after restore succeeds */
+void CpuRiver_Functional::saveSnapshot(ISnapshotStream *s) {
+    CpuGeneric::saveSnapshot(s);
+    s->writeUInt64(mmuReservatedAddr_);
+    s->writeUInt64(mmuReservedAddrWatchdog_);
+}
+
+/**
+ * CSR port is restored before the CPU section, so the translation
+ * state is derived from satp and TLBs start empty. Performance counters
+ * and their event selectors are the part of CSR port.
+ */
+bool CpuRiver_Functional::restoreSnapshot(ISnapshotStream *s) {
+    if (!CpuGeneric::restoreSnapshot(s)) {
+        return false;
+    }
+    uint64_t satp = readCSR(CSR_satp);
+    mmuMode_ = satp >> 60;
+    mmuAsid_ = (satp >> 44) & 0xFFFF;
+    mmuRootAddr_ = (satp & ((1ull << 44) - 1)) << 12;
+    mmuReservatedAddr_ = s->readUInt64();
+    mmuReservedAddrWatchdog_ = s->readUInt64();
+    mmuPageFault_ = false;
+    memset(&itlb_, 0, sizeof(itlb_));
+    memset(&dtlb_, 0, sizeof(dtlb_));
+    hpmUpdateEvents();
+    updateStackProtection();
+    return true;
 }
 
 GenericInstruction *CpuRiver_Functional::decodeInstruction(Reg64Type *cache) {
     RiscvInstruction *instr = NULL;
-    int hash_idx = hash32(cacheline_[0].buf32[0]);
-    for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
-        instr = static_cast<RiscvInstruction *>(
-                        listInstr_[hash_idx][i].to_iface());
-        if (instr->parse(cacheline_[0].buf32)) {
-            break;
+    uint32_t val = cache[0].buf32[0];
+    if ((val & 0x3) != 0x3) {
+        // Compressed instruction:
+        instr = decode16_[val & 0xFFFF];
+    } else {
+        DecodeBucketType *pbucket = &decode32_[decodeKey32(val)];
+        for (unsigned i = 0; i < pbucket->size; i++) {
+            if (pbucket->instr[i]->parse(cache[0].buf32)) {
+                instr = pbucket->instr[i];
+                break;
+            }
+        }
+    }
+    return instr;
+}
+
+/**
+ * System instructions (CSR access, xRET, ECALL, EBREAK, WFI), fences and
+ * jumps end the basic block. Conditional branches stay inside of the block
+ * and leave it only when taken.
+ */
+bool CpuRiver_Functional::isBlockTerminator(Reg64Type *payload) {
+    uint32_t val = payload->buf32[0];
+    if ((val & 0x3) == 0x3) {
+        switch ((val >> 2) & 0x1F) {
+        case 0x03:      // MISC-MEM: FENCE, FENCE.I
+        case 0x19:      // JALR
+        case 0x1B:      // JAL
+        case 0x1C:      // SYSTEM
+            return true;
+        default:;
         }
-        instr = NULL;
+        return false;
     }
-    // Check compressed instructions:
-    if (instr == NULL) {
-        hash_idx = hash16(cacheline_[0].buf16[0]);
-        for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
-            instr = static_cast<RiscvInstruction *>(
-                            listInstr_[hash_idx][i].to_iface());
-            if (instr->parse(cacheline_[0].buf32)) {
+    uint32_t funct3 = (val >> 13) & 0x7;
+    if ((val & 0x3) == 0x1 && funct3 == 0x5) {
+        return true;    // C.J
+    }
+    if ((val & 0x3) == 0x2 && funct3 == 0x4 && ((val >> 2) & 0x1F) == 0) {
+        return true;    // C.JR, C.JALR, C.EBREAK
+    }
+    return false;
+}
+
+/**
+ * Data access with the address translation. Effective privilege level
+ * is taken from mstatus.MPP when mstatus.MPRV is set. With MprvHighAddrOnly
+ * the model behaves as River RTL: M-mode with MPRV=1 accesses addresses
+ * with zero bits [63:48] physically and doesn't check PTE.U bit.
+ */
+ETransStatus CpuRiver_Functional::dma_memop(Axi4TransactionType *tr) {
+    mmuPageFault_ = false;
+    if (mmuMode_ == SATP_MODE_BARE) {
+        hpmMemop(tr);
+        return CpuGeneric::dma_memop(tr);
+    }
+    csr_mstatus_type mstatus;
+    mstatus.value = readCSR(CSR_mstatus);
+    uint64_t prv = cur_prv_level;
+    if (prv == PRV_M && mstatus.bits.MPRV) {
+        if (!mprvHighAddr_.to_bool()) {
+            prv = mstatus.bits.MPP;
+        } else if ((tr->addr >> 48) != 0) {
+            prv = mstatus.bits.MPP;
+            mstatus.bits.SUM = 1;
+        }
+    }
+    if (prv == PRV_M) {
+        hpmMemop(tr);
+        return CpuGeneric::dma_memop(tr);
+    }
+
+    ETransStatus ret;
+    uint64_t vaddr = tr->addr;
+    uint64_t paddr;
+    bool we = tr->action == MemAction_Write;
+    if (!mmuTranslate(vaddr, we ? MMU_Write : MMU_Read, prv,
+                      mstatus.value, &paddr)) {
+        generateException(we ? EXCEPTION_StorePageFault
+                             : EXCEPTION_LoadPageFault, vaddr);
+        mmuPageFault_ = true;
+        return TRANS_ERROR;
+    }
+    tr->addr = paddr;
+    hpmMemop(tr);
+    ret = CpuGeneric::dma_memop(tr);
+    tr->addr = vaddr;
+    return ret;
+}
+
+bool CpuRiver_Functional::translateFetch(uint64_t vaddr, uint64_t *paddr) {
+    bool ret = true;
+    if (mmuMode_ == SATP_MODE_BARE || cur_prv_level == PRV_M) {
+        *paddr = vaddr;
+    } else {
+        ret = mmuTranslate(vaddr, MMU_Exec, cur_prv_level,
+                           readCSR(CSR_mstatus), paddr);
+    }
+    if (ret && hpmEventMask_[HpmEvent_ICacheMiss]
+        && hpmCacheMiss(hpmITag_, *paddr)) {
+        hpmCount(HpmEvent_ICacheMiss);
+    }
+    return ret;
+}
+
+bool CpuRiver_Functional::translateDebug(uint64_t vaddr, uint64_t *paddr) {
+    uint64_t pte;
+    uint64_t pte_addr;
+    int lvl;
+    if (mmuMode_ == SATP_MODE_BARE || cur_prv_level == PRV_M) {
+        *paddr = vaddr;
+        return true;
+    }
+    if (!mmuWalk(vaddr, &pte, &pte_addr, &lvl)) {
+        return false;
+    }
+    uint64_t mask = (1ull << (12 + 9*lvl)) - 1;
+    *paddr = (((pte >> 10) & ((1ull << 44) - 1)) << 12) | (vaddr & mask);
+    return true;
+}
+
+/**
+ * Instruction fetch. 32-bits instruction may cross the page boundary,
+ * the second halfword is translated only when it is really needed.
+ */
+ETransStatus CpuRiver_Functional::ifetch_memop(Axi4TransactionType *tr) {
+    mmuPageFault_ = false;
+    if (mmuMode_ == SATP_MODE_BARE || cur_prv_level == PRV_M) {
+        return CpuGeneric::dma_memop(tr);
+    }
+
+    ETransStatus ret;
+    uint64_t vaddr = tr->addr;
+    uint64_t paddr;
+    uint64_t mstatus = readCSR(CSR_mstatus);
+    unsigned sz = tr->xsize;
+    unsigned sz0 = 0x1000 - static_cast<unsigned>(vaddr & 0xFFF);
+    if (!mmuTranslate(vaddr, MMU_Exec, cur_prv_level, mstatus, &paddr)) {
+        generateException(EXCEPTION_InstrPageFault, vaddr);
+        mmuPageFault_ = true;
+        return TRANS_ERROR;
+    }
+    tr->addr = paddr;
+    if (sz0 >= sz) {
+        ret = CpuGeneric::dma_memop(tr);
+        tr->addr = vaddr;
+        return ret;
+    }
+
+    Reg64Type rdata;
+    tr->xsize = sz0;
+    ret = CpuGeneric::dma_memop(tr);
+    rdata.val = tr->rpayload.b64[0];
+    if (ret == TRANS_OK && (rdata.buf16[0] & 0x3) == 0x3) {
+        if (!mmuTranslate(vaddr + sz0, MMU_Exec, cur_prv_level, mstatus,
+                          &paddr)) {
+            generateException(EXCEPTION_InstrPageFault, vaddr + sz0);
+            mmuPageFault_ = true;
+            ret = TRANS_ERROR;
+        } else {
+            tr->addr = paddr;
+            tr->xsize = sz - sz0;
+            ret = CpuGeneric::dma_memop(tr);
+            memcpy(&rdata.buf[sz0], tr->rpayload.b8, sz - sz0);
+        }
+    }
+    tr->rpayload.b64[0] = rdata.val;
+    tr->addr = vaddr;
+    tr->xsize = sz;
+    return ret;
+}
+
+bool CpuRiver_Functional::mmuCheckAccess(uint64_t pte, int access,
+                                         uint64_t prv, uint64_t mstatus) {
+    csr_mstatus_type st;
+    st.value = mstatus;
+    if (pte & PTE_U) {
+        // S-mode never executes user pages, data access requires SUM
+        if (prv == PRV_S && (access == MMU_Exec || st.bits.SUM == 0)) {
+            return false;
+        }
+    } else if (prv == PRV_U) {
+        return false;
+    }
+    switch (access) {
+    case MMU_Exec:
+        return (pte & PTE_X) != 0;
+    case MMU_Write:
+        return (pte & PTE_W) != 0;
+    default:
+        return (pte & PTE_R) != 0
+            || ((pte & PTE_X) != 0 && st.bits.MXR != 0);
+    }
+}
+
+/**
+ * Sv39/Sv48 address translation: software TLB lookup and page table walk
+ * on miss. Accessed and Dirty bits are updated by the walker.
+ */
+bool CpuRiver_Functional::mmuTranslate(uint64_t vaddr, int access,
+                                       uint64_t prv, uint64_t mstatus,
+                                       uint64_t *paddr) {
+    TlbType *tlb = access == MMU_Exec ? &itlb_ : &dtlb_;
+    uint64_t adbits = PTE_A | (access == MMU_Write ? PTE_D : 0);
+    TlbEntryType *e = &tlb->direct[(vaddr >> 12) & (TLB_DIRECT_SIZE - 1)];
+    if (!e->valid || e->vaddr != (vaddr & ~e->mask)
+        || (e->asid != mmuAsid_ && (e->pte & PTE_G) == 0)) {
+        e = 0;
+        for (int i = 0; i < TLB_ASSOC_SIZE; i++) {
+            TlbEntryType *p = &tlb->assoc[i];
+            if (p->valid && p->vaddr == (vaddr & ~p->mask)
+                && (p->asid == mmuAsid_ || (p->pte & PTE_G) != 0)) {
+                e = p;
                 break;
             }
-            instr = NULL;
         }
     }
-    if (mmuReservedAddrWatchdog_) {
-        mmuReservedAddrWatchdog_--;
+    if (e && (e->pte & adbits) == adbits) {
+        if (!mmuCheckAccess(e->pte, access, prv, mstatus)) {
+            return false;
+        }
+        *paddr = e->paddr | (vaddr & e->mask);
+        return true;
+    }
+
+    // Page table walk:
+    hpmEvent(HpmEvent_TlbMiss);
+    uint64_t pte;
+    uint64_t pte_addr;
+    int lvl;
+    if (!mmuWalk(vaddr, &pte, &pte_addr, &lvl)) {
+        return false;
+    }
+    uint64_t mask = (1ull << (12 + 9*lvl)) - 1;
+    uint64_t pbase = ((pte >> 10) & ((1ull << 44) - 1)) << 12;
+    if (!mmuCheckAccess(pte, access, prv, mstatus)) {
+        return false;
+    }
+    if ((pte & adbits) != adbits) {
+        Axi4TransactionType tr;
+        pte |= adbits;
+        tr.source_idx = sysBusMasterID_.to_int();
+        tr.xsize = 8;
+        tr.action = MemAction_Write;
+        tr.addr = pte_addr;
+        tr.wstrb = 0xFF;
+        tr.wpayload.b64[0] = pte;
+        if (isysbus_->b_transport(&tr) == TRANS_ERROR) {
+            return false;
+        }
+    }
+
+    if (lvl == 0) {
+        e = &tlb->direct[(vaddr >> 12) & (TLB_DIRECT_SIZE - 1)];
+    } else {
+        e = &tlb->assoc[tlb->assocNext];
+        tlb->assocNext = (tlb->assocNext + 1) % TLB_ASSOC_SIZE;
+    }
+    e->vaddr = vaddr & ~mask;
+    e->paddr = pbase;
+    e->mask = mask;
+    e->pte = pte & 0xFF;
+    e->asid = mmuAsid_;
+    e->valid = true;
+
+    *paddr = pbase | (vaddr & mask);
+    return true;
+}
+
+/**
+ * Page table walk without side effects. Returns the leaf PTE, its address
+ * and level, the super-page alignment is checked.
+ */
+bool CpuRiver_Functional::mmuWalk(uint64_t vaddr, uint64_t *pte,
+                                  uint64_t *pte_addr, int *lvl) {
+    int levels = mmuMode_ == SATP_MODE_SV48 ? 4 : 3;
+    int vabits = 12 + 9*levels;
+    int64_t vsign = static_cast<int64_t>(vaddr) >> (vabits - 1);
+    if (vsign != 0 && vsign != -1) {
+        return false;       // not canonical address
+    }
+
+    Axi4TransactionType tr;
+    uint64_t a = mmuRootAddr_;
+    int i;
+    tr.source_idx = sysBusMasterID_.to_int();
+    tr.xsize = 8;
+    *pte = 0;
+    for (i = levels - 1; i >= 0; i--) {
+        *pte_addr = a + ((vaddr >> (12 + 9*i)) & 0x1FF) * 8;
+        tr.action = MemAction_Read;
+        tr.addr = *pte_addr;
+        tr.wstrb = 0;
+        if (isysbus_->b_transport(&tr) == TRANS_ERROR) {
+            return false;
+        }
+        *pte = tr.rpayload.b64[0];
+        if ((*pte & PTE_V) == 0 || ((*pte & PTE_R) == 0 && (*pte & PTE_W))) {
+            return false;
+        }
+        if (*pte & (PTE_R | PTE_X)) {
+            break;
+        }
+        a = ((*pte >> 10) & ((1ull << 44) - 1)) << 12;
+    }
+    if (i < 0) {
+        return false;
+    }
+    uint64_t mask = (1ull << (12 + 9*i)) - 1;
+    if ((((*pte >> 10) & ((1ull << 44) - 1)) << 12) & mask) {
+        return false;       // misaligned super-page
+    }
+    *lvl = i;
+    return true;
+}
+
+/**
+ * Recompute masks of the counters incremented by each event. Counters
+ * with the set mcountinhibit bit are skipped.
+ */
+void CpuRiver_Functional::hpmUpdateEvents() {
+    uint64_t inhibit = readCSR(CSR_mcountinhibit);
+    uint64_t ev;
+    memset(hpmEventMask_, 0, sizeof(hpmEventMask_));
+    for (uint32_t i = 0; i < hpmCounters_.to_uint32(); i++) {
+        ev = readCSR(CSR_mhpmevent3 + i);
+        if (((inhibit >> (i + 3)) & 0x1) == 0
+            && ev != HpmEvent_None && ev < HpmEvent_Total) {
+            hpmEventMask_[ev] |= 1u << i;
+        }
+    }
+}
+
+void CpuRiver_Functional::hpmCount(int ev) {
+    uint64_t *cnt = &portCSR_.getpR64()[CSR_mhpmcounter3];
+    for (uint32_t t = hpmEventMask_[ev]; t; t >>= 1, cnt++) {
+        if (t & 0x1) {
+            (*cnt)++;
+        }
+    }
+}
+
+/**
+ * Loads and stores of the program. Accesses from the program buffer are
+ * issued by debugger and not counted, the same as in RTL.
+ */
+void CpuRiver_Functional::hpmMemop(Axi4TransactionType *tr) {
+    if (estate_ == CORE_ProgbufExec) {
+        return;
+    }
+    hpmEvent(tr->action == MemAction_Write ? HpmEvent_Store : HpmEvent_Load);
+    if (hpmEventMask_[HpmEvent_DCacheMiss]
+        && hpmCacheMiss(hpmDTag_, tr->addr)) {
+        hpmCount(HpmEvent_DCacheMiss);
+    }
+}
+
+/** Tag is stored as line index + 1, so zero means the empty line */
+bool CpuRiver_Functional::hpmCacheMiss(uint64_t *tags, uint64_t addr) {
+    uint64_t line = (addr >> HPM_CACHE_LINE_SHIFT) + 1;
+    uint64_t *tag = &tags[line & (HPM_CACHE_LINES - 1)];
+    if (*tag == line) {
+        return false;
+    }
+    *tag = line;
+    return true;
+}
+
+/**
+ * SFENCE.VMA: vaddr = ~0 flushes all pages, asid = ~0 flushes all address
+ * spaces. Global mappings are flushed only with all address spaces.
+ */
+void CpuRiver_Functional::mmuFlush(uint64_t vaddr, uint64_t asid) {
+    TlbType *tlbs[2] = {&itlb_, &dtlb_};
+    for (int n = 0; n < 2; n++) {
+        for (int i = 0; i < TLB_DIRECT_SIZE + TLB_ASSOC_SIZE; i++) {
+            TlbEntryType *e = i < TLB_DIRECT_SIZE ? &tlbs[n]->direct[i]
+                            : &tlbs[n]->assoc[i - TLB_DIRECT_SIZE];
+            if (!e->valid) {
+                continue;
+            }
+            if (vaddr != ~0ull && e->vaddr != (vaddr & ~e->mask)) {
+                continue;
+            }
+            if (asid != ~0ull && (e->asid != asid || (e->pte & PTE_G))) {
+                continue;
+            }
+            e->valid = false;
+        }
     }
-    return instr;
 }
 
 void CpuRiver_Functional::generateIllegalOpcode() {
@@ -356,6 +959,26 @@ void CpuRiver_Functional::writeRegDbg(uint32_t regno, uint64_t val) {
     }
 }
 
+bool CpuRiver_Functional::isCsrAccessIllegal(uint32_t regno) {
+    uint64_t prv = getPrvLevel();
+    if (prv == PRV_M) {
+        return false;
+    }
+    if (regno == CSR_satp) {
+        csr_mstatus_type mstatus;
+        mstatus.value = readCSR(CSR_mstatus);
+        return prv == PRV_S && mstatus.bits.TVM;
+    }
+    if (regno >= CSR_cycle && regno <= CSR_hpmcounter31) {
+        uint64_t bit = 1ull << (regno - CSR_cycle);
+        if ((readCSR(CSR_mcounteren) & bit) == 0) {
+            return true;
+        }
+        return prv == PRV_U && (readCSR(CSR_scounteren) & bit) == 0;
+    }
+    return false;
+}
+
 uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
     uint64_t ret = 0;
     uint64_t trigidx;
@@ -406,11 +1029,27 @@ uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
             mip.bits.MSIP = iirqloc_->getPendingRequest(2*hartid);
             mip.bits.MTIP = iirqloc_->getPendingRequest(2*hartid + 1);
             mip.bits.MEIP = iirqext_->getPendingRequest(hartid) != IRQ_REQUEST_NONE;
-            ret = mip.value;
+            ret = mip.value | readPendingS(MIP_S_MASK);
             rd_access = false;
         }
         break;
-    default:;
+    case CSR_sstatus:
+        ret = readCSR(CSR_mstatus) & SSTATUS_MASK;
+        rd_access = false;
+        break;
+    case CSR_sie:
+        ret = readCSR(CSR_mie) & readCSR(CSR_mideleg);
+        rd_access = false;
+        break;
+    case CSR_sip:
+        ret = readCSR(CSR_mip) & readCSR(CSR_mideleg);
+        rd_access = false;
+        break;
+    default:
+        // User shadows of the performance counters
+        if (regno >= CSR_hpmcounter3 && regno <= CSR_hpmcounter31) {
+            regno -= CSR_hpmcounter3 - CSR_mhpmcounter3;
+        }
     }
     if (rd_access) {
         RISCV_mutex_lock(&mutex_csr_);
@@ -422,7 +1061,9 @@ uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
 
 void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
     bool wr_access = true;
+    bool hpmupd = false;
     uint64_t trigidx;
+    uint64_t mask;
     switch (regno) {
     // Read-Only registers
     case CSR_misa:
@@ -440,9 +1081,15 @@ void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
     case CSR_insret:
         wr_access = false;
         break;
+    case CSR_dpc:
+        // Debugger changes resume address while hart is halted
+        if (isHalted()) {
+            setNPC(val);
+        }
+        break;
     case CSR_tselect:
-        if (val > triggersTotal_.to_uint64()) {
-            val = triggersTotal_.to_uint64();
+        if (val >= triggersTotal_.to_uint64()) {
+            val = triggersTotal_.to_uint64() - 1;
             RISCV_debug("Select trigger %d", static_cast<int>(val));
         }
         break;
@@ -472,19 +1119,72 @@ void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
     case CSR_flushi:
         flush(val);
         break;
+    case CSR_mip:
+        // Machine interrupts are wired to CLINT and PLIC
+        val &= MIP_S_MASK;
+        break;
+    case CSR_mideleg:
+        val &= MIP_S_MASK;
+        break;
+    case CSR_medeleg:
+        val &= MEDELEG_MASK;
+        break;
+    // Supervisor views of the machine registers
+    case CSR_sstatus:
+        regno = CSR_mstatus;
+        val = (readCSR(regno) & ~SSTATUS_MASK) | (val & SSTATUS_MASK);
+        break;
+    case CSR_sie:
+        mask = readCSR(CSR_mideleg);
+        regno = CSR_mie;
+        val = (readCSR(regno) & ~mask) | (val & mask);
+        break;
+    case CSR_sip:
+        mask = readCSR(CSR_mideleg) & 0x2;      // only SSIP is writable
+        regno = CSR_mip;
+        RISCV_mutex_lock(&mutex_csr_);
+        val = (portCSR_.read(regno).val & ~mask) | (val & mask);
+        RISCV_mutex_unlock(&mutex_csr_);
+        break;
     case CSR_satp:
-        if ((val >> 60) & 0xf) {
+        // Write with unsupported mode has no effect
+        if ((val >> 60) != SATP_MODE_BARE && (val >> 60) != SATP_MODE_SV39
+            && (val >> 60) != SATP_MODE_SV48) {
             RISCV_error(
-                "[satp] <= %016" RV_PRI64 "x. Paging not supported", val);
+                "[satp] <= %016" RV_PRI64 "x. Paging mode not supported", val);
+            wr_access = false;
+            break;
         }
+        mmuMode_ = val >> 60;
+        mmuAsid_ = (val >> 44) & 0xFFFF;
+        mmuRootAddr_ = (val & ((1ull << 44) - 1)) << 12;
+        break;
+    case CSR_mcountinhibit:
+        hpmupd = true;
         break;
-    default:;
+    default:
+        // Not implemented performance counters are hardwired to zero
+        if (regno >= CSR_hpmcounter3 && regno <= CSR_hpmcounter31) {
+            wr_access = false;
+        } else if (regno >= CSR_mhpmcounter3 && regno <= CSR_mhpmcounter31) {
+            wr_access = isHpmCounter(regno);
+        } else if (regno >= CSR_mhpmevent3 && regno <= CSR_mhpmevent31) {
+            wr_access = isHpmCounter(regno - CSR_mhpmevent3
+                                     + CSR_mhpmcounter3);
+            hpmupd = wr_access;
+        }
     }
     if (wr_access) {
         RISCV_mutex_lock(&mutex_csr_);
         portCSR_.write(regno, val);
         RISCV_mutex_unlock(&mutex_csr_);
     }
+    if (regno == CSR_mstackovr || regno == CSR_mstackund) {
+        updateStackProtection();
+    }
+    if (hpmupd) {
+        hpmUpdateEvents();
+    }
 }
 
 
@@ -40,17 +40,31 @@ class CpuRiver_Functional : public CpuGeneric,
     /** IResetListener interface */
     virtual void reset(IFace *isource);
 
+    /** ISnapshot interface */
+    virtual void saveSnapshot(ISnapshotStream *s) override;
+    virtual bool restoreSnapshot(ISnapshotStream *s) override;
+
     /** ICpuFunctional interface */
     virtual void enterDebugMode(uint64_t v, uint32_t cause) override;
     virtual void raiseSoftwareIrq() {}
     virtual void setReg(int idx, uint64_t val) override {
-        if (idx) {
+        // Instruction that raised exception doesn't modify registers
+        if (idx && !exceptions_) {
             CpuGeneric::setReg(idx, val);
         }
     }
     virtual uint64_t getIrqAddress(int idx) { return readCSR(CSR_mtvec); }
+    virtual ETransStatus dma_memop(Axi4TransactionType *tr) override;
+    virtual bool translateDebug(uint64_t vaddr, uint64_t *paddr) override;
     virtual void generateException(int e, uint64_t arg) override {
-        writeCSR(CSR_mtval, arg);
+        if (mmuPageFault_ && (e == EXCEPTION_InstrFault
+            || e == EXCEPTION_LoadFault || e == EXCEPTION_StoreFault)) {
+            // Already reported as page fault
+            mmuPageFault_ = false;
+            return;
+        }
+        // Written into mtval or stval when the trap is taken
+        trapValue_ = arg;
         CpuGeneric::generateException(e, arg);
     }
     virtual void generateExceptionLoadInstruction(uint64_t addr) override {
@@ -64,20 +78,43 @@ class CpuRiver_Functional : public CpuGeneric,
     /** ICpuRiscV interface */
     virtual uint64_t readCSR(uint32_t idx);
     virtual void writeCSR(uint32_t idx, uint64_t val);
+    /** CSR instruction traps by mstatus.TVM and xcounteren (debugger isn't) */
+    bool isCsrAccessIllegal(uint32_t idx);
     virtual uint64_t readGPR(uint32_t regno) { return R[regno]; }
     virtual void writeGPR(uint32_t regno, uint64_t val) { R[regno] = val; }
     virtual uint64_t readNonStandardReg(uint32_t regno) { return 0; }
     virtual void writeNonStandardReg(uint32_t regno, uint64_t val) {}
     virtual void mmuAddrReserve(uint64_t addr) override {
         mmuReservatedAddr_ = addr;
-        mmuReservedAddrWatchdog_ = 64;
+        mmuReservedAddrWatchdog_ = step_cnt_ + 64;
+        if (iquantum_) {
+            // Called right after the load, so the last address is valid
+            iquantum_->reserveAddress(quantumSlot_, memop_paddr_);
+        }
+    }
+    void mmuFlush(uint64_t vaddr, uint64_t asid);
+    /** Harts in own threads: AMO and SC are atomic to each other */
+    void atomicLock(uint64_t addr) {
+        if (iquantum_) {
+            iquantum_->lockReservation(addr);
+        }
+    }
+    void atomicUnlock(uint64_t addr) {
+        if (iquantum_) {
+            iquantum_->unlockReservation(addr);
+        }
     }
     virtual bool mmuAddrRelease(uint64_t addr) override {
         bool success = 0;
-        if (mmuReservedAddrWatchdog_ && mmuReservatedAddr_ == addr) {
+        if (mmuReservedAddrWatchdog_ && step_cnt_ <= mmuReservedAddrWatchdog_
+            && mmuReservatedAddr_ == addr) {
             success = true;
             mmuReservedAddrWatchdog_ = 0;
         }
+        if (iquantum_ && !iquantum_->releaseAddress(quantumSlot_)) {
+            // Reservation was broken by a store from another hart
+            success = false;
+        }
         return success;
     }
 
@@ -94,6 +131,24 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void traceOutput() override;
     virtual bool isStepEnabled() override;
     virtual void checkStackProtection() override;
+    virtual bool isTrapCheckRequired() override;
+    virtual bool isInterruptPending() override {
+        uint64_t cause;
+        uint32_t prvnxt;
+        return selectInterrupt(&cause, &prvnxt);
+    }
+    virtual bool isBlockTerminator(Reg64Type *payload) override;
+    virtual int instructionLength(Reg64Type *payload) override {
+        return (payload->buf32[0] & 0x3) == 0x3 ? 4 : 2;
+    }
+    virtual uint32_t getHartId() override { return hartid_.to_uint32(); }
+    virtual bool translateFetch(uint64_t vaddr, uint64_t *paddr) override;
+    virtual ETransStatus ifetch_memop(Axi4TransactionType *tr) override;
+    /** I-cache miss event requires the fetch of each instruction */
+    virtual bool isBlockExecEnabled() override {
+        return hpmEventMask_[HpmEvent_ICacheMiss] == 0
+            && CpuGeneric::isBlockExecEnabled();
+    }
 
     void addIsaUserRV64I();
     void addIsaPrivilegedRV64I();
@@ -109,9 +164,47 @@ class CpuRiver_Functional : public CpuGeneric,
         uint32_t t1 = val & 0x3;
         return 0x20 | ((val >> 13) << 2) | t1;
     }
+    /** Decode table index: opcode[6:2], funct3[14:12], funct7[31:25] */
+    uint32_t decodeKey32(uint32_t val) {
+        return ((val >> 2) & 0x1F) | (((val >> 12) & 0x7) << 5)
+             | ((val >> 25) << 8);
+    }
+    void buildDecodeTables();
 
  private:
     void switchContext(uint32_t prvnxt);
+    bool selectInterrupt(uint64_t *cause, uint32_t *prvnxt);
+    void updateStackProtection() {
+        stackProtection_ = readCSR(CSR_mstackovr) != 0
+                        || readCSR(CSR_mstackund) != 0;
+    }
+    uint64_t readPendingS(uint64_t mie);
+
+    enum EMmuAccess {
+        MMU_Read,
+        MMU_Write,
+        MMU_Exec
+    };
+    bool mmuTranslate(uint64_t vaddr, int access, uint64_t prv,
+                      uint64_t mstatus, uint64_t *paddr);
+    bool mmuCheckAccess(uint64_t pte, int access, uint64_t prv,
+                        uint64_t mstatus);
+    bool mmuWalk(uint64_t vaddr, uint64_t *pte, uint64_t *pte_addr,
+                 int *lvl);
+
+    bool isHpmCounter(uint32_t regno) {
+        return regno >= CSR_mhpmcounter3
+            && regno < CSR_mhpmcounter3 + hpmCounters_.to_uint32();
+    }
+    void hpmUpdateEvents();
+    void hpmCount(int ev);
+    void hpmEvent(int ev) {
+        if (hpmEventMask_[ev]) {
+            hpmCount(ev);
+        }
+    }
+    void hpmMemop(Axi4TransactionType *tr);
+    bool hpmCacheMiss(uint64_t *tags, uint64_t addr);
 
  private:
     AttributeType vendorid_;
@@ -121,18 +214,87 @@ class CpuRiver_Functional : public CpuGeneric,
     AttributeType listExtISA_;
     AttributeType clint_;       // Core-local interruptor
     AttributeType plic_;        // External interrupt controller
+    AttributeType hpmCounters_; // Implemented mhpmcounter3.. registers
+    AttributeType mprvHighAddr_;    // River RTL MPRV behaviour
+
+    /** mstatus fields visible through sstatus */
+    static const uint64_t SSTATUS_MASK = 0x80000003000DE122ull;
+    /** Supervisor interrupts: SSIP, STIP, SEIP */
+    static const uint64_t MIP_S_MASK = 0x222;
+    /** Environment call from M-mode is never delegated */
+    static const uint64_t MEDELEG_MASK = ~(1ull << 11);
+
+    uint64_t trapValue_;        // address or instruction of the exception
+    bool stackProtection_;      // mstackovr or mstackund is set
 
     static const int INSTR_HASH_TABLE_SIZE = 1 << 6;
     AttributeType listInstr_[INSTR_HASH_TABLE_SIZE];
 
+    /**
+     * Pre-decoded lookup tables generated from the instruction masks at
+     * start-up. Every 16-bit halfword resolves to a single instruction and
+     * every 32-bit instruction resolves to a short list of candidates
+     * sharing the same opcode/funct3/funct7 bits.
+     */
+    static const int DECODE32_TABLE_SIZE = 1 << 15;
+    static const int DECODE16_TABLE_SIZE = 1 << 16;
+    struct DecodeBucketType {
+        RiscvInstruction **instr;   // candidates in registration order
+        unsigned size;
+    };
+    DecodeBucketType *decode32_;
+    RiscvInstruction **decode32pool_;
+    RiscvInstruction **decode16_;
+
     IIrqController *iirqloc_;
     IIrqController *iirqext_;
 
     CmdBrRiscv *pcmd_br_;
     ICommand *pcmd_cpu_;
 
+    /**
+     * Software TLB: direct-mapped table of 4 KB pages and small fully
+     * associative table of the super-pages. Entries are tagged with ASID
+     * and valid until SFENCE.VMA.
+     */
+    static const int TLB_DIRECT_SIZE = 256;
+    static const int TLB_ASSOC_SIZE = 16;
+    static const uint64_t SATP_MODE_BARE = 0;
+    static const uint64_t SATP_MODE_SV39 = 8;
+    static const uint64_t SATP_MODE_SV48 = 9;
+
+    struct TlbEntryType {
+        uint64_t vaddr;         // virtual page base address
+        uint64_t paddr;         // physical page base address
+        uint64_t mask;          // page offset mask
+        uint64_t pte;           // leaf PTE flags
+        uint64_t asid;
+        bool valid;
+    };
+    struct TlbType {
+        TlbEntryType direct[TLB_DIRECT_SIZE];
+        TlbEntryType assoc[TLB_ASSOC_SIZE];
+        unsigned assocNext;     // round-robin replacement
+    } itlb_, dtlb_;
+
+    uint64_t mmuMode_;          // satp[63:60]
+    uint64_t mmuAsid_;          // satp[59:44]
+    uint64_t mmuRootAddr_;      // satp[43:0] << 12
+    bool mmuPageFault_;         // suppress access fault after page fault
+
+    /**
+     * Performance counters are stored in the CSR bank. Each event has the
+     * mask of counters it increments, so disabled events cost one check.
+     * Cache misses are estimated with direct-mapped tags of the L1 size.
+     */
+    static const int HPM_CACHE_LINES = 512;
+    static const int HPM_CACHE_LINE_SHIFT = 5;
+    uint32_t hpmEventMask_[HpmEvent_Total];
+    uint64_t hpmITag_[HPM_CACHE_LINES];
+    uint64_t hpmDTag_[HPM_CACHE_LINES];
+
     uint64_t mmuReservatedAddr_;
-    int mmuReservedAddrWatchdog_;   // not exceed 64 instructions between LR/SC
+    uint64_t mmuReservedAddrWatchdog_;  // not exceed 64 instructions between LR/SC
 };
 
 DECLARE_CLASS(CpuRiver_Functional)
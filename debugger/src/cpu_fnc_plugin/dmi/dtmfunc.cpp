@@ -56,7 +56,6 @@ void DtmFunctional::resetTAP(char trst, char srst) {
 
 void DtmFunctional::setPins(char tck, char tms, char tdi) {
     bool tck_posedge = false;
-    uint64_t stat = DMISTAT_SUCCESS;
 
     if (!tck_ && tck) {
         tck_posedge = true;
@@ -71,75 +70,21 @@ void DtmFunctional::setPins(char tck, char tms, char tdi) {
 
     switch (estate_) {
     case CAPTURE_DR:
-        if (ir_ == IR_IDCODE) {
-            dr_ = idcode;
-            dr_length_ = 32;
-        } else if (ir_ == IR_DTMCONTROL) {
-            dr_ = 0x1;      // version
-            dr_ |= abits << 4;    // the size of the address
-            dr_ |= stat << 10;
-            dr_length_ = 32;
-        } else if (ir_ == IR_DBUS) {
-            dr_ = stat;
-            dr_ |= (trans_.rpayload.b64[0] << 2);
-            dr_ |= dmi_addr_ << 34;
-            dr_length_ = abits + 34;
-        } else if (ir_ == IR_BYPASS) {
-            dr_ = bypass_;
-            dr_length_ = 1;
-        }
+        captureDR();
         break;
     case SHIFT_DR:
         dr_ >>= 1;
         dr_ |= (static_cast<uint64_t>(tdi_) << (dr_length_ - 1));
         break;
     case UPDATE_DR:
-        if (ir_ == IR_DTMCONTROL) {
-            //v_dmi_reset = r.dr.read()[DTMCONTROL_DMIRESET];
-            //v_dmi_hardreset = r.dr.read()[DTMCONTROL_DMIHARDRESET];
-        } else if (ir_ == IR_BYPASS) {
-            bypass_ = dr_ & 0x1;
-        } else if (ir_ == IR_DBUS) {
-            dmi_addr_ = (dr_ >> 34) & ((1ull << abits) - 1);
-            trans_.rpayload.b64[0] = (dr_ >> 2) & 0xFFFFFFFFul;
-            if (dr_ & 0x3) {        // read | write
-                if ((dr_ >> 1) & 0x1) {
-                    trans_.action = MemAction_Write;
-                    if (dmi_addr_ == 0x10) {
-                        uint32_t selhart = (trans_.rpayload.b32[0] >> 6) & 0x3FF;
-                        selhart =  (selhart << 10) | ((trans_.rpayload.b32[0] >> 16) & 0x3FF);
-                        RISCV_debug("DMI: [0x%02x] <= %08x, Select hart 0x%x",
-                                     dmi_addr_, trans_.rpayload.b32[0], selhart);
-                    } else {
-                        RISCV_debug("DMI: [0x%02x] <= %08x",
-                                     dmi_addr_, trans_.rpayload.b32[0]);
-                    }
-                } else {
-                    trans_.action = MemAction_Read;
-                }
-                trans_.source_idx = busid_.to_int();
-                trans_.addr = dmibar_.to_uint64() + (dmi_addr_ << 2);
-                trans_.xsize = 4;
-                trans_.wstrb = (1u << trans_.xsize) - 1;
-                trans_.wpayload.b64[0] = trans_.rpayload.b64[0];
-                ibus_->b_transport(&trans_);
-
-                if (trans_.action == MemAction_Read && dmi_addr_ != 0x11) {
-                    // Exclude polling DMI status from the debug output
-                    RISCV_debug("DMI: [0x%02x] => %08x",
-                                 dmi_addr_, trans_.rpayload.b32[0]);
-                }
-            }
-        }
+        updateDR();
         break;
     case CAPTURE_IR:
-        dr_ = ir_ & ((1ul << irlen) - 1);
-        dr_ = (dr_ >> 2) << 2;
-        dr_ |= 0x1;
+        captureIR();
         break;
     case SHIFT_IR:
         dr_ >>= 1;
-        dr_ |= (tdi_ << (irlen - 1));
+        dr_ |= (static_cast<uint64_t>(tdi_) << (irlen - 1));
         break;
     case UPDATE_IR:
         ir_ = dr_ & ((1ull << irlen) - 1);
@@ -153,6 +98,145 @@ void DtmFunctional::setPins(char tck, char tms, char tdi) {
     tms_ = tms;
 }
 
+/**
+ * OpenOCD sends each shifted bit as a pair of symbols with TCK low and
+ * high (optionally with 'R' in between). While TAP stays in the shift
+ * state with TMS=0 the whole run is shifted without the edge detection.
+ */
+int DtmFunctional::bitbang(const char *cmd, int cnt, char *tdo) {
+    int tsz = 0;
+    int i = 0;
+    while (i < cnt) {
+        if (estate_ == SHIFT_DR || estate_ == SHIFT_IR) {
+            int shlen = estate_ == SHIFT_DR ? dr_length_ : irlen;
+            while (i + 1 < cnt && (cmd[i] == '0' || cmd[i] == '1')) {
+                int k = i + 1;
+                bool sample = cmd[k] == 'R';
+                if (sample) {
+                    k++;
+                }
+                if (k >= cnt || cmd[k] != cmd[i] + 4) {
+                    break;
+                }
+                if (sample) {
+                    tdo[tsz++] = (dr_ & 0x1) ? '1' : '0';
+                }
+                tdi_ = cmd[i] - '0';
+                dr_ >>= 1;
+                dr_ |= static_cast<uint64_t>(tdi_) << (shlen - 1);
+                tck_ = 1;
+                tms_ = 0;
+                i = k + 1;
+            }
+            if (i >= cnt) {
+                break;
+            }
+        }
+
+        if (cmd[i] == 'R') {
+            tdo[tsz++] = getTDO() ? '1' : '0';
+        } else {
+            int pins = cmd[i] - '0';
+            setPins((pins >> 2) & 0x1, (pins >> 1) & 0x1, pins & 0x1);
+        }
+        i++;
+    }
+    return tsz;
+}
+
+uint64_t DtmFunctional::scanIR(uint64_t tdi, int len) {
+    captureIR();
+    uint64_t tdo = shiftBits(tdi, len, irlen);
+    ir_ = dr_ & ((1ull << irlen) - 1);
+    estate_ = IDLE;
+    return tdo;
+}
+
+uint64_t DtmFunctional::scanDR(uint64_t tdi, int len) {
+    captureDR();
+    uint64_t tdo = shiftBits(tdi, len, dr_length_);
+    updateDR();
+    estate_ = IDLE;
+    return tdo;
+}
+
+uint64_t DtmFunctional::shiftBits(uint64_t tdi, int len, int shlen) {
+    uint64_t tdo = 0;
+    for (int i = 0; i < len; i++) {
+        tdo |= (dr_ & 0x1) << i;
+        dr_ >>= 1;
+        dr_ |= ((tdi >> i) & 0x1) << (shlen - 1);
+    }
+    return tdo;
+}
+
+void DtmFunctional::captureDR() {
+    uint64_t stat = DMISTAT_SUCCESS;
+    if (ir_ == IR_IDCODE) {
+        dr_ = idcode;
+        dr_length_ = 32;
+    } else if (ir_ == IR_DTMCONTROL) {
+        dr_ = 0x1;      // version
+        dr_ |= abits << 4;    // the size of the address
+        dr_ |= stat << 10;
+        dr_length_ = 32;
+    } else if (ir_ == IR_DBUS) {
+        dr_ = stat;
+        dr_ |= (trans_.rpayload.b64[0] << 2);
+        dr_ |= dmi_addr_ << 34;
+        dr_length_ = abits + 34;
+    } else if (ir_ == IR_BYPASS) {
+        dr_ = bypass_;
+        dr_length_ = 1;
+    }
+}
+
+void DtmFunctional::updateDR() {
+    if (ir_ == IR_DTMCONTROL) {
+        //v_dmi_reset = r.dr.read()[DTMCONTROL_DMIRESET];
+        //v_dmi_hardreset = r.dr.read()[DTMCONTROL_DMIHARDRESET];
+    } else if (ir_ == IR_BYPASS) {
+        bypass_ = dr_ & 0x1;
+    } else if (ir_ == IR_DBUS) {
+        dmi_addr_ = (dr_ >> 34) & ((1ull << abits) - 1);
+        trans_.rpayload.b64[0] = (dr_ >> 2) & 0xFFFFFFFFul;
+        if (dr_ & 0x3) {        // read | write
+            if ((dr_ >> 1) & 0x1) {
+                trans_.action = MemAction_Write;
+                if (dmi_addr_ == 0x10) {
+                    uint32_t selhart = (trans_.rpayload.b32[0] >> 6) & 0x3FF;
+                    selhart =  (selhart << 10) | ((trans_.rpayload.b32[0] >> 16) & 0x3FF);
+                    RISCV_debug("DMI: [0x%02x] <= %08x, Select hart 0x%x",
+                                 dmi_addr_, trans_.rpayload.b32[0], selhart);
+                } else {
+                    RISCV_debug("DMI: [0x%02x] <= %08x",
+                                 dmi_addr_, trans_.rpayload.b32[0]);
+                }
+            } else {
+                trans_.action = MemAction_Read;
+            }
+            trans_.source_idx = busid_.to_int();
+            trans_.addr = dmibar_.to_uint64() + (dmi_addr_ << 2);
+            trans_.xsize = 4;
+            trans_.wstrb = (1u << trans_.xsize) - 1;
+            trans_.wpayload.b64[0] = trans_.rpayload.b64[0];
+            ibus_->b_transport(&trans_);
+
+            if (trans_.action == MemAction_Read && dmi_addr_ != 0x11) {
+                // Exclude polling DMI status from the debug output
+                RISCV_debug("DMI: [0x%02x] => %08x",
+                             dmi_addr_, trans_.rpayload.b32[0]);
+            }
+        }
+    }
+}
+
+void DtmFunctional::captureIR() {
+    dr_ = ir_ & ((1ul << irlen) - 1);
+    dr_ = (dr_ >> 2) << 2;
+    dr_ |= 0x1;
+}
+
 bool DtmFunctional::getTDO() {
     return dr_ & 0x1 ? true : false;
 }
@@ -39,7 +39,15 @@ class DtmFunctional : public IService,
     virtual void resetTAP(char trst, char srst);
     virtual void setPins(char tck, char tms, char tdi);
     virtual bool getTDO();
+    virtual int bitbang(const char *cmd, int cnt, char *tdo);
+    virtual uint64_t scanIR(uint64_t tdi, int len);
+    virtual uint64_t scanDR(uint64_t tdi, int len);
 
+ private:
+    void captureDR();
+    void updateDR();
+    void captureIR();
+    uint64_t shiftBits(uint64_t tdi, int len, int shlen);
 
  private:
     AttributeType sysbus_;
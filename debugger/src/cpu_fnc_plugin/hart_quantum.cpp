@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "hart_quantum.h"
+
+namespace debugger {
+
+HartQuantum::HartQuantum(const char *name) : IService(name) {
+    registerInterface(static_cast<IHartQuantum *>(this));
+    registerAttribute("QuantumSteps", &quantumSteps_);
+
+    quantumSteps_.make_uint64(10000);
+    RISCV_mutex_init(&mutexBarrier_);
+    for (int i = 0; i < RESERVATION_LOCKS; i++) {
+        RISCV_mutex_init(&mutexReservation_[i]);
+    }
+    members_ = 0;
+    arrived_ = 0;
+    generation_.store(0);
+    hartTotal_ = 0;
+    for (int i = 0; i < HART_MAX; i++) {
+        slot_[i].icpu = 0;
+        slot_[i].reserved.store(0);
+    }
+}
+
+HartQuantum::~HartQuantum() {
+    RISCV_mutex_destroy(&mutexBarrier_);
+    for (int i = 0; i < RESERVATION_LOCKS; i++) {
+        RISCV_mutex_destroy(&mutexReservation_[i]);
+    }
+}
+
+int HartQuantum::registerHart(IFace *icpu) {
+    int ret = -1;
+    RISCV_mutex_lock(&mutexBarrier_);
+    if (hartTotal_ < HART_MAX) {
+        ret = hartTotal_++;
+        slot_[ret].icpu = icpu;
+    }
+    RISCV_mutex_unlock(&mutexBarrier_);
+    return ret;
+}
+
+void HartQuantum::attachHart(int slot) {
+    RISCV_mutex_lock(&mutexBarrier_);
+    members_++;
+    RISCV_mutex_unlock(&mutexBarrier_);
+}
+
+/** Leaving hart could be the last one that others are waiting for */
+void HartQuantum::detachHart(int slot) {
+    RISCV_mutex_lock(&mutexBarrier_);
+    members_--;
+    slot_[slot].reserved.store(0, std::memory_order_relaxed);
+    if (arrived_ && arrived_ >= members_) {
+        releaseBarrier();
+    }
+    RISCV_mutex_unlock(&mutexBarrier_);
+}
+
+uint64_t HartQuantum::arrive(int slot) {
+    RISCV_mutex_lock(&mutexBarrier_);
+    uint64_t ret = generation_.load(std::memory_order_relaxed);
+    if (++arrived_ >= members_) {
+        releaseBarrier();
+    }
+    RISCV_mutex_unlock(&mutexBarrier_);
+    return ret;
+}
+
+void HartQuantum::releaseBarrier() {
+    arrived_ = 0;
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+void HartQuantum::reserveAddress(int slot, uint64_t paddr) {
+    slot_[slot].reserved.store((paddr & RESERVATION_MASK) | RESERVATION_VALID,
+                               std::memory_order_relaxed);
+}
+
+bool HartQuantum::releaseAddress(int slot) {
+    return slot_[slot].reserved.exchange(0, std::memory_order_acq_rel) != 0;
+}
+
+void HartQuantum::storeNotify(int slot, uint64_t paddr, uint32_t sz) {
+    uint64_t first = (paddr & RESERVATION_MASK) | RESERVATION_VALID;
+    uint64_t last = ((paddr + sz - 1) & RESERVATION_MASK) | RESERVATION_VALID;
+    for (int i = 0; i < hartTotal_; i++) {
+        if (i == slot) {
+            continue;
+        }
+        uint64_t t = slot_[i].reserved.load(std::memory_order_relaxed);
+        if (t == first || t == last) {
+            slot_[i].reserved.compare_exchange_strong(t, 0,
+                                            std::memory_order_relaxed);
+        }
+    }
+}
+
+}  // namespace debugger
@@ -0,0 +1,89 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_QUANTUM_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_QUANTUM_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/ihartquantum.h"
+#include <atomic>
+
+namespace debugger {
+
+/**
+ * Shared by all functional harts of the system: quantum barrier and
+ * LR/SC reservation set of every hart.
+ */
+class HartQuantum : public IService,
+                    public IHartQuantum {
+ public:
+    explicit HartQuantum(const char *name);
+    virtual ~HartQuantum();
+
+    /** IHartQuantum */
+    virtual uint64_t getQuantumSteps() { return quantumSteps_.to_uint64(); }
+    virtual int registerHart(IFace *icpu);
+    virtual void attachHart(int slot);
+    virtual void detachHart(int slot);
+    virtual uint64_t arrive(int slot);
+    virtual bool isReleased(uint64_t generation) {
+        return generation_.load(std::memory_order_acquire) != generation;
+    }
+    virtual void reserveAddress(int slot, uint64_t paddr);
+    virtual bool releaseAddress(int slot);
+    virtual void storeNotify(int slot, uint64_t paddr, uint32_t sz);
+    virtual void lockReservation(uint64_t addr) {
+        RISCV_mutex_lock(&mutexReservation_[reservationLock(addr)]);
+    }
+    virtual void unlockReservation(uint64_t addr) {
+        RISCV_mutex_unlock(&mutexReservation_[reservationLock(addr)]);
+    }
+
+ private:
+    void releaseBarrier();
+    /** Address bits [11:6] are the same in virtual and physical address */
+    static int reservationLock(uint64_t addr) {
+        return static_cast<int>((addr >> 6) & (RESERVATION_LOCKS - 1));
+    }
+
+ private:
+    static const int HART_MAX = 32;
+    static const uint64_t RESERVATION_MASK = ~0x3Full;  // 64-bytes set
+    static const uint64_t RESERVATION_VALID = 0x1;
+    static const int RESERVATION_LOCKS = 64;
+
+    AttributeType quantumSteps_;
+
+    mutex_def mutexBarrier_;
+    int members_;
+    int arrived_;
+    std::atomic<uint64_t> generation_;
+    mutex_def mutexReservation_[RESERVATION_LOCKS];
+
+    int hartTotal_;
+    struct HartSlotType {
+        IFace *icpu;
+        std::atomic<uint64_t> reserved;     // reservation set | valid
+        uint8_t rsrv[64 - sizeof(IFace *) - sizeof(uint64_t)];
+    } slot_[HART_MAX];
+};
+
+DECLARE_CLASS(HartQuantum)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_QUANTUM_H__
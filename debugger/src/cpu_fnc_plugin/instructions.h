@@ -40,6 +40,10 @@ public:
         return (opcode_ >> 2) & 0x1F;
     }
 
+    /** Fixed bits of the instruction word and their values */
+    uint32_t mask() { return mask_; }
+    uint32_t opcode() { return opcode_; }
+
     uint16_t hash16() {
         uint16_t t1 = static_cast<uint16_t>(opcode_) & 0x3;
         return 0x20 | ((static_cast<uint16_t>(opcode_) >> 13) << 2) | t1;
@@ -20,6 +20,8 @@
 #include "srcproc/srcproc.h"
 #include "dmi/dmifunc.h"
 #include "dmi/dtmfunc.h"
+#include "hart_quantum.h"
+#include "cosim.h"
 
 namespace debugger {
 
@@ -30,6 +32,8 @@ extern "C" void plugin_init(void) {
     REGISTER_CLASS_IDX(ICacheFunctional, 4);
     REGISTER_CLASS_IDX(DmiFunctional, 5);
     REGISTER_CLASS_IDX(DtmFunctional, 6);
+    REGISTER_CLASS_IDX(HartQuantum, 7);
+    REGISTER_CLASS_IDX(CoSimulator, 8);
 }
 
 }  // namespace debugger
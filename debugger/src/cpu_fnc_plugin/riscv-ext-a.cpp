@@ -53,6 +53,7 @@ public:
             // AMO always should generate Store exceptions (spike)
             icpu_->generateException(ICpuRiscV::EXCEPTION_StoreMisalign, icpu_->getPC());
         } else {
+            icpu_->atomicLock(trans.addr);
             if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
                 // AMO always should generate Store exceptions (spike)
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
@@ -74,6 +75,7 @@ public:
                 }
                 icpu_->setReg(u.bits.rd, t);
             }
+            icpu_->atomicUnlock(trans.addr);
         }
         return 4;
     }
@@ -318,6 +320,8 @@ public:
             trans.rpayload.b64[0] = 0;
             icpu_->generateException(ICpuRiscV::EXCEPTION_LoadMisalign, icpu_->getPC());
         } else {
+            // Load and reservation aren't split by SC of another hart
+            icpu_->atomicLock(trans.addr);
             if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_LoadFault, trans.addr);
             } else {
@@ -329,6 +333,7 @@ public:
                 icpu_->mmuAddrReserve(trans.addr);
                 icpu_->setReg(u.bits.rd, t);
             }
+            icpu_->atomicUnlock(trans.addr);
         }
         return 4;
     }
@@ -350,12 +355,15 @@ public:
             trans.rpayload.b64[0] = 0;
             icpu_->generateException(ICpuRiscV::EXCEPTION_LoadMisalign, icpu_->getPC());
         } else {
+            // Load and reservation aren't split by SC of another hart
+            icpu_->atomicLock(trans.addr);
             if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_LoadFault, trans.addr);
             } else {
                 icpu_->mmuAddrReserve(trans.addr);
                 icpu_->setReg(u.bits.rd, trans.rpayload.b32[0]);
             }
+            icpu_->atomicUnlock(trans.addr);
         }
         return 4;
     }
@@ -371,6 +379,7 @@ public:
         ISA_R_type u;
         u.value = payload->buf32[0];
         bool error = 1;
+        icpu_->atomicLock(R[u.bits.rs1]);
         if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
             trans.action = MemAction_Write;
             trans.addr = R[u.bits.rs1];
@@ -387,6 +396,7 @@ public:
                 }
             }
         }
+        icpu_->atomicUnlock(R[u.bits.rs1]);
         icpu_->setReg(u.bits.rd, error);    // success
         return 4;
     }
@@ -402,6 +412,7 @@ public:
         ISA_R_type u;
         u.value = payload->buf32[0];
         bool error = 1;
+        icpu_->atomicLock(R[u.bits.rs1]);
         if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
             trans.action = MemAction_Write;
             trans.addr = R[u.bits.rs1];
@@ -418,6 +429,7 @@ public:
                 }
             }
         }
+        icpu_->atomicUnlock(R[u.bits.rs1]);
         icpu_->setReg(u.bits.rd, error);    // success
         return 4;
     }
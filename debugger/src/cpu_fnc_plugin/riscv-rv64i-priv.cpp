@@ -39,6 +39,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t clr_mask = ~R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -65,6 +69,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t clr_mask = ~static_cast<uint64_t>((u.bits.rs1));
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -95,6 +103,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t set_mask = R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -121,6 +133,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t set_mask = u.bits.rs1;
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -149,6 +165,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t wr_value = R[u.bits.rs1];
         if (u.bits.rd) {
@@ -174,6 +194,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (icpu_->isCsrAccessIllegal(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t wr_value = u.bits.rs1;
         if (u.bits.rd) {
@@ -252,6 +276,7 @@ public:
         mstatus.bits.SPIE = 1;
         icpu_->setPrvLevel(mstatus.bits.SPP);
         mstatus.bits.SPP = ICpuRiscV::PRV_U;
+        mstatus.bits.MPRV = 0;
             
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
         return 4;
@@ -309,6 +334,9 @@ public:
         mstatus.bits.MIE = mstatus.bits.MPIE;
         mstatus.bits.MPIE = 1;
         icpu_->setPrvLevel(mstatus.bits.MPP);
+        if (mstatus.bits.MPP != ICpuRiscV::PRV_M) {
+            mstatus.bits.MPRV = 0;
+        }
         mstatus.bits.MPP = ICpuRiscV::PRV_U;
 
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
@@ -335,7 +363,8 @@ public:
 /** 
  * @brief FENCE_I (memory barrier)
  *
- * Not used in functional model so that cache is not modeling.
+ * Cache is not modeling in functional model but translated basic blocks
+ * should be discarded.
  */
 class FENCE_I : public RiscvInstruction {
 public:
@@ -343,6 +372,35 @@ public:
         RiscvInstruction(icpu, "FENCE_I", "?????????????????001?????0001111") {}
 
     virtual int exec(Reg64Type *payload) {
+        icpu_->flush(~0ull);
+        return 4;
+    }
+};
+
+/**
+ * @brief SFENCE.VMA (address translation fence)
+ *
+ * rs1 = x0 flushes all virtual addresses, rs2 = x0 flushes all address
+ * spaces including global mappings.
+ */
+class SFENCE_VMA : public RiscvInstruction {
+public:
+    SFENCE_VMA(CpuRiver_Functional *icpu) :
+        RiscvInstruction(icpu, "SFENCE_VMA", "0001001??????????000000001110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        csr_mstatus_type mstatus;
+        mstatus.value = icpu_->readCSR(ICpuRiscV::CSR_mstatus);
+        if (icpu_->getPrvLevel() == ICpuRiscV::PRV_U
+            || (icpu_->getPrvLevel() == ICpuRiscV::PRV_S && mstatus.bits.TVM)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
+        uint64_t vaddr = u.bits.rs1 ? R[u.bits.rs1] : ~0ull;
+        uint64_t asid = u.bits.rs2 ? (R[u.bits.rs2] & 0xFFFF) : ~0ull;
+        icpu_->mmuFlush(vaddr, asid);
         return 4;
     }
 };
@@ -383,6 +441,9 @@ public:
         case ICpuRiscV::PRV_M:
             icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromMmode, icpu_->getPC());
             break;
+        case ICpuRiscV::PRV_S:
+            icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromSmode, icpu_->getPC());
+            break;
         case ICpuRiscV::PRV_U:
             icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromUmode, icpu_->getPC());
             break;
@@ -406,13 +467,13 @@ void CpuRiver_Functional::addIsaPrivilegedRV64I() {
     addSupportedInstruction(new MRET(this));
     addSupportedInstruction(new FENCE(this));
     addSupportedInstruction(new FENCE_I(this));
+    addSupportedInstruction(new SFENCE_VMA(this));
     addSupportedInstruction(new ECALL(this));
     addSupportedInstruction(new EBREAK(this));
 
     // TODO:
     /*
   def DRET               = BitPat("b01111011001000000000000001110011")
-  def SFENCE_VMA         = BitPat("b0001001??????????000000001110011")
   def WFI                = BitPat("b00010000010100000000000001110011")  // wait for interrupt
 
     def RDCYCLE            = BitPat("b11000000000000000010?????1110011")
@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "cmd_cachestat.h"
+
+namespace debugger {
+
+CmdCacheStat::CmdCacheStat(sc_object *top)
+    : ICommand("cachestat", 0, 0) {
+
+    briefDescr_.make_string("Read or clear counters of the RTL caches");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Read hit, miss, write-back, snoop hit and memory stall\n"
+        "    counters of the I$, D$ and L2 models. Counters are\n"
+        "    accumulated since start or since the last 'clear'.\n"
+        "Usage:\n"
+        "    cachestat [clear]\n"
+        "Output format:\n"
+        "    [{'Name':s,'Hits':i,'Misses':i,'WriteBacks':i,\n"
+        "      'SnoopHits':i,'MemStalls':i},...]\n"
+        "Example:\n"
+        "    cachestat\n"
+        "    cachestat clear\n");
+
+    caches_ = 0;
+    cacheCnt_ = 0;
+    addCaches(top, false);
+    if (cacheCnt_) {
+        caches_ = new sc_object *[cacheCnt_];
+        cacheCnt_ = 0;
+        addCaches(top, true);
+    }
+}
+
+CmdCacheStat::~CmdCacheStat() {
+    if (caches_) {
+        delete [] caches_;
+    }
+}
+
+void CmdCacheStat::addCaches(sc_object *obj, bool fill) {
+    if (dynamic_cast<ICacheStat *>(obj)) {
+        if (fill) {
+            caches_[cacheCnt_] = obj;
+        }
+        cacheCnt_++;
+    }
+    const std::vector<sc_object *> &child = obj->get_child_objects();
+    for (size_t i = 0; i < child.size(); i++) {
+        addCaches(child[i], fill);
+    }
+}
+
+int CmdCacheStat::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1) {
+        return CMD_VALID;
+    }
+    if (args->size() == 2 && (*args)[1].is_equal("clear")) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdCacheStat::exec(AttributeType *args, AttributeType *res) {
+    ICacheStat *icache;
+    const CacheStatType *st;
+
+    res->attr_free();
+    res->make_list(0);
+    for (unsigned i = 0; i < cacheCnt_; i++) {
+        icache = dynamic_cast<ICacheStat *>(caches_[i]);
+        if (args->size() == 2) {
+            icache->clearCacheStat();
+            continue;
+        }
+        st = icache->getCacheStat();
+        AttributeType &item = res->new_list_item();
+        item.make_dict();
+        item["Name"].make_string(caches_[i]->name());
+        item["Hits"].make_uint64(st->hits);
+        item["Misses"].make_uint64(st->misses);
+        item["WriteBacks"].make_uint64(st->writebacks);
+        item["SnoopHits"].make_uint64(st->snoop_hits);
+        item["MemStalls"].make_uint64(st->mem_stalls);
+    }
+}
+
+}  // namespace debugger
@@ -29,6 +29,12 @@ CpuRiscV_RTL::CpuRiscV_RTL(const char *name)
     registerAttribute("AsyncReset", &asyncReset_);
     registerAttribute("CpuNum", &cpuNum_);
     registerAttribute("L2CacheEnable", &l2CacheEnable_);
+    registerAttribute("ILog2NWays", &ilog2NWays_);
+    registerAttribute("ILog2LinesPerWay", &ilog2LinesPerWay_);
+    registerAttribute("DLog2NWays", &dlog2NWays_);
+    registerAttribute("DLog2LinesPerWay", &dlog2LinesPerWay_);
+    registerAttribute("L2Log2NWays", &l2log2NWays_);
+    registerAttribute("L2Log2LinesPerWay", &l2log2LinesPerWay_);
     registerAttribute("CLINT", &clint_);
     registerAttribute("PLIC", &plic_);
     registerAttribute("Bus", &bus_);
@@ -40,6 +46,12 @@ CpuRiscV_RTL::CpuRiscV_RTL(const char *name)
 
     bus_.make_string("");
     freqHz_.make_uint64(1);
+    ilog2NWays_.make_uint64(2);
+    ilog2LinesPerWay_.make_uint64(7);
+    dlog2NWays_.make_uint64(2);
+    dlog2LinesPerWay_.make_uint64(7);
+    l2log2NWays_.make_uint64(4);
+    l2log2LinesPerWay_.make_uint64(9);
     InVcdFile_.make_string("");
     OutVcdFile_.make_string("");
     RISCV_event_create(&config_done_, "riscv_sysc_config_done");
@@ -119,6 +131,9 @@ void CpuRiscV_RTL::postinitService() {
     pcmd_cpu_->enableDMA(ibus_, dmibar_.to_uint64());
     icmdexec_->registerCommand(pcmd_cpu_);
 
+    pcmd_cachestat_ = new CmdCacheStat(group0_);
+    icmdexec_->registerCommand(pcmd_cachestat_);
+
     if (!run()) {
         RISCV_error("Can't create thread.", NULL);
         return;
@@ -126,15 +141,60 @@ void CpuRiscV_RTL::postinitService() {
 }
 
 void CpuRiscV_RTL::predeleteService() {
+    AttributeType args, res;
+    args.make_list(1);
+    args[0u].make_string("cachestat");
+    pcmd_cachestat_->exec(&args, &res);
+    for (unsigned i = 0; i < res.size(); i++) {
+        AttributeType &item = res[i];
+        RISCV_info("%s: hits %" RV_PRI64 "d, misses %" RV_PRI64 "d, "
+                   "write-backs %" RV_PRI64 "d, snoop hits %" RV_PRI64 "d, "
+                   "mem stalls %" RV_PRI64 "d",
+                   item["Name"].to_string(),
+                   item["Hits"].to_uint64(),
+                   item["Misses"].to_uint64(),
+                   item["WriteBacks"].to_uint64(),
+                   item["SnoopHits"].to_uint64(),
+                   item["MemStalls"].to_uint64());
+    }
+
     icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_br_));
     icmdexec_->unregisterCommand(pcmd_cpu_);
+    icmdexec_->unregisterCommand(pcmd_cachestat_);
     delete pcmd_br_;
     delete pcmd_cpu_;
+    delete pcmd_cachestat_;
+}
+
+void CpuRiscV_RTL::checkCacheGeometry(const char *cache,
+                                      AttributeType *log2nways,
+                                      AttributeType *log2lines,
+                                      uint32_t minways, uint32_t maxways,
+                                      uint32_t minlines, uint32_t maxlines,
+                                      uint32_t defways, uint32_t deflines) {
+    uint32_t ways = log2nways->to_uint32();
+    uint32_t lines = log2lines->to_uint32();
+    if (ways >= minways && ways <= maxways
+        && lines >= minlines && lines <= maxlines) {
+        return;
+    }
+    RISCV_error("%s geometry log2(ways)=%d, log2(lines)=%d not instantiated, "
+                "use %d, %d", cache, ways, lines, defways, deflines);
+    log2nways->make_uint64(defways);
+    log2lines->make_uint64(deflines);
 }
 
 void CpuRiscV_RTL::createSystemC() {
     sc_set_default_time_unit(1, SC_NS);
 
+    // Ranges of the tag memory templates instantiated in the cache models
+    checkCacheGeometry("I$", &ilog2NWays_, &ilog2LinesPerWay_,
+                       1, 3, 6, 9, 2, 7);
+    checkCacheGeometry("D$", &dlog2NWays_, &dlog2LinesPerWay_,
+                       1, 3, 6, 9, 2, 7);
+    checkCacheGeometry("L2", &l2log2NWays_, &l2log2LinesPerWay_,
+                       2, 4, 7, 11, 4, 9);
+
 
     /** Create all objects, then initilize SystemC context: */
     wrapper_ = new RtlWrapper(static_cast<IService *>(this), "wrapper");
@@ -171,10 +231,13 @@ void CpuRiscV_RTL::createSystemC() {
     group0_ = new Workgroup("group0",
                             asyncReset_.to_bool(),
                             cpuNum_.to_uint32(),
-                            2, 7,
-                            2, 7,
+                            ilog2NWays_.to_uint32(),
+                            ilog2LinesPerWay_.to_uint32(),
+                            dlog2NWays_.to_uint32(),
+                            dlog2LinesPerWay_.to_uint32(),
                             l2CacheEnable_.to_uint32(),
-                            4, 9);
+                            l2log2NWays_.to_uint32(),
+                            l2log2LinesPerWay_.to_uint32());
     group0_->i_cores_nrst(w_sys_nrst);
     group0_->i_dmi_nrst(w_dmi_nrst);
     group0_->i_clk(wrapper_->o_clk);
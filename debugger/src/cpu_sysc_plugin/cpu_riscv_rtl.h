@@ -19,6 +19,11 @@
  *             InVcdFile   - Stimulus VCD file
  *             OutVcdFile  - Reference VCD file with any number of signals
  *
+ *             Cache geometry is selected at startup by the attributes
+ *             ILog2NWays/ILog2LinesPerWay (I$), DLog2NWays/DLog2LinesPerWay
+ *             (D$) and L2Log2NWays/L2Log2LinesPerWay (L2). Counters of all
+ *             caches are read by the 'cachestat' command and printed on exit.
+ *
  * @note       When GenerateRef is true Core uses step counter instead 
  *             of clock counter to generate callbacks.
  */
@@ -37,6 +42,7 @@
 #include "coreservices/itap.h"
 #include "coreservices/iirq.h"
 #include "cmds/cmd_br_riscv.h"
+#include "cmds/cmd_cachestat.h"
 #include "rtl_wrapper.h"
 #include "tap_bitbang.h"
 #include "bus_slv.h"
@@ -92,12 +98,24 @@ class CpuRiscV_RTL : public IService,
  private:
     void createSystemC();
     void deleteSystemC();
+    void checkCacheGeometry(const char *cache,
+                            AttributeType *log2nways,
+                            AttributeType *log2lines,
+                            uint32_t minways, uint32_t maxways,
+                            uint32_t minlines, uint32_t maxlines,
+                            uint32_t defways, uint32_t deflines);
 
  private:
     AttributeType hartid_;
     AttributeType asyncReset_;
     AttributeType cpuNum_;
     AttributeType l2CacheEnable_;
+    AttributeType ilog2NWays_;
+    AttributeType ilog2LinesPerWay_;
+    AttributeType dlog2NWays_;
+    AttributeType dlog2LinesPerWay_;
+    AttributeType l2log2NWays_;
+    AttributeType l2log2LinesPerWay_;
     AttributeType clint_;
     AttributeType plic_;
     AttributeType bus_;
@@ -158,6 +176,7 @@ class CpuRiscV_RTL : public IService,
 
     CmdBrRiscv *pcmd_br_;
     ICommand *pcmd_cpu_;
+    CmdCacheStat *pcmd_cachestat_;
 };
 
 DECLARE_CLASS(CpuRiscV_RTL)
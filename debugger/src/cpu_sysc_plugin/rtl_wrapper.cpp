@@ -289,7 +289,6 @@ void RtlWrapper::sys_bus_proc() {
     uint64_t offset;
 
     step_queue_.initProc();
-    step_queue_.pushPreQueued();
     uint64_t step_cnt = r.clk_cnt.read();
     while ((cb = step_queue_.getNext(step_cnt)) != 0) {
         static_cast<IClockListener *>(cb)->stepCallback(step_cnt);
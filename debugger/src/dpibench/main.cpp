@@ -0,0 +1,348 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <iservice.h>
+#include "coreservices/idpi.h"
+#include "coreservices/itap.h"
+#include "coreservices/ithread.h"
+#include "coreservices/irawlistener.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+using namespace debugger;
+
+static const char *BENCH_CONFIG =
+"{"
+  "'GlobalSettings':{'SimEnable':true},"
+  "'Services':["
+    "{'Class':'DpiClientClass','Instances':["
+      "{'Name':'dpijson','Attr':["
+        "['Enable',true],"
+        "['Timeout',1000],"
+        "['HostIP','127.0.0.1'],"
+        "['HostPort',%d]]},"
+      "{'Name':'dpibin','Attr':["
+        "['Enable',true],"
+        "['Timeout',1000],"
+        "['HostIP','127.0.0.1'],"
+        "['HostPort',%d],"
+        "['Batched',true]]}]}"
+  "]"
+"}";
+
+static const int SIM_MEM_SIZE = 1 << 20;
+
+/**
+ * Stand-in of the DPI wrapper in the HDL simulator: single connection,
+ * JSON and binary requests, memory model instead of the RTL.
+ */
+class DpiSimServer : public IThread {
+ public:
+    DpiSimServer() : IThread() {
+        mem_ = new uint8_t[SIM_MEM_SIZE];
+        memset(mem_, 0, SIM_MEM_SIZE);
+        rxcnt_ = 0;
+        txcnt_ = 0;
+        hclient_ = -1;
+        hsock_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        addr.sin_port = 0;
+        bind(hsock_, reinterpret_cast<struct sockaddr *>(&addr),
+             sizeof(addr));
+        addr_size_t addrsz = sizeof(addr);
+        getsockname(hsock_, reinterpret_cast<struct sockaddr *>(&addr),
+                    &addrsz);
+        port_ = ntohs(addr.sin_port);
+        listen(hsock_, 1);
+    }
+    virtual ~DpiSimServer() {
+        closeSocket(hclient_);
+        closeSocket(hsock_);
+        delete [] mem_;
+    }
+
+    int getPort() { return port_; }
+
+ protected:
+    virtual void busyLoop() {
+        hclient_ = accept(hsock_, 0, 0);
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        setsockopt(hclient_, SOL_SOCKET, SO_RCVTIMEO,
+                   reinterpret_cast<char *>(&tv), sizeof(tv));
+        int nodelay = 1;
+        setsockopt(hclient_, IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<char *>(&nodelay), sizeof(nodelay));
+        while (isEnabled()) {
+            int rd = recv(hclient_, &rxbuf_[rxcnt_],
+                          sizeof(rxbuf_) - rxcnt_, 0);
+            if (rd <= 0) {
+                continue;
+            }
+            rxcnt_ += rd;
+            int off = 0;
+            int sz;
+            while ((sz = processFrame(&rxbuf_[off], rxcnt_ - off)) > 0) {
+                off += sz;
+            }
+            memmove(rxbuf_, &rxbuf_[off], rxcnt_ - off);
+            rxcnt_ -= off;
+            flush();
+        }
+    }
+
+ private:
+    /** Returns size of the processed frame or 0 if it isn't complete */
+    int processFrame(char *buf, int sz) {
+        if (sz == 0) {
+            return 0;
+        }
+        if (static_cast<uint8_t>(buf[0]) == DPI_BIN_MAGIC) {
+            DpiPacketHeaderType h;
+            if (sz < static_cast<int>(sizeof(h))) {
+                return 0;
+            }
+            memcpy(&h, buf, sizeof(h));
+            int frame = static_cast<int>(sizeof(h));
+            if (h.cmd == DpiCmd_Write) {
+                frame += 8 * h.beats;
+                if (sz < frame) {
+                    return 0;
+                }
+                int bytes = h.bytes < 8 ? h.bytes : 8 * h.beats;
+                memcpy(&mem_[h.addr % SIM_MEM_SIZE], &buf[sizeof(h)], bytes);
+            } else if (h.cmd == DpiCmd_Read) {
+                h.cmd = DpiCmd_ReadResp;
+                write(&h, sizeof(h));
+                write(&mem_[h.addr % SIM_MEM_SIZE], 8 * h.beats);
+            }
+            return frame;
+        }
+        int len = static_cast<int>(strnlen(buf, sz));
+        if (len == sz) {
+            return 0;
+        }
+        processJson(buf);
+        return len + 1;
+    }
+
+    void processJson(const char *msg) {
+        char tstr[1024];
+        int tsz;
+        AttributeType req;
+        req.from_config(msg);
+        if (req.size() < 2) {
+            return;
+        }
+        if (req[1].is_equal("HartBeat")) {
+            tsz = RISCV_sprintf(tstr, sizeof(tstr), "%s",
+                "['HartBeat',{'tm':0.0,'clkcnt':0}]");
+            write(tstr, tsz + 1);
+            return;
+        }
+        AttributeType &d = req[2];
+        uint64_t addr = d["addr"].to_uint64() % SIM_MEM_SIZE;
+        int bytes = d["bytes"].to_int();
+        if (d["we"].to_int()) {
+            AttributeType &wdata = d["wdata"];
+            for (unsigned i = 0; i < wdata.size(); i++) {
+                uint64_t v = wdata[i].to_uint64();
+                memcpy(&mem_[addr + 8 * i], &v, bytes < 8 ? bytes : 8);
+            }
+            tsz = RISCV_sprintf(tstr, sizeof(tstr), "%s", "['AXI4',{}]");
+        } else {
+            tsz = RISCV_sprintf(tstr, sizeof(tstr), "%s",
+                                "['AXI4',{'rdata':[");
+            for (int i = 0; i < (bytes + 7) / 8; i++) {
+                uint64_t v = 0;
+                memcpy(&v, &mem_[addr + 8 * i], bytes < 8 ? bytes : 8);
+                tsz += RISCV_sprintf(&tstr[tsz], sizeof(tstr) - tsz,
+                    "%s0x%" RV_PRI64 "x", i ? "," : "", v);
+            }
+            tsz += RISCV_sprintf(&tstr[tsz], sizeof(tstr) - tsz, "%s", "]}]");
+        }
+        write(tstr, tsz + 1);
+    }
+
+    void write(const void *buf, int sz) {
+        if (txcnt_ + sz > static_cast<int>(sizeof(txbuf_))) {
+            flush();
+        }
+        memcpy(&txbuf_[txcnt_], buf, sz);
+        txcnt_ += sz;
+    }
+
+    void flush() {
+        int off = 0;
+        while (off < txcnt_) {
+            int wr = send(hclient_, &txbuf_[off], txcnt_ - off, 0);
+            if (wr <= 0) {
+                break;
+            }
+            off += wr;
+        }
+        txcnt_ = 0;
+    }
+
+    void closeSocket(socket_def h) {
+        if (h < 0) {
+            return;
+        }
+#if defined(_WIN32) || defined(__CYGWIN__)
+        closesocket(h);
+#else
+        shutdown(h, SHUT_RDWR);
+        close(h);
+#endif
+    }
+
+ private:
+    socket_def hsock_;
+    socket_def hclient_;
+    int port_;
+    uint8_t *mem_;
+    char rxbuf_[1 << 16];
+    int rxcnt_;
+    char txbuf_[1 << 16];
+    int txcnt_;
+};
+
+/** Counts mismatch reports in the log */
+class MismatchCounter : public IRawListener {
+ public:
+    MismatchCounter() : IRawListener(), cnt(0) {}
+    virtual int updateData(const char *buf, int buflen) {
+        if (strstr(buf, "DPI diff")) {
+            cnt++;
+        }
+        return buflen;
+    }
+    int cnt;
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point t0,
+                         int iter) {
+    std::chrono::duration<double, std::nano> d =
+        std::chrono::steady_clock::now() - t0;
+    return d.count() / iter;
+}
+
+static int bench(const char *name, IDpi *idpi, ITap *itap,
+                 MismatchCounter *mcnt, int iter) {
+    int ret = 0;
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        idpi->axi4_write((8 * i) % SIM_MEM_SIZE, 8, 0x1000000000ull + i);
+    }
+    idpi->axi4_flush();
+    double ns_write = elapsed_ns(t0, iter);
+
+    int mismatch = mcnt->cnt;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        // Every 1000-th expected value is wrong
+        uint64_t expected = 0x1000000000ull + i + ((i % 1000) == 999);
+        idpi->axi4_compare((8 * i) % SIM_MEM_SIZE, 8, expected);
+    }
+    idpi->axi4_flush();
+    double ns_compare = elapsed_ns(t0, iter);
+    RISCV_sleep_ms(200);        // log queue drain
+    mismatch = mcnt->cnt - mismatch;
+
+    uint8_t wbuf[301];
+    uint8_t rbuf[301];
+    for (int i = 0; i < static_cast<int>(sizeof(wbuf)); i++) {
+        wbuf[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    itap->write(0x10003, sizeof(wbuf), wbuf);
+    memset(rbuf, 0, sizeof(rbuf));
+    itap->read(0x10003, sizeof(rbuf), rbuf);
+    if (memcmp(wbuf, rbuf, sizeof(rbuf))) {
+        printf("%s: ITap data mismatch\n", name);
+        ret = 1;
+    }
+    if (mismatch != iter / 1000) {
+        printf("%s: %d mismatches reported, expected %d\n",
+               name, mismatch, iter / 1000);
+        ret = 1;
+    }
+    printf("%-8s write %8.1f ns, compare %8.1f ns, mismatches %d\n",
+           name, ns_write, ns_compare, mismatch);
+    return ret;
+}
+
+int main(int argc, char* argv[]) {
+    int iter = 20000;
+    if (argc > 1) {
+        iter = atoi(argv[1]);
+    }
+    if (iter <= 0) {
+        printf("Usage:\n");
+        printf("    dpibench [<accesses>]\n");
+        printf("        Compare JSON and batched binary DPI client modes\n");
+        printf("        against the local stand-in of the HDL simulator\n");
+        return 1;
+    }
+
+    RISCV_init();
+    DpiSimServer srvjson;
+    DpiSimServer srvbin;
+    srvjson.run();
+    srvbin.run();
+
+    char cfgstr[4096];
+    RISCV_sprintf(cfgstr, sizeof(cfgstr), BENCH_CONFIG,
+                  srvjson.getPort(), srvbin.getPort());
+    AttributeType cfg;
+    cfg.from_config(cfgstr);
+    if (RISCV_set_configuration(&cfg)) {
+        RISCV_cleanup();
+        return 1;
+    }
+    MismatchCounter mcnt;
+    RISCV_add_default_output(static_cast<IRawListener *>(&mcnt));
+    RISCV_sleep_ms(500);
+
+    int ret = 0;
+    ret |= bench("JSON",
+        static_cast<IDpi *>(RISCV_get_service_iface("dpijson", IFACE_DPI)),
+        static_cast<ITap *>(RISCV_get_service_iface("dpijson", IFACE_TAP)),
+        &mcnt, iter);
+    ret |= bench("Batched",
+        static_cast<IDpi *>(RISCV_get_service_iface("dpibin", IFACE_DPI)),
+        static_cast<ITap *>(RISCV_get_service_iface("dpibin", IFACE_TAP)),
+        &mcnt, iter);
+
+    RISCV_remove_default_output(static_cast<IRawListener *>(&mcnt));
+    const char *clients[2] = {"dpijson", "dpibin"};
+    for (int i = 0; i < 2; i++) {
+        IThread *ith = static_cast<IThread *>(
+            RISCV_get_service_iface(clients[i], IFACE_THREAD));
+        ith->stop();
+    }
+    srvjson.stop();
+    srvbin.stop();
+    RISCV_cleanup();
+    return ret;
+}
@@ -0,0 +1,257 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/ilink.h"
+#include "coreservices/itap.h"
+#include "coreservices/ithread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+using namespace debugger;
+
+/**
+ * Local stand-in of the board: Greth service handles EDCL requests from
+ * its own UDP socket and accesses simulated memory. Host side EdclService
+ * sends requests through the link that can drop datagrams.
+ */
+static const char *BENCH_CONFIG =
+"{"
+  "'GlobalSettings':{'SimEnable':true},"
+  "'Services':["
+    "{'Class':'MemorySimClass','Instances':["
+      "{'Name':'mem0','Attr':["
+        "['BaseAddress',0x10000000],"
+        "['Length',0x400000]]}]},"
+    "{'Class':'UdpServiceClass','Instances':["
+      "{'Name':'udpboard','Attr':["
+        "['Timeout',100],"
+        "['HostIP','127.0.0.1'],"
+        "['SimTarget','udphost']]},"
+      "{'Name':'udphost','Attr':["
+        "['Timeout',%d],"
+        "['HostIP','127.0.0.1'],"
+        "['SimTarget','udpboard']]}]},"
+    "{'Class':'GrethClass','Instances':["
+      "{'Name':'eth0','Attr':["
+        "['Bus','mem0'],"
+        "['Transport','udpboard'],"
+        "['SysBusMasterID',0]]}]},"
+    "{'Class':'EdclLossyLinkClass','Instances':["
+      "{'Name':'lossy0','Attr':["
+        "['Transport','udphost'],"
+        "['LossPercent',%d]]}]},"
+    "{'Class':'EdclServiceClass','Instances':["
+      "{'Name':'edcl0','Attr':["
+        "['Transport','lossy0'],"
+        "['Retries',8]]}]}"
+  "]"
+"}";
+
+static const uint64_t BENCH_ADDR = 0x10000000;
+
+/** Link that drops requests and responses with the defined probability */
+class EdclLossyLink : public IService,
+                      public ILink {
+ public:
+    explicit EdclLossyLink(const char *name) : IService(name) {
+        registerInterface(static_cast<ILink *>(this));
+        registerAttribute("Transport", &transport_);
+        registerAttribute("LossPercent", &lossPercent_);
+        lossPercent_.make_int64(0);
+        itransport_ = 0;
+        dropped_ = 0;
+    }
+
+    virtual void postinitService() {
+        itransport_ = static_cast<ILink *>(
+            RISCV_get_service_iface(transport_.to_string(), IFACE_LINK));
+    }
+
+    virtual void getConnectionSettings(AttributeType *settings) {
+        itransport_->getConnectionSettings(settings);
+    }
+    virtual void setConnectionSettings(const AttributeType *target) {
+        itransport_->setConnectionSettings(target);
+    }
+    virtual int sendData(const uint8_t *msg, int len) {
+        if (drop()) {
+            return len;
+        }
+        return itransport_->sendData(msg, len);
+    }
+    virtual int readData(const uint8_t *buf, int maxlen) {
+        int ret;
+        do {
+            ret = itransport_->readData(buf, maxlen);
+        } while (ret > 0 && drop());
+        return ret;
+    }
+
+    int getDropped() { return dropped_; }
+
+ private:
+    bool drop() {
+        if (rand() % 100 >= lossPercent_.to_int()) {
+            return false;
+        }
+        dropped_++;
+        return true;
+    }
+
+ private:
+    AttributeType transport_;
+    AttributeType lossPercent_;
+    ILink *itransport_;
+    int dropped_;
+};
+
+DECLARE_CLASS(EdclLossyLink)
+
+static double elapsed_sec(std::chrono::steady_clock::time_point t0) {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+    return d.count();
+}
+
+static bool check_unaligned(ITap *itap) {
+    uint8_t wbuf[64];
+    uint8_t rbuf[80];
+    uint8_t fill[80];
+    for (int i = 0; i < static_cast<int>(sizeof(fill)); i++) {
+        fill[i] = static_cast<uint8_t>(0xA0 + i);
+    }
+    for (int i = 0; i < static_cast<int>(sizeof(wbuf)); i++) {
+        wbuf[i] = static_cast<uint8_t>(i + 1);
+    }
+    for (int off = 1; off < 4; off++) {
+        for (int sz = 1; sz < 45; sz += 7) {
+            if (itap->write(BENCH_ADDR, sizeof(fill), fill) == TAP_ERROR
+                || itap->write(BENCH_ADDR + 8 + off, sz, wbuf) == TAP_ERROR
+                || itap->read(BENCH_ADDR + 7, 60, rbuf) == TAP_ERROR) {
+                return false;
+            }
+            for (int i = 0; i < 60; i++) {
+                int k = i - 1 - off;
+                uint8_t v = (k >= 0 && k < sz) ? wbuf[k] : fill[i + 7];
+                if (rbuf[i] != v) {
+                    printf("Mismatch: off=%d sz=%d byte[%d] %02x != %02x\n",
+                           off, sz, i, rbuf[i], v);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int kbytes = 256;
+    int loss = 0;
+    if (argc > 1) {
+        kbytes = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        loss = atoi(argv[2]);
+    }
+    if (kbytes <= 0 || kbytes > 4096 || loss < 0 || loss > 50) {
+        printf("Usage:\n");
+        printf("    edclbench [<kbytes> [<loss_percent>]]\n");
+        printf("        Measure EDCL read/write throughput for the\n");
+        printf("        different window sizes against the local Greth\n");
+        printf("        model on the loopback interface\n");
+        return 1;
+    }
+
+    RISCV_init();
+    REGISTER_CLASS(EdclLossyLink);
+
+    char cfgstr[4096];
+    RISCV_sprintf(cfgstr, sizeof(cfgstr), BENCH_CONFIG,
+                  loss ? 20 : 1000, loss);
+    AttributeType cfg;
+    cfg.from_config(cfgstr);
+    if (RISCV_set_configuration(&cfg)) {
+        RISCV_cleanup();
+        return 1;
+    }
+
+    ITap *itap = static_cast<ITap *>(
+        RISCV_get_service_iface("edcl0", IFACE_TAP));
+    IService *iedcl = static_cast<IService *>(RISCV_get_service("edcl0"));
+    AttributeType *window =
+        static_cast<AttributeType *>(iedcl->getAttribute("WindowSize"));
+    EdclLossyLink *ilossy = static_cast<EdclLossyLink *>(
+        static_cast<IService *>(RISCV_get_service("lossy0")));
+
+    int sz = kbytes * 1024;
+    uint8_t *wbuf = new uint8_t[sz];
+    uint8_t *rbuf = new uint8_t[sz];
+    int ret = 0;
+    srand(1);
+    for (int i = 0; i < sz; i++) {
+        wbuf[i] = static_cast<uint8_t>(rand());
+    }
+
+    printf("window     write KB/s      read KB/s  dropped\n");
+    const int windows[] = {1, 2, 4, 8, 16, 32};
+    for (unsigned n = 0; n < sizeof(windows) / sizeof(windows[0]); n++) {
+        window->make_int64(windows[n]);
+        memset(rbuf, 0, sz);
+        int dropped = ilossy->getDropped();
+
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        if (itap->write(BENCH_ADDR, sz, wbuf) == TAP_ERROR) {
+            printf("%6d  write error\n", windows[n]);
+            ret = 1;
+            break;
+        }
+        double twr = elapsed_sec(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        if (itap->read(BENCH_ADDR, sz, rbuf) == TAP_ERROR) {
+            printf("%6d  read error\n", windows[n]);
+            ret = 1;
+            break;
+        }
+        double trd = elapsed_sec(t0);
+
+        printf("%6d %14.1f %14.1f %8d%s\n", windows[n],
+               kbytes / twr, kbytes / trd, ilossy->getDropped() - dropped,
+               memcmp(wbuf, rbuf, sz) ? "  data mismatch" : "");
+        if (memcmp(wbuf, rbuf, sz)) {
+            ret = 1;
+        }
+    }
+    if (ret == 0 && !check_unaligned(itap)) {
+        printf("Unaligned access check failed\n");
+        ret = 1;
+    }
+
+    IThread *ith = static_cast<IThread *>(
+        RISCV_get_service_iface("eth0", IFACE_THREAD));
+    if (ith) {
+        ith->stop();
+    }
+    delete [] wbuf;
+    delete [] rbuf;
+    RISCV_cleanup();
+    return ret;
+}
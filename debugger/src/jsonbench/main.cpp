@@ -0,0 +1,185 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "jsonstream.h"
+
+using namespace debugger;
+
+/** Frame size of the TCP stream emulation */
+static const int FRAME_SIZE = 1460;
+
+/** Parser callbacks without building the tree */
+class CountHandler : public JsonHandler {
+ public:
+    CountHandler() : tokens(0), bytes(0) {}
+    virtual void onListBegin() { tokens++; }
+    virtual void onListEnd() {}
+    virtual void onDictBegin() { tokens++; }
+    virtual void onDictEnd() {}
+    virtual void onKey(const char *s, int len) { bytes += len; }
+    virtual void onString(const char *s, int len) { tokens++; bytes += len; }
+    virtual void onInteger(int64_t v) { tokens++; }
+    virtual void onFloating(double v) { tokens++; }
+    virtual void onBoolean(bool v) { tokens++; }
+    virtual void onNil() { tokens++; }
+    virtual void onData(const uint8_t *p, int len) { tokens++; }
+    virtual void onDocument() {}
+    virtual void onError(const char *descr) {}
+
+    uint64_t tokens;
+    uint64_t bytes;
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point t0,
+                         int iter) {
+    std::chrono::duration<double, std::nano> d =
+        std::chrono::steady_clock::now() - t0;
+    return d.count() / iter;
+}
+
+static char *make_memdump(int words) {
+    int sz = 64 + 24 * words;
+    char *s = new char[sz];
+    int off = RISCV_sprintf(s, sz, "%s", "[7,[");
+    for (int i = 0; i < words; i++) {
+        off += RISCV_sprintf(&s[off], sz - off, "%s0x%08x",
+                             i ? "," : "", 0x13000000 + i * 0x101);
+    }
+    RISCV_sprintf(&s[off], sz - off, "%s", "]]");
+    return s;
+}
+
+static char *make_config(int entries) {
+    int sz = 256 + 160 * entries;
+    char *s = new char[sz];
+    int off = RISCV_sprintf(s, sz, "%s", "[9,{'Services':[");
+    for (int i = 0; i < entries; i++) {
+        off += RISCV_sprintf(&s[off], sz - off,
+            "%s{'Class':'Class%d','Instances':[{'Name':'obj%d','Attr':"
+            "[['LogLevel',3],['Enable',true],['Freq',1.5],"
+            "['Descr','Module description %d']]}]}",
+            i ? "," : "", i, i, i);
+    }
+    RISCV_sprintf(&s[off], sz - off, "%s", "]}]");
+    return s;
+}
+
+static void bench(const char *name, const char *msg, int iter) {
+    int len = static_cast<int>(strlen(msg));
+    AttributeType ref;
+    ref.from_config(msg);
+
+    // Check that both serializers give the same output
+    AttributeType t1;
+    t1.clone(&ref);
+    t1.to_config();
+    int outsz = 2 * t1.size() + 64;
+    char *out = new char[outsz];
+    int outlen = attribute_to_json(&ref, out, outsz);
+    if (outlen != static_cast<int>(t1.size())
+        || strcmp(out, t1.to_string()) != 0) {
+        printf("%s: serializers mismatch\n", name);
+    }
+
+    printf("%s: %d bytes\n", name, len);
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        AttributeType a;
+        a.from_config(msg);
+    }
+    printf("    from_config           %10.1f ns\n", elapsed_ns(t0, iter));
+
+    JsonAttributeBuilder builder;
+    JsonStreamParser parser(&builder);
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        parser.parse(msg, len);
+        builder.reset();
+    }
+    printf("    stream, whole message %10.1f ns\n", elapsed_ns(t0, iter));
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        for (int off = 0; off < len; off += FRAME_SIZE) {
+            int frame = len - off < FRAME_SIZE ? len - off : FRAME_SIZE;
+            parser.parse(&msg[off], frame);
+        }
+        builder.reset();
+    }
+    printf("    stream, %4d B frames %10.1f ns\n",
+           FRAME_SIZE, elapsed_ns(t0, iter));
+
+    CountHandler counter;
+    JsonStreamParser sax(&counter);
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        sax.parse(msg, len);
+    }
+    printf("    SAX without tree      %10.1f ns\n", elapsed_ns(t0, iter));
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        t1.clone(&ref);
+        t1.to_config();
+    }
+    double ns_clone = 0;
+    double ns_toconfig = elapsed_ns(t0, iter);
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        t1.clone(&ref);
+    }
+    ns_clone = elapsed_ns(t0, iter);
+    printf("    to_config             %10.1f ns\n", ns_toconfig - ns_clone);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iter; i++) {
+        attribute_to_json(&ref, out, outsz);
+    }
+    printf("    attribute_to_json     %10.1f ns\n", elapsed_ns(t0, iter));
+    delete [] out;
+}
+
+int main(int argc, char* argv[]) {
+    int iter = 10000;
+    if (argc > 1) {
+        iter = atoi(argv[1]);
+    }
+    if (iter <= 0) {
+        printf("Usage:\n");
+        printf("    jsonbench [<iterations>]\n");
+        printf("        Compare from_config()/to_config() with the\n");
+        printf("        streaming parser and serializer\n");
+        return 1;
+    }
+
+    char *memdump = make_memdump(1024);
+    char *config = make_config(64);
+    bench("Status request", "[1,'Status','Steps']", iter);
+    bench("Command request",
+          "[2,'Command','read 0x80000000 64']", iter);
+    bench("Memory dump response", memdump, iter / 10 + 1);
+    bench("Configuration response", config, iter / 10 + 1);
+    delete [] memdump;
+    delete [] config;
+    return 0;
+}
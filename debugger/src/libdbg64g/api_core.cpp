@@ -33,6 +33,7 @@
 #include "services/remote/tcpclient.h"
 #include "services/remote/tcpserver.h"
 #include "services/remote/dpiclient.h"
+#include "services/snapshot/snapshot.h"
 #include "services/comport/comport.h"
 #include "services/console/autocompleter.h"
 #include "services/console/console.h"
@@ -67,6 +68,7 @@ extern "C" int RISCV_init() {
     }
 #endif
     pcore_ = new CoreService("core");
+    pcore_->startLogQueue();
 
     REGISTER_CLASS_IDX(BusGeneric, 0);
     REGISTER_CLASS_IDX(SerialDbgService, 1);
@@ -88,12 +90,14 @@ extern "C" int RISCV_init() {
     REGISTER_CLASS_IDX(Greth, 17)
     REGISTER_CLASS_IDX(DSU, 18);
     REGISTER_CLASS_IDX(TcpJtagBitBangClient, 19);
+    REGISTER_CLASS_IDX(SnapshotService, 20);
 
     pcore_->load_plugins();
     return 0;
 }
 
 extern "C" void RISCV_cleanup() {
+    pcore_->stopLogQueue();
     pcore_->predeletePlatformServices();
     pcore_->unload_plugins();
 
@@ -101,6 +105,7 @@ extern "C" void RISCV_cleanup() {
     WSACleanup();
 #endif
     delete pcore_;
+    pcore_ = NULL;
 }
 
 extern "C" int RISCV_set_configuration(AttributeType *cfg) {
@@ -172,6 +177,25 @@ extern "C" IFace *RISCV_create_service(IFace *iclass, const char *name,
     return iobj;
 }
 
+extern "C" void RISCV_invalidate_service_index() {
+    // Services are created before the core and removed after it
+    if (pcore_) {
+        pcore_->invalidateServiceIndex();
+    }
+}
+
+/**
+ * Out of line, so that the interface type check isn't inlined into the
+ * service constructors.
+ */
+extern "C" void RISCV_register_interface(IFace *iservice, IFace *iface) {
+    if (strcmp(iface->getFaceName(), IFACE_MEMORY_OPERATION) == 0) {
+        static_cast<IService *>(iservice)->registerMemoryAttributes(
+            static_cast<IMemoryOperation *>(iface));
+    }
+    RISCV_invalidate_service_index();
+}
+
 extern "C" IFace *RISCV_get_service(const char *name) {
     return pcore_->getService(name);
 }
@@ -338,53 +362,60 @@ extern "C" void RISCV_disable_log() {
     pcore_->closeLog();
 }
 
+/**
+ * Message is formatted by the calling thread without locks and queued,
+ * console and log file are written by the log drain thread.
+ */
 extern "C" int RISCV_printf(void *iface, int level, 
                             const char *fmt, ...) {
     int ret = 0;
     va_list arg;
     IFace *iout = reinterpret_cast<IFace *>(iface);
-    uint64_t cur_t = pcore_->getTimestamp();
-
-    char *buf = pcore_->getpBufLog();
-    size_t buf_sz = pcore_->sizeBufLog();
-    pcore_->lockPrintf();
+    const char *name;
     if (iout == NULL) {
-        ret = RISCV_sprintf(buf, buf_sz,
-                    "[%" RV_PRI64 "d, \"%s\", \"", cur_t, "unknown");
+        name = "unknown";
     } else if (strcmp(iout->getFaceName(), IFACE_SERVICE) == 0) {
         IService *iserv = static_cast<IService *>(iout);
-        AttributeType *local_level = 
-                static_cast<AttributeType *>(iserv->getAttribute("LogLevel"));
-        if (level > static_cast<int>(local_level->to_int64())) {
-            pcore_->unlockPrintf();
+        if (level > iserv->getLogLevel()) {
             return 0;
         }
-        ret = RISCV_sprintf(buf, buf_sz,
-                "[%" RV_PRI64 "d, \"%s\", \"", cur_t, iserv->getObjName());
+        name = iserv->getObjName();
     } else if (strcmp(iout->getFaceName(), IFACE_CLASS) == 0) {
-        IClass *icls = static_cast<IClass *>(iout);
-        ret = RISCV_sprintf(buf, buf_sz,
-                "[%" RV_PRI64 "d, \"%s\", \"", cur_t, icls->getClassName());
+        name = static_cast<IClass *>(iout)->getClassName();
     } else {
-        ret = RISCV_sprintf(buf, buf_sz,
-                "[%" RV_PRI64 "d, \"%s\", \"", cur_t, iout->getFaceName());
+        name = iout->getFaceName();
     }
+
+    char tbuf[1024];
+    char *buf = tbuf;
+    ret = RISCV_sprintf(buf, sizeof(tbuf), "[%" RV_PRI64 "d, \"%s\", \"",
+                        pcore_->getTimestamp(), name);
     va_start(arg, fmt);
-#if defined(_WIN32) || defined(__CYGWIN__)
-    ret += vsprintf_s(&buf[ret], buf_sz - ret, fmt, arg);
-#else
-    ret += vsprintf(&buf[ret], fmt, arg);
-#endif
+    int msgsz = vsnprintf(&buf[ret], sizeof(tbuf) - ret, fmt, arg);
     va_end(arg);
+    if (msgsz < 0) {
+        msgsz = 0;
+    }
+    int total = ret + msgsz + 4;
+    if (total > static_cast<int>(sizeof(tbuf))) {
+        buf = new char[total];
+        memcpy(buf, tbuf, ret);
+        va_start(arg, fmt);
+        vsnprintf(&buf[ret], total - ret, fmt, arg);
+        va_end(arg);
+    }
+    ret += msgsz;
 
     buf[ret++] = '\"';
     buf[ret++] = ']';
     buf[ret++] = '\n';
     buf[ret] = '\0';
 
-    pcore_->outputConsole(buf, ret);
-    pcore_->outputLog(buf, ret);
-    pcore_->unlockPrintf();
+    // Console output and errors are never dropped
+    pcore_->writeLog(buf, ret, level >= LOG_INFO);
+    if (buf != tbuf) {
+        delete [] buf;
+    }
     return ret;
 }
 
@@ -405,11 +436,7 @@ extern "C" int RISCV_sscanf(const char *s, const char *fmt, ...) {
     int ret;
     va_list arg;
     va_start(arg, fmt);
-#if defined(_WIN32) || defined(__CYGWIN__)
     ret = vsscanf(s, fmt, arg);
-#else
-    ret = vsscanf(fmt, s, arg);
-#endif
     va_end(arg);
     return ret;
 }
@@ -618,7 +645,7 @@ extern "C" void* RISCV_memshare_map(sharemem_def h, int sz) {
                         sz);
 #else
     ret = mmap(NULL, sz + 1, PROT_READ|PROT_WRITE, MAP_SHARED, h, 0);
-    if (ret < 0) {
+    if (ret == MAP_FAILED) {
         ret = 0;
     }
 #endif
@@ -644,6 +671,123 @@ extern "C" void RISCV_memshare_delete(sharemem_def h) {
 #endif
 }
 
+extern "C" void *RISCV_memory_reserve(uint64_t sz) {
+    void *ret = 0;
+    if (sz == 0) {
+        return ret;
+    }
+#if defined(_WIN32) || defined(__CYGWIN__)
+    ret = VirtualAlloc(NULL, static_cast<SIZE_T>(sz),
+                       MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    ret = mmap(NULL, static_cast<size_t>(sz), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ret == MAP_FAILED) {
+        ret = 0;
+    }
+#endif
+    if (ret == 0) {
+        RISCV_error("Couldn't reserve %" RV_PRI64 "d bytes", sz);
+    }
+    return ret;
+}
+
+extern "C" void *RISCV_memory_map_file(const char *filename, uint64_t sz,
+                                       uint64_t *filesz) {
+    void *ret = 0;
+    uint64_t fsz = 0;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        RISCV_error("Can't open '%s' file", filename);
+        return ret;
+    }
+    _fseeki64(fp, 0, SEEK_END);
+    fsz = static_cast<uint64_t>(_ftelli64(fp));
+    _fseeki64(fp, 0, SEEK_SET);
+    if (sz == 0) {
+        sz = fsz;
+    }
+    ret = RISCV_memory_reserve(sz);
+    if (ret) {
+        fread(ret, 1, static_cast<size_t>(fsz < sz ? fsz : sz), fp);
+    }
+    fclose(fp);
+#else
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        RISCV_error("Can't open '%s' file", filename);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return ret;
+    }
+    fsz = static_cast<uint64_t>(st.st_size);
+    if (sz == 0) {
+        sz = fsz;
+    }
+    ret = RISCV_memory_reserve(sz);
+    if (ret && fsz) {
+        // Pages beyond the end of file raise SIGBUS, leave them anonymous
+        uint64_t pagesz = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        uint64_t maplen = fsz < sz ? fsz : sz;
+        maplen = (maplen + pagesz - 1) & ~(pagesz - 1);
+        void *p = mmap(ret, static_cast<size_t>(maplen),
+                       PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                       fd, 0);
+        if (p == MAP_FAILED) {
+            RISCV_error("Couldn't map file '%s'", filename);
+            munmap(ret, static_cast<size_t>(sz));
+            ret = 0;
+        }
+    }
+    close(fd);
+#endif
+    if (filesz) {
+        *filesz = fsz;
+    }
+    return ret;
+}
+
+extern "C" int RISCV_memory_remap(void *addr, uint64_t sz,
+                                  const char *filename, uint64_t offset) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return 0;
+#else
+    uint64_t pagemask = static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) - 1;
+    if ((reinterpret_cast<uint64_t>(addr) | sz | offset) & pagemask) {
+        return 0;
+    }
+    void *p;
+    if (filename == 0) {
+        p = mmap(addr, static_cast<size_t>(sz), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                 -1, 0);
+    } else {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            return 0;
+        }
+        p = mmap(addr, static_cast<size_t>(sz), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(offset));
+        close(fd);
+    }
+    return p == MAP_FAILED ? 0 : 1;
+#endif
+}
+
+extern "C" void RISCV_memory_release(void *ptr, uint64_t sz) {
+    if (ptr == 0) {
+        return;
+    }
+#if defined(_WIN32) || defined(__CYGWIN__)
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, static_cast<size_t>(sz));
+#endif
+}
+
 extern "C" int RISCV_mutex_init(mutex_def *mutex) {
 #if defined(_WIN32) || defined(__CYGWIN__)
     InitializeCriticalSection(mutex);
@@ -734,6 +878,25 @@ extern "C" int RISCV_get_core_folderw(wchar_t* out, int sz) {
     return 0;
 }
 
+extern "C" int RISCV_get_full_path(const char *path, char *out, int sz) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    if (_fullpath(out, path, sz) == NULL
+        || GetFileAttributesA(out) == INVALID_FILE_ATTRIBUTES) {
+        return 0;
+    }
+    return 1;
+#else
+    char *full = realpath(path, NULL);
+    if (full == NULL) {
+        return 0;
+    }
+    int ret = strlen(full) < static_cast<size_t>(sz) ? 1 : 0;
+    RISCV_sprintf(out, sz, "%s", full);
+    free(full);
+    return ret;
+#endif
+}
+
 extern "C" void RISCV_set_current_dir() {
 #if defined(_WIN32) || defined(__CYGWIN__)
     HMODULE hMod = GetModuleHandle(NULL);
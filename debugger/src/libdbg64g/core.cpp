@@ -40,19 +40,28 @@ CoreService::CoreService(const char *name) : IService("CoreService") {
     RISCV_mutex_init(&mutexPrintf_);
     RISCV_mutex_init(&mutexDefaultConsoles_);
     RISCV_mutex_init(&mutexLogFile_);
+    RISCV_mutex_init(&mutexServiceIndex_);
+    serviceIndex_.store(0);
+    serviceIndexValid_ = false;
     //logLevel_.make_int64(LOG_DEBUG);  // default = LOG_ERROR
     iclk_ = 0;
     uniqueIdx_ = 0;
     logFile_ = 0;
+    logq_ = 0;
 }
 
 CoreService::~CoreService() {
+    stopLogQueue();
+    delete logq_;
+    logq_ = 0;
     closeLog();
     RISCV_mutex_lock(&mutexPrintf_);
     RISCV_mutex_destroy(&mutexPrintf_);
     RISCV_mutex_lock(&mutexDefaultConsoles_);
     RISCV_mutex_destroy(&mutexDefaultConsoles_);
     RISCV_mutex_destroy(&mutexLogFile_);
+    RISCV_mutex_destroy(&mutexServiceIndex_);
+    delete serviceIndex_.load();
     RISCV_event_close(&eventExiting_);
 }
 
@@ -157,6 +166,7 @@ void CoreService::registerClass(IFace *icls) {
     }
     AttributeType item(icls);
     listClasses_.add_to_list(&item);
+    invalidateServiceIndex();
 }
 
 void CoreService::unregisterClass(const char *clsname) {
@@ -165,6 +175,7 @@ void CoreService::unregisterClass(const char *clsname) {
         icls = static_cast<IClass *>(listClasses_[i].to_iface());
         if (strcmp(icls->getClassName(), clsname) == 0) {
             listClasses_.remove_from_list(i);
+            invalidateServiceIndex();
             break;
         }
     }
@@ -372,70 +383,60 @@ IFace *CoreService::getClass(const char *name) {
 }
 
 IFace *CoreService::getService(const char *name) {
-    IClass *icls;
-    IService *iserv;
-    for (unsigned i = 0; i < listClasses_.size(); i++) {
-        icls = static_cast<IClass *>(listClasses_[i].to_iface());
-        if ((iserv = icls->getInstance(name)) != NULL) {
-            return iserv;
-        }
-    }
-    return NULL;
+    return getServiceIndex()->getService(name);
 }
 
 void CoreService::getServicesWithIFace(const char *iname,
                                        AttributeType *list) {
-    IClass *icls;
-    IService *iserv;
-    IFace *iface;
     const AttributeType *tlist;
-    list->make_list(0);
-    
-    for (unsigned i = 0; i < listClasses_.size(); i++) {
-        icls = static_cast<IClass *>(listClasses_[i].to_iface());
-        tlist = icls->getInstanceList();
-        for (unsigned n = 0; n < tlist->size(); n++) {
-            iserv = static_cast<IService *>((*tlist)[n].to_iface());
-            iface = iserv->getInterface(iname);
-            if (iface) {
-                AttributeType t1(iserv);
-                list->add_to_list(&t1);
-            }
-        }
+    tlist = getServiceIndex()->getServicesWithIFace(iname);
+    if (tlist) {
+        list->clone(tlist);
+    } else {
+        list->make_list(0);
     }
 }
 
 void CoreService::getIFaceList(const char *iname,
                                AttributeType *list) {
-    IClass *icls;
-    IService *iserv;
-    IFace *iface;
     const AttributeType *tlist;
-    const AttributeType *tports;
-    list->make_list(0);
-    
-    for (unsigned i = 0; i < listClasses_.size(); i++) {
-        icls = static_cast<IClass *>(listClasses_[i].to_iface());
-        tlist = icls->getInstanceList();
-        for (unsigned n = 0; n < tlist->size(); n++) {
-            iserv = static_cast<IService *>((*tlist)[n].to_iface());
-            iface = iserv->getInterface(iname);
-            if (iface) {
-                AttributeType t1(iface);
-                list->add_to_list(&t1);
-            }
-            tports = iserv->getPortList();
-            for (unsigned k = 0; k < tports->size(); k++) {
-                const AttributeType &prt = (*tports)[k];
-                // [0] port name; [1] port interface
-                iface = prt[1].to_iface();
-                if (strcmp(iname, iface->getFaceName()) == 0) {
-                    AttributeType t1(iface);
-                    list->add_to_list(&t1);
-                }
-            }
-        }
+    tlist = getServiceIndex()->getIFaceList(iname);
+    if (tlist) {
+        list->clone(tlist);
+    } else {
+        list->make_list(0);
+    }
+}
+
+/**
+ * Index is rebuilt on the next lookup. Services are created and removed
+ * in batches on start and exit, so there's no need in incremental update.
+ */
+void CoreService::invalidateServiceIndex() {
+    serviceIndexValid_.store(false);
+}
+
+/**
+ * Lookup takes the lock only when the index is outdated. Concurrent
+ * invalidation during the build leaves the flag cleared for the next one.
+ */
+ServiceIndex *CoreService::getServiceIndex() {
+    ServiceIndex *idx = 0;
+    if (serviceIndexValid_.load(std::memory_order_acquire)) {
+        idx = serviceIndex_.load(std::memory_order_acquire);
+    }
+    if (idx) {
+        return idx;
     }
+    RISCV_mutex_lock(&mutexServiceIndex_);
+    if (!serviceIndexValid_.exchange(true)) {
+        idx = new ServiceIndex(serviceIndex_.load());
+        idx->build(&listClasses_);
+        serviceIndex_.store(idx, std::memory_order_release);
+    }
+    idx = serviceIndex_.load();
+    RISCV_mutex_unlock(&mutexServiceIndex_);
+    return idx;
 }
 
 void CoreService::lockPrintf() {
@@ -485,6 +486,30 @@ void CoreService::outputConsole(const char *buf, int sz) {
     RISCV_mutex_unlock(&mutexDefaultConsoles_);
 }
 
+void CoreService::writeLog(const char *buf, int sz, bool droppable) {
+    if (logq_ && logq_->write(buf, sz, droppable)) {
+        return;
+    }
+    lockPrintf();
+    outputConsole(buf, sz);
+    outputLog(buf, sz);
+    unlockPrintf();
+}
+
+void CoreService::startLogQueue() {
+    if (!logq_) {
+        logq_ = new LogQueue(this);
+        logq_->run();
+    }
+}
+
+/** Messages after this call are written synchronously */
+void CoreService::stopLogQueue() {
+    if (logq_) {
+        logq_->shutdown();
+    }
+}
+
 void CoreService::generateUniqueName(const char *prefix,
                                      char *out, size_t outsz) {
     RISCV_sprintf(out, outsz, "%s_%d_%08x",
@@ -21,6 +21,8 @@
 #include "iclass.h"
 #include "iservice.h"
 #include "ihap.h"
+#include "logqueue.h"
+#include "serviceindex.h"
 #include <iostream>
 
 namespace debugger {
@@ -68,6 +70,8 @@ class CoreService : public IService {
     IFace *getService(const char *name);
     void getServicesWithIFace(const char *iname, AttributeType *list);
     void getIFaceList(const char *iname, AttributeType *list);
+    void invalidateServiceIndex();
+    ServiceIndex *getServiceIndex();
 
     void lockPrintf();
     void unlockPrintf();
@@ -75,12 +79,14 @@ class CoreService : public IService {
     void closeLog();
     void outputLog(const char *buf, int sz);
     void outputConsole(const char *buf, int sz);
+    /** Formatted message is queued or written directly without drain */
+    void writeLog(const char *buf, int sz, bool droppable);
+    void startLogQueue();
+    void stopLogQueue();
 
     void setTimestampClk(IFace *iclk) { iclk_ = iclk; }
     uint64_t getTimestamp();
 
-    char *getpBufLog() { return bufLog_; }
-    size_t sizeBufLog() { return sizeof(bufLog_); }
     void generateUniqueName(const char *prefix, char *out, size_t outsz);
 
  private:
@@ -95,12 +101,17 @@ class CoreService : public IService {
     mutex_def mutexLogFile_;
     mutex_def mutexPrintf_;
     mutex_def mutexDefaultConsoles_;
+    mutex_def mutexServiceIndex_;
 
     IFace *iclk_;
     FILE *logFile_;
-
-    /** Temporary buffer for the log messages. */
-    char bufLog_[1024*1024];
+    LogQueue *logq_;
+    /**
+     * Published index is immutable and read without locking. Outdated
+     * versions are kept until exit as a lookup may still use them.
+     */
+    std::atomic<ServiceIndex *> serviceIndex_;
+    std::atomic<bool> serviceIndexValid_;
     int uniqueIdx_;
 };
 
@@ -0,0 +1,270 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "logqueue.h"
+#include "core.h"
+
+namespace debugger {
+
+struct LogQueue::RingType {
+    RingType *next;
+    std::atomic<bool> owned;
+    std::atomic<uint64_t> head;         // written by the owner thread
+    std::atomic<uint64_t> tail;         // read by the drain thread
+    std::atomic<uint64_t> dropped;
+    char *data;
+};
+
+/** Message header in the ring, text or heap pointer follows it */
+struct LogRecordType {
+    uint32_t size;
+    uint32_t flags;
+    uint64_t seq;
+};
+
+static const uint32_t LOG_REC_WRAP = 0xFFFFFFFFu;
+static const uint32_t LOG_REC_HEAP = 0x1;
+
+static std::atomic<uint64_t> log_generation_(0);
+
+/** Ring of the thread is released on the thread exit and re-used */
+struct LogThreadBinding {
+    LogThreadBinding() : generation(0), ring(0), owned(0) {}
+    ~LogThreadBinding() {
+        if (owned && generation == log_generation_.load()) {
+            owned->store(false);
+        }
+    }
+    uint64_t generation;
+    void *ring;
+    std::atomic<bool> *owned;
+};
+
+static thread_local LogThreadBinding log_binding_;
+static thread_local bool log_drain_thread_ = false;
+
+LogQueue::LogQueue(CoreService *core) : IThread() {
+    core_ = core;
+    generation_ = ++log_generation_;
+    rings_ = 0;
+    seq_ = 0;
+    nextSeq_ = 0;
+    running_ = true;
+    dropped_ = 0;
+    filebuf_ = new char[FILE_BUF_SIZE];
+    filecnt_ = 0;
+}
+
+LogQueue::~LogQueue() {
+    log_generation_++;
+    RingType *r = rings_.load();
+    while (r) {
+        RingType *next = r->next;
+        delete [] r->data;
+        delete r;
+        r = next;
+    }
+    delete [] filebuf_;
+}
+
+LogQueue::RingType *LogQueue::claimRing() {
+    for (RingType *r = rings_.load(); r; r = r->next) {
+        bool expected = false;
+        if (r->owned.compare_exchange_strong(expected, true)) {
+            return r;
+        }
+    }
+    RingType *r = new RingType;
+    r->owned = true;
+    r->head = 0;
+    r->tail = 0;
+    r->dropped = 0;
+    r->data = new char[RING_SIZE];
+    r->next = rings_.load();
+    while (!rings_.compare_exchange_weak(r->next, r)) {}
+    return r;
+}
+
+bool LogQueue::write(const char *buf, int sz, bool droppable) {
+    if (!running_.load(std::memory_order_acquire)
+        || (log_drain_thread_ && !droppable)) {
+        return false;
+    }
+    RingType *r = static_cast<RingType *>(log_binding_.ring);
+    if (!r || log_binding_.generation != generation_) {
+        r = claimRing();
+        log_binding_.generation = generation_;
+        log_binding_.ring = r;
+        log_binding_.owned = &r->owned;
+    }
+
+    bool heap = sz > INLINE_MAX;
+    uint32_t payload = heap ? sizeof(char *) : static_cast<uint32_t>(sz);
+    uint32_t recsz = (sizeof(LogRecordType) + payload + 7) & ~7u;
+    uint64_t head = r->head.load(std::memory_order_relaxed);
+    uint32_t off = static_cast<uint32_t>(head & (RING_SIZE - 1));
+    uint32_t contig = RING_SIZE - off;
+    uint64_t need = recsz + (contig < recsz ? contig : 0);
+    while (RING_SIZE - (head - r->tail.load(std::memory_order_acquire))
+            < need) {
+        if (droppable) {
+            r->dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        RISCV_sleep_ms(0);
+    }
+    if (contig < recsz) {
+        reinterpret_cast<LogRecordType *>(&r->data[off])->size = LOG_REC_WRAP;
+        head += contig;
+        off = 0;
+    }
+
+    LogRecordType *rec = reinterpret_cast<LogRecordType *>(&r->data[off]);
+    rec->size = static_cast<uint32_t>(sz);
+    rec->flags = heap ? LOG_REC_HEAP : 0;
+    rec->seq = seq_.fetch_add(1, std::memory_order_relaxed);
+    if (heap) {
+        char *p = new char[sz];
+        memcpy(p, buf, sz);
+        memcpy(rec + 1, &p, sizeof(p));
+    } else {
+        memcpy(rec + 1, buf, sz);
+    }
+    r->head.store(head + recsz, std::memory_order_release);
+    return true;
+}
+
+void LogQueue::shutdown() {
+    running_.store(false, std::memory_order_release);
+    stop();
+    drain(true);
+}
+
+void LogQueue::busyLoop() {
+    log_drain_thread_ = true;
+    while (isEnabled()) {
+        if (!drain(false)) {
+            RISCV_sleep_ms(1);
+        }
+    }
+}
+
+/**
+ * Output of all queued messages ordered by the sequence number. Returns
+ * number of the messages.
+ *
+ * Sequence number is taken before the record is published, so the next
+ * number may be still held by the preempted writer while the later ones
+ * are already visible. Output stops at such gap until the writer commits
+ * its record. On shutdown the gap is awaited for a limited time only.
+ */
+int LogQueue::drain(bool final) {
+    int cnt = 0;
+    int gapwait = 0;
+    while (true) {
+        RingType *best = 0;
+        LogRecordType *bestrec = 0;
+        for (RingType *r = rings_.load(); r; r = r->next) {
+            uint64_t tail = r->tail.load(std::memory_order_relaxed);
+            uint64_t head = r->head.load(std::memory_order_acquire);
+            if (tail == head) {
+                continue;
+            }
+            uint32_t off = static_cast<uint32_t>(tail & (RING_SIZE - 1));
+            LogRecordType *rec =
+                    reinterpret_cast<LogRecordType *>(&r->data[off]);
+            if (rec->size == LOG_REC_WRAP) {
+                tail += RING_SIZE - off;
+                r->tail.store(tail, std::memory_order_release);
+                rec = reinterpret_cast<LogRecordType *>(r->data);
+            }
+            if (!bestrec || rec->seq < bestrec->seq) {
+                best = r;
+                bestrec = rec;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        if (bestrec->seq > nextSeq_) {
+            if (!final) {
+                break;
+            }
+            if (gapwait++ < GAP_WAIT_MAX) {
+                RISCV_sleep_ms(0);
+                continue;
+            }
+        }
+        gapwait = 0;
+        if (bestrec->seq >= nextSeq_) {
+            nextSeq_ = bestrec->seq + 1;
+        }
+
+        const char *text = reinterpret_cast<const char *>(bestrec + 1);
+        char *heapbuf = 0;
+        uint32_t payload = bestrec->size;
+        if (bestrec->flags & LOG_REC_HEAP) {
+            memcpy(&heapbuf, text, sizeof(heapbuf));
+            text = heapbuf;
+            payload = sizeof(char *);
+        }
+        core_->outputConsole(text, bestrec->size);
+        if (filecnt_ + static_cast<int>(bestrec->size) > FILE_BUF_SIZE) {
+            flushFile();
+        }
+        if (static_cast<int>(bestrec->size) > FILE_BUF_SIZE) {
+            core_->outputLog(text, bestrec->size);
+        } else {
+            memcpy(&filebuf_[filecnt_], text, bestrec->size);
+            filecnt_ += bestrec->size;
+        }
+        delete [] heapbuf;
+
+        uint32_t recsz = (sizeof(LogRecordType) + payload + 7) & ~7u;
+        best->tail.store(best->tail.load(std::memory_order_relaxed) + recsz,
+                         std::memory_order_release);
+        cnt++;
+    }
+
+    flushFile();
+    uint64_t total = 0;
+    for (RingType *r = rings_.load(); r; r = r->next) {
+        total += r->dropped.load(std::memory_order_relaxed);
+    }
+    if (total != dropped_) {
+        char tstr[256];
+        int sz = RISCV_sprintf(tstr, sizeof(tstr),
+            "[%" RV_PRI64 "d, \"%s\", \"%" RV_PRI64 "d log messages "
+            "dropped\"]\n", core_->getTimestamp(), core_->getObjName(),
+            total - dropped_);
+        dropped_ = total;
+        core_->outputConsole(tstr, sz);
+        core_->outputLog(tstr, sz);
+    }
+    return cnt;
+}
+
+void LogQueue::flushFile() {
+    if (filecnt_) {
+        core_->outputLog(filebuf_, filecnt_);
+        filecnt_ = 0;
+    }
+}
+
+}  // namespace debugger
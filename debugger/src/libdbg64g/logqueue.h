@@ -0,0 +1,82 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __SRC_LIBDBG64G_LOGQUEUE_H__
+#define __SRC_LIBDBG64G_LOGQUEUE_H__
+
+#include "api_core.h"
+#include "coreservices/ithread.h"
+#include <atomic>
+
+namespace debugger {
+
+class CoreService;
+
+/**
+ * @brief Asynchronous output of the log messages.
+ * @details Every thread writes formatted messages into its own single
+ *          producer ring buffer without locks. Drain thread merges rings
+ *          by the global sequence number and passes messages to the
+ *          default consoles and log file. Info and debug messages are
+ *          dropped and counted when the ring is full, so that the
+ *          simulation isn't blocked by the slow console.
+ */
+class LogQueue : public IThread {
+ public:
+    explicit LogQueue(CoreService *core);
+    virtual ~LogQueue();
+
+    /**
+     * Returns false when the message should be written synchronously.
+     * Message which isn't droppable waits for the free space in the ring.
+     */
+    bool write(const char *buf, int sz, bool droppable);
+
+    /** Stop drain thread and output pending messages */
+    void shutdown();
+
+    uint64_t getDropped() { return dropped_; }
+
+ protected:
+    /** IThread */
+    virtual void busyLoop();
+
+ private:
+    struct RingType;
+    RingType *claimRing();
+    int drain(bool final);
+    void flushFile();
+
+ private:
+    static const int RING_SIZE = 1 << 18;
+    static const int INLINE_MAX = RING_SIZE / 8;
+    static const int FILE_BUF_SIZE = 1 << 16;
+    static const int GAP_WAIT_MAX = 1000;
+
+    CoreService *core_;
+    uint64_t generation_;
+    std::atomic<RingType *> rings_;
+    std::atomic<uint64_t> seq_;
+    uint64_t nextSeq_;                  // next sequence to output
+    std::atomic<bool> running_;
+    uint64_t dropped_;
+    char *filebuf_;
+    int filecnt_;
+};
+
+}  // namespace debugger
+
+#endif  // __SRC_LIBDBG64G_LOGQUEUE_H__
@@ -0,0 +1,244 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "serviceindex.h"
+#include "iclass.h"
+
+namespace debugger {
+
+ServiceIndex::ServiceIndex(ServiceIndex *retired) {
+    retired_ = retired;
+    servSize_ = 64;
+    servCnt_ = 0;
+    services_ = new IService *[servSize_];
+    servHash_ = new uint32_t[servSize_];
+    memset(services_, 0, servSize_ * sizeof(IService *));
+    ifaceSize_ = 32;
+    ifaceCnt_ = 0;
+    ifaces_ = new IFaceEntryType *[ifaceSize_];
+    memset(ifaces_, 0, ifaceSize_ * sizeof(IFaceEntryType *));
+}
+
+ServiceIndex::~ServiceIndex() {
+    clear();
+    delete [] services_;
+    delete [] servHash_;
+    delete [] ifaces_;
+    delete retired_;
+}
+
+void ServiceIndex::clear() {
+    memset(services_, 0, servSize_ * sizeof(IService *));
+    servCnt_ = 0;
+    for (unsigned i = 0; i < ifaceSize_; i++) {
+        if (ifaces_[i]) {
+            delete [] ifaces_[i]->name;
+            delete ifaces_[i];
+            ifaces_[i] = 0;
+        }
+    }
+    ifaceCnt_ = 0;
+}
+
+/** FNV-1a */
+uint32_t ServiceIndex::hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= static_cast<uint8_t>(*s++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Services are added in the same order as the linear search walked them:
+ * class by class, instance by instance, first interface with the name and
+ * then all ports.
+ */
+void ServiceIndex::build(const AttributeType *classes) {
+    IClass *icls;
+    const AttributeType *tlist;
+    clear();
+    for (unsigned i = 0; i < classes->size(); i++) {
+        icls = static_cast<IClass *>((*classes)[i].to_iface());
+        tlist = icls->getInstanceList();
+        for (unsigned n = 0; n < tlist->size(); n++) {
+            addService(static_cast<IService *>((*tlist)[n].to_iface()));
+        }
+    }
+}
+
+void ServiceIndex::addService(IService *iserv) {
+    if ((servCnt_ + 1) * 2 > servSize_) {
+        growServices();
+    }
+    const char *name = iserv->getObjName();
+    uint32_t h = hash(name);
+    unsigned idx = h & (servSize_ - 1);
+    bool exists = false;
+    while (services_[idx]) {
+        if (servHash_[idx] == h
+            && strcmp(services_[idx]->getObjName(), name) == 0) {
+            // The first instance hides others with the same name
+            exists = true;
+            break;
+        }
+        idx = (idx + 1) & (servSize_ - 1);
+    }
+    if (!exists) {
+        services_[idx] = iserv;
+        servHash_[idx] = h;
+        servCnt_++;
+    }
+
+    // The first interface with the name, as getInterface() returns
+    const AttributeType *tlist = iserv->getInterfaceList();
+    IFaceEntryType *e;
+    IFace *iface;
+    for (unsigned i = 0; i < tlist->size(); i++) {
+        iface = (*tlist)[i].to_iface();
+        e = addIFace(iface->getFaceName());
+        if (e->last == iserv) {
+            continue;
+        }
+        e->last = iserv;
+        AttributeType t1(iserv);
+        e->services.add_to_list(&t1);
+        AttributeType t2(iface);
+        e->ifaces.add_to_list(&t2);
+    }
+
+    // Ports: [0] port name; [1] port interface
+    tlist = iserv->getPortList();
+    for (unsigned i = 0; i < tlist->size(); i++) {
+        iface = (*tlist)[i][1].to_iface();
+        e = addIFace(iface->getFaceName());
+        AttributeType t1(iface);
+        e->ifaces.add_to_list(&t1);
+    }
+}
+
+ServiceIndex::IFaceEntryType *ServiceIndex::findIFace(const char *iname,
+                                                      uint32_t h) {
+    IFaceEntryType *e;
+    unsigned idx = h & (ifaceSize_ - 1);
+    while ((e = ifaces_[idx]) != 0) {
+        if (e->alias == iname
+            || (e->hash == h && strcmp(e->name, iname) == 0)) {
+            return e;
+        }
+        idx = (idx + 1) & (ifaceSize_ - 1);
+    }
+    return 0;
+}
+
+ServiceIndex::IFaceEntryType *ServiceIndex::addIFace(const char *iname) {
+    uint32_t h = hash(iname);
+    IFaceEntryType *e = findIFace(iname, h);
+    if (e) {
+        return e;
+    }
+    if ((ifaceCnt_ + 1) * 2 > ifaceSize_) {
+        growIFaces();
+    }
+    size_t len = strlen(iname);
+    e = new IFaceEntryType;
+    e->name = new char[len + 1];
+    memcpy(e->name, iname, len + 1);
+    e->alias = iname;
+    e->hash = h;
+    e->last = 0;
+    e->services.make_list(0);
+    e->ifaces.make_list(0);
+
+    unsigned idx = h & (ifaceSize_ - 1);
+    while (ifaces_[idx]) {
+        idx = (idx + 1) & (ifaceSize_ - 1);
+    }
+    ifaces_[idx] = e;
+    ifaceCnt_++;
+    return e;
+}
+
+void ServiceIndex::growServices() {
+    IService **prev = services_;
+    uint32_t *prevHash = servHash_;
+    unsigned prevSize = servSize_;
+    servSize_ *= 2;
+    services_ = new IService *[servSize_];
+    servHash_ = new uint32_t[servSize_];
+    memset(services_, 0, servSize_ * sizeof(IService *));
+    for (unsigned i = 0; i < prevSize; i++) {
+        if (!prev[i]) {
+            continue;
+        }
+        unsigned idx = prevHash[i] & (servSize_ - 1);
+        while (services_[idx]) {
+            idx = (idx + 1) & (servSize_ - 1);
+        }
+        services_[idx] = prev[i];
+        servHash_[idx] = prevHash[i];
+    }
+    delete [] prev;
+    delete [] prevHash;
+}
+
+void ServiceIndex::growIFaces() {
+    IFaceEntryType **prev = ifaces_;
+    unsigned prevSize = ifaceSize_;
+    ifaceSize_ *= 2;
+    ifaces_ = new IFaceEntryType *[ifaceSize_];
+    memset(ifaces_, 0, ifaceSize_ * sizeof(IFaceEntryType *));
+    for (unsigned i = 0; i < prevSize; i++) {
+        if (!prev[i]) {
+            continue;
+        }
+        unsigned idx = prev[i]->hash & (ifaceSize_ - 1);
+        while (ifaces_[idx]) {
+            idx = (idx + 1) & (ifaceSize_ - 1);
+        }
+        ifaces_[idx] = prev[i];
+    }
+    delete [] prev;
+}
+
+IService *ServiceIndex::getService(const char *name) {
+    if (!name) {
+        return 0;
+    }
+    uint32_t h = hash(name);
+    unsigned idx = h & (servSize_ - 1);
+    while (services_[idx]) {
+        if (servHash_[idx] == h
+            && strcmp(services_[idx]->getObjName(), name) == 0) {
+            return services_[idx];
+        }
+        idx = (idx + 1) & (servSize_ - 1);
+    }
+    return 0;
+}
+
+const AttributeType *ServiceIndex::getServicesWithIFace(const char *iname) {
+    IFaceEntryType *e = findIFace(iname, hash(iname));
+    return e ? &e->services : 0;
+}
+
+const AttributeType *ServiceIndex::getIFaceList(const char *iname) {
+    IFaceEntryType *e = findIFace(iname, hash(iname));
+    return e ? &e->ifaces : 0;
+}
+
+}  // namespace debugger
@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __SRC_LIBDBG64G_SERVICEINDEX_H__
+#define __SRC_LIBDBG64G_SERVICEINDEX_H__
+
+#include "api_core.h"
+#include "iservice.h"
+
+namespace debugger {
+
+/**
+ * @brief Hashed lookup of the service instances.
+ * @details Index maps the object name on service and the interface name
+ *          on the list of services and interfaces (including ports) that
+ *          implement it. Interface names are interned on build so that
+ *          the name taken from the same IFACE_* constant is matched by
+ *          the pointer. Index is rebuilt from the class list after any
+ *          service or interface was created or removed.
+ */
+class ServiceIndex {
+ public:
+    /** 'retired' is the previous version released with this one */
+    explicit ServiceIndex(ServiceIndex *retired);
+    ~ServiceIndex();
+
+    /** Remove all entries before the next build */
+    void clear();
+    /** Add instances of all classes from the list */
+    void build(const AttributeType *classes);
+
+    IService *getService(const char *name);
+    /** Lists are owned by the index */
+    const AttributeType *getServicesWithIFace(const char *iname);
+    const AttributeType *getIFaceList(const char *iname);
+
+ private:
+    struct IFaceEntryType {
+        char *name;                 // own copy
+        const char *alias;          // first seen pointer, never dereferenced
+        uint32_t hash;
+        IService *last;             // last added service
+        AttributeType services;
+        AttributeType ifaces;
+    };
+
+    static uint32_t hash(const char *s);
+    void addService(IService *iserv);
+    IFaceEntryType *findIFace(const char *iname, uint32_t h);
+    IFaceEntryType *addIFace(const char *iname);
+    void growServices();
+    void growIFaces();
+
+ private:
+    IService **services_;           // open addressing on object name
+    uint32_t *servHash_;
+    unsigned servSize_;             // power of 2
+    unsigned servCnt_;
+    IFaceEntryType **ifaces_;       // open addressing on interface name
+    unsigned ifaceSize_;            // power of 2
+    unsigned ifaceCnt_;
+    ServiceIndex *retired_;
+};
+
+}  // namespace debugger
+
+#endif  // __SRC_LIBDBG64G_SERVICEINDEX_H__
@@ -23,18 +23,31 @@ EdclService::EdclService(const char *name) : IService(name) {
     registerInterface(static_cast<ITap *>(this));
     registerAttribute("Transport", &transport_);
     registerAttribute("seq_cnt", &seq_cnt_);
+    registerAttribute("WindowSize", &windowSize_);
+    registerAttribute("Retries", &retries_);
     seq_cnt_.make_uint64(0);
+    windowSize_.make_int64(4);
+    retries_.make_int64(3);
     itransport_ = 0;
+    inflight_ = 0;
+    ignore_ = 0;
+    xbuf_ = 0;
+    xbufsz_ = 0;
 
     dbgRdTRansactionCnt_ = 0;
 }
 
+EdclService::~EdclService() {
+    delete [] xbuf_;
+}
+
 void EdclService::postinitService() {
     IService *iserv = 
         static_cast<IService *>(RISCV_get_service(transport_.to_string()));
     if (!iserv) {
         RISCV_error("Transport service '%'s not found", 
                     transport_.to_string());
+        return;
     }
     itransport_ = static_cast<ILink *>(iserv->getInterface(IFACE_LINK));
     if (!itransport_) {
@@ -44,14 +57,9 @@ void EdclService::postinitService() {
 }
 
 int EdclService::read(uint64_t addr, int bytes, uint8_t *obuf) {
-    int txoff, rxoff;
-    UdpEdclCommonType req = {0};
-    UdpEdclCommonType rsp;
     uint32_t align_addr;
     uint32_t align_offset;
     int align_length;
-    uint32_t obuf_len;
-    uint32_t obuf_off = 0;
 
     align_offset = addr & 0x3ul;
     align_addr = addr & ~0x3ul;
@@ -62,202 +70,287 @@ int EdclService::read(uint64_t addr, int bytes, uint8_t *obuf) {
         return TAP_ERROR;
     }
 
-    int rd_bytes = 0;
-    while (rd_bytes < align_length && rd_bytes != TAP_ERROR) {
-        req.control.request.seqidx = 
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        req.control.request.write = 0;
-        req.address = static_cast<uint32_t>(align_addr + rd_bytes);
-        if ((align_length - rd_bytes) > EDCL_PAYLOAD_MAX_BYTES) {
-            req.control.request.len = 
-                    static_cast<uint32_t>(EDCL_PAYLOAD_MAX_BYTES);
-        } else {
-            req.control.request.len =
-                static_cast<uint32_t>(align_length - rd_bytes);
-        }
+    uint8_t *tbuf = obuf;
+    if (align_offset || align_length != bytes) {
+        tbuf = getAlignedBuffer(align_length);
+    }
+    dbgRdTRansactionCnt_++;
+    if (transfer(0, align_addr, align_length, tbuf) == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    if (tbuf != obuf) {
+        memcpy(obuf, &tbuf[align_offset], bytes);
+    }
+    return bytes;
+}
+
+int EdclService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
+    uint32_t align_addr;
+    uint32_t align_offset;
+    int align_length;
 
-        txoff = write16(tx_buf_, 0, req.offset);
-        txoff = write32(tx_buf_, txoff, req.control.word);
-        txoff = write32(tx_buf_, txoff, req.address);
+    if (!itransport_) {
+        RISCV_error("UDP transport not defined, addr=%x", addr);
+        return TAP_ERROR;
+    }
+
+    align_offset = addr & 0x3ul;
+    align_addr = addr & ~0x3ul;
+    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
+
+    uint8_t *tbuf = ibuf;
+    if (align_offset || align_length != bytes) {
+        // Read-modify-write of the partially written words
+        tbuf = getAlignedBuffer(align_length);
+        if (align_offset
+            && transfer(0, align_addr, 4, tbuf) == TAP_ERROR) {
+            return TAP_ERROR;
+        }
+        if ((align_offset + bytes) & 0x3
+            && (align_length > 4 || !align_offset)
+            && transfer(0, align_addr + align_length - 4, 4,
+                        &tbuf[align_length - 4]) == TAP_ERROR) {
+            return TAP_ERROR;
+        }
+        memcpy(&tbuf[align_offset], ibuf, bytes);
+    }
+    if (transfer(1, align_addr, align_length, tbuf) == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    return bytes;
+}
 
-        txoff = itransport_->sendData(tx_buf_, txoff);
-        if (txoff == -1) {
-            RISCV_error("Data sending error", NULL);
-            rd_bytes = TAP_ERROR;
-            break;
+/**
+ * Split aligned buffer on requests and keep up to 'WindowSize' of them
+ * in flight. Response is matched with the request by the sequence index.
+ */
+int EdclService::transfer(int write, uint32_t addr, int len, uint8_t *buf) {
+    UdpEdclCommonType rsp;
+    EdclSlotType *s;
+    int rxoff;
+    int window = windowSize_.to_int();
+    int total = (len + EDCL_PAYLOAD_MAX_BYTES - 1) / EDCL_PAYLOAD_MAX_BYTES;
+    int base = 0;           // the first not acknowledged request
+    int next = 0;           // the first not sent request
+    int retry = 0;
+    bool stale;
+    const char *NAK[2] = {"ACK", "NAK"};
+    const char *RW[2] = {"read", "write"};
+
+    if (window < 1) {
+        window = 1;
+    } else if (window > EDCL_WINDOW_MAX) {
+        window = EDCL_WINDOW_MAX;
+    }
+    inflight_ = 0;
+    ignore_ = 0;
+
+    while (base < total) {
+        while (next < total && next - base < window) {
+            s = &slot_[next % window];
+            s->addr = addr + next * EDCL_PAYLOAD_MAX_BYTES;
+            s->len = len - next * EDCL_PAYLOAD_MAX_BYTES;
+            if (s->len > EDCL_PAYLOAD_MAX_BYTES) {
+                s->len = EDCL_PAYLOAD_MAX_BYTES;
+            }
+            s->data = &buf[next * EDCL_PAYLOAD_MAX_BYTES];
+            s->acked = false;
+            s->seqidx = nextSeq();
+            if (sendRequest(write, s) == -1) {
+                return TAP_ERROR;
+            }
+            next++;
         }
 
-        dbgRdTRansactionCnt_++;
         rxoff = itransport_->readData(rx_buf_, sizeof(rx_buf_));
         if (rxoff == -1) {
             RISCV_error("Data receiving error", NULL);
-            rd_bytes = TAP_ERROR;
-            break;
-        } 
+            return TAP_ERROR;
+        }
         if (rxoff == 0) {
-            RISCV_error("No response. Break read transaction[%d] at %08x",
-                        dbgRdTRansactionCnt_, req.address);
-            rd_bytes = TAP_ERROR;
-            break;
+            s = &slot_[base % window];
+            if (++retry > retries_.to_int()) {
+                RISCV_error("No response. Break %s transaction[%d] at %08x",
+                            RW[write], dbgRdTRansactionCnt_, s->addr);
+                return TAP_ERROR;
+            }
+            RISCV_info("No response at %08x. Re-sending %d requests.",
+                        s->addr, next - base);
+            // Requests or responses are lost
+            inflight_ = 0;
+            ignore_ = 0;
+            if (resend(write, base, next, window) == -1) {
+                return TAP_ERROR;
+            }
+            continue;
+        }
+        if (rxoff < static_cast<int>(sizeof(UdpEdclCommonType))) {
+            continue;
+        }
+        if (inflight_) {
+            inflight_--;
+        }
+        stale = ignore_ > 0;
+        if (stale) {
+            ignore_--;
         }
 
         rsp.control.word = read32(&rx_buf_[2]);
-
-        const char *NAK[2] = {"ACK", "NAK"};
-        RISCV_debug("EDCL read: %s[%d], len = %d", 
+        RISCV_debug("EDCL %s: %s[%d], len = %d", RW[write],
                     NAK[rsp.control.response.nak],
                     rsp.control.response.seqidx,
                     rsp.control.response.len);
 
-        // Retry with new sequence counter.
         if (rsp.control.response.nak) {
+            if (stale) {
+                // NAK on the request sent before re-sync
+                continue;
+            }
+            if (++retry > retries_.to_int()) {
+                RISCV_error("Sequence re-sync failed. Break %s at %08x",
+                            RW[write], slot_[base % window].addr);
+                return TAP_ERROR;
+            }
             RISCV_info("Sequence counter detected %d. Re-sending transaction.",
                          rsp.control.response.seqidx);
-            seq_cnt_.make_uint64(rsp.control.response.seqidx);
-            continue;
-        }
-
-        // Try to receive next packet:
-        if (rsp.control.response.seqidx != seq_cnt_.to_uint32()) {
-            RISCV_error("Wrong ID received %d != %d. Try again.",
-                        seq_cnt_.to_uint32(), rsp.control.response.seqidx);
-
-            rxoff = itransport_->readData(rx_buf_, sizeof(rx_buf_));
-            if (rxoff <= 0) {
-                rd_bytes = TAP_ERROR;
-                break;
-            }
-            rsp.control.word = read32(&rx_buf_[2]);
-            if (rsp.control.response.seqidx != seq_cnt_.to_uint32()) {
-                rd_bytes = TAP_ERROR;
-                break;
+            ignore_ = inflight_;
+            resync(rsp.control.response.seqidx, base, next, window);
+            if (resend(write, base, next, window) == -1) {
+                return TAP_ERROR;
             }
+            continue;
         }
 
-        obuf_len = rsp.control.response.len;
-        if ((obuf_off + obuf_len) > static_cast<uint32_t>(bytes)) {
-            // exclude alignment bytes from buffer end
-            obuf_len = static_cast<uint32_t>(bytes) - obuf_off;
+        s = findSlot(rsp.control.response.seqidx, base, next, window);
+        if (!s) {
+            // Response on the duplicated request
+            continue;
         }
-        if (align_offset) {
-            if (rd_bytes == 0) {
-                memcpy(&obuf[obuf_off], &rx_buf_[10 + align_offset], obuf_len);
-                obuf_off += (rsp.control.response.len - align_offset);
-            } else {
-                memcpy(&obuf[obuf_off], &rx_buf_[10], obuf_len);
-                obuf_off += obuf_len;
+        if (!write) {
+            if (static_cast<int>(rsp.control.response.len) != s->len
+                || rxoff < static_cast<int>(sizeof(UdpEdclCommonType))
+                            + s->len) {
+                RISCV_error("Wrong response length %d at %08x",
+                            rsp.control.response.len, s->addr);
+                continue;
             }
-        } else {
-            memcpy(&obuf[obuf_off], &rx_buf_[10], obuf_len);
-            obuf_off += obuf_len;
+            memcpy(s->data, &rx_buf_[sizeof(UdpEdclCommonType)], s->len);
+        }
+        s->acked = true;
+        retry = 0;
+        while (base < next && slot_[base % window].acked) {
+            base++;
         }
-        rd_bytes += rsp.control.response.len;
-        seq_cnt_.make_uint64((seq_cnt_.to_uint64() + 1) & 0x3FFF);
     }
-    return bytes;
+    return len;
 }
 
-int EdclService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
-    int off;
+int EdclService::sendRequest(int write, EdclSlotType *s) {
     UdpEdclCommonType req = {0};
-    UdpEdclCommonType rsp;
-    uint32_t align_addr;
-    uint32_t align_offset;
-    uint32_t align_offset0;
-    int align_length;
-    uint32_t ibuf_len;
-    uint32_t ibuf_off = 0;
-    uint32_t ubytes = static_cast<uint32_t>(bytes);
+    int off;
+    req.control.request.seqidx = s->seqidx;
+    req.control.request.write = write;
+    req.control.request.len = static_cast<uint32_t>(s->len);
+    req.address = s->addr;
+
+    off = write16(tx_buf_, 0, req.offset);
+    off = write32(tx_buf_, off, req.control.word);
+    off = write32(tx_buf_, off, req.address);
+    if (write) {
+        memcpy(&tx_buf_[off], s->data, s->len);
+        off += s->len;
+    }
 
-    if (!itransport_) {
-        RISCV_error("UDP transport not defined, addr=%x", addr);
-        return TAP_ERROR;
+    off = itransport_->sendData(tx_buf_, off);
+    if (off == -1) {
+        RISCV_error("Data sending error", NULL);
+        return -1;
     }
+    inflight_++;
+    return off;
+}
 
-    align_offset = addr & 0x3ul;
-    align_addr = addr & ~0x3ul;
-    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
-    align_offset0 = align_offset;
-
-    int wr_bytes = 0;
-    while (wr_bytes < align_length && wr_bytes != -1) {
-        req.control.request.seqidx =
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        req.control.request.write = 1;
-        req.address = static_cast<uint32_t>(align_addr + wr_bytes);
-        if ((align_length - wr_bytes) > EDCL_PAYLOAD_MAX_BYTES) {
-            req.control.request.len =
-                    static_cast<uint32_t>(EDCL_PAYLOAD_MAX_BYTES);
-        } else {
-            req.control.request.len =
-                    static_cast<uint32_t>(align_length - wr_bytes);
+/**
+ * Device accepts only the expected sequence index. Requests with the
+ * indexes from the expected up to the last sent are re-sent as is. Others
+ * were already handled (response is lost) or never be accepted, so they
+ * get the new indexes after the last sent one.
+ */
+void EdclService::resync(uint32_t seqidx, int base, int next, int window) {
+    uint32_t last = seq_cnt_.to_uint32();
+    uint32_t span = (last - seqidx) & EDCL_SEQ_MASK;
+    EdclSlotType *s;
+    if (!findSlot(seqidx, base, next, window)) {
+        seq_cnt_.make_uint64(seqidx);
+        span = 0;
+    }
+    for (int i = base; i < next; i++) {
+        s = &slot_[i % window];
+        if (s->acked) {
+            continue;
         }
+        if (((s->seqidx - seqidx) & EDCL_SEQ_MASK) >= span) {
+            s->seqidx = nextSeq();
+        }
+    }
+}
 
-        off = write16(tx_buf_, 0, req.offset);
-        off = write32(tx_buf_, off, req.control.word);
-        off = write32(tx_buf_, off, req.address);
-
-        ibuf_len = req.control.request.len;
-        // Alignment at the and of buffer
-        if (ibuf_off + req.control.request.len - align_offset0 > ubytes) {
-            read(req.address, 8, &tx_buf_[off]);
-            ibuf_len = align_offset0 + ubytes - ibuf_off;
+/** Re-send not acknowledged requests in the sequence index order */
+int EdclService::resend(int write, int base, int next, int window) {
+    EdclSlotType *order[EDCL_WINDOW_MAX];
+    EdclSlotType *s;
+    uint32_t last = seq_cnt_.to_uint32();
+    int cnt = 0;
+    int k;
+    for (int i = base; i < next; i++) {
+        s = &slot_[i % window];
+        if (s->acked) {
+            continue;
         }
-        // Alignment at the begin of buffer
-        if (align_offset0 != 0) {
-            off += read(align_addr, align_offset, &tx_buf_[off]);
-            ibuf_len -= align_offset;
+        // Insertion sort by the distance from the last sent index
+        for (k = cnt; k > 0; k--) {
+            if (((order[k - 1]->seqidx - last) & EDCL_SEQ_MASK)
+                < ((s->seqidx - last) & EDCL_SEQ_MASK)) {
+                break;
+            }
+            order[k] = order[k - 1];
         }
-        // seqidx can be modified by alingment reading
-        req.control.request.seqidx =
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        write32(tx_buf_, 2, req.control.word);
-
-        memcpy(&tx_buf_[off], &ibuf[ibuf_off], ibuf_len);
-        ibuf_off += ibuf_len;
-        align_offset0 = 0;      // only for zero step
-
-        off = itransport_->sendData(tx_buf_, 10 + req.control.request.len);
-        if (off == -1) {
-            RISCV_error("Data sending error", NULL);
-            wr_bytes = -1;
-            break;
+        order[k] = s;
+        cnt++;
+    }
+    for (int i = 0; i < cnt; i++) {
+        if (sendRequest(write, order[i]) == -1) {
+            return -1;
         }
+    }
+    return cnt;
+}
 
-        off = itransport_->readData(rx_buf_, sizeof(rx_buf_));
-        if (off == -1) {
-            RISCV_error("Data receiving error", NULL);
-            wr_bytes = -1;
-            break;
-        } 
-        if (off == 0) {
-            RISCV_error("No response. Break write transaction.", NULL);
-            wr_bytes = -1;
-            break;
+EdclService::EdclSlotType *EdclService::findSlot(uint32_t seqidx, int base,
+                                                 int next, int window) {
+    EdclSlotType *s;
+    for (int i = base; i < next; i++) {
+        s = &slot_[i % window];
+        if (!s->acked && s->seqidx == seqidx) {
+            return s;
         }
+    }
+    return 0;
+}
 
-        rsp.control.word = read32(&rx_buf_[2]);
-
-        // Warning:
-        //   response length = 0;
-        const char *NAK[2] = {"ACK", "NAK"};
-        RISCV_debug("EDCL write: %s[%d], len = %d", 
-                    NAK[rsp.control.response.nak],
-                    rsp.control.response.seqidx,
-                    req.control.request.len);
-
-        // Retry with new sequence counter.
-        if (rsp.control.response.nak) {
-            RISCV_info("Sequence counter detected %d. Re-sending transaction.",
-                         rsp.control.response.seqidx);
-            seq_cnt_.make_uint64(rsp.control.response.seqidx);
-            continue;
-        }
+uint32_t EdclService::nextSeq() {
+    uint32_t ret = seq_cnt_.to_uint32() & EDCL_SEQ_MASK;
+    seq_cnt_.make_uint64((ret + 1) & EDCL_SEQ_MASK);
+    return ret;
+}
 
-        wr_bytes += req.control.request.len;
-        seq_cnt_.make_uint64(seq_cnt_.to_uint64() + 1);
+uint8_t *EdclService::getAlignedBuffer(int sz) {
+    if (sz > xbufsz_) {
+        delete [] xbuf_;
+        xbufsz_ = sz;
+        xbuf_ = new uint8_t[xbufsz_];
     }
-    return bytes;
+    return xbuf_;
 }
 
 int EdclService::write16(uint8_t *buf, int off, uint16_t v) {
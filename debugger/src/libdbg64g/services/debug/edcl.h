@@ -25,10 +25,19 @@
 
 namespace debugger {
 
+/**
+ * @brief EDCL debug transport over UDP.
+ * @details Up to 'WindowSize' requests are sent without waiting for the
+ *          responses. Device handles requests strictly in the sequence
+ *          order and answers NAK with the expected sequence index on
+ *          mismatch, so on NAK or timeout all unacknowledged requests
+ *          are re-sent starting from the expected one.
+ */
 class EdclService : public IService,
                     public ITap {
 public:
     EdclService(const char *name);
+    virtual ~EdclService();
 
     /** IService interface */
     virtual void postinitService();
@@ -38,6 +47,22 @@ public:
     virtual int write(uint64_t addr, int bytes, uint8_t *ibuf);
 
 private:
+    struct EdclSlotType {
+        uint32_t seqidx;
+        uint32_t addr;
+        int len;
+        uint8_t *data;
+        bool acked;
+    };
+
+    int transfer(int write, uint32_t addr, int len, uint8_t *buf);
+    int sendRequest(int write, EdclSlotType *s);
+    int resend(int write, int base, int next, int window);
+    void resync(uint32_t seqidx, int base, int next, int window);
+    EdclSlotType *findSlot(uint32_t seqidx, int base, int next, int window);
+    uint32_t nextSeq();
+    uint8_t *getAlignedBuffer(int sz);
+
     int write16(uint8_t *buf, int off, uint16_t v);
     int write32(uint8_t *buf, int off, uint32_t v);
     uint32_t read32(uint8_t *buf);
@@ -47,13 +72,22 @@ private:
      * following value up to 242 words. */
     static const int EDCL_PAYLOAD_MAX_WORDS32 = 8;
     static const int EDCL_PAYLOAD_MAX_BYTES  = 4*EDCL_PAYLOAD_MAX_WORDS32;
+    static const int EDCL_WINDOW_MAX = 64;
+    static const uint32_t EDCL_SEQ_MASK = 0x3FFF;
 
     uint8_t tx_buf_[4096];
     uint8_t rx_buf_[4096];
     ILink *itransport_;
     AttributeType transport_;
     AttributeType seq_cnt_;
+    AttributeType windowSize_;
+    AttributeType retries_;
 
+    EdclSlotType slot_[EDCL_WINDOW_MAX];
+    int inflight_;          // requests sent without response
+    int ignore_;            // responses on requests sent before re-sync
+    uint8_t *xbuf_;
+    int xbufsz_;
     int dbgRdTRansactionCnt_;
 };
 
@@ -27,13 +27,22 @@ MemorySim::MemorySim(const char *name)  : MemoryGeneric(name) {
 
     initFile_.make_string("");
     binaryFile_.make_boolean(false);
-    mem_ = NULL;
+    fsz_ = 0;
 }
 
 void MemorySim::postinitService() {
+    if (initFile_.size() && binaryFile_.to_bool()) {
+        // Image is mapped copy-on-write instead of reading into the heap
+        memsize_ = length_.to_uint64();
+        mem_ = static_cast<uint8_t *>(
+            RISCV_memory_map_file(initFile_.to_string(), memsize_, &fsz_));
+        if (fsz_ > memsize_) {
+            RISCV_error("File '%s' was trimmed", initFile_.to_string());
+        }
+    }
     MemoryGeneric::postinitService();
 
-    if (initFile_.size() == 0) {
+    if (initFile_.size() == 0 || binaryFile_.to_bool() || mem_ == NULL) {
         return;
     }
 
@@ -46,12 +55,14 @@ void MemorySim::postinitService() {
         filename = spath + std::string(initFile_.to_string());
     }
 
-    if (binaryFile_.to_bool()) {
-        readBinFile(initFile_.to_string(), mem_, length_.to_int());
-    } else if (strstr(initFile_.to_string(), ".hex")) {
+    if (strstr(initFile_.to_string(), ".hex")) {
         readHexFile(initFile_.to_string(), mem_, length_.to_int());
     } else {
-        uint8_t *tbuf = new uint8_t[length_.to_int()];
+        uint8_t *tbuf = static_cast<uint8_t *>(
+            RISCV_memory_reserve(length_.to_uint64()));
+        if (tbuf == NULL) {
+            return;
+        }
         std::string lo = std::string(initFile_.to_string()) + "_lo.hex";
         std::string hi = std::string(initFile_.to_string()) + "_hi.hex";
         int sz = readHexFile(lo.c_str(), tbuf, length_.to_int());
@@ -61,67 +72,55 @@ void MemorySim::postinitService() {
         uint32_t *lsb = reinterpret_cast<uint32_t *>(tbuf);
         uint32_t *msb = reinterpret_cast<uint32_t *>(&tbuf[sz]);
         uint32_t *dst = reinterpret_cast<uint32_t *>(mem_);
-        uint32_t t1;
         for (int i = 0; i < sz/sizeof(uint32_t); i++) {
             *dst++ = *lsb++;
             *dst++ = *msb++;
         }
-        delete [] tbuf;
+        RISCV_memory_release(tbuf, length_.to_uint64());
     }
 }
 
+/**
+ * Text file is mapped and parsed in place: each line is a hex value
+ * stored in the little-endian order.
+ */
 int MemorySim::readHexFile(const char *filename, uint8_t *buf, int bufsz) {
     int ret = 0;
-    int rd_symb;
     int linecnt = 0;
     uint64_t lineval = 0;
+    uint64_t fsz = 0;
 
-    FILE *fp = fopen(filename, "r");
-    if (fp == NULL) {
-        RISCV_error("Can't open '%s' file", filename);
+    uint8_t *text = static_cast<uint8_t *>(
+        RISCV_memory_map_file(filename, 0, &fsz));
+    if (text == NULL) {
         return ret;
     }
 
-    while (!feof(fp)) {
-        rd_symb = fgetc(fp);
+    // One more iteration after the last symbol flushes the last line
+    for (uint64_t i = 0; i <= fsz; i++) {
+        int rd_symb = i < fsz ? text[i] : EOF;
         if (chishex(rd_symb)) {
             lineval <<= 4;
             lineval |=  chtohex(rd_symb);
             linecnt++;
             continue;
         }
+        if (linecnt == 0) {
+            continue;
+        }
 
         if ((ret + linecnt/2) > bufsz) {
             RISCV_error("HEX file tries to write out "
                         "of allocated array\n", NULL);
             break;
-        } 
+        }
 
         memcpy(&buf[ret], &lineval, linecnt/2);
         ret += linecnt/2;
         linecnt = 0;
         lineval = 0;
     }
-    fclose(fp);
-    return ret;
-}
-
-int MemorySim::readBinFile(const char *filename, uint8_t *buf, int bufsz) {
-    int ret = 0;
-    FILE *fp = fopen(filename, "r");
-    if (fp == NULL) {
-        RISCV_error("Can't open '%s' file", filename);
-        return ret;
-    }
-    fseek(fp, 0, SEEK_END);
-    uint64_t fsz = ftell(fp);
-    if (fsz > bufsz) {
-        RISCV_error("File '%s' was trimmed", filename);
-        fsz = bufsz;
-    }
-    fseek(fp, 0, SEEK_SET);
-    ret = fread(mem_, 1, static_cast<size_t>(fsz), fp);
-    fclose(fp);
+    RISCV_memory_release(text, fsz);
     return ret;
 }
 
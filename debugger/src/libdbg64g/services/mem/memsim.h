@@ -33,11 +33,12 @@ class MemorySim : public MemoryGeneric {
     bool chishex(int s);
     uint8_t chtohex(int s);
     int readHexFile(const char *filename, uint8_t *buf, int bufsz);
-    int readBinFile(const char *filename, uint8_t *buf, int bufsz);
 
  private:
     AttributeType initFile_;
     AttributeType binaryFile_;
+
+    uint64_t fsz_;              // size of the mapped binary image
 };
 
 DECLARE_CLASS(MemorySim)
@@ -41,6 +41,7 @@ CmdDpi::CmdDpi(IService *parent, uint64_t dmibar)
         "    dpi time sec\n"
         "    dpi axi4 read 8 0x1000\n"
         "    dpi axi4 write 8 0x1000 0xcafef00d\n"
+        "    dpi stat\n"
         );
 }
 
@@ -77,6 +78,8 @@ void CmdDpi::exec(AttributeType *args, AttributeType *res) {
     }
     else if ((*args)[1].is_equal("clkcnt")) {
         res->make_uint64(p->getHartBeatClkcnt());
+    } else if ((*args)[1].is_equal("stat")) {
+        p->getStatistic(res);
     }
 }
 
@@ -91,6 +94,8 @@ DpiClient::DpiClient(const char *name) : IService(name),
     registerAttribute("Timeout", &timeout_);
     registerAttribute("HostIP", &hostIP_);
     registerAttribute("HostPort", &hostPort_);
+    registerAttribute("Batched", &batched_);
+    batched_.make_boolean(false);
 
     RISCV_event_create(&event_cmd_, name);
     RISCV_mutex_init(&mutex_tx_);
@@ -103,11 +108,23 @@ DpiClient::DpiClient(const char *name) : IService(name),
     hsock_ = 0;
     hartbeatTime_ = 0;
     hartbeatClkcnt_ = 0;
+
+    pending_ = new DpiPendingType[PENDING_MAX];
+    pendWr_ = 0;
+    pendRd_ = 0;
+    burstOff_ = -1;
+    seqcnt_ = 0;
+    lastHartBeat_ = 0;
+    statPosted_ = 0;
+    statReads_ = 0;
+    statBeats_ = 0;
+    statMismatch_ = 0;
 }
 
 DpiClient::~DpiClient() {
     RISCV_mutex_destroy(&mutex_tx_);
     RISCV_event_close(&event_cmd_);
+    delete [] pending_;
 }
 
 void DpiClient::postinitService() {
@@ -163,21 +180,47 @@ void DpiClient::busyLoop() {
                 RISCV_sleep_ms(2000);
                 continue;
             }
+            RISCV_mutex_lock(&mutex_tx_);
             connected_ = true;
             cmdcnt_ = 0;
             txcnt_ = 0;
+            burstOff_ = -1;
+            pendRd_.store(pendWr_);
+            RISCV_mutex_unlock(&mutex_tx_);
         }
 
         rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf), 0);
 
         if (rxbytes <= 0) {
-            // Timeout:
-            writeTx(reqHartBeat_.to_string(), reqHartBeat_.size() + 1);
+            // Timeout. In batched mode it is the flush period.
+            uint64_t t = RISCV_get_time_ms();
+            if (!batched_.to_bool() || (timeout_.to_uint64()
+                && t - lastHartBeat_ >= timeout_.to_uint64())) {
+                writeTx(reqHartBeat_.to_string(), reqHartBeat_.size() + 1);
+                lastHartBeat_ = t;
+            }
             rxbytes = 0;
         }
 
         for (int i = 0; i < rxbytes; i++) {
+            if (cmdcnt_ >= static_cast<int>(sizeof(cmdbuf_))) {
+                RISCV_error("Rx overflow %d", cmdcnt_);
+                cmdcnt_ = 0;
+            }
             cmdbuf_[cmdcnt_++] = rcvbuf[i];
+            if (static_cast<uint8_t>(cmdbuf_[0]) == DPI_BIN_MAGIC) {
+                const DpiPacketHeaderType *h =
+                    reinterpret_cast<DpiPacketHeaderType *>(cmdbuf_);
+                if (cmdcnt_ < static_cast<int>(sizeof(DpiPacketHeaderType))
+                    || (h->cmd == DpiCmd_ReadResp
+                        && cmdcnt_ < static_cast<int>(
+                            sizeof(DpiPacketHeaderType) + 8 * h->beats))) {
+                    continue;
+                }
+                processBinaryRx();
+                cmdcnt_ = 0;
+                continue;
+            }
             if (rcvbuf[i] != '\0') {
                 continue;
             }
@@ -212,6 +255,48 @@ void DpiClient::processRx() {
     RISCV_event_set(&event_cmd_);
 }
 
+/**
+ * Simulator handles requests in order so the response belongs to the
+ * oldest pending read.
+ */
+void DpiClient::processBinaryRx() {
+    const DpiPacketHeaderType *h =
+        reinterpret_cast<DpiPacketHeaderType *>(cmdbuf_);
+    if (h->cmd == DpiCmd_Error) {
+        RISCV_error("DPI transaction #%d [%08" RV_PRI64 "x] failed",
+                    h->seqid, h->addr);
+        return;
+    }
+    uint32_t rd = pendRd_.load();
+    DpiPendingType *p = &pending_[rd % PENDING_MAX];
+    if (h->cmd != DpiCmd_ReadResp || rd == pendWr_
+        || p->seqid != h->seqid || p->beats != h->beats) {
+        RISCV_error("Unexpected DPI response #%d", h->seqid);
+        return;
+    }
+
+    uint64_t mask = ~0ull;
+    uint64_t v;
+    if (p->bytes < 8) {
+        mask = (1ull << (8 * p->bytes)) - 1;
+    }
+    for (int i = 0; i < p->beats; i++) {
+        memcpy(&v, &cmdbuf_[sizeof(DpiPacketHeaderType) + 8 * i], 8);
+        if (p->rdata) {
+            p->rdata[i] = v;
+        }
+        if (p->compare && ((v ^ p->expected[i]) & mask)) {
+            statMismatch_++;
+            RISCV_error("DPI diff #%d [%08x]: %016" RV_PRI64 "x != %016"
+                        RV_PRI64 "x", p->seqid,
+                        static_cast<unsigned>(p->addr + 8 * i),
+                        v, p->expected[i]);
+        }
+    }
+    pendRd_.store(rd + 1);
+    RISCV_event_set(&event_cmd_);
+}
+
 void DpiClient::processTx() {
     const char *ptx = txbuf_;
 
@@ -231,6 +316,7 @@ void DpiClient::processTx() {
 
     }
     txcnt_ -= txcnt_;
+    burstOff_ = -1;
     RISCV_mutex_unlock(&mutex_tx_);
 }
 
@@ -283,9 +369,18 @@ int DpiClient::createServerSocket() {
     tv.tv_usec = (timeout_.to_int() % 1000) * 1000;
     tv.tv_sec = timeout_.to_int() / 1000;
 #endif
+    if (batched_.to_bool()) {
+        // Posted requests are flushed on timeout
+#if defined(_WIN32) || defined(__CYGWIN__)
+        tv.tv_sec = 1;
+#else
+        tv.tv_usec = 1000;
+        tv.tv_sec = 0;
+#endif
+    }
     setsockopt(hsock_, SOL_SOCKET, SO_RCVTIMEO,
                     reinterpret_cast<char *>(&tv), sizeof(struct timeval));
-    setsockopt(hsock_, SOL_SOCKET, TCP_NODELAY,
+    setsockopt(hsock_, IPPROTO_TCP, TCP_NODELAY,
                     reinterpret_cast<char *>(&nodelay), sizeof(nodelay));
 
 
@@ -326,6 +421,10 @@ void DpiClient::closeServerSocket() {
 }
 
 void DpiClient::axi4_write(uint64_t addr, int bytes, uint64_t data) {
+    if (batched_.to_bool()) {
+        postWrite(addr, bytes, 1, reinterpret_cast<uint8_t *>(&data));
+        return;
+    }
     char tstr[1024];
     AttributeType resp;
     int sz = RISCV_sprintf(tstr, sizeof(tstr),
@@ -344,6 +443,13 @@ void DpiClient::axi4_write(uint64_t addr, int bytes, uint64_t data) {
 }
 
 void DpiClient::axi4_read(uint64_t addr, int bytes, uint64_t *data) {
+    if (batched_.to_bool()) {
+        uint32_t idx;
+        if (postRead(addr, bytes, 1, data, 0, &idx)) {
+            waitRead(idx);
+        }
+        return;
+    }
     char tstr[1024];
     int sz = RISCV_sprintf(tstr, sizeof(tstr),
         "["
@@ -431,7 +537,233 @@ void DpiClient::msgWrite(uint64_t addr, int bytes, uint8_t *buf) {
     }
 }
 
+void DpiClient::axi4_compare(uint64_t addr, int bytes, uint64_t expected) {
+    if (batched_.to_bool()) {
+        uint32_t idx;
+        postRead(addr, bytes, 1, 0, &expected, &idx);
+        return;
+    }
+    uint64_t rdata = 0;
+    axi4_read(addr, bytes, &rdata);
+    if (rdata != expected) {
+        RISCV_error("DPI diff [%08x]: %016" RV_PRI64 "x != %016" RV_PRI64 "x",
+            static_cast<unsigned>(addr), rdata, expected);
+    }
+}
+
+void DpiClient::axi4_flush() {
+    if (!batched_.to_bool()) {
+        return;
+    }
+    RISCV_mutex_lock(&mutex_tx_);
+    uint32_t idx = pendWr_ - 1;
+    bool empty = pendRd_.load() == pendWr_;
+    processTx();
+    RISCV_mutex_unlock(&mutex_tx_);
+    if (!empty) {
+        waitRead(idx);
+    }
+}
+
+void DpiClient::getStatistic(AttributeType *res) {
+    res->make_dict();
+    (*res)["Posted"].make_uint64(statPosted_);
+    (*res)["Reads"].make_uint64(statReads_);
+    (*res)["Beats"].make_uint64(statBeats_);
+    (*res)["Mismatch"].make_uint64(statMismatch_);
+    (*res)["Pending"].make_uint64(pendWr_ - pendRd_.load());
+}
+
+void DpiClient::postWrite(uint64_t addr, int bytes, int beats,
+                          const uint8_t *buf) {
+    DpiPacketHeaderType h;
+    int sz = static_cast<int>(sizeof(h)) + 8 * beats;
+    h.magic = DPI_BIN_MAGIC;
+    h.cmd = DpiCmd_Write;
+    h.bytes = static_cast<uint8_t>(bytes);
+    h.beats = static_cast<uint8_t>(beats);
+    h.addr = addr;
+
+    RISCV_mutex_lock(&mutex_tx_);
+    if (!connected_) {
+        RISCV_mutex_unlock(&mutex_tx_);
+        return;
+    }
+    if (txcnt_ + sz > static_cast<int>(sizeof(txbuf_))) {
+        processTx();
+    }
+    h.seqid = seqcnt_++;
+    memcpy(&txbuf_[txcnt_], &h, sizeof(h));
+    if (bytes < 8) {
+        memset(&txbuf_[txcnt_ + sizeof(h)], 0, 8);
+        memcpy(&txbuf_[txcnt_ + sizeof(h)], buf, bytes);
+    } else {
+        memcpy(&txbuf_[txcnt_ + sizeof(h)], buf, 8 * beats);
+    }
+    txcnt_ += sz;
+    burstOff_ = -1;
+    statPosted_++;
+    if (txcnt_ >= TX_FLUSH_BYTES) {
+        processTx();
+    }
+    RISCV_mutex_unlock(&mutex_tx_);
+}
+
+/**
+ * Compare read of the next qword is appended to the burst not sent yet.
+ * Waits when all pending slots are busy. Returns false when there's no
+ * connection.
+ */
+bool DpiClient::postRead(uint64_t addr, int bytes, int beats,
+                         uint64_t *rdata, const uint64_t *expected,
+                         uint32_t *idx) {
+    DpiPacketHeaderType *h;
+    DpiPendingType *p;
+    bool single = !rdata && expected && bytes == 8 && beats == 1
+                && (addr & 0x7) == 0;
+
+    RISCV_mutex_lock(&mutex_tx_);
+    if (single && burstOff_ >= 0) {
+        p = &pending_[(pendWr_ - 1) % PENDING_MAX];
+        if (p->beats < DPI_BURST_BEATS_MAX
+            && p->addr + 8 * p->beats == addr
+            && txcnt_ + 8 <= static_cast<int>(sizeof(txbuf_))) {
+            p->expected[p->beats++] = *expected;
+            h = reinterpret_cast<DpiPacketHeaderType *>(&txbuf_[burstOff_]);
+            h->beats = static_cast<uint8_t>(p->beats);
+            statBeats_++;
+            *idx = pendWr_ - 1;
+            RISCV_mutex_unlock(&mutex_tx_);
+            return true;
+        }
+    }
+
+    while (connected_ && pendWr_ - pendRd_.load() >= PENDING_MAX) {
+        processTx();
+        RISCV_event_clear(&event_cmd_);
+        RISCV_mutex_unlock(&mutex_tx_);
+        RISCV_event_wait_ms(&event_cmd_, 1);
+        RISCV_mutex_lock(&mutex_tx_);
+    }
+    if (!connected_) {
+        RISCV_mutex_unlock(&mutex_tx_);
+        return false;
+    }
+    if (txcnt_ + static_cast<int>(sizeof(DpiPacketHeaderType))
+        > static_cast<int>(sizeof(txbuf_))) {
+        processTx();
+    }
+
+    p = &pending_[pendWr_ % PENDING_MAX];
+    p->seqid = seqcnt_++;
+    p->addr = addr;
+    p->bytes = bytes;
+    p->beats = beats;
+    p->rdata = rdata;
+    p->compare = expected != 0;
+    if (expected) {
+        p->expected[0] = *expected;
+    }
+
+    h = reinterpret_cast<DpiPacketHeaderType *>(&txbuf_[txcnt_]);
+    h->magic = DPI_BIN_MAGIC;
+    h->cmd = DpiCmd_Read;
+    h->bytes = static_cast<uint8_t>(bytes);
+    h->beats = static_cast<uint8_t>(beats);
+    h->seqid = p->seqid;
+    h->addr = addr;
+    burstOff_ = single ? txcnt_ : -1;
+    txcnt_ += static_cast<int>(sizeof(DpiPacketHeaderType));
+    *idx = pendWr_++;
+    statReads_++;
+    statBeats_ += beats;
+    if (txcnt_ >= TX_FLUSH_BYTES) {
+        processTx();
+    }
+    RISCV_mutex_unlock(&mutex_tx_);
+    return true;
+}
+
+/** Wait response on the read with the pending index */
+bool DpiClient::waitRead(uint32_t idx) {
+    processTx();
+    while (static_cast<int32_t>(pendRd_.load() - idx) <= 0) {
+        if (!connected_) {
+            return false;
+        }
+        RISCV_event_clear(&event_cmd_);
+        if (static_cast<int32_t>(pendRd_.load() - idx) > 0) {
+            break;
+        }
+        RISCV_event_wait_ms(&event_cmd_, 1);
+    }
+    return true;
+}
+
+int DpiClient::readBatched(uint64_t addr, int bytes, uint8_t *obuf) {
+    uint64_t addr0 = addr & ~0x7ull;
+    int total = static_cast<int>(((addr + bytes + 7) & ~0x7ull) - addr0) / 8;
+    uint64_t *tbuf = new uint64_t[total];
+    uint32_t idx = 0;
+    int beats;
+    bool ok = true;
+    for (int i = 0; i < total && ok; i += beats) {
+        beats = total - i;
+        if (beats > DPI_BURST_BEATS_MAX) {
+            beats = DPI_BURST_BEATS_MAX;
+        }
+        ok = postRead(addr0 + 8 * i, 8, beats, &tbuf[i], 0, &idx);
+    }
+    if (ok && waitRead(idx)) {
+        memcpy(obuf, reinterpret_cast<uint8_t *>(tbuf) + (addr & 0x7), bytes);
+    } else {
+        bytes = TAP_ERROR;
+    }
+    delete [] tbuf;
+    return bytes;
+}
+
+int DpiClient::writeBatched(uint64_t addr, int bytes, uint8_t *ibuf) {
+    uint8_t *pin = ibuf;
+    int bytes_total = bytes;
+    int tbytes;
+    int beats;
+
+    // Unaligned first qword
+    if ((addr & 0x7) != 0 || bytes < 8) {
+        tbytes = 8 - static_cast<int>(addr & 0x7);
+        if (tbytes > bytes_total) {
+            tbytes = bytes_total;
+        }
+        postWrite(addr, tbytes, 1, pin);
+        addr += tbytes;
+        pin += tbytes;
+        bytes_total -= tbytes;
+    }
+
+    while (bytes_total >= 8) {
+        beats = bytes_total / 8;
+        if (beats > DPI_BURST_BEATS_MAX) {
+            beats = DPI_BURST_BEATS_MAX;
+        }
+        postWrite(addr, 8, beats, pin);
+        addr += 8 * beats;
+        pin += 8 * beats;
+        bytes_total -= 8 * beats;
+    }
+
+    // Ending unaligned bytes
+    if (bytes_total) {
+        postWrite(addr, bytes_total, 1, pin);
+    }
+    processTx();
+    return bytes;
+}
+
 int DpiClient::read(uint64_t addr, int bytes, uint8_t *obuf) {
+    if (batched_.to_bool()) {
+        return readBatched(addr, bytes, obuf);
+    }
     uint8_t *pout = obuf;
     int bytes_total = bytes;
     Reg64Type t;
@@ -504,6 +836,9 @@ int DpiClient::read(uint64_t addr, int bytes, uint8_t *obuf) {
 }
 
 int DpiClient::write(uint64_t addr, int bytes, uint8_t *ibuf) {
+    if (batched_.to_bool()) {
+        return writeBatched(addr, bytes, ibuf);
+    }
     uint8_t *pin = ibuf;
     int bytes_total = bytes;
 
@@ -23,6 +23,7 @@
 #include "coreservices/idpi.h"
 #include "coreservices/icmdexec.h"
 #include "coreservices/itap.h"
+#include <atomic>
 
 namespace debugger {
 
@@ -40,6 +41,14 @@ class CmdDpi : public ICommand  {
 
 
 
+/**
+ * @brief TCP client of the SystemVerilog DPI wrapper.
+ * @details JSON request is sent for each access and the caller waits for
+ *          the response. In 'Batched' mode binary frames are used: writes
+ *          are posted, adjacent compare reads are coalesced into bursts
+ *          and compared on response, so that the caller isn't blocked by
+ *          the TCP round-trip.
+ */
 class DpiClient : public IService,
                   public IThread,
                   public IDpi,
@@ -55,6 +64,8 @@ class DpiClient : public IService,
     /** IDpi */
     virtual void axi4_write(uint64_t addr, int bytes, uint64_t data);
     virtual void axi4_read(uint64_t addr, int bytes, uint64_t *data);
+    virtual void axi4_compare(uint64_t addr, int bytes, uint64_t expected);
+    virtual void axi4_flush();
     virtual bool is_irq();
     virtual int get_irq();
 
@@ -65,6 +76,7 @@ class DpiClient : public IService,
     /** Common methods */
     double getHartBeatTime() { return hartbeatTime_; }
     uint64_t getHartBeatClkcnt() { return hartbeatClkcnt_; }
+    void getStatistic(AttributeType *res);
 
  protected:
     /** IThread interface */
@@ -81,14 +93,36 @@ class DpiClient : public IService,
     void msgRead(uint64_t addr, int bytes);
     void msgWrite(uint64_t addr, int bytes, uint8_t *buf);
 
+    /** Batched mode */
+    void processBinaryRx();
+    void postWrite(uint64_t addr, int bytes, int beats, const uint8_t *buf);
+    bool postRead(uint64_t addr, int bytes, int beats, uint64_t *rdata,
+                  const uint64_t *expected, uint32_t *idx);
+    bool waitRead(uint32_t idx);
+    int readBatched(uint64_t addr, int bytes, uint8_t *obuf);
+    int writeBatched(uint64_t addr, int bytes, uint8_t *ibuf);
+
  private:
     static const int BURST_LEN_MAX = 4*8;    // hardcoded in libdpiwrapper
+    static const int PENDING_MAX = 256;      // reads without response
+    static const int TX_FLUSH_BYTES = 1 << 13;
+
+    struct DpiPendingType {
+        uint32_t seqid;
+        uint64_t addr;
+        int bytes;
+        int beats;
+        uint64_t *rdata;            // blocking read destination
+        bool compare;
+        uint64_t expected[DPI_BURST_BEATS_MAX];
+    };
 
     AttributeType isEnable_;
     AttributeType cmdexec_;
     AttributeType timeout_;
     AttributeType hostIP_;
     AttributeType hostPort_;
+    AttributeType batched_;
     AttributeType syncResponse_;
     AttributeType reqHartBeat_;
     AttributeType respHartBeat_;
@@ -104,7 +138,7 @@ class DpiClient : public IService,
     char rcvbuf[4096];
     char cmdbuf_[4096];
     int cmdcnt_;
-    char txbuf_[4096];
+    char txbuf_[1 << 16];
     int txcnt_;
     bool connected_;
     double hartbeatTime_;
@@ -113,6 +147,17 @@ class DpiClient : public IService,
     char tmpbuf_[1024];
     int tmpsz_;
 
+    DpiPendingType *pending_;       // ring protected by mutex_tx_
+    uint32_t pendWr_;
+    std::atomic<uint32_t> pendRd_;
+    int burstOff_;                  // open burst header in txbuf_ or -1
+    uint32_t seqcnt_;
+    uint64_t lastHartBeat_;
+    uint64_t statPosted_;
+    uint64_t statReads_;
+    uint64_t statBeats_;
+    uint64_t statMismatch_;
+
 };
 
 DECLARE_CLASS(DpiClient)
@@ -15,6 +15,8 @@
  */
 
 #include "gdbcmd.h"
+#include <stdlib.h>
+#include <riscv-isa.h>
 
 namespace debugger {
 /*
@@ -50,6 +52,41 @@ uint8_t RspPacket::checksum(const char *data, const size_t sz) {
 
 GdbCommands::GdbCommands(IService *parent) : TcpCommandsGen(parent) {
     estate_ = State_AckMode;
+    packet_len_ = 0;
+    tmptotal_ = 2 * PACKET_SIZE + 64;
+    tmpbuf_ = new char[tmptotal_];
+    membuf_ = new uint8_t[PACKET_SIZE];
+    xml_ = 0;
+    dmemValid_ = false;
+    memModified_ = false;
+    swbrCnt_ = 0;
+    memset(&dmem_, 0, sizeof(dmem_));
+
+    icpuriscv_ = static_cast<ICpuRiscV *>(
+        RISCV_get_service_iface(cpu_.to_string(), IFACE_CPU_RISCV));
+
+    ibus_ = 0;
+    IService *iexecsrv = static_cast<IService *>(
+                        RISCV_get_service(executor_.to_string()));
+    if (iexecsrv) {
+        AttributeType *bus = static_cast<AttributeType *>(
+                        iexecsrv->getAttribute("Bus"));
+        ibus_ = static_cast<IMemoryOperation *>(
+            RISCV_get_service_iface(bus->to_string(), IFACE_MEMORY_OPERATION));
+    }
+
+    char tstr[128];
+    RISCV_sprintf(tstr, sizeof(tstr), "%s_gdbnb", parent_->getObjName());
+    RISCV_event_create(&eventNb_, tstr);
+}
+
+GdbCommands::~GdbCommands() {
+    RISCV_event_close(&eventNb_);
+    delete [] tmpbuf_;
+    delete [] membuf_;
+    if (xml_) {
+        delete [] xml_;
+    }
 }
 
 int GdbCommands::processCommand(const char *cmdbuf, int bufsz) {
@@ -73,8 +110,14 @@ int GdbCommands::processCommand(const char *cmdbuf, int bufsz) {
     }
 
     // Remove '$' start symbol and CRC at the end
-    memcpy(&packet_data_, &cmdbuf[1], bufsz - 4);
-    packet_data_[bufsz - 4] = '\0';
+    if (bufsz - 4 >= static_cast<int>(sizeof(packet_data_))) {
+        RISCV_error("Packet is too long: %d", bufsz);
+        sendPacket("E01");
+        return bufsz;
+    }
+    packet_len_ = bufsz - 4;
+    memcpy(&packet_data_, &cmdbuf[1], packet_len_);
+    packet_data_[packet_len_] = '\0';
 
     handlePacket(packet_data_);
     return bufsz;
@@ -213,9 +256,13 @@ void GdbCommands::handleQuery() {
     } else if (strncmp("qSupported", 
                         packet_data_, strlen("qSupported")) == 0) {
         /* Report a list of the features we support.
-         * 1000h == 4096
-         * 500h  == 1280 */
-        sendPacket("PacketSize=500;QStartNoAckMode+;vContSupported+");
+         * 10000h == 65536, the whole 'X' packet with the binary data */
+        char tstr[256];
+        RISCV_sprintf(tstr, sizeof(tstr),
+                "PacketSize=%x;QStartNoAckMode+;vContSupported+%s",
+                PACKET_SIZE,
+                icpuriscv_ ? ";qXfer:features:read+" : "");
+        sendPacket(tstr);
         //QNonStop+
     } else if (strncmp("qSymbol:", packet_data_, strlen("qSymbol:")) == 0) {
         /* Offer to look up symbols. Ignore for now */
@@ -230,8 +277,11 @@ void GdbCommands::handleQuery() {
     } else if (strncmp("qTStatus", packet_data_, strlen("qTStatus")) == 0) {
         /* Don't support tracing, return empty packet. */
         sendPacket("");
+    } else if (strncmp("qXfer:features:read:",
+                       packet_data_, strlen("qXfer:features:read:")) == 0) {
+        handleXferFeatures();
     } else if (strncmp("qXfer:", packet_data_, strlen("qXfer:")) == 0) {
-        /* No 'qXfer' requests supported, return empty packet. */
+        /* Other 'qXfer' requests aren't supported, return empty packet. */
         sendPacket("");
     } else {
         RISCV_error("Unrecognized RSP query: %s \n", packet_data_);
@@ -244,15 +294,49 @@ void GdbCommands::handleStopReasonQuery() {
 }
 
 void GdbCommands::handleContinue() {
-    AttributeType res;
     if (!iexec_) {
         sendPacket("E01");
         return;
     }
+    sendStopReply(resumeAndWait());
+}
+
+/**
+ * CPU monitor should see the running state even if the hart halts
+ * faster than the status is polled. Worker of the connection is blocked
+ * here, so the GDB interrupt (0x03) and the closed connection are polled
+ * from the received data; the hart is halted on both.
+ */
+int GdbCommands::resumeAndWait() {
+    AttributeType res;
+    char tstr[128];
+    int sig = SIGNAL_TRAP;
+    RISCV_sprintf(tstr, sizeof(tstr), "%s go", cpu_.to_string());
+    flushModified();
     RISCV_event_clear(&eventHalt_);
-    iexec_->exec("run", &res, false);
-    RISCV_event_wait(&eventHalt_);
-    sendPacket("S05");
+    RISCV_trigger_hap(HAP_Resume, 0, "GDB resume");
+    iexec_->exec(tstr, &res, false);
+    while (RISCV_event_wait_ms(&eventHalt_, HALT_POLL_MS)) {
+        if (conn_ == 0) {
+            continue;
+        }
+        bool closed = conn_->isPeerClosed();
+        if (closed || conn_->takeByte(INTERRUPT_REQUEST)) {
+            RISCV_info("Halt by %s", closed ? "disconnect" : "GDB interrupt");
+            sig = SIGNAL_INT;
+            RISCV_sprintf(tstr, sizeof(tstr), "%s halt", cpu_.to_string());
+            iexec_->exec(tstr, &res, false);
+            RISCV_event_wait_ms(&eventHalt_, HALT_POLL_MS);
+            break;
+        }
+    }
+    return sig;
+}
+
+void GdbCommands::sendStopReply(int sig) {
+    char tstr[8];
+    RISCV_sprintf(tstr, sizeof(tstr), "S%02x", sig);
+    sendPacket(tstr);
 }
 
 void GdbCommands::handleDetach() {
@@ -277,6 +361,17 @@ void GdbCommands::handleGetRegisters() {
     char resp[512] = "\0";
     AttributeType res;
 
+    if (icpuriscv_) {
+        int total = isFpuEnabled() ? RISCV_REGNUM_CSR0 : RISCV_REGNUM_FPR0;
+        int pos = 0;
+        for (int i = 0; i < total; i++) {
+            pos += appendHex64(&tmpbuf_[pos], readRegRiscV(i));
+        }
+        tmpbuf_[pos] = '\0';
+        sendPacket(tmpbuf_);
+        return;
+    }
+
     if (iexec_) {
         iexec_->exec("regs", &res, false);
     }
@@ -310,7 +405,15 @@ void GdbCommands::handleGetRegisters() {
 }
 
 void GdbCommands::handleSetRegisters() {
-    sendPacket("");
+    if (!icpuriscv_) {
+        sendPacket("");
+        return;
+    }
+    int total = (packet_len_ - 1) / 16;
+    for (int i = 0; i < total && i < RISCV_REGNUM_CSR0; i++) {
+        writeRegRiscV(i, parseHex64(&packet_data_[1 + 16*i]));
+    }
+    sendPacket("OK");
 }
 
 void GdbCommands::handleSetThread() {
@@ -339,6 +442,24 @@ void GdbCommands::handleGetMemory() {
         return;
     }
 
+    if (ibus_) {
+        if (len > PACKET_SIZE / 2) {
+            len = PACKET_SIZE / 2;
+        }
+        if (readMem(address, len, membuf_) != TRANS_OK) {
+            sendPacket("E01");
+            return;
+        }
+        static const char HEX[] = "0123456789abcdef";
+        for (int i = 0; i < len; i++) {
+            tmpbuf_[2*i] = HEX[membuf_[i] >> 4];
+            tmpbuf_[2*i + 1] = HEX[membuf_[i] & 0xF];
+        }
+        tmpbuf_[2*len] = '\0';
+        sendPacket(tmpbuf_);
+        return;
+    }
+
     AttributeType res;
     char tstr[256];
     RISCV_sprintf(tstr, sizeof(tstr), "read 0x%lx %d", address, len);
@@ -359,7 +480,30 @@ void GdbCommands::handleGetMemory() {
 }
 
 void GdbCommands::handleWriteMemoryHex() {
-    sendPacket("");
+    /* Syntax is: M<addr>,<length>:<hex data> */
+    unsigned long address;
+    unsigned int len;
+    if (!ibus_ || RISCV_sscanf(packet_data_, "M%lx,%x:", &address, &len) != 2) {
+        sendPacket("E01");
+        return;
+    }
+    const char *data_ptr = strchr(packet_data_, ':') + 1;
+    if (len > static_cast<unsigned>(PACKET_SIZE)
+        || data_ptr + 2*len > &packet_data_[packet_len_]) {
+        sendPacket("E01");
+        return;
+    }
+    char byte_hex[3] = {0};
+    for (unsigned i = 0; i < len; i++) {
+        byte_hex[0] = data_ptr[2*i];
+        byte_hex[1] = data_ptr[2*i + 1];
+        membuf_[i] = static_cast<uint8_t>(strtoul(byte_hex, 0, 16));
+    }
+    if (writeMem(address, len, membuf_) != TRANS_OK) {
+        sendPacket("E01");
+        return;
+    }
+    sendPacket("OK");
 }
 
 void GdbCommands::handleReadRegister() {
@@ -372,6 +516,13 @@ void GdbCommands::handleReadRegister() {
         return;
     }
 
+    if (icpuriscv_) {
+        char resp[32];
+        appendHex64(resp, readRegRiscV(regnum));
+        sendPacket(resp);
+        return;
+    }
+
     AttributeType res;
     if (iexec_) {
         iexec_->exec("regs", &res, false);
@@ -389,6 +540,17 @@ void GdbCommands::handleWriteRegister() {
     char           byte2[3];
     char           byte3[3];
 
+    if (icpuriscv_) {
+        const char *val = strchr(packet_data_, '=');
+        if (RISCV_sscanf(packet_data_, "P%x=", &regnum) != 1 || !val) {
+            sendPacket("E01");
+            return;
+        }
+        writeRegRiscV(regnum, parseHex64(val + 1));
+        sendPacket("OK");
+        return;
+    }
+
     if (RISCV_sscanf(packet_data_, "P%x=%2s%2s%2s%2s",
                &regnum, byte0, byte1, byte2, byte3) != 5) {
         RISCV_info("Failed to recognize RSP write register "
@@ -439,7 +601,26 @@ void GdbCommands::handleGeneralSet() {
 }
 
 void GdbCommands::handleStep() {
-    sendPacket("");
+    AttributeType res;
+    int sig = SIGNAL_TRAP;
+    if (!iexec_) {
+        sendPacket("E01");
+        return;
+    }
+    if (icpuriscv_) {
+        /** dcsr.step: the hart re-enters Debug Mode after one instruction */
+        static const uint64_t DCSR_STEP = 1ull << 2;
+        uint64_t dcsr = icpuriscv_->readCSR(ICpuRiscV::CSR_dcsr);
+        icpuriscv_->writeCSR(ICpuRiscV::CSR_dcsr, dcsr | DCSR_STEP);
+        sig = resumeAndWait();
+        dcsr = icpuriscv_->readCSR(ICpuRiscV::CSR_dcsr);
+        icpuriscv_->writeCSR(ICpuRiscV::CSR_dcsr, dcsr & ~DCSR_STEP);
+    } else {
+        char tstr[128];
+        RISCV_sprintf(tstr, sizeof(tstr), "%s step", cpu_.to_string());
+        iexec_->exec(tstr, &res, false);
+    }
+    sendStopReply(sig);
 }
 
 void GdbCommands::handleThreadAlive() {
@@ -453,22 +634,24 @@ void GdbCommands::handleVCommand() {
         const char *packet_ptr = packet_data_;
         packet_ptr += 5;
         if (*packet_ptr == '?') {
-            sendPacket("vCont;c;C");
+            sendPacket("vCont;c;C;s;S");
             return;
         }
         if (*packet_ptr == ';') {
             packet_ptr++;
         }
-        if (*packet_ptr == 'c') {
-            RISCV_info("Continue packet: %s", packet_data_);
+        /** Single thread target: the first action is applied */
+        if (*packet_ptr == 'c' || *packet_ptr == 'C') {
+            RISCV_debug("Continue packet: %s", packet_data_);
             handleContinue();
+        } else if (*packet_ptr == 's' || *packet_ptr == 'S') {
+            RISCV_debug("Step packet: %s", packet_data_);
+            handleStep();
+        } else {
+            sendPacket("");
         }
-        if (*packet_ptr == 's') {
-            AttributeType res;
-            RISCV_info("Step packet: %s", packet_data_);
-            iexec_->exec("c 1", &res, false);
-            sendPacket("S05");
-        }
+    } else {
+        sendPacket("");
     }
 }
 
@@ -483,28 +666,36 @@ void GdbCommands::handleWriteMemory() {
         sendPacket("E01");
         return;
     }
+    if (!ibus_ || len > static_cast<size_t>(PACKET_SIZE)) {
+        sendPacket("E01");
+        return;
+    }
 
-    data_ptr = static_cast<char*>(memchr(packet_data_, ':', DATA_MAX));
+    /** Binary data with escaped '#', '$', '}' and '*': 0x7d, (x ^ 0x20) */
+    data_ptr = static_cast<char *>(memchr(packet_data_, ':', packet_len_));
     data_ptr++;
-    char data_hex[2 * DATA_MAX + 1];
-    data_hex[0] = '\0';
-
-    for (size_t offset = 0; offset < len; offset++) {
-        char byte_hex[3];
-        RISCV_sprintf(byte_hex, sizeof(byte_hex), "%02x", data_ptr[offset]);
-        strncat(data_hex, byte_hex, 2);
+    const char *data_end = &packet_data_[packet_len_];
+    size_t cnt = 0;
+    while (cnt < len && data_ptr < data_end) {
+        if (*data_ptr == 0x7d && data_ptr + 1 < data_end) {
+            membuf_[cnt++] = static_cast<uint8_t>(data_ptr[1] ^ 0x20);
+            data_ptr += 2;
+        } else {
+            membuf_[cnt++] = static_cast<uint8_t>(*data_ptr++);
+        }
     }
-
-    AttributeType res;
-    // 32 should be enough for 'write 0x000000 9999 '
-    char tstr[DATA_MAX * 2 + 32];
-    RISCV_sprintf(tstr, sizeof(tstr), "write 0x%lx %lu 0x%s",
-                  address, len, data_hex);
-
-    if (iexec_) {
-        iexec_->exec(tstr, &res, false);
+    if (cnt != len) {
+        RISCV_error("Wrong X packet length %d, expected %d",
+                    static_cast<int>(cnt), static_cast<int>(len));
+        sendPacket("E01");
+        return;
     }
 
+    if (len && writeMem(address, static_cast<uint32_t>(len),
+                        membuf_) != TRANS_OK) {
+        sendPacket("E01");
+        return;
+    }
     sendPacket("OK");
 }
 
@@ -521,8 +712,18 @@ void GdbCommands::handleBreakpoint() {
         return;
     }
 
-    /* Sanity check that the length is 4 */
-    if (len != 4) {
+    if (type == 1 && icpuriscv_) {
+        /* Hardware breakpoint in the trigger module */
+        if (hwBreakpoint(zZ == 'Z', address)) {
+            sendPacket("OK");
+        } else {
+            sendPacket("E01");
+        }
+        return;
+    }
+
+    /* Sanity check that the length is 4 (2 for compressed RISC-V) */
+    if (len != 4 && !(len == 2 && icpuriscv_)) {
         RISCV_info("Warning: length is not 4, but %d", len);
         len = 4;
     }
@@ -530,7 +731,14 @@ void GdbCommands::handleBreakpoint() {
     /* Sort out the type of breakpoint, currently only memory is supported */
     AttributeType addr, res;
     addr.make_uint64(address);
-    if (type == 0) {
+    if (type == 0 && icpuriscv_ && ibus_) {
+        /* ebreak instruction in memory */
+        if (swBreakpoint(zZ == 'Z', address, len)) {
+            sendPacket("OK");
+        } else {
+            sendPacket("E01");
+        }
+    } else if (type == 0) {
         /* Memory breakpoint */
         if (zZ == 'Z') {
             br_add(addr, &res);
@@ -538,12 +746,412 @@ void GdbCommands::handleBreakpoint() {
             br_rm(addr, &res);
         }
         sendPacket("OK");
+    } else if (type == 1 || type == 2 || type == 3 || type == 4) {
+        /* Hardware breakpoint or watchpoint isn't supported */
+        sendPacket("");
     } else {
         RISCV_info("Failed to recognize RSP breakpoint type: %d", type);
         sendPacket("E01");
     }
 }
 
+/**
+ * Target description: qXfer:features:read:target.xml:offset,length
+ */
+void GdbCommands::handleXferFeatures() {
+    unsigned int offset;
+    unsigned int len;
+    const char *args = strrchr(packet_data_, ':');
+    if (!icpuriscv_ || !strstr(packet_data_, ":target.xml:")
+        || RISCV_sscanf(args, ":%x,%x", &offset, &len) != 2) {
+        sendPacket("E00");
+        return;
+    }
+    int xmlsz = targetXml();
+    if (static_cast<int>(offset) >= xmlsz) {
+        sendPacket("l");
+        return;
+    }
+    if (len > static_cast<unsigned>(PACKET_SIZE) - 8) {
+        len = PACKET_SIZE - 8;
+    }
+    if (offset + len >= static_cast<unsigned>(xmlsz)) {
+        len = xmlsz - offset;
+        tmpbuf_[0] = 'l';
+    } else {
+        tmpbuf_[0] = 'm';
+    }
+    memcpy(&tmpbuf_[1], &xml_[offset], len);
+    tmpbuf_[len + 1] = '\0';
+    sendPacket(tmpbuf_);
+}
+
+bool GdbCommands::isFpuEnabled() {
+    uint64_t misa = icpuriscv_->readCSR(ICpuRiscV::CSR_misa);
+    return (misa & ((1ull << ('F' - 'A')) | (1ull << ('D' - 'A')))) != 0;
+}
+
+int GdbCommands::targetXml() {
+    static const int XML_SIZE = 16 * 1024;
+    static const struct CsrNameType {
+        const char *name;
+        uint32_t idx;
+    } CSR_LIST[] = {
+        {"mstatus", ICpuRiscV::CSR_mstatus},
+        {"misa", ICpuRiscV::CSR_misa},
+        {"medeleg", ICpuRiscV::CSR_medeleg},
+        {"mideleg", ICpuRiscV::CSR_mideleg},
+        {"mie", ICpuRiscV::CSR_mie},
+        {"mtvec", ICpuRiscV::CSR_mtvec},
+        {"mscratch", ICpuRiscV::CSR_mscratch},
+        {"mepc", ICpuRiscV::CSR_mepc},
+        {"mcause", ICpuRiscV::CSR_mcause},
+        {"mtval", ICpuRiscV::CSR_mtval},
+        {"mip", ICpuRiscV::CSR_mip},
+        {"satp", ICpuRiscV::CSR_satp},
+        {"tselect", ICpuRiscV::CSR_tselect},
+        {"tdata1", ICpuRiscV::CSR_tdata1},
+        {"tdata2", ICpuRiscV::CSR_tdata2},
+        {"dcsr", ICpuRiscV::CSR_dcsr},
+        {"dpc", ICpuRiscV::CSR_dpc},
+        {"mcycle", ICpuRiscV::CSR_mcycle},
+        {"minstret", ICpuRiscV::CSR_minsret},
+        {"mhartid", ICpuRiscV::CSR_mhartid},
+        {"", 0}
+    };
+    if (xml_) {
+        return static_cast<int>(strlen(xml_));
+    }
+    xml_ = new char[XML_SIZE];
+    int pos = RISCV_sprintf(xml_, XML_SIZE, "%s",
+        "<?xml version=\"1.0\"?>\n"
+        "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+        "<target version=\"1.0\">\n"
+        "<architecture>riscv:rv64</architecture>\n"
+        "<feature name=\"org.gnu.gdb.riscv.cpu\">\n");
+    for (int i = 0; i < ICpuRiscV::Reg_Total; i++) {
+        pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos,
+            "<reg name=\"%s\" bitsize=\"64\" regnum=\"%d\" type=\"%s\"/>\n",
+            RISCV_IREGS_NAMES[i], i,
+            i == ICpuRiscV::Reg_sp || i == ICpuRiscV::Reg_s0
+                ? "data_ptr" : "int");
+    }
+    pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos,
+        "<reg name=\"pc\" bitsize=\"64\" regnum=\"%d\" type=\"code_ptr\"/>\n"
+        "</feature>\n", RISCV_REGNUM_PC);
+
+    if (isFpuEnabled()) {
+        pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos, "%s",
+            "<feature name=\"org.gnu.gdb.riscv.fpu\">\n");
+        for (int i = 0; i < ICpuRiscV::RegFpu_Total; i++) {
+            pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos,
+                "<reg name=\"%s\" bitsize=\"64\" regnum=\"%d\" type=\"ieee_double\"/>\n",
+                RISCV_IREGS_NAMES[ICpuRiscV::RegFpu_Offset + i],
+                RISCV_REGNUM_FPR0 + i);
+        }
+        pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos,
+            "<reg name=\"fflags\" bitsize=\"64\" regnum=\"%d\" group=\"float\"/>\n"
+            "<reg name=\"frm\" bitsize=\"64\" regnum=\"%d\" group=\"float\"/>\n"
+            "<reg name=\"fcsr\" bitsize=\"64\" regnum=\"%d\" group=\"float\"/>\n"
+            "</feature>\n",
+            RISCV_REGNUM_CSR0 + ICpuRiscV::CSR_fflags,
+            RISCV_REGNUM_CSR0 + ICpuRiscV::CSR_frm,
+            RISCV_REGNUM_CSR0 + ICpuRiscV::CSR_fcsr);
+    }
+
+    pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos, "%s",
+        "<feature name=\"org.gnu.gdb.riscv.csr\">\n");
+    for (const CsrNameType *p = CSR_LIST; p->name[0]; p++) {
+        pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos,
+            "<reg name=\"%s\" bitsize=\"64\" regnum=\"%d\" group=\"csr\"/>\n",
+            p->name, RISCV_REGNUM_CSR0 + p->idx);
+    }
+    pos += RISCV_sprintf(&xml_[pos], XML_SIZE - pos, "%s",
+        "</feature>\n"
+        "</target>\n");
+    return pos;
+}
+
+/**
+ * GDB register numbers: x0..x31, pc, f0..f31, then CSRs with offset 65.
+ */
+uint64_t GdbCommands::readRegRiscV(uint32_t regnum) {
+    if (regnum < RISCV_REGNUM_PC) {
+        return icpuriscv_->readGPR(regnum);
+    } else if (regnum == RISCV_REGNUM_PC) {
+        return icpuriscv_->readCSR(ICpuRiscV::CSR_dpc);
+    } else if (regnum < RISCV_REGNUM_CSR0) {
+        return icpuriscv_->readGPR(ICpuRiscV::RegFpu_Offset
+                                   + regnum - RISCV_REGNUM_FPR0);
+    } else if (regnum < RISCV_REGNUM_CSR0 + 4096) {
+        return icpuriscv_->readCSR(regnum - RISCV_REGNUM_CSR0);
+    }
+    return 0;
+}
+
+void GdbCommands::writeRegRiscV(uint32_t regnum, uint64_t val) {
+    if (regnum == 0) {
+        return;
+    } else if (regnum < RISCV_REGNUM_PC) {
+        icpuriscv_->writeGPR(regnum, val);
+    } else if (regnum == RISCV_REGNUM_PC) {
+        icpuriscv_->writeCSR(ICpuRiscV::CSR_dpc, val);
+    } else if (regnum < RISCV_REGNUM_CSR0) {
+        icpuriscv_->writeGPR(ICpuRiscV::RegFpu_Offset
+                             + regnum - RISCV_REGNUM_FPR0, val);
+    } else if (regnum < RISCV_REGNUM_CSR0 + 4096) {
+        icpuriscv_->writeCSR(regnum - RISCV_REGNUM_CSR0, val);
+    }
+}
+
+/** Target byte order (little-endian) hex string of 64-bits value */
+int GdbCommands::appendHex64(char *s, uint64_t val) {
+    static const char HEX[] = "0123456789abcdef";
+    for (int i = 0; i < 8; i++) {
+        s[2*i] = HEX[(val >> (8*i + 4)) & 0xF];
+        s[2*i + 1] = HEX[(val >> (8*i)) & 0xF];
+    }
+    s[16] = '\0';
+    return 16;
+}
+
+uint64_t GdbCommands::parseHex64(const char *s) {
+    uint64_t ret = 0;
+    char byte_hex[3] = {0};
+    for (int i = 0; i < 8; i++) {
+        if (!s[2*i] || !s[2*i + 1]) {
+            break;
+        }
+        byte_hex[0] = s[2*i];
+        byte_hex[1] = s[2*i + 1];
+        ret |= static_cast<uint64_t>(strtoul(byte_hex, 0, 16)) << (8*i);
+    }
+    return ret;
+}
+
+/**
+ * Use free address match trigger (mcontrol) with the action 'enter
+ * Debug Mode' on instruction execution in any privilege mode.
+ */
+bool GdbCommands::hwBreakpoint(bool insert, uint64_t addr) {
+    static const int TRIGGERS_MAX = 16;
+    static const uint64_t TRIGGER_ADDR_DATA_MATCH = 2;
+    TriggerData1Type tdata1;
+    uint64_t tselect_z = icpuriscv_->readCSR(ICpuRiscV::CSR_tselect);
+    bool ret = false;
+    for (uint64_t i = 0; i < TRIGGERS_MAX && !ret; i++) {
+        icpuriscv_->writeCSR(ICpuRiscV::CSR_tselect, i);
+        if (icpuriscv_->readCSR(ICpuRiscV::CSR_tselect) != i) {
+            break;
+        }
+        tdata1.val = icpuriscv_->readCSR(ICpuRiscV::CSR_tdata1);
+        bool used = tdata1.mcontrol_bits.type == TRIGGER_ADDR_DATA_MATCH
+                 && (tdata1.mcontrol_bits.m | tdata1.mcontrol_bits.s
+                     | tdata1.mcontrol_bits.u);
+        if (insert && tdata1.val == 0) {
+            tdata1.val = 0;
+            tdata1.mcontrol_bits.type = TRIGGER_ADDR_DATA_MATCH;
+            tdata1.mcontrol_bits.dmode = 1;
+            tdata1.mcontrol_bits.action = 1;
+            tdata1.mcontrol_bits.m = 1;
+            tdata1.mcontrol_bits.s = 1;
+            tdata1.mcontrol_bits.u = 1;
+            tdata1.mcontrol_bits.execute = 1;
+            icpuriscv_->writeCSR(ICpuRiscV::CSR_tdata2, addr);
+            icpuriscv_->writeCSR(ICpuRiscV::CSR_tdata1, tdata1.val);
+            ret = true;
+        } else if (!insert && used && tdata1.mcontrol_bits.execute
+            && icpuriscv_->readCSR(ICpuRiscV::CSR_tdata2) == addr) {
+            icpuriscv_->writeCSR(ICpuRiscV::CSR_tdata1, 0);
+            ret = true;
+        }
+    }
+    icpuriscv_->writeCSR(ICpuRiscV::CSR_tselect, tselect_z);
+    return ret;
+}
+
+/**
+ * Replace instruction with ebreak (c.ebreak for 2-bytes breakpoint kind)
+ * and enable Debug Mode entry on ebreak in M, S and U modes while any
+ * breakpoint is inserted. Instruction is patched at the physical address
+ * of the fetch in the current address space.
+ */
+bool GdbCommands::swBreakpoint(bool insert, uint64_t addr, int len) {
+    static const uint32_t INSTR_EBREAK = 0x00100073;
+    static const uint32_t INSTR_C_EBREAK = 0x9002;
+    static const uint64_t DCSR_EBREAK_MSU = (1ull << 15)    // ebreakm
+                                          | (1ull << 13)    // ebreaks
+                                          | (1ull << 12);   // ebreaku
+    int idx = 0;
+    while (idx < swbrCnt_ && swbr_[idx].addr != addr) {
+        idx++;
+    }
+    if (!insert) {
+        if (idx == swbrCnt_) {
+            return false;
+        }
+        SwBreakpointType &br = swbr_[idx];
+        writeMem(br.paddr, br.len, reinterpret_cast<uint8_t *>(&br.instr));
+        swbr_[idx] = swbr_[--swbrCnt_];
+        if (swbrCnt_ == 0) {
+            uint64_t dcsr = icpuriscv_->readCSR(ICpuRiscV::CSR_dcsr);
+            icpuriscv_->writeCSR(ICpuRiscV::CSR_dcsr, dcsr & ~DCSR_EBREAK_MSU);
+        }
+        return true;
+    }
+    if (idx < swbrCnt_) {
+        return true;
+    }
+    if (swbrCnt_ >= static_cast<int>(sizeof(swbr_) / sizeof(swbr_[0]))) {
+        return false;
+    }
+    SwBreakpointType &br = swbr_[swbrCnt_];
+    br.addr = addr;
+    br.len = len == 2 ? 2 : 4;
+    br.instr = 0;
+    if (!translateBreakpoint(addr, &br.paddr)) {
+        RISCV_error("Cannot translate breakpoint address %" RV_PRI64 "x",
+                    addr);
+        return false;
+    }
+    uint32_t ebreak = br.len == 2 ? INSTR_C_EBREAK : INSTR_EBREAK;
+    if (readMem(br.paddr, br.len, reinterpret_cast<uint8_t *>(&br.instr))
+            != TRANS_OK
+        || writeMem(br.paddr, br.len,
+                    reinterpret_cast<const uint8_t *>(&ebreak))
+            != TRANS_OK) {
+        return false;
+    }
+    swbrCnt_++;
+
+    uint64_t dcsr = icpuriscv_->readCSR(ICpuRiscV::CSR_dcsr);
+    icpuriscv_->writeCSR(ICpuRiscV::CSR_dcsr, dcsr | DCSR_EBREAK_MSU);
+    return true;
+}
+
+/**
+ * Functional model translates through its MMU. Other targets accept only
+ * the physical address: M-mode or bare satp.
+ */
+bool GdbCommands::translateBreakpoint(uint64_t addr, uint64_t *paddr) {
+    if (icpufunc_) {
+        return icpufunc_->translateDebug(addr, paddr);
+    }
+    uint64_t prv = icpuriscv_->readCSR(ICpuRiscV::CSR_dcsr) & 0x3;
+    uint64_t satp_mode = icpuriscv_->readCSR(ICpuRiscV::CSR_satp) >> 60;
+    *paddr = addr;
+    return prv == ICpuRiscV::PRV_M || satp_mode == 0;
+}
+
+/**
+ * Plain memory is accessed via host pointer granted by the system bus,
+ * otherwise by 8-bytes non-blocking transactions.
+ */
+bool GdbCommands::directMem(uint64_t addr, bool write) {
+    if (!dmemValid_ || addr < dmem_.addr
+        || addr >= dmem_.addr + dmem_.length || (write && !dmem_.wrena)) {
+        Axi4TransactionType tr;
+        memset(&tr, 0, sizeof(tr));
+        tr.action = write ? MemAction_Write : MemAction_Read;
+        tr.addr = addr;
+        tr.xsize = 1;
+        dmemValid_ = ibus_->get_direct_mem_ptr(&tr, &dmem_,
+                    static_cast<IDirectMemInvalidate *>(this));
+        if (!dmemValid_) {
+            return false;
+        }
+    }
+    return write ? dmem_.wrena : dmem_.rdena;
+}
+
+ETransStatus GdbCommands::readMem(uint64_t addr, uint32_t sz, uint8_t *buf) {
+    Axi4TransactionType tr;
+    uint32_t bytecnt = 0;
+    while (bytecnt < sz) {
+        if (directMem(addr, false)) {
+            uint64_t chunk = dmem_.addr + dmem_.length - addr;
+            if (chunk > sz - bytecnt) {
+                chunk = sz - bytecnt;
+            }
+            memcpy(&buf[bytecnt], &dmem_.ptr[addr - dmem_.addr], chunk);
+            bytecnt += static_cast<uint32_t>(chunk);
+            addr += chunk;
+            continue;
+        }
+        memset(&tr, 0, sizeof(tr));
+        tr.action = MemAction_Read;
+        tr.addr = addr;
+        tr.xsize = 8 - static_cast<uint32_t>(addr & 0x7);
+        if (tr.xsize > sz - bytecnt) {
+            tr.xsize = sz - bytecnt;
+        }
+        RISCV_event_clear(&eventNb_);
+        ibus_->nb_transport(&tr, static_cast<IAxi4NbResponse *>(this));
+        RISCV_event_wait(&eventNb_);
+        if (nbresp_.response == MemResp_Error) {
+            return TRANS_ERROR;
+        }
+        memcpy(&buf[bytecnt], nbresp_.rpayload.b8, tr.xsize);
+        bytecnt += tr.xsize;
+        addr += tr.xsize;
+    }
+    return TRANS_OK;
+}
+
+ETransStatus GdbCommands::writeMem(uint64_t addr, uint32_t sz,
+                                   const uint8_t *buf) {
+    Axi4TransactionType tr;
+    uint32_t bytecnt = 0;
+    memModified_ = true;
+    while (bytecnt < sz) {
+        if (directMem(addr, true)) {
+            uint64_t chunk = dmem_.addr + dmem_.length - addr;
+            if (chunk > sz - bytecnt) {
+                chunk = sz - bytecnt;
+            }
+            memcpy(&dmem_.ptr[addr - dmem_.addr], &buf[bytecnt], chunk);
+            bytecnt += static_cast<uint32_t>(chunk);
+            addr += chunk;
+            continue;
+        }
+        memset(&tr, 0, sizeof(tr));
+        tr.action = MemAction_Write;
+        tr.addr = addr;
+        tr.xsize = 8 - static_cast<uint32_t>(addr & 0x7);
+        if (tr.xsize > sz - bytecnt) {
+            tr.xsize = sz - bytecnt;
+        }
+        tr.wstrb = (1u << tr.xsize) - 1;
+        memcpy(tr.wpayload.b8, &buf[bytecnt], tr.xsize);
+        RISCV_event_clear(&eventNb_);
+        ibus_->nb_transport(&tr, static_cast<IAxi4NbResponse *>(this));
+        RISCV_event_wait(&eventNb_);
+        if (nbresp_.response == MemResp_Error) {
+            return TRANS_ERROR;
+        }
+        bytecnt += tr.xsize;
+        addr += tr.xsize;
+    }
+    return TRANS_OK;
+}
+
+/** Instruction caches of the functional model must see loaded code */
+void GdbCommands::flushModified() {
+    if (memModified_ && icpufunc_) {
+        icpufunc_->flush(~0ull);
+    }
+    memModified_ = false;
+}
+
+void GdbCommands::nb_response(Axi4TransactionType *trans) {
+    nbresp_ = *trans;
+    RISCV_event_set(&eventNb_);
+}
+
+void GdbCommands::invalidate_direct_mem_ptr(uint64_t start, uint64_t end) {
+    dmemValid_ = false;
+}
+
 void GdbCommands::sendPacket(const char *data) {
     int tsz = static_cast<int>(strlen(data));
     respcnt_ = 0;
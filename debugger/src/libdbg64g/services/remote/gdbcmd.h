@@ -18,6 +18,8 @@
 #define __DEBUGGER_SERVICES_REMOTE_GDBCMD_H__
 
 #include "tcpcmd_gen.h"
+#include "coreservices/icpuriscv.h"
+#include "coreservices/imemop.h"
 
 namespace debugger {
 
@@ -40,9 +42,23 @@ static const int DATA_MAX = 4096;
 };*/
 
 
-class GdbCommands : public TcpCommandsGen {
+/**
+ * GDB Remote Serial Protocol stub. RISC-V target is accessed directly via
+ * ICpuRiscV and IMemoryOperation of the system bus, other targets use the
+ * commands of the executor.
+ */
+class GdbCommands : public TcpCommandsGen,
+                    public IAxi4NbResponse,
+                    public IDirectMemInvalidate {
  public:
     explicit GdbCommands(IService *parent);
+    virtual ~GdbCommands();
+
+    /** IAxi4NbResponse */
+    virtual void nb_response(Axi4TransactionType *trans);
+
+    /** IDirectMemInvalidate */
+    virtual void invalidate_direct_mem_ptr(uint64_t start, uint64_t end);
 
  protected:
     virtual int processCommand(const char *cmdbuf, int bufsz);
@@ -53,7 +69,7 @@ class GdbCommands : public TcpCommandsGen {
         return s == '$';
     }
     virtual bool isEndMarker(const char *s, int sz) {
-        return s[sz - 3] == '#';
+        return sz >= 4 && s[sz - 3] == '#';
     }
 
  private:
@@ -65,6 +81,8 @@ class GdbCommands : public TcpCommandsGen {
     // RSP packet handlers
     void handleStopReasonQuery();
     void handleContinue();
+    int resumeAndWait();
+    void sendStopReply(int sig);
     void handleDetach();
     void handleGetRegisters();
     void handleSetRegisters();
@@ -81,14 +99,65 @@ class GdbCommands : public TcpCommandsGen {
     void handleVCommand();
     void handleWriteMemory();
     void handleBreakpoint();
+    void handleXferFeatures();
 
     void appendRegValue(char *s, uint32_t value);
 
+    // RISC-V target access
+    bool isFpuEnabled();
+    int targetXml();
+    uint64_t readRegRiscV(uint32_t regnum);
+    void writeRegRiscV(uint32_t regnum, uint64_t val);
+    int appendHex64(char *s, uint64_t val);
+    uint64_t parseHex64(const char *s);
+    bool hwBreakpoint(bool insert, uint64_t addr);
+    bool swBreakpoint(bool insert, uint64_t addr, int len);
+    bool translateBreakpoint(uint64_t addr, uint64_t *paddr);
+    ETransStatus readMem(uint64_t addr, uint32_t sz, uint8_t *buf);
+    ETransStatus writeMem(uint64_t addr, uint32_t sz, const uint8_t *buf);
+    bool directMem(uint64_t addr, bool write);
+    void flushModified();
+
  private:
     //RspPacket previous_packet;
     //bool is_ack_mode;
     //bool last_success_;
-    char packet_data_[1 << 16];
+    char packet_data_[1 << 17];
+    int packet_len_;
+    char *tmpbuf_;              // hex formatted response
+    int tmptotal_;
+    uint8_t *membuf_;
+    char *xml_;
+
+    ICpuRiscV *icpuriscv_;
+    IMemoryOperation *ibus_;
+    DirectMemRegionType dmem_;
+    volatile bool dmemValid_;
+    bool memModified_;
+    event_def eventNb_;
+    Axi4TransactionType nbresp_;
+
+    // Software breakpoints with the original instruction
+    struct SwBreakpointType {
+        uint64_t addr;
+        uint64_t paddr;
+        uint32_t instr;
+        int len;
+    } swbr_[64];
+    int swbrCnt_;
+
+    // Stop reply signals and the interrupt request of the running target
+    static const int SIGNAL_INT = 2;
+    static const int SIGNAL_TRAP = 5;
+    static const char INTERRUPT_REQUEST = 0x03;
+    static const int HALT_POLL_MS = 100;
+    // Maximal packet size advertised by qSupported
+    static const int PACKET_SIZE = 1 << 16;
+    // GDB register numbers of the RISC-V target
+    static const int RISCV_REGNUM_PC = 32;
+    static const int RISCV_REGNUM_FPR0 = 33;
+    static const int RISCV_REGNUM_CSR0 = 65;
+
     enum EState {
         State_AckMode,
         State_WaitAckToSwitch,
@@ -18,16 +18,62 @@
 
 namespace debugger {
 
-JsonCommands::JsonCommands(IService *parent) : TcpCommandsGen(parent) {
+JsonCommands::JsonCommands(IService *parent) : TcpCommandsGen(parent),
+    parser_(&builder_) {
+}
+
+/**
+ * Message received completely is parsed by from_config() into the arena,
+ * it is faster than building the tree from the parser callbacks. Only a
+ * message split between frames goes through the streaming parser.
+ */
+int JsonCommands::updateData(const char *buf, int buflen) {
+    int ret = 0;
+    while (ret < buflen) {
+        const char *end = 0;
+        if (parser_.isIdle()) {
+            char c = buf[ret];
+            if (c == '\0' || c == ' ' || c == '\r' || c == '\n' || c == '\t') {
+                ret++;      // messages delimiter
+                continue;
+            }
+            end = static_cast<const char *>(
+                    memchr(&buf[ret], '\0', buflen - ret));
+        }
+        if (end) {
+            AttributeType cmd;
+            cmd.from_config(&buf[ret]);
+            ret = static_cast<int>(end - buf) + 1;
+            processRequest(&cmd);
+        } else {
+            ret += parser_.parse(&buf[ret], buflen - ret);
+            if (!builder_.isReady() && !builder_.isError()) {
+                continue;
+            }
+            processRequest(builder_.getDocument());
+            builder_.reset();
+        }
+        if (conn_ && respcnt_) {
+            conn_->sendData(respbuf_, respcnt_);
+            respcnt_ = 0;
+        }
+    }
+    return ret;
 }
 
 int JsonCommands::processCommand(const char *cmdbuf, int bufsz) {
     AttributeType cmd;
-    cmd.from_config(rxbuf_);
+    cmd.from_config(cmdbuf);
+    processRequest(&cmd);
+    return bufsz;
+}
+
+void JsonCommands::processRequest(AttributeType *pcmd) {
+    AttributeType &cmd = *pcmd;
     if (!cmd.is_list() || cmd.size() < 3) {
         respcnt_ = RISCV_sprintf(respbuf_, resptotal_, "%s",
                                  "wrong request format");
-        return 0;
+        return;
     }
 
     AttributeType &requestType = cmd[1];
@@ -92,17 +138,26 @@ int JsonCommands::processCommand(const char *cmdbuf, int bufsz) {
         resp[0u].make_string("ERROR");
         resp[1].make_string("Wrong command format");
     }
-    resp.to_config();
+    writeResponse(idx, &resp);
+}
 
-    if (static_cast<int>(resp.size()) > (resptotal_ - 64)) {
+/**
+ * Message [idx,resp] with the terminating zero. Buffer is re-allocated
+ * and the response is written again only when it doesn't fit.
+ */
+void JsonCommands::writeResponse(uint32_t idx, const AttributeType *resp) {
+    int hdrsz = RISCV_sprintf(respbuf_, resptotal_, "[%d,", idx);
+    int sz = attribute_to_json(resp, &respbuf_[hdrsz], resptotal_ - hdrsz);
+    if (hdrsz + sz + 2 > resptotal_) {
         delete [] respbuf_;
-        resptotal_ = resp.size() + 64;
+        resptotal_ = hdrsz + sz + 64;
         respbuf_ = new char[resptotal_];
+        hdrsz = RISCV_sprintf(respbuf_, resptotal_, "[%d,", idx);
+        attribute_to_json(resp, &respbuf_[hdrsz], resptotal_ - hdrsz);
     }
-
-    respcnt_ = RISCV_sprintf(respbuf_, resptotal_, "[%d,%s]",
-                             idx, resp.to_string()) + 1;
-    return rxcnt_;
+    respcnt_ = hdrsz + sz;
+    respbuf_[respcnt_++] = ']';
+    respbuf_[respcnt_++] = '\0';
 }
 
 }  // namespace debugger
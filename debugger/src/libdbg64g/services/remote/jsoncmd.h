@@ -18,19 +18,36 @@
 #define __DEBUGGER_SERVICES_REMOTE_JSONCMD_H__
 
 #include "tcpcmd_gen.h"
+#include "jsonstream.h"
 
 namespace debugger {
 
+/**
+ * Requests split between the received frames are parsed by the streaming
+ * parser without accumulating the whole message, the response is
+ * serialized into the output buffer without intermediate string.
+ */
 class JsonCommands : public TcpCommandsGen {
  public:
     explicit JsonCommands(IService *parent);
 
+    /** IRawListener interface */
+    virtual int updateData(const char *buf, int buflen);
+
  protected:
     virtual int processCommand(const char *cmdbuf, int bufsz);
     virtual bool isStartMarker(char s) { return true; }
     virtual bool isEndMarker(const char *s, int sz) {
         return s[sz - 1] == '\0';
     }
+
+ private:
+    void processRequest(AttributeType *cmd);
+    void writeResponse(uint32_t idx, const AttributeType *resp);
+
+ private:
+    JsonAttributeBuilder builder_;
+    JsonStreamParser parser_;
 };
 
 }  // namespace debugger
@@ -22,12 +22,14 @@ namespace debugger {
 
 TcpClient::TcpClient(const char *name) : IService(name) {
     registerInterface(static_cast<IThread *>(this));
+    registerInterface(static_cast<ITcpHandler *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("PlatformConfig", &platformConfig_);
     registerAttribute("Type", &type_);
     registerAttribute("ListenDefaultOutput", &listenDefaultOutput_);
     RISCV_mutex_init(&mutexTx_);
     tcpcmd_ = 0;
+    conn_ = 0;
 }
 
 TcpClient::~TcpClient() {
@@ -57,6 +59,20 @@ void TcpClient::postinitService() {
 }
 
 int TcpClient::updateData(const char *buf, int buflen) {
+    RISCV_mutex_lock(&mutexTx_);
+    if (conn_) {
+        int tsz = RISCV_sprintf(&asyncbuf_[0].ibyte, sizeof(asyncbuf_),
+                                "['%s',", "Console");
+        memcpy(&asyncbuf_[tsz], buf, buflen);
+        tsz += buflen;
+        asyncbuf_[tsz++].ubyte = ']';
+        asyncbuf_[tsz++].ubyte = '\0';
+        conn_->sendData(&asyncbuf_[0].ibyte, tsz);
+        RISCV_mutex_unlock(&mutexTx_);
+        return buflen;
+    }
+    RISCV_mutex_unlock(&mutexTx_);
+
     int tsz = RISCV_sprintf(&asyncbuf_[0].ibyte, sizeof(asyncbuf_),
                     "['%s',", "Console");
 
@@ -69,6 +85,35 @@ int TcpClient::updateData(const char *buf, int buflen) {
     return buflen;
 }
 
+/**
+ * Connection is attached by the event driven server instead of running
+ * the own thread.
+ */
+void TcpClient::attachConnection(ITcpConnection *conn) {
+    if (!tcpcmd_) {
+        if (conn) {
+            conn->closeConnection();
+        }
+        return;
+    }
+    if (!conn && listenDefaultOutput_.to_bool()) {
+        RISCV_remove_default_output(static_cast<IRawListener *>(this));
+    }
+    RISCV_mutex_lock(&mutexTx_);
+    conn_ = conn;
+    tcpcmd_->setConnection(conn);
+    RISCV_mutex_unlock(&mutexTx_);
+    if (conn && listenDefaultOutput_.to_bool()) {
+        RISCV_add_default_output(static_cast<IRawListener *>(this));
+    }
+}
+
+void TcpClient::processData(const char *buf, int sz) {
+    RISCV_debug("i=>[%d]", sz);
+    tcpcmd_->updateData(buf, sz);
+    tcpcmd_->done();
+}
+
 void TcpClient::busyLoop() {
     int rxbytes;
     if (listenDefaultOutput_.to_bool()) {
@@ -77,7 +122,7 @@ void TcpClient::busyLoop() {
 
     txcnt_ = 0;
     while (isEnabled()) {
-        rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf), 0);
+        rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf) - 1, 0);
         if (rxbytes <= 0) {
             // Timeout:
             continue;
@@ -22,12 +22,14 @@
 #include "tcpcmd_gen.h"
 #include "coreservices/ithread.h"
 #include "coreservices/irawlistener.h"
+#include "coreservices/itcphandler.h"
 
 namespace debugger {
 
 class TcpClient : public IService,
                   public IThread,
-                  public IRawListener {
+                  public IRawListener,
+                  public ITcpHandler {
  public:
     explicit TcpClient(const char *name);
     virtual ~TcpClient();
@@ -41,6 +43,10 @@ class TcpClient : public IService,
     /** IRawListener interface */
     virtual int updateData(const char *buf, int buflen);
 
+    /** ITcpHandler interface */
+    virtual void attachConnection(ITcpConnection *conn);
+    virtual void processData(const char *buf, int sz);
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
@@ -58,7 +64,7 @@ class TcpClient : public IService,
 
     socket_def hsock_;
     mutex_def mutexTx_;
-    char rcvbuf[4096];
+    char rcvbuf[1 << 16];
     char txbuf_[1<<20];
     int txcnt_;
     union reg8_type {
@@ -67,6 +73,7 @@ class TcpClient : public IService,
     } asyncbuf_[1 << 20];
 
     TcpCommandsGen *tcpcmd_;
+    ITcpConnection *conn_;      // served by the server event loop
 };
 
 DECLARE_CLASS(TcpClient)
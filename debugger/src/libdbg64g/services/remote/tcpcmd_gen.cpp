@@ -20,7 +20,10 @@ namespace debugger {
 
 TcpCommandsGen::TcpCommandsGen(IService *parent) : IHap(HAP_All) {
     parent_ = parent;
+    conn_ = 0;
     rxcnt_ = 0;
+    rxtotal_ = 1 << 17;     // the longest packet including markers
+    rxbuf_ = new char[rxtotal_ + 1];
     estate_ = State_Idle;
 
     resptotal_ = 1 << 18;   // should re-allocated if need in childs
@@ -63,12 +66,14 @@ TcpCommandsGen::TcpCommandsGen(IService *parent) : IHap(HAP_All) {
 }
 
 TcpCommandsGen::~TcpCommandsGen() {
+    RISCV_unregister_hap(static_cast<IHap *>(this));
     RISCV_event_close(&eventHalt_);
     RISCV_event_close(&eventDelayMs_);
     RISCV_event_close(&eventPowerChanged_);
     respcnt_ = 0;
     resptotal_ = 0;
     delete [] respbuf_;
+    delete [] rxbuf_;
 }
 
 void TcpCommandsGen::setPlatformConfig(AttributeType *cfg) {
@@ -100,7 +105,7 @@ int TcpCommandsGen::updateData(const char *buf, int buflen) {
             }
             break;
         case State_Started:
-            if (rxcnt_ < static_cast<int>(sizeof(rxbuf_))) {
+            if (rxcnt_ < rxtotal_) {
                 rxbuf_[rxcnt_++] = buf[i];
                 rxbuf_[rxcnt_] = '\0';
             } else {
@@ -115,6 +120,10 @@ int TcpCommandsGen::updateData(const char *buf, int buflen) {
 
         if (estate_ == State_Ready) {
             processCommand(rxbuf_, rxcnt_);
+            if (conn_ && respcnt_) {
+                conn_->sendData(respbuf_, respcnt_);
+                respcnt_ = 0;
+            }
             rxcnt_ = 0;
             estate_ = State_Idle;
             ret = i + 1;  // take into account the last symbol
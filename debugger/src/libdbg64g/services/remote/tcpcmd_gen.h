@@ -34,6 +34,7 @@
 #include "coreservices/irawlistener.h"
 #include "coreservices/iserial.h"
 #include "coreservices/idisplay.h"
+#include "coreservices/itcphandler.h"
 #include "igui.h"
 
 namespace debugger {
@@ -60,6 +61,8 @@ class TcpCommandsGen : public IRawListener,
     uint8_t *response_buf() { return reinterpret_cast<uint8_t *>(respbuf_); }
     int response_size() { return respcnt_; }
     void done() { respcnt_ = 0; }
+    /** Responses are sent to the connection after each command */
+    void setConnection(ITcpConnection *conn) { conn_ = conn; }
 
  protected:
     virtual int processCommand(const char *cmdbuf, int bufsz) = 0;
@@ -80,7 +83,8 @@ class TcpCommandsGen : public IRawListener,
     void power_off(const char *btn_name, AttributeType *res);
 
  protected:
-    char rxbuf_[4096];
+    char *rxbuf_;
+    int rxtotal_;
     int rxcnt_;
     AttributeType platformConfig_;
     AttributeType cpu_;
@@ -93,6 +97,7 @@ class TcpCommandsGen : public IRawListener,
     int respcnt_;
 
     IService *parent_;
+    ITcpConnection *conn_;
     ICmdExecutor *iexec_;
     ISourceCode *isrc_;
     ICpuFunctional *icpufunc_;
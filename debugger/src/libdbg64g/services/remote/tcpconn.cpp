@@ -0,0 +1,309 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "tcpconn.h"
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+namespace debugger {
+
+TcpConnection::TcpConnection(IService *parent, socket_def skt, int epfd,
+                             IService *isrv, ITcpHandler *ihandler,
+                             int txlimit) {
+    parent_ = parent;
+    isrv_ = isrv;
+    ihandler_ = ihandler;
+    hsock_ = skt;
+    epfd_ = epfd;
+    nextWork_ = 0;
+    nextConn_ = 0;
+    RISCV_mutex_init(&mutex_);
+
+    rxbuf_ = new char[RX_BUF_SIZE];
+    rxcnt_ = 0;
+    txhead_ = 0;
+    txtail_ = 0;
+    txbytes_ = 0;
+    txlimit_ = txlimit;
+    busy_ = false;
+    closing_ = false;
+    peerClosed_ = false;
+    claimed_ = false;
+
+    int flags = fcntl(hsock_, F_GETFL, 0);
+    fcntl(hsock_, F_SETFL, flags | O_NONBLOCK);
+    int enable = 1;
+    setsockopt(hsock_, IPPROTO_TCP, TCP_NODELAY,
+               reinterpret_cast<const char *>(&enable), sizeof(int));
+
+    struct epoll_event ev;
+    events_ = EPOLLIN;
+    ev.events = events_;
+    ev.data.ptr = this;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, hsock_, &ev);
+}
+
+TcpConnection::~TcpConnection() {
+    if (hsock_ >= 0) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, hsock_, 0);
+        close(hsock_);
+    }
+    while (txhead_) {
+        TxChunkType *p = txhead_;
+        txhead_ = p->next;
+        delete [] reinterpret_cast<char *>(p);
+    }
+    delete [] rxbuf_;
+    RISCV_mutex_destroy(&mutex_);
+}
+
+/**
+ * Data is written immediately if the queue is empty and the socket
+ * accepts it, the rest is queued and flushed by the event loop. Queue
+ * is limited by 4 x TxQueueLimit, the connection is closed on overflow
+ * so that the client never gets a truncated message.
+ */
+void TcpConnection::sendData(const char *buf, int sz) {
+    RISCV_mutex_lock(&mutex_);
+    if (closing_) {
+        RISCV_mutex_unlock(&mutex_);
+        return;
+    }
+    if (!txhead_) {
+        while (sz > 0) {
+            ssize_t n = send(hsock_, buf, sz, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            buf += n;
+            sz -= static_cast<int>(n);
+        }
+    }
+    if (sz > 0 && txbytes_ + sz > 4 * txlimit_) {
+        RISCV_error("Client doesn't read data, %d bytes pending, "
+                    "connection closed", txbytes_ + sz);
+        closing_ = true;
+        // Event loop gets a single hang-up event and deletes connection
+        // unless it is processed by worker at the moment.
+        struct epoll_event ev;
+        ev.events = EPOLLONESHOT;
+        ev.data.ptr = this;
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, hsock_, &ev);
+        shutdown(hsock_, SHUT_RDWR);
+        RISCV_mutex_unlock(&mutex_);
+        return;
+    }
+    if (sz > 0) {
+        char *mem = new char[sizeof(TxChunkType) + sz];
+        TxChunkType *p = reinterpret_cast<TxChunkType *>(mem);
+        p->next = 0;
+        p->size = sz;
+        p->off = 0;
+        memcpy(p->data, buf, sz);
+        if (txtail_) {
+            txtail_->next = p;
+        } else {
+            txhead_ = p;
+        }
+        txtail_ = p;
+        txbytes_ += sz;
+    }
+    updateEvents();
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void TcpConnection::closeConnection() {
+    RISCV_mutex_lock(&mutex_);
+    shutdownSocket();
+    RISCV_mutex_unlock(&mutex_);
+}
+
+bool TcpConnection::isPeerClosed() {
+    RISCV_mutex_lock(&mutex_);
+    bool ret = peerClosed_ || closing_;
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
+
+bool TcpConnection::takeByte(char c) {
+    RISCV_mutex_lock(&mutex_);
+    char *p = static_cast<char *>(memchr(rxbuf_, c, rxcnt_));
+    if (p) {
+        int off = static_cast<int>(p - rxbuf_);
+        rxcnt_--;
+        memmove(p, p + 1, rxcnt_ - off);
+        updateEvents();
+    }
+    RISCV_mutex_unlock(&mutex_);
+    return p != 0;
+}
+
+/**
+ * Requests received together with FIN are still processed: the connection
+ * is half-closed and shut down by the worker when the buffer is drained.
+ */
+bool TcpConnection::readSocket() {
+    bool schedule = false;
+    bool reset = false;
+    RISCV_mutex_lock(&mutex_);
+    while (!closing_ && !peerClosed_ && rxcnt_ < RX_BUF_SIZE) {
+        ssize_t n = recv(hsock_, &rxbuf_[rxcnt_], RX_BUF_SIZE - rxcnt_, 0);
+        if (n > 0) {
+            rxcnt_ += static_cast<int>(n);
+        } else if (n == 0) {
+            peerClosed_ = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            reset = true;
+            break;
+        }
+    }
+    if (reset || (peerClosed_ && rxcnt_ == 0 && !busy_)) {
+        shutdownSocket();
+    } else if (rxcnt_ && !busy_ && !closing_) {
+        busy_ = true;
+        schedule = true;
+    }
+    updateEvents();
+    RISCV_mutex_unlock(&mutex_);
+    return schedule;
+}
+
+void TcpConnection::writeSocket() {
+    RISCV_mutex_lock(&mutex_);
+    if (!closing_) {
+        flushQueue();
+        updateEvents();
+    }
+    RISCV_mutex_unlock(&mutex_);
+}
+
+/** Only one of the event loop or worker takes the closed connection */
+bool TcpConnection::claimDead() {
+    RISCV_mutex_lock(&mutex_);
+    bool ret = closing_ && !busy_ && !claimed_;
+    if (ret) {
+        claimed_ = true;
+    }
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
+
+/**
+ * Returns 0 when there's no more data, then the worker releases the
+ * connection. Negative value means that the connection was closed while
+ * it was processed and now the worker passes it to the event loop to
+ * be deleted.
+ */
+int TcpConnection::takeData(char *buf, int sz) {
+    RISCV_mutex_lock(&mutex_);
+    int ret = rxcnt_ < sz ? rxcnt_ : sz;
+    if (ret == 0 && peerClosed_) {
+        shutdownSocket();
+    }
+    if (closing_) {
+        ret = -1;
+        busy_ = false;
+        claimed_ = true;
+    } else if (ret == 0) {
+        busy_ = false;
+    } else {
+        memcpy(buf, rxbuf_, ret);
+        rxcnt_ -= ret;
+        memmove(rxbuf_, &rxbuf_[ret], rxcnt_);
+        updateEvents();
+    }
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
+
+void TcpConnection::updateEvents() {
+    if (closing_) {
+        return;
+    }
+    uint32_t ev = 0;
+    if (!peerClosed_ && rxcnt_ < RX_BUF_SIZE && txbytes_ < txlimit_) {
+        ev |= EPOLLIN;
+    }
+    if (txhead_) {
+        ev |= EPOLLOUT;
+    }
+    if (ev != events_) {
+        struct epoll_event e;
+        e.events = ev;
+        e.data.ptr = this;
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, hsock_, &e);
+        events_ = ev;
+    }
+}
+
+/** Pending responses are flushed as much as the socket accepts */
+void TcpConnection::shutdownSocket() {
+    if (closing_) {
+        return;
+    }
+    flushQueue();
+    closing_ = true;
+    // No more events, connection is deleted by the event loop
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, hsock_, 0);
+    shutdown(hsock_, SHUT_RDWR);
+}
+
+/** Scatter/gather output of the queued chunks */
+void TcpConnection::flushQueue() {
+    struct iovec iov[TX_IOV_MAX];
+    while (txhead_) {
+        int cnt = 0;
+        for (TxChunkType *p = txhead_; p && cnt < TX_IOV_MAX; p = p->next) {
+            iov[cnt].iov_base = &p->data[p->off];
+            iov[cnt].iov_len = p->size - p->off;
+            cnt++;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = cnt;
+        ssize_t n = sendmsg(hsock_, &msg, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        txbytes_ -= static_cast<int>(n);
+        while (n > 0) {
+            TxChunkType *p = txhead_;
+            int left = p->size - p->off;
+            if (n < left) {
+                p->off += static_cast<int>(n);
+                break;
+            }
+            n -= left;
+            txhead_ = p->next;
+            delete [] reinterpret_cast<char *>(p);
+        }
+        if (!txhead_) {
+            txtail_ = 0;
+        }
+    }
+}
+
+}  // namespace debugger
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <api_core.h>
+#include <iservice.h>
+#include "coreservices/itcphandler.h"
+
+namespace debugger {
+
+/**
+ * Non-blocking socket of the event driven TCP server.
+ *
+ * Event loop reads the socket into the receive buffer and flushes the
+ * transmit queue with sendmsg(). Worker thread takes the received data
+ * and passes it to the protocol handler. Reading is paused while the
+ * receive buffer is full or the transmit queue exceeds the limit, so
+ * that the client which doesn't read responses is throttled by TCP.
+ */
+class TcpConnection : public ITcpConnection {
+ public:
+    TcpConnection(IService *parent, socket_def skt, int epfd,
+                  IService *isrv, ITcpHandler *ihandler, int txlimit);
+    virtual ~TcpConnection();
+
+    /** ITcpConnection */
+    virtual void sendData(const char *buf, int sz);
+    virtual void closeConnection();
+    virtual bool isPeerClosed();
+    virtual bool takeByte(char c);
+
+    /** Event loop side, returns true when worker should be scheduled */
+    bool readSocket();
+    void writeSocket();
+    /** Closed connection isn't processed by worker and can be deleted */
+    bool claimDead();
+
+    /** Worker side */
+    int takeData(char *buf, int sz);
+    ITcpHandler *getHandler() { return ihandler_; }
+    IService *getService() { return isrv_; }
+
+    TcpConnection *nextWork_;       // worker queue or dead list
+    TcpConnection *nextConn_;       // all connections of the server
+
+ protected:
+    IFace *getInterface(const char *name) {
+        return parent_->getInterface(name);
+    }
+
+ private:
+    void updateEvents();
+    void flushQueue();
+    void shutdownSocket();
+
+ private:
+    static const int RX_BUF_SIZE = 1 << 17;
+    static const int TX_IOV_MAX = 64;
+
+    struct TxChunkType {
+        TxChunkType *next;
+        int size;
+        int off;
+        char data[1];
+    };
+
+    IService *parent_;
+    IService *isrv_;
+    ITcpHandler *ihandler_;
+    socket_def hsock_;
+    int epfd_;
+    mutex_def mutex_;
+
+    char *rxbuf_;
+    int rxcnt_;
+    TxChunkType *txhead_;
+    TxChunkType *txtail_;
+    int txbytes_;
+    int txlimit_;
+    uint32_t events_;
+    bool busy_;             // queued or processed by worker
+    bool closing_;
+    bool peerClosed_;       // FIN received, the rest of rxbuf_ is processed
+    bool claimed_;
+};
+
+}  // namespace debugger
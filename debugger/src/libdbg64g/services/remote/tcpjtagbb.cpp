@@ -21,9 +21,15 @@ namespace debugger {
 TcpJtagBitBangClient::TcpJtagBitBangClient(const char *name)
     : IService(name) {
     registerInterface(static_cast<IThread *>(this));
+    registerInterface(static_cast<ITcpHandler *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("JtagTap", &jtagtap_);
+    registerAttribute("Protocol", &protocol_);
 
+    protocol_.make_string("bitbang");
+    rcvcnt_ = 0;
+    itap_ = 0;
+    conn_ = 0;
     RISCV_mutex_init(&mutexTx_);
 }
 
@@ -59,67 +65,20 @@ void TcpJtagBitBangClient::busyLoop() {
     int rxbytes;
     int tsz = 0;
     bool quit = false;
+    bool scan = protocol_.is_equal("scan");
 
     while (isEnabled()) {
-        rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf), 0);
+        rxbytes = recv(hsock_, &rcvbuf[rcvcnt_],
+                       sizeof(rcvbuf) - rcvcnt_, 0);
         if (rxbytes <= 0 || quit) {
             break;
         } 
 
         txcnt_ = 0;
-        for (int i = 0; i < rxbytes; i++) {
-            switch (rcvbuf[i]) {
-            case 'B':
-                RISCV_debug("%s", "Blink on");
-                break;
-            case 'b':
-                RISCV_debug("%s", "Blink off");
-                break;
-            case 'r':
-                itap_->resetTAP(0, 0);
-                break;
-            case 's':
-                itap_->resetTAP(0, 1);
-                break;
-            case 't':
-                itap_->resetTAP(1, 0);
-                break;
-            case 'u':
-                itap_->resetTAP(1, 1);
-                break;
-            case '0':
-                itap_->setPins(0, 0, 0);
-                break;
-            case '1':
-                itap_->setPins(0, 0, 1);
-                break;
-            case '2':
-                itap_->setPins(0, 1, 0);
-                break;
-            case '3':
-                itap_->setPins(0, 1, 1);
-                break;
-            case '4':
-                itap_->setPins(1, 0, 0);
-                break;
-            case '5':
-                itap_->setPins(1, 0, 1);
-                break;
-            case '6':
-                itap_->setPins(1, 1, 0);
-                break;
-            case '7':
-                itap_->setPins(1, 1, 1);
-                break;
-            case 'R':
-                txbuf_[tsz++] = itap_->getTDO() ? '1' : '0';
-                break;
-            case 'Q':
-                quit = true;
-                break;
-            default:
-                RISCV_error("Unsupported command '%c'\n", rcvbuf[i]);
-            }
+        if (scan) {
+            tsz = processScan(rcvcnt_ + rxbytes, &quit);
+        } else {
+            tsz = processBitBang(rxbytes, &quit);
         }
 
         if (tsz != 0) {
@@ -131,6 +90,154 @@ void TcpJtagBitBangClient::busyLoop() {
     closeSocket();
 }
 
+void TcpJtagBitBangClient::attachConnection(ITcpConnection *conn) {
+    conn_ = conn;
+    if (conn && !itap_) {
+        conn->closeConnection();
+    }
+}
+
+/**
+ * Data from the event loop is processed by the receive buffer sized
+ * pieces, the same way as it was received by recv() in busyLoop().
+ */
+void TcpJtagBitBangClient::processData(const char *buf, int sz) {
+    bool quit = false;
+    bool scan = protocol_.is_equal("scan");
+    int tsz;
+
+    while (sz > 0 && !quit) {
+        int rxbytes = static_cast<int>(sizeof(rcvbuf)) - rcvcnt_;
+        if (rxbytes > sz) {
+            rxbytes = sz;
+        }
+        memcpy(&rcvbuf[rcvcnt_], buf, rxbytes);
+        buf += rxbytes;
+        sz -= rxbytes;
+
+        if (scan) {
+            tsz = processScan(rcvcnt_ + rxbytes, &quit);
+        } else {
+            tsz = processBitBang(rxbytes, &quit);
+        }
+        if (tsz != 0) {
+            conn_->sendData(txbuf_, tsz);
+        }
+    }
+
+    if (quit) {
+        conn_->closeConnection();
+    }
+}
+
+/**
+ * Pin symbols are passed to the TAP by runs, so that the functional TAP
+ * is able to shift the whole bit sequence without per symbol calls.
+ */
+int TcpJtagBitBangClient::processBitBang(int rxbytes, bool *quit) {
+    int tsz = 0;
+    int i = 0;
+    while (i < rxbytes) {
+        int run = 0;
+        while (i + run < rxbytes
+            && ((rcvbuf[i + run] >= '0' && rcvbuf[i + run] <= '7')
+                || rcvbuf[i + run] == 'R')) {
+            run++;
+        }
+        if (run) {
+            tsz += itap_->bitbang(&rcvbuf[i], run, &txbuf_[tsz]);
+            i += run;
+            continue;
+        }
+
+        switch (rcvbuf[i]) {
+        case 'B':
+            RISCV_debug("%s", "Blink on");
+            break;
+        case 'b':
+            RISCV_debug("%s", "Blink off");
+            break;
+        case 'r':
+            itap_->resetTAP(0, 0);
+            break;
+        case 's':
+            itap_->resetTAP(0, 1);
+            break;
+        case 't':
+            itap_->resetTAP(1, 0);
+            break;
+        case 'u':
+            itap_->resetTAP(1, 1);
+            break;
+        case 'Q':
+            *quit = true;
+            break;
+        default:
+            RISCV_error("Unsupported command '%c'\n", rcvbuf[i]);
+        }
+        i++;
+    }
+    return tsz;
+}
+
+int TcpJtagBitBangClient::processScan(int rxbytes, bool *quit) {
+    int tsz = 0;
+    int i = 0;
+    while (i < rxbytes) {
+        char cmd = rcvbuf[i];
+        if (cmd == 'r') {
+            itap_->resetTAP(0, 0);
+            i++;
+            continue;
+        } else if (cmd == 'Q') {
+            *quit = true;
+            i++;
+            continue;
+        } else if (cmd != 'I' && cmd != 'D') {
+            RISCV_error("Unsupported scan command '%c'", cmd);
+            i++;
+            continue;
+        }
+
+        if (i + 2 > rxbytes) {
+            break;
+        }
+        int len = static_cast<uint8_t>(rcvbuf[i + 1]);
+        int nbytes = (len + 7) / 8;
+        if (len == 0 || len > 64) {
+            RISCV_error("Wrong scan length %d", len);
+            i += 2;
+            continue;
+        }
+        if (i + 2 + nbytes > rxbytes) {
+            break;
+        }
+
+        uint64_t tdi = 0;
+        uint64_t tdo;
+        for (int n = 0; n < nbytes; n++) {
+            tdi |= static_cast<uint64_t>(
+                    static_cast<uint8_t>(rcvbuf[i + 2 + n])) << (8 * n);
+        }
+        if (cmd == 'I') {
+            tdo = itap_->scanIR(tdi, len);
+        } else {
+            tdo = itap_->scanDR(tdi, len);
+        }
+        for (int n = 0; n < nbytes; n++) {
+            txbuf_[tsz++] = static_cast<char>(tdo >> (8 * n));
+        }
+        i += 2 + nbytes;
+    }
+
+    // Keep incomplete message for the next recv()
+    rcvcnt_ = rxbytes - i;
+    if (rcvcnt_) {
+        memmove(rcvbuf, &rcvbuf[i], rcvcnt_);
+    }
+    return tsz;
+}
+
 int TcpJtagBitBangClient::sendData(char *buf, int sz) {
     int total = sz;
     char *ptx = buf;
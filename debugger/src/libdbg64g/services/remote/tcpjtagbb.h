@@ -21,11 +21,24 @@
 #include "tcpcmd_gen.h"
 #include "coreservices/ithread.h"
 #include "coreservices/ijtagtap.h"
+#include "coreservices/itcphandler.h"
 
 namespace debugger {
 
+/**
+ * Protocol 'bitbang' is the OpenOCD remote_bitbang ASCII protocol.
+ * Protocol 'scan' executes the whole IR/DR scan per message, all
+ * multi-byte fields are little-endian, nbytes = (len + 7) / 8:
+ *      'I' len[1] tdi[nbytes]  -> tdo[nbytes]   IR scan, len = 1..64
+ *      'D' len[1] tdi[nbytes]  -> tdo[nbytes]   DR scan, len = 1..64
+ *      'r'                                      reset TAP
+ *      'Q'                                      close connection
+ * Scans start and finish in Run-Test/Idle state. Responses on all
+ * messages received by one recv() call are sent back at once.
+ */
 class TcpJtagBitBangClient : public IService,
-                             public IThread {
+                             public IThread,
+                             public ITcpHandler {
  public:
     explicit TcpJtagBitBangClient(const char *name);
     virtual ~TcpJtagBitBangClient();
@@ -33,6 +46,10 @@ class TcpJtagBitBangClient : public IService,
     /** IService interface */
     virtual void postinitService() override;
 
+    /** ITcpHandler interface */
+    virtual void attachConnection(ITcpConnection *conn);
+    virtual void processData(const char *buf, int sz);
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
@@ -43,16 +60,21 @@ class TcpJtagBitBangClient : public IService,
  protected:
     int sendData(char *buf, int sz);
     void closeSocket();
+    int processBitBang(int rxbytes, bool *quit);
+    int processScan(int rxbytes, bool *quit);
 
  private:
     AttributeType isEnable_;
     AttributeType jtagtap_;
+    AttributeType protocol_;
 
     IJtagTap *itap_;
+    ITcpConnection *conn_;      // served by the server event loop
 
     socket_def hsock_;
     mutex_def mutexTx_;
     char rcvbuf[4096];
+    int rcvcnt_;                // unprocessed tail of the scan message
     char txbuf_[1<<20];
     int txcnt_;
     union reg8_type {
@@ -15,6 +15,10 @@
  */
 
 #include "tcpserver.h"
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 namespace debugger {
 
@@ -29,20 +33,85 @@ TcpServer::TcpServer(const char *name) : IService(name) {
     registerAttribute("Type", &type_);
     registerAttribute("ListenDefaultOutput", &listenDefaultOutput_);
     registerAttribute("JtagTap", &jtagtap_);
+    registerAttribute("Workers", &workers_);
+    registerAttribute("TxQueueLimit", &txQueueLimit_);
+
+    workers_.make_int64(4);
+    txQueueLimit_.make_int64(1 << 20);
+    hsock_ = -1;
+    clientIdx_ = 0;
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    epfd_ = -1;
+    wakefd_ = -1;
+    pool_ = 0;
+    poolSize_ = 0;
+    conns_ = 0;
+    workHead_ = 0;
+    workTail_ = 0;
+    released_ = 0;
+    RISCV_mutex_init(&mutexq_);
+    char tstr[64];
+    RISCV_sprintf(tstr, sizeof(tstr), "%s_work", name);
+    RISCV_event_create(&eventWork_, tstr);
+#endif
+}
+
+TcpServer::~TcpServer() {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    for (int i = 0; i < poolSize_; i++) {
+        delete pool_[i];
+    }
+    delete [] pool_;
+    if (wakefd_ >= 0) {
+        close(wakefd_);
+    }
+    if (epfd_ >= 0) {
+        close(epfd_);
+    }
+    RISCV_event_close(&eventWork_);
+    RISCV_mutex_destroy(&mutexq_);
+#endif
 }
 
 void TcpServer::postinitService() {
     createServerSocket();
 
-    if (listen(hsock_, 1) < 0)  {
+    if (listen(hsock_, SOMAXCONN) < 0)  {
         RISCV_error("listen() failed", 0);
         return;
     }
 
+#if defined(_WIN32) || defined(__CYGWIN__)
     /** By default socket was created with Blocking mode */
     if (!blockmode_.to_bool()) {
         setBlockingMode(false);
     }
+#else
+    /** Event loop accepts all pending connections until EAGAIN */
+    setBlockingMode(false);
+
+    epfd_ = epoll_create1(0);
+    wakefd_ = eventfd(0, EFD_NONBLOCK);
+    if (epfd_ < 0 || wakefd_ < 0) {
+        RISCV_error("Can't create epoll instance", 0);
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = this;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, hsock_, &ev);
+    ev.data.ptr = &wakefd_;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+
+    poolSize_ = workers_.to_int();
+    if (poolSize_ < 1) {
+        poolSize_ = 1;
+    }
+    pool_ = new TcpWorker *[poolSize_];
+    for (int i = 0; i < poolSize_; i++) {
+        pool_[i] = new TcpWorker(this);
+    }
+#endif
 
     if (isEnable_.to_bool()) {
         if (!run()) {
@@ -52,6 +121,66 @@ void TcpServer::postinitService() {
     }
 }
 
+/**
+ * Client service is created with disabled thread when it is served by
+ * the event loop.
+ */
+IService *TcpServer::createClient(socket_def skt, bool threaded) {
+    IClass *icls;
+    IService *isrv;
+    char tname[64];
+    RISCV_sprintf(tname, sizeof(tname), "client%d", clientIdx_++);
+
+    AttributeType lst, item;
+    lst.make_list(0);
+    item.make_list(2);
+    if (type_.is_equal("openocd") || type_.is_equal("jtagscan")) {
+        icls = static_cast<IClass *>(RISCV_get_class("TcpJtagBitBangClientClass"));
+        isrv = icls->createService(".", tname);
+        item[0u].make_string("LogLevel");
+        item[1].make_int64(logLevel_.to_int());
+        lst.add_to_list(&item);
+        item[0u].make_string("Enable");
+        item[1].make_boolean(threaded);
+        lst.add_to_list(&item);
+        item[0u].make_string("JtagTap");
+        item[1].clone(&jtagtap_);
+        lst.add_to_list(&item);
+        item[0u].make_string("Protocol");
+        item[1].make_string(type_.is_equal("jtagscan") ? "scan"
+                                                       : "bitbang");
+        lst.add_to_list(&item);
+    } else {
+        icls = static_cast<IClass *>(RISCV_get_class("TcpClientClass"));
+        isrv = icls->createService(".", tname);
+        item[0u].make_string("LogLevel");
+        item[1].make_int64(logLevel_.to_int());
+        lst.add_to_list(&item);
+        item[0u].make_string("Enable");
+        item[1].make_boolean(threaded);
+        lst.add_to_list(&item);
+        item[0u].make_string("PlatformConfig");
+        item[1].clone(&platformConfig_);
+        lst.add_to_list(&item);
+        item[0u].make_string("Type");
+        item[1].clone(&type_);
+        lst.add_to_list(&item);
+        item[0u].make_string("ListenDefaultOutput");
+        item[1].clone(&listenDefaultOutput_);
+        lst.add_to_list(&item);
+    }
+
+    isrv->initService(&lst);
+    if (threaded) {
+        IThread *ithrd =
+            static_cast<IThread *>(isrv->getInterface(IFACE_THREAD));
+        ithrd->setExtArgument(&skt);
+    }
+    isrv->postinitService();
+    return isrv;
+}
+
+#if defined(_WIN32) || defined(__CYGWIN__)
 void TcpServer::busyLoop() {
     socket_def client_sock;
     int err;
@@ -61,10 +190,6 @@ void TcpServer::busyLoop() {
     timeout.tv_sec = 0;
     timeout.tv_usec = 400000;   // 400 ms
 
-    int idx = 0;
-    char tname[64];
-
-    IClass *icls;
     IService *isrv;
     while (isEnabled()) {
         FD_ZERO(&readSet);
@@ -73,48 +198,7 @@ void TcpServer::busyLoop() {
         if (err > 0) {
             client_sock = accept(hsock_, 0, 0);
             setRcvTimeout(client_sock, timeout_.to_int());
-            RISCV_sprintf(tname, sizeof(tname), "client%d", idx++);
-
-            AttributeType lst, item;
-            lst.make_list(0);
-            item.make_list(2);
-            if (type_.is_equal("openocd")) {
-                icls = static_cast<IClass *>(RISCV_get_class("TcpJtagBitBangClientClass"));
-                isrv = icls->createService(".", tname);
-                item[0u].make_string("LogLevel");
-                item[1].make_int64(logLevel_.to_int());
-                lst.add_to_list(&item);
-                item[0u].make_string("Enable");
-                item[1].make_boolean(true);
-                lst.add_to_list(&item);
-                item[0u].make_string("JtagTap");
-                item[1].clone(&jtagtap_);
-                lst.add_to_list(&item);
-            } else {
-                icls = static_cast<IClass *>(RISCV_get_class("TcpClientClass"));
-                isrv = icls->createService(".", tname);
-                item[0u].make_string("LogLevel");
-                item[1].make_int64(logLevel_.to_int());
-                lst.add_to_list(&item);
-                item[0u].make_string("Enable");
-                item[1].make_boolean(true);
-                lst.add_to_list(&item);
-                item[0u].make_string("PlatformConfig");
-                item[1].clone(&platformConfig_);
-                lst.add_to_list(&item);
-                item[0u].make_string("Type");
-                item[1].clone(&type_);
-                lst.add_to_list(&item);
-                item[0u].make_string("ListenDefaultOutput");
-                item[1].clone(&listenDefaultOutput_);
-                lst.add_to_list(&item);
-            }
-
-            isrv->initService(&lst);
-            IThread *ithrd =
-                static_cast<IThread *>(isrv->getInterface(IFACE_THREAD));
-            ithrd->setExtArgument(&client_sock);
-            isrv->postinitService();
+            isrv = createClient(client_sock, true);
             RISCV_info("TCP %s %p started", isrv->getObjName(), client_sock);
         } else if (err == 0) {
             // timeout
@@ -125,6 +209,181 @@ void TcpServer::busyLoop() {
     }
     closeServerSocket();
 }
+#else
+void TcpServer::busyLoop() {
+    struct epoll_event events[EPOLL_EVENTS_MAX];
+    for (int i = 0; i < poolSize_; i++) {
+        pool_[i]->run();
+    }
+
+    while (isEnabled()) {
+        // Timeout only to check the loop enable flag
+        int n = epoll_wait(epfd_, events, EPOLL_EVENTS_MAX, 100);
+        if (n < 0 && errno != EINTR) {
+            RISCV_error("epoll_wait() failed", 0);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == this) {
+                acceptConnections();
+                continue;
+            } else if (events[i].data.ptr == &wakefd_) {
+                uint64_t cnt;
+                ssize_t rd = read(wakefd_, &cnt, sizeof(cnt));
+                (void)rd;
+                continue;
+            }
+            TcpConnection *conn =
+                reinterpret_cast<TcpConnection *>(events[i].data.ptr);
+            uint32_t ev = events[i].events;
+            if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                if (conn->readSocket()) {
+                    pushWork(conn);
+                }
+            }
+            if (ev & EPOLLOUT) {
+                conn->writeSocket();
+            }
+            if (conn->claimDead()) {
+                deleteConnection(conn);
+            }
+        }
+        deleteReleased();
+    }
+
+    for (int i = 0; i < poolSize_; i++) {
+        pool_[i]->stop();
+    }
+    // Close all: queued connections are taken by the loop, connection
+    // still processed by a blocked handler is left as is.
+    for (TcpConnection *p = conns_; p; p = p->nextConn_) {
+        p->closeConnection();
+    }
+    TcpConnection *conn;
+    while ((conn = takeWork(1)) != 0) {
+        conn->takeData(0, 0);
+        releaseConnection(conn);
+    }
+    deleteReleased();
+    TcpConnection *next;
+    for (TcpConnection *p = conns_; p; p = next) {
+        next = p->nextConn_;
+        if (p->claimDead()) {
+            deleteConnection(p);
+        }
+    }
+    closeServerSocket();
+}
+
+void TcpServer::acceptConnections() {
+    while (isEnabled()) {
+        socket_def skt = accept(hsock_, 0, 0);
+        if (skt < 0) {
+            break;
+        }
+        IService *isrv = createClient(skt, false);
+        ITcpHandler *ihandler = static_cast<ITcpHandler *>(
+                        isrv->getInterface(IFACE_TCP_HANDLER));
+        TcpConnection *conn = new TcpConnection(this, skt, epfd_, isrv,
+                                ihandler, txQueueLimit_.to_int());
+        conn->nextConn_ = conns_;
+        conns_ = conn;
+        ihandler->attachConnection(conn);
+        RISCV_info("TCP %s %d attached", isrv->getObjName(), skt);
+    }
+}
+
+void TcpServer::pushWork(TcpConnection *conn) {
+    RISCV_mutex_lock(&mutexq_);
+    conn->nextWork_ = 0;
+    if (workTail_) {
+        workTail_->nextWork_ = conn;
+    } else {
+        workHead_ = conn;
+    }
+    workTail_ = conn;
+    RISCV_event_set(&eventWork_);
+    RISCV_mutex_unlock(&mutexq_);
+}
+
+TcpConnection *TcpServer::takeWork(int timeout_ms) {
+    RISCV_event_wait_ms(&eventWork_, timeout_ms);
+    RISCV_mutex_lock(&mutexq_);
+    TcpConnection *ret = workHead_;
+    if (ret) {
+        workHead_ = ret->nextWork_;
+        if (!workHead_) {
+            workTail_ = 0;
+        }
+        ret->nextWork_ = 0;
+    }
+    if (!workHead_) {
+        RISCV_event_clear(&eventWork_);
+    }
+    RISCV_mutex_unlock(&mutexq_);
+    return ret;
+}
+
+/** Closed connection is passed back to the event loop to be deleted */
+void TcpServer::releaseConnection(TcpConnection *conn) {
+    RISCV_mutex_lock(&mutexq_);
+    conn->nextWork_ = released_;
+    released_ = conn;
+    RISCV_mutex_unlock(&mutexq_);
+    uint64_t one = 1;
+    ssize_t wr = write(wakefd_, &one, sizeof(one));
+    (void)wr;
+}
+
+void TcpServer::deleteReleased() {
+    RISCV_mutex_lock(&mutexq_);
+    TcpConnection *p = released_;
+    released_ = 0;
+    RISCV_mutex_unlock(&mutexq_);
+    while (p) {
+        TcpConnection *next = p->nextWork_;
+        deleteConnection(p);
+        p = next;
+    }
+}
+
+void TcpServer::deleteConnection(TcpConnection *conn) {
+    TcpConnection **pp = &conns_;
+    while (*pp && *pp != conn) {
+        pp = &(*pp)->nextConn_;
+    }
+    if (*pp) {
+        *pp = conn->nextConn_;
+    }
+
+    IService *isrv = conn->getService();
+    conn->getHandler()->attachConnection(0);
+    delete conn;
+
+    RISCV_info("TCP %s closed", isrv->getObjName());
+    IClass *icls = static_cast<IClass *>(RISCV_get_class(
+        type_.is_equal("openocd") || type_.is_equal("jtagscan")
+            ? "TcpJtagBitBangClientClass" : "TcpClientClass"));
+    icls->deleteService(isrv->getObjName());
+}
+
+void TcpWorker::busyLoop() {
+    while (isEnabled()) {
+        TcpConnection *conn = parent_->takeWork(100);
+        if (!conn) {
+            continue;
+        }
+        ITcpHandler *ihandler = conn->getHandler();
+        int sz;
+        while ((sz = conn->takeData(buf_, sizeof(buf_))) > 0) {
+            ihandler->processData(buf_, sz);
+        }
+        if (sz < 0) {
+            parent_->releaseConnection(conn);
+        }
+    }
+}
+#endif
 
 int TcpServer::createServerSocket() {
     char hostName[256];
@@ -19,18 +19,50 @@
 #include <iclass.h>
 #include <iservice.h>
 #include "coreservices/ithread.h"
+#include "coreservices/itcphandler.h"
 #include "tcpclient.h"
+#include "tcpconn.h"
 
 namespace debugger {
 
+class TcpServer;
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+/** Pool thread that runs protocol handlers of the ready connections */
+class TcpWorker : public IThread {
+ public:
+    explicit TcpWorker(TcpServer *parent) : parent_(parent) {}
+
+ protected:
+    /** IThread interface */
+    virtual void busyLoop();
+
+ private:
+    TcpServer *parent_;
+    char buf_[1 << 16];
+};
+#endif
+
+/**
+ * On Linux all connections are served by one epoll() event loop with
+ * non-blocking sockets, received data is processed by the small pool of
+ * worker threads. Windows keeps the thread per client.
+ */
 class TcpServer : public IService,
                   public IThread {
  public:
     explicit TcpServer(const char *name);
+    virtual ~TcpServer();
 
     /** IService interface */
     virtual void postinitService() override;
 
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    /** Worker side */
+    TcpConnection *takeWork(int timeout_ms);
+    void releaseConnection(TcpConnection *conn);
+#endif
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
@@ -40,6 +72,13 @@ class TcpServer : public IService,
     void closeServerSocket();
     void setRcvTimeout(socket_def skt, int timeout_ms);
     bool setBlockingMode(bool mode);
+    IService *createClient(socket_def skt, bool threaded);
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    void acceptConnections();
+    void pushWork(TcpConnection *conn);
+    void deleteConnection(TcpConnection *conn);
+    void deleteReleased();
+#endif
 
  private:
     AttributeType isEnable_;
@@ -51,10 +90,26 @@ class TcpServer : public IService,
     AttributeType type_;
     AttributeType listenDefaultOutput_;
     AttributeType jtagtap_;
+    AttributeType workers_;
+    AttributeType txQueueLimit_;
 
     struct sockaddr_in sockaddr_ipv4_;
     socket_def hsock_;
-    char rcvbuf[4096];
+    int clientIdx_;
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    static const int EPOLL_EVENTS_MAX = 64;
+
+    int epfd_;
+    int wakefd_;
+    TcpWorker **pool_;
+    int poolSize_;
+    TcpConnection *conns_;
+    mutex_def mutexq_;
+    event_def eventWork_;
+    TcpConnection *workHead_;
+    TcpConnection *workTail_;
+    TcpConnection *released_;
+#endif
 };
 
 DECLARE_CLASS(TcpServer)
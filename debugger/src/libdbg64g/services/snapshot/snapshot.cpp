@@ -0,0 +1,873 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "snapshot.h"
+#include "coreservices/idport.h"
+#include <string.h>
+#include <random>
+
+namespace debugger {
+
+/**
+ * File format (host byte order):
+ *      magic[8], u64 id, u32 baselen, base file name relative to this file
+ *      records: u32 type, u32 namelen, name, then
+ *          section: u64 size, data
+ *          image:   u32 ordinal, u64 size, u64 pagecnt, u64 pageidx[],
+ *                   zero padding up to the page aligned file offset,
+ *                   pages in the order of pageidx[]
+ *      u32 SnapRec_End
+ * Pages are aligned in the file so that they can be mapped directly.
+ */
+static const char SNAPSHOT_MAGIC[8] = {'R', 'V', 'S', 'N', 'A', 'P', '0', '3'};
+static const int SNAPSHOT_BASE_DEPTH_MAX = 16;
+
+enum ESnapshotRecord {
+    SnapRec_End,
+    SnapRec_Section,
+    SnapRec_Image
+};
+
+static bool is_zero_page(const uint8_t *p, uint64_t sz) {
+    const uint64_t *p64 = reinterpret_cast<const uint64_t *>(p);
+    uint64_t i = 0;
+    for (; i < sz / 8; i++) {
+        if (p64[i]) {
+            return false;
+        }
+    }
+    for (i *= 8; i < sz; i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_absolute_path(const char *path) {
+    return path[0] == '/' || path[0] == '\\'
+        || (path[0] != '\0' && path[1] == ':');
+}
+
+static bool is_same_path(const char *a, const char *b) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return _stricmp(a, b) == 0;
+#else
+    return strcmp(a, b) == 0;
+#endif
+}
+
+/** Length of the directory part with the trailing separator */
+static size_t dir_length(const char *path) {
+    size_t n = strlen(path);
+    while (n > 0 && path[n - 1] != '/' && path[n - 1] != '\\') {
+        n--;
+    }
+    return n;
+}
+
+/** Only the directory is resolved for the file that doesn't exist yet */
+static bool snapshot_full_path(const char *filename, char *out, int sz) {
+    if (RISCV_get_full_path(filename, out, sz)) {
+        return true;
+    }
+    char dir[4096] = ".";
+    size_t dirlen = dir_length(filename);
+    if (dirlen >= sizeof(dir)) {
+        return false;
+    }
+    if (dirlen) {
+        memcpy(dir, filename, dirlen);
+        dir[dirlen] = '\0';
+    }
+    if (!RISCV_get_full_path(dir, out, sz)) {
+        return false;
+    }
+    int n = static_cast<int>(strlen(out));
+    const char *sep = dir_length(out) == static_cast<size_t>(n) ? "" : "/";
+    return RISCV_sprintf(&out[n], sz - n, "%s%s", sep, &filename[dirlen])
+            < sz - n;
+}
+
+/**
+ * Path of the base file relative to the directory of the snapshot, so
+ * that both can be moved together. Both paths are absolute.
+ */
+static void snapshot_relative_path(const char *filename, const char *base,
+                                   char *out, int sz) {
+    size_t dirlen = dir_length(filename);
+    size_t common = 0;
+    for (size_t i = 0; i < dirlen && filename[i] == base[i]; i++) {
+        if (filename[i] == '/' || filename[i] == '\\') {
+            common = i + 1;
+        }
+    }
+    int n = 0;
+    out[0] = '\0';
+    // Nothing in common on the other drive, absolute path is kept
+    for (size_t i = common; common && i < dirlen; i++) {
+        if (filename[i] == '/' || filename[i] == '\\') {
+            n += RISCV_sprintf(&out[n], sz - n, "../");
+        }
+    }
+    RISCV_sprintf(&out[n], sz - n, "%s", &base[common]);
+}
+
+/**
+ * Identifier tells that the memory is still equal to the snapshot, so it
+ * must differ for files saved by other simulator instances.
+ */
+static uint64_t new_snapshot_id() {
+    std::random_device rd;
+    uint64_t id = (static_cast<uint64_t>(rd()) << 32) ^ rd()
+                ^ RISCV_get_time_ms();
+    return id ? id : 1;
+}
+
+/** Stream of the section that is being saved */
+class SnapshotWriter : public ISnapshotStream {
+ public:
+    SnapshotWriter(FILE *f, SnapshotFile *base, uint64_t id, uint64_t pos)
+        : f_(f), base_(base), id_(id), pos_(pos) {
+        bufsz_ = 4096;
+        buf_ = new uint8_t[bufsz_];
+        cnt_ = 0;
+        name_ = 0;
+        ordinal_ = 0;
+        pages_ = 0;
+    }
+    ~SnapshotWriter() {
+        delete [] buf_;
+    }
+
+    void begin(const char *name) {
+        name_ = name;
+        cnt_ = 0;
+        ordinal_ = 0;
+    }
+
+    void end() {
+        putRecord(SnapRec_Section);
+        put(&cnt_, sizeof(cnt_));
+        put(buf_, cnt_);
+    }
+
+    void finish() {
+        uint32_t recend = SnapRec_End;
+        put(&recend, sizeof(recend));
+    }
+
+    virtual void write(const void *buf, uint64_t sz) {
+        if (cnt_ + sz > bufsz_) {
+            while (cnt_ + sz > bufsz_) {
+                bufsz_ *= 2;
+            }
+            uint8_t *t = new uint8_t[bufsz_];
+            memcpy(t, buf_, static_cast<size_t>(cnt_));
+            delete [] buf_;
+            buf_ = t;
+        }
+        memcpy(&buf_[cnt_], buf, static_cast<size_t>(sz));
+        cnt_ += sz;
+    }
+
+    virtual bool read(void *buf, uint64_t sz) { return false; }
+
+    virtual uint64_t getSnapshotId() { return id_; }
+
+    /** Image goes into the file immediately, the section keeps ordinal */
+    virtual void writeImage(const uint8_t *mem, uint64_t sz,
+                            const SnapshotWriteTracker *tracker) {
+        uint32_t ordinal = ordinal_++;
+        write(&ordinal, sizeof(ordinal));
+
+        putRecord(SnapRec_Image);
+        put(&ordinal, sizeof(ordinal));
+        put(&sz, sizeof(sz));
+
+        const uint64_t pagesz = SnapshotService::PAGE_SIZE;
+        uint64_t *pageidx = new uint64_t[(sz + pagesz - 1) / pagesz + 1];
+        uint64_t pagecnt = 0;
+        const uint8_t *ref;
+        bool tracked = tracker && base_
+                && tracker->getSnapshotId() == base_->getId();
+        for (uint64_t off = 0; off < sz; off += pagesz) {
+            uint64_t idx = off / pagesz;
+            if (tracked && !tracker->isWritten(idx)) {
+                continue;
+            }
+            ref = base_ ? base_->findPage(name_, ordinal, idx) : 0;
+            if (ref ? memcmp(&mem[off], ref, pageBytes(off, sz)) == 0
+                    : is_zero_page(&mem[off], pageBytes(off, sz))) {
+                continue;
+            }
+            pageidx[pagecnt++] = idx;
+        }
+        put(&pagecnt, sizeof(pagecnt));
+        put(pageidx, pagecnt * sizeof(uint64_t));
+
+        uint8_t zero[SnapshotService::PAGE_SIZE] = {0};
+        put(zero, (pagesz - (pos_ & (pagesz - 1))) & (pagesz - 1));
+        for (uint64_t i = 0; i < pagecnt; i++) {
+            uint64_t off = pageidx[i] * pagesz;
+            uint64_t n = pageBytes(off, sz);
+            put(&mem[off], n);
+            put(zero, pagesz - n);
+        }
+        pages_ += pagecnt;
+        delete [] pageidx;
+    }
+
+    virtual bool readImage(uint8_t *mem, uint64_t sz) { return false; }
+    virtual bool mapImage(uint8_t *mem, uint64_t sz) { return false; }
+
+    uint64_t getPages() { return pages_; }
+
+ private:
+    void putRecord(uint32_t type) {
+        uint32_t namelen = static_cast<uint32_t>(strlen(name_));
+        put(&type, sizeof(type));
+        put(&namelen, sizeof(namelen));
+        put(name_, namelen);
+    }
+
+    /** File offset is tracked to align pages */
+    void put(const void *buf, uint64_t sz) {
+        fwrite(buf, 1, static_cast<size_t>(sz), f_);
+        pos_ += sz;
+    }
+
+    static size_t pageBytes(uint64_t off, uint64_t sz) {
+        uint64_t n = sz - off;
+        if (n > SnapshotService::PAGE_SIZE) {
+            n = SnapshotService::PAGE_SIZE;
+        }
+        return static_cast<size_t>(n);
+    }
+
+ private:
+    FILE *f_;
+    SnapshotFile *base_;
+    uint64_t id_;
+    uint64_t pos_;
+    const char *name_;
+    uint8_t *buf_;
+    uint64_t bufsz_;
+    uint64_t cnt_;
+    uint32_t ordinal_;
+    uint64_t pages_;
+};
+
+/** Stream of the section that is being restored */
+class SnapshotReader : public ISnapshotStream {
+ public:
+    explicit SnapshotReader(SnapshotFile *file) : file_(file) {
+        name_ = 0;
+        data_ = 0;
+        size_ = 0;
+        pos_ = 0;
+    }
+
+    bool begin(const char *name) {
+        name_ = name;
+        pos_ = 0;
+        data_ = file_->getSection(name, &size_);
+        return data_ != 0;
+    }
+
+    virtual void write(const void *buf, uint64_t sz) {}
+
+    virtual uint64_t getSnapshotId() { return file_->getId(); }
+
+    virtual bool read(void *buf, uint64_t sz) {
+        if (pos_ + sz > size_) {
+            pos_ = size_;
+            return false;
+        }
+        memcpy(buf, &data_[pos_], static_cast<size_t>(sz));
+        pos_ += sz;
+        return true;
+    }
+
+    virtual void writeImage(const uint8_t *mem, uint64_t sz,
+                            const SnapshotWriteTracker *tracker) {}
+
+    virtual bool readImage(uint8_t *mem, uint64_t sz) {
+        uint32_t ordinal;
+        if (!read(&ordinal, sizeof(ordinal))
+            || file_->getImageSize(name_, ordinal) != sz) {
+            return false;
+        }
+        copyImage(ordinal, mem, sz);
+        return true;
+    }
+
+    /** Copying is the fallback when the host cannot remap the region */
+    virtual bool mapImage(uint8_t *mem, uint64_t sz) {
+        uint32_t ordinal;
+        if (!read(&ordinal, sizeof(ordinal))
+            || file_->getImageSize(name_, ordinal) != sz) {
+            return false;
+        }
+        if (!file_->mapImage(name_, ordinal, mem, sz)) {
+            copyImage(ordinal, mem, sz);
+        }
+        return true;
+    }
+
+ private:
+    /** Pages are written only when differ, so clean pages stay shared */
+    void copyImage(uint32_t ordinal, uint8_t *mem, uint64_t sz) {
+        const uint8_t *p;
+        uint64_t n;
+        for (uint64_t off = 0; off < sz; off += SnapshotService::PAGE_SIZE) {
+            n = sz - off;
+            if (n > SnapshotService::PAGE_SIZE) {
+                n = SnapshotService::PAGE_SIZE;
+            }
+            p = file_->findPage(name_, ordinal,
+                                off / SnapshotService::PAGE_SIZE);
+            if (p) {
+                if (memcmp(&mem[off], p, static_cast<size_t>(n))) {
+                    memcpy(&mem[off], p, static_cast<size_t>(n));
+                }
+            } else if (!is_zero_page(&mem[off], n)) {
+                memset(&mem[off], 0, static_cast<size_t>(n));
+            }
+        }
+    }
+
+ private:
+    SnapshotFile *file_;
+    const char *name_;
+    const uint8_t *data_;
+    uint64_t size_;
+    uint64_t pos_;
+};
+
+
+SnapshotFile::SnapshotFile() {
+    filename_ = 0;
+    id_ = 0;
+    mapped_ = 0;
+    mapsz_ = 0;
+    sections_ = 0;
+    sectionCnt_ = 0;
+    images_ = 0;
+    imageCnt_ = 0;
+    base_ = 0;
+}
+
+SnapshotFile::~SnapshotFile() {
+    for (unsigned i = 0; images_ && i < imageCnt_; i++) {
+        delete [] images_[i].pageidx;
+    }
+    delete [] sections_;
+    delete [] images_;
+    delete base_;
+    delete [] filename_;
+    RISCV_memory_release(mapped_, mapsz_);
+}
+
+bool SnapshotFile::load(const char *filename, int depth) {
+    if (depth >= SNAPSHOT_BASE_DEPTH_MAX) {
+        RISCV_printf(NULL, LOG_ERROR,
+                     "Too deep chain of the base snapshots %s", filename);
+        return false;
+    }
+    // Full path stays valid when the current directory is changed
+    filename_ = new char[4096];
+    if (!snapshot_full_path(filename, filename_, 4096)) {
+        RISCV_printf(NULL, LOG_ERROR, "Can't open '%s' file", filename);
+        return false;
+    }
+    mapped_ = static_cast<uint8_t *>(
+        RISCV_memory_map_file(filename_, 0, &mapsz_));
+    if (mapped_ == 0) {
+        return false;
+    }
+    if (!parse(false)) {
+        RISCV_printf(NULL, LOG_ERROR, "Wrong snapshot file %s", filename);
+        return false;
+    }
+    sections_ = new SectionType[sectionCnt_ + 1];
+    images_ = new ImageType[imageCnt_ + 1];
+    parse(true);
+
+    uint32_t baselen;
+    uint64_t pos = sizeof(SNAPSHOT_MAGIC);
+    memcpy(&id_, &mapped_[pos], sizeof(id_));
+    pos += sizeof(id_);
+    memcpy(&baselen, &mapped_[pos], sizeof(baselen));
+    pos += sizeof(baselen);
+    if (baselen) {
+        char basename[4096];
+        size_t dirlen = 0;
+        const char *stored = reinterpret_cast<const char *>(&mapped_[pos]);
+        if (!is_absolute_path(stored)) {
+            dirlen = dir_length(filename_);
+            memcpy(basename, filename_, dirlen);
+        }
+        if (dirlen + baselen >= sizeof(basename)) {
+            return false;
+        }
+        memcpy(&basename[dirlen], stored, baselen);
+        basename[dirlen + baselen] = '\0';
+        base_ = new SnapshotFile;
+        if (!base_->load(basename, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The first pass only checks bounds and counts records, the second one
+ * fills the tables allocated with these counts.
+ */
+bool SnapshotFile::parse(bool fill) {
+    uint64_t pos = 0;
+    uint32_t u32;
+    uint64_t u64;
+#define SNAP_GET(dst) \
+    if (pos + sizeof(dst) > mapsz_) { return false; } \
+    memcpy(&dst, &mapped_[pos], sizeof(dst)); \
+    pos += sizeof(dst);
+
+    if (mapsz_ < sizeof(SNAPSHOT_MAGIC)
+        || memcmp(mapped_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) {
+        return false;
+    }
+    pos = sizeof(SNAPSHOT_MAGIC);
+    SNAP_GET(u64);
+    SNAP_GET(u32);
+    pos += u32;
+
+    sectionCnt_ = 0;
+    imageCnt_ = 0;
+    while (true) {
+        uint32_t type;
+        uint32_t namelen;
+        SNAP_GET(type);
+        if (type == SnapRec_End) {
+            break;
+        }
+        SNAP_GET(namelen);
+        const char *name = reinterpret_cast<const char *>(&mapped_[pos]);
+        pos += namelen;
+        if (type == SnapRec_Section) {
+            SNAP_GET(u64);
+            if (pos + u64 > mapsz_) {
+                return false;
+            }
+            if (fill) {
+                SectionType &sec = sections_[sectionCnt_];
+                sec.name = name;
+                sec.namelen = namelen;
+                sec.data = &mapped_[pos];
+                sec.size = u64;
+            }
+            sectionCnt_++;
+            pos += u64;
+        } else if (type == SnapRec_Image) {
+            ImageType *img = fill ? &images_[imageCnt_] : 0;
+            SNAP_GET(u32);
+            SNAP_GET(u64);
+            if (img) {
+                img->name = name;
+                img->namelen = namelen;
+                img->ordinal = u32;
+                img->size = u64;
+            }
+            uint64_t pagecnt;
+            SNAP_GET(pagecnt);
+            if (pagecnt > mapsz_ / SnapshotService::PAGE_SIZE) {
+                return false;
+            }
+            uint64_t table = pos;
+            pos += pagecnt * sizeof(uint64_t);
+            pos = (pos + SnapshotService::PAGE_SIZE - 1)
+                & ~(SnapshotService::PAGE_SIZE - 1);
+            uint64_t dataoff = pos;
+            pos += pagecnt * SnapshotService::PAGE_SIZE;
+            if (pos > mapsz_) {
+                return false;
+            }
+            if (img) {
+                img->pagecnt = pagecnt;
+                img->pageidx = new uint64_t[pagecnt + 1];
+                memcpy(img->pageidx, &mapped_[table],
+                       static_cast<size_t>(pagecnt * sizeof(uint64_t)));
+                img->dataoff = dataoff;
+            }
+            imageCnt_++;
+        } else {
+            return false;
+        }
+    }
+#undef SNAP_GET
+    return true;
+}
+
+bool SnapshotFile::isInChain(const char *fullname) {
+    if (filename_ && is_same_path(filename_, fullname)) {
+        return true;
+    }
+    return base_ ? base_->isInChain(fullname) : false;
+}
+
+bool SnapshotFile::nameEqual(const char *s, uint32_t len, const char *name) {
+    return strncmp(s, name, len) == 0 && name[len] == '\0';
+}
+
+const uint8_t *SnapshotFile::getSection(const char *name, uint64_t *sz) {
+    for (unsigned i = 0; i < sectionCnt_; i++) {
+        if (nameEqual(sections_[i].name, sections_[i].namelen, name)) {
+            *sz = sections_[i].size;
+            return sections_[i].data;
+        }
+    }
+    return 0;
+}
+
+SnapshotFile::ImageType *SnapshotFile::findImage(const char *name,
+                                                 unsigned ordinal) {
+    for (unsigned i = 0; i < imageCnt_; i++) {
+        if (images_[i].ordinal == ordinal
+            && nameEqual(images_[i].name, images_[i].namelen, name)) {
+            return &images_[i];
+        }
+    }
+    return 0;
+}
+
+uint64_t SnapshotFile::getImageSize(const char *name, unsigned ordinal) {
+    ImageType *img = findImage(name, ordinal);
+    return img ? img->size : ~0ull;
+}
+
+const uint8_t *SnapshotFile::findPage(const char *name, unsigned ordinal,
+                                      uint64_t pageidx) {
+    ImageType *img = findImage(name, ordinal);
+    if (img) {
+        uint64_t lo = 0;
+        uint64_t hi = img->pagecnt;
+        while (lo < hi) {
+            uint64_t mid = (lo + hi) / 2;
+            if (img->pageidx[mid] < pageidx) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < img->pagecnt && img->pageidx[lo] == pageidx) {
+            return &mapped_[img->dataoff + lo * SnapshotService::PAGE_SIZE];
+        }
+    }
+    return base_ ? base_->findPage(name, ordinal, pageidx) : 0;
+}
+
+/**
+ * The oldest base is mapped first over zero pages, then every next file
+ * maps its runs of consecutive pages on top of it.
+ */
+bool SnapshotFile::mapImage(const char *name, unsigned ordinal,
+                            uint8_t *mem, uint64_t sz) {
+    const uint64_t pagesz = SnapshotService::PAGE_SIZE;
+    uint64_t mapsz = (sz + pagesz - 1) & ~(pagesz - 1);
+    if (base_) {
+        if (!base_->mapImage(name, ordinal, mem, sz)) {
+            return false;
+        }
+    } else if (!RISCV_memory_remap(mem, mapsz, 0, 0)) {
+        return false;
+    }
+    ImageType *img = findImage(name, ordinal);
+    if (img == 0) {
+        return true;
+    }
+    uint64_t i = 0;
+    while (i < img->pagecnt) {
+        uint64_t n = 1;
+        while (i + n < img->pagecnt
+            && img->pageidx[i + n] == img->pageidx[i] + n) {
+            n++;
+        }
+        if (img->pageidx[i] * pagesz + n * pagesz > mapsz
+            || !RISCV_memory_remap(&mem[img->pageidx[i] * pagesz],
+                                   n * pagesz, filename_,
+                                   img->dataoff + i * pagesz)) {
+            return false;
+        }
+        i += n;
+    }
+    return true;
+}
+
+
+CmdSave::CmdSave(IService *parent, uint64_t dmibar)
+    : ICommand("save", dmibar, 0) {
+    parent_ = parent;
+    briefDescr_.make_string("Save state of the halted platform into file");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Save registers, memories and clock events of all services.\n"
+        "    With the base snapshot only memory pages changed since the\n"
+        "    base are stored, the base file must be kept for restoring.\n"
+        "Usage:\n"
+        "    save filename [base_filename]\n"
+        "Example:\n"
+        "    save boot.snap\n"
+        "    save test1.snap boot.snap\n");
+}
+
+int CmdSave::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() < 2 || !(*args)[1].is_string()) {
+        return CMD_WRONG_ARGS;
+    }
+    return CMD_VALID;
+}
+
+void CmdSave::exec(AttributeType *args, AttributeType *res) {
+    SnapshotService *p = static_cast<SnapshotService *>(parent_);
+    const char *base = 0;
+    if (args->size() > 2 && (*args)[2].is_string()) {
+        base = (*args)[2].to_string();
+    }
+    res->attr_free();
+    res->make_nil();
+    if (!p->isSimulationHalted()) {
+        generateError(res, "Halt simulation first");
+    } else if (!p->save((*args)[1].to_string(), base)) {
+        generateError(res, "Can't save snapshot");
+    }
+}
+
+CmdRestore::CmdRestore(IService *parent, uint64_t dmibar)
+    : ICommand("restore", dmibar, 0) {
+    parent_ = parent;
+    briefDescr_.make_string("Restore state of the halted platform from file");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Restore state saved by the 'save' command. Configuration of\n"
+        "    the platform must be the same.\n"
+        "Usage:\n"
+        "    restore filename\n"
+        "Example:\n"
+        "    restore boot.snap\n");
+}
+
+int CmdRestore::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() < 2 || !(*args)[1].is_string()) {
+        return CMD_WRONG_ARGS;
+    }
+    return CMD_VALID;
+}
+
+void CmdRestore::exec(AttributeType *args, AttributeType *res) {
+    SnapshotService *p = static_cast<SnapshotService *>(parent_);
+    res->attr_free();
+    res->make_nil();
+    if (!p->isSimulationHalted()) {
+        generateError(res, "Halt simulation first");
+    } else if (!p->restore((*args)[1].to_string())) {
+        generateError(res, "Can't restore snapshot");
+    }
+}
+
+
+SnapshotService::SnapshotService(const char *name) : IService(name),
+    cmdSave_(static_cast<IService *>(this), 0),
+    cmdRestore_(static_cast<IService *>(this), 0) {
+    registerAttribute("CmdExecutor", &cmdexec_);
+    iexec_ = 0;
+}
+
+SnapshotService::~SnapshotService() {
+}
+
+void SnapshotService::postinitService() {
+    iexec_ = static_cast<ICmdExecutor *>(
+            RISCV_get_service_iface(cmdexec_.to_string(),
+                                    IFACE_CMD_EXECUTOR));
+    if (!iexec_) {
+        RISCV_error("Can't get ICmdExecutor interface %s",
+                    cmdexec_.to_string());
+        return;
+    }
+    iexec_->registerCommand(&cmdSave_);
+    iexec_->registerCommand(&cmdRestore_);
+}
+
+void SnapshotService::predeleteService() {
+    if (iexec_) {
+        iexec_->unregisterCommand(&cmdSave_);
+        iexec_->unregisterCommand(&cmdRestore_);
+    }
+}
+
+bool SnapshotService::isSimulationHalted() {
+    AttributeType list;
+    RISCV_get_iface_list(IFACE_DPORT, &list);
+    for (unsigned i = 0; i < list.size(); i++) {
+        IDPort *idport = static_cast<IDPort *>(list[i].to_iface());
+        if (!idport->isHalted()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Registers ports of the service go before the service itself, so that
+ * on restore the service can rely on its registers values.
+ */
+bool SnapshotService::save(const char *filename, const char *basename) {
+    char fullname[4096];
+    char relbase[4096] = "";
+    if (!snapshot_full_path(filename, fullname, sizeof(fullname))) {
+        RISCV_error("Can't open '%s' file", filename);
+        return false;
+    }
+    SnapshotFile *base = 0;
+    if (basename && basename[0]) {
+        base = new SnapshotFile;
+        if (!base->load(basename)) {
+            delete base;
+            return false;
+        }
+        // The new file replaces the base that it refers to
+        if (base->isInChain(fullname)) {
+            RISCV_error("Base snapshot '%s' refers to the output file '%s'",
+                        basename, filename);
+            delete base;
+            return false;
+        }
+        snapshot_relative_path(fullname, base->getFileName(),
+                               relbase, sizeof(relbase));
+    }
+    // Restored memory may still map pages of the old file, so the new one
+    // is written aside and replaces it only when complete.
+    char tmpname[4096];
+    RISCV_sprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    FILE *f = fopen(tmpname, "wb");
+    if (f == NULL) {
+        RISCV_error("Can't open '%s' file", tmpname);
+        delete base;
+        return false;
+    }
+    uint64_t id = new_snapshot_id();
+    uint32_t baselen = static_cast<uint32_t>(strlen(relbase));
+    fwrite(SNAPSHOT_MAGIC, 1, sizeof(SNAPSHOT_MAGIC), f);
+    fwrite(&id, sizeof(id), 1, f);
+    fwrite(&baselen, sizeof(baselen), 1, f);
+    fwrite(relbase, 1, baselen, f);
+
+    SnapshotWriter w(f, base, id, sizeof(SNAPSHOT_MAGIC) + sizeof(id)
+                                  + sizeof(baselen) + baselen);
+    AttributeType servlist;
+    char secname[256];
+    int seccnt = 0;
+    RISCV_get_services_with_iface(IFACE_SERVICE, &servlist);
+    for (unsigned i = 0; i < servlist.size(); i++) {
+        IService *iserv = static_cast<IService *>(servlist[i].to_iface());
+        const AttributeType *ports = iserv->getPortList();
+        for (unsigned n = 0; n < ports->size(); n++) {
+            IFace *iface = (*ports)[n][1].to_iface();
+            if (strcmp(iface->getFaceName(), IFACE_SNAPSHOT) != 0) {
+                continue;
+            }
+            RISCV_sprintf(secname, sizeof(secname), "%s:%s",
+                          iserv->getObjName(), (*ports)[n][0u].to_string());
+            w.begin(secname);
+            static_cast<ISnapshot *>(iface)->saveSnapshot(&w);
+            w.end();
+            seccnt++;
+        }
+        ISnapshot *isnap = static_cast<ISnapshot *>(
+                iserv->getInterface(IFACE_SNAPSHOT));
+        if (isnap) {
+            w.begin(iserv->getObjName());
+            isnap->saveSnapshot(&w);
+            w.end();
+            seccnt++;
+        }
+    }
+    w.finish();
+    bool ret = ferror(f) == 0;
+    fclose(f);
+    delete base;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    if (ret) {
+        remove(filename);
+    }
+#endif
+    if (!ret || rename(tmpname, filename) != 0) {
+        RISCV_error("Can't write '%s' file", filename);
+        remove(tmpname);
+        return false;
+    }
+
+    RISCV_info("Snapshot %s: %d sections, %" RV_PRI64 "d memory pages",
+               filename, seccnt, w.getPages());
+    return ret;
+}
+
+bool SnapshotService::restore(const char *filename) {
+    SnapshotFile file;
+    if (!file.load(filename)) {
+        return false;
+    }
+    SnapshotReader r(&file);
+    AttributeType servlist;
+    char secname[256];
+    bool ret = true;
+    RISCV_get_services_with_iface(IFACE_SERVICE, &servlist);
+    for (unsigned i = 0; i < servlist.size(); i++) {
+        IService *iserv = static_cast<IService *>(servlist[i].to_iface());
+        const AttributeType *ports = iserv->getPortList();
+        for (unsigned n = 0; n < ports->size(); n++) {
+            IFace *iface = (*ports)[n][1].to_iface();
+            if (strcmp(iface->getFaceName(), IFACE_SNAPSHOT) != 0) {
+                continue;
+            }
+            RISCV_sprintf(secname, sizeof(secname), "%s:%s",
+                          iserv->getObjName(), (*ports)[n][0u].to_string());
+            if (!r.begin(secname)
+                || !static_cast<ISnapshot *>(iface)->restoreSnapshot(&r)) {
+                RISCV_error("Can't restore section %s", secname);
+                ret = false;
+            }
+        }
+        ISnapshot *isnap = static_cast<ISnapshot *>(
+                iserv->getInterface(IFACE_SNAPSHOT));
+        if (isnap) {
+            if (!r.begin(iserv->getObjName()) || !isnap->restoreSnapshot(&r)) {
+                RISCV_error("Can't restore section %s", iserv->getObjName());
+                ret = false;
+            }
+        }
+    }
+    return ret;
+}
+
+}  // namespace debugger
@@ -0,0 +1,142 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SERVICES_SNAPSHOT_SNAPSHOT_H__
+#define __DEBUGGER_SERVICES_SNAPSHOT_SNAPSHOT_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icmdexec.h"
+#include "coreservices/isnapshot.h"
+#include <stdio.h>
+
+namespace debugger {
+
+class CmdSave : public ICommand  {
+ public:
+    CmdSave(IService *parent, uint64_t dmibar);
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+
+ private:
+    IService *parent_;
+};
+
+class CmdRestore : public ICommand  {
+ public:
+    CmdRestore(IService *parent, uint64_t dmibar);
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+
+ private:
+    IService *parent_;
+};
+
+/**
+ * Parsed snapshot file with the chain of its base snapshots. File is
+ * mapped into memory and records are referenced in place.
+ */
+class SnapshotFile {
+ public:
+    SnapshotFile();
+    ~SnapshotFile();
+
+    bool load(const char *filename, int depth = 0);
+
+    /** Unique identifier stored in the file header */
+    uint64_t getId() { return id_; }
+    /** Absolute path of the loaded file */
+    const char *getFileName() { return filename_; }
+    /** The file or one of its bases is the file fullname */
+    bool isInChain(const char *fullname);
+
+    /** Data of the service section or 0 */
+    const uint8_t *getSection(const char *name, uint64_t *sz);
+    /** Image size or ~0ull if the image wasn't stored in this file */
+    uint64_t getImageSize(const char *name, unsigned ordinal);
+    /** Page content from this file or its bases, 0 means zero page */
+    const uint8_t *findPage(const char *name, unsigned ordinal,
+                            uint64_t pageidx);
+    /** Map pages of the whole chain into the reserved region */
+    bool mapImage(const char *name, unsigned ordinal, uint8_t *mem,
+                  uint64_t sz);
+
+ private:
+    struct SectionType {
+        const char *name;
+        uint32_t namelen;
+        const uint8_t *data;
+        uint64_t size;
+    };
+    struct ImageType {
+        const char *name;
+        uint32_t namelen;
+        unsigned ordinal;
+        uint64_t size;
+        uint64_t pagecnt;
+        uint64_t *pageidx;          // sorted
+        uint64_t dataoff;           // file offset of the first page
+    };
+
+    static bool nameEqual(const char *s, uint32_t len, const char *name);
+    ImageType *findImage(const char *name, unsigned ordinal);
+    bool parse(bool fill);
+
+ private:
+    char *filename_;
+    uint64_t id_;
+    uint8_t *mapped_;
+    uint64_t mapsz_;
+    SectionType *sections_;
+    unsigned sectionCnt_;
+    ImageType *images_;
+    unsigned imageCnt_;
+    SnapshotFile *base_;
+};
+
+class SnapshotService : public IService {
+ public:
+    explicit SnapshotService(const char *name);
+    virtual ~SnapshotService();
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** Common methods */
+    bool isSimulationHalted();
+    bool save(const char *filename, const char *basename);
+    bool restore(const char *filename);
+
+    static const uint64_t PAGE_SIZE = SnapshotWriteTracker::PAGE_SIZE;
+
+ private:
+    AttributeType cmdexec_;
+
+    ICmdExecutor *iexec_;
+    CmdSave cmdSave_;
+    CmdRestore cmdRestore_;
+};
+
+DECLARE_CLASS(SnapshotService)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SERVICES_SNAPSHOT_SNAPSHOT_H__
@@ -0,0 +1,125 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace_reader.h"
+
+using namespace debugger;
+
+static TraceBinRecordType recA;
+static TraceBinRecordType recB;
+static char outstr[1 << 16];
+
+static void printUsage() {
+    printf("Usage:\n");
+    printf("    rvtrace totext <trace.bin> [<output.log>]\n");
+    printf("        Convert binary trace into the text format\n");
+    printf("    rvtrace diff <ref.log|bin> <dut.log|bin> [options]\n");
+    printf("        Compare functional, binary or RTL Tracer traces\n");
+    printf("        --maxerr <n>    report up to n diverged records (1)\n");
+    printf("        --nosteps       don't compare step counters\n");
+    printf("        --nomemdata     compare only addresses of memops\n");
+}
+
+static int toText(const char *inname, const char *outname) {
+    TraceBinReader rd;
+    FILE *out = stdout;
+    if (!rd.open(inname)) {
+        printf("Error: can't open binary trace %s\n", inname);
+        return 2;
+    }
+    if (outname) {
+        out = fopen(outname, "wb");
+        if (!out) {
+            printf("Error: can't create %s\n", outname);
+            return 2;
+        }
+    }
+    while (rd.read(&recA)) {
+        trace_record_to_text(&recA, outstr, sizeof(outstr));
+        fputs(outstr, out);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+static int diff(const char *refname, const char *dutname,
+                int maxerr, int flags) {
+    TraceFileReader ref;
+    TraceFileReader dut;
+    uint64_t cnt = 0;
+    int errcnt = 0;
+    if (!ref.open(refname)) {
+        printf("Error: can't open %s\n", refname);
+        return 2;
+    }
+    if (!dut.open(dutname)) {
+        printf("Error: can't open %s\n", dutname);
+        return 2;
+    }
+    while (errcnt < maxerr) {
+        bool okA = ref.read(&recA);
+        bool okB = dut.read(&recB);
+        if (!okA || !okB) {
+            if (okA != okB) {
+                printf("Trace %s ended after %" RV_PRI64 "d records\n",
+                        okA ? dutname : refname, cnt);
+                errcnt++;
+            }
+            break;
+        }
+        if (!trace_record_match(&recA, &recB, flags)) {
+            printf("Diverged at record %" RV_PRI64 "d:\n", cnt);
+            trace_record_to_text(&recA, outstr, sizeof(outstr));
+            printf("< %s", outstr);
+            trace_record_to_text(&recB, outstr, sizeof(outstr));
+            printf("> %s", outstr);
+            errcnt++;
+        }
+        cnt++;
+    }
+    if (errcnt == 0) {
+        printf("Traces are equal: %" RV_PRI64 "d records\n", cnt);
+    }
+    return errcnt ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "totext") == 0) {
+        return toText(argv[2], argc > 3 ? argv[3] : 0);
+    }
+    if (argc >= 4 && strcmp(argv[1], "diff") == 0) {
+        int maxerr = 1;
+        int flags = TRACE_MATCH_STEPS | TRACE_MATCH_MEMDATA;
+        for (int i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "--maxerr") == 0 && i + 1 < argc) {
+                maxerr = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--nosteps") == 0) {
+                flags &= ~TRACE_MATCH_STEPS;
+            } else if (strcmp(argv[i], "--nomemdata") == 0) {
+                flags &= ~TRACE_MATCH_MEMDATA;
+            }
+        }
+        return diff(argv[2], argv[3], maxerr, flags);
+    }
+    printUsage();
+    return 2;
+}
@@ -0,0 +1,166 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <string.h>
+#include <stdlib.h>
+#include <riscv-isa.h>
+#include "trace_reader.h"
+
+namespace debugger {
+
+static const int REG_NAMES_TOTAL =
+    sizeof(RISCV_IREGS_NAMES) / sizeof(RISCV_IREGS_NAMES[0]);
+
+TraceFileReader::TraceFileReader() {
+    binary_ = false;
+    fl_ = 0;
+    line_valid_ = false;
+}
+
+TraceFileReader::~TraceFileReader() {
+    close();
+}
+
+bool TraceFileReader::open(const char *filename) {
+    binary_ = bin_.open(filename);
+    if (binary_) {
+        return true;
+    }
+    fl_ = fopen(filename, "rb");
+    line_valid_ = false;
+    return fl_ != 0;
+}
+
+void TraceFileReader::close() {
+    bin_.close();
+    if (fl_) {
+        fclose(fl_);
+        fl_ = 0;
+    }
+}
+
+/** Actions are aligned by 20 spaces, step counter uses 9 symbols */
+bool TraceFileReader::isActionLine() {
+    return strncmp(line_, "                    ", 20) == 0;
+}
+
+bool TraceFileReader::readTextLine() {
+    if (line_valid_) {
+        return true;
+    }
+    while (fgets(line_, sizeof(line_), fl_)) {
+        size_t len = strlen(line_);
+        while (len && (line_[len - 1] == '\n' || line_[len - 1] == '\r')) {
+            line_[--len] = '\0';
+        }
+        if (len) {
+            line_valid_ = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Action line formats:
+ *      "                     [addr] <= data"   store
+ *      "                     [addr] => data"   load
+ *      "                      name <= data"    register write
+ */
+bool TraceFileReader::parseAction(TraceBinRecordType *rec) {
+    char *p = line_;
+    while (*p == ' ') {
+        p++;
+    }
+    TraceBinRecordType::ActionType *pa = &rec->action[rec->action_cnt];
+    char *arrow = strstr(p, "<=");
+    bool load = false;
+    if (!arrow) {
+        arrow = strstr(p, "=>");
+        load = true;
+    }
+    if (!arrow) {
+        return false;
+    }
+    pa->data = strtoull(arrow + 2, 0, 16);
+    if (*p == '[') {
+        pa->memop = true;
+        pa->write = !load;
+        pa->addr = strtoull(p + 1, 0, 16);
+        pa->size = 0;           // unknown
+    } else {
+        char name[16];
+        int n = 0;
+        while (p[n] != ' ' && n < static_cast<int>(sizeof(name)) - 1) {
+            name[n] = p[n];
+            n++;
+        }
+        name[n] = '\0';
+        pa->memop = false;
+        pa->waddr = -1;
+        for (int i = 0; i < REG_NAMES_TOTAL; i++) {
+            if (strcmp(name, RISCV_IREGS_NAMES[i]) == 0) {
+                pa->waddr = i;
+                break;
+            }
+        }
+        if (pa->waddr < 0) {
+            return false;
+        }
+    }
+    if (rec->action_cnt < 63) {
+        rec->action_cnt++;
+    }
+    return true;
+}
+
+bool TraceFileReader::read(TraceBinRecordType *rec) {
+    if (binary_) {
+        return bin_.read(rec);
+    }
+    if (!fl_) {
+        return false;
+    }
+    // Instruction line: "%9d: %08x: disasm"
+    bool found = false;
+    while (!found && readTextLine()) {
+        char *p;
+        line_valid_ = false;
+        if (isActionLine()) {
+            continue;
+        }
+        rec->step_cnt = strtoull(line_, &p, 10);
+        if (p == line_ || p[0] != ':') {
+            continue;
+        }
+        rec->pc = strtoull(p + 1, &p, 16);
+        found = p[0] == ':';
+    }
+    if (!found) {
+        return false;
+    }
+    rec->instr = 0;
+    rec->isize = 0;
+    rec->action_cnt = 0;
+    while (readTextLine() && isActionLine()) {
+        line_valid_ = false;
+        parseAction(rec);
+    }
+    return true;
+}
+
+}  // namespace debugger
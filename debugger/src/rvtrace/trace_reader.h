@@ -0,0 +1,56 @@
+/*
+ *  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_RVTRACE_TRACE_READER_H__
+#define __DEBUGGER_SRC_RVTRACE_TRACE_READER_H__
+
+#include <stdio.h>
+#include "generic/trace_bin.h"
+
+namespace debugger {
+
+/**
+ * Reader of the binary trace or of the text trace generated by the
+ * functional model (trace_river_func.log) or by the RTL Tracer
+ * (trace_river_sysc*.log). Text record doesn't contain instruction
+ * word, so that isize is equal to 0.
+ */
+class TraceFileReader {
+ public:
+    TraceFileReader();
+    ~TraceFileReader();
+
+    bool open(const char *filename);
+    void close();
+    bool read(TraceBinRecordType *rec);
+    bool isBinary() { return binary_; }
+
+ private:
+    bool readTextLine();
+    bool isActionLine();
+    bool parseAction(TraceBinRecordType *rec);
+
+ private:
+    bool binary_;
+    TraceBinReader bin_;
+    FILE *fl_;
+    char line_[1024];
+    bool line_valid_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_RVTRACE_TRACE_READER_H__
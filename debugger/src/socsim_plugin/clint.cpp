@@ -26,8 +26,9 @@ CLINT::CLINT(const char *name) : RegMemBankGeneric(name),
     mtimecmp(static_cast<IService *>(this), "mtimecmp", 0x004000),
     mtime(static_cast<IService *>(this), "mtime", 0x00bff8) {
     registerInterface(static_cast<IIrqController *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("Clock", &clock_);
-    update_time_ = 0;
+    mtime_offset_ = 0;
 }
 
 void CLINT::postinitService() {
@@ -43,17 +44,16 @@ void CLINT::postinitService() {
 }
 
 void CLINT::setTimer(uint64_t v) {
-    update_time_ = iclk_->getStepCounter();
+    mtime_offset_ = v - iclk_->getStepCounter();
     mtime.setValue(v);
 }
 
+/**
+ * Timer value is computed from the clock without accumulation, so that
+ * harts running in parallel threads may update it simultaneously.
+ */
 void CLINT::updateTimer() {
-    uint64_t cur_time = iclk_->getStepCounter();
-    uint64_t dt = cur_time - update_time_;
-    uint64_t t = mtime.getValue().val;
-
-    update_time_ = cur_time;
-    mtime.setValue(t + dt);
+    mtime.setValue(mtime_offset_ + iclk_->getStepCounter());
 }
 
 int CLINT::getPendingRequest(int ctxid) {
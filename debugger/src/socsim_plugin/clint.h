@@ -21,6 +21,7 @@
 #include "coreservices/imemop.h"
 #include "coreservices/iirq.h"
 #include "coreservices/iclock.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
 #include "generic/rmembank_gen1.h"
 
@@ -29,7 +30,8 @@ namespace debugger {
 static const int CLINT_HART_MAX = 4096;
 
 class CLINT : public RegMemBankGeneric,
-              public IIrqController {
+              public IIrqController,
+              public ISnapshot {
  public:
     explicit CLINT(const char *name);
 
@@ -40,6 +42,15 @@ class CLINT : public RegMemBankGeneric,
     virtual int requestInterrupt(IFace *isrc, int idx) { return 0; }
     virtual int getPendingRequest(int ctxid);
 
+    /** ISnapshot: registers are stored by their ports */
+    virtual void saveSnapshot(ISnapshotStream *s) {
+        s->writeUInt64(mtime_offset_);
+    }
+    virtual bool restoreSnapshot(ISnapshotStream *s) {
+        mtime_offset_ = s->readUInt64();
+        return true;
+    }
+
  private:
     void setTimer(uint64_t v);
     void updateTimer();
@@ -78,7 +89,7 @@ class CLINT : public RegMemBankGeneric,
     CLINT_MTIMECMP_TYPE mtimecmp;    // [004000..007fff] 1 register (8-Bytes) per hart
     CLINT_MTIME_TYPE mtime;          // [00bff8] 1 register for all hart
 
-    uint64_t update_time_;          // Last time when mtime was updated
+    uint64_t mtime_offset_;         // mtime minus clock step counter
 };
 
 DECLARE_CLASS(CLINT)
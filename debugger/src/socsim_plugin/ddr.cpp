@@ -21,71 +21,39 @@ namespace debugger {
 
 DDR::DDR(const char *name) : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
-    mem_.bid = 0;
-    mem_.prv = 0;
-    mem_.nxt = 0;
-    memset(mem_.m, 0, sizeof(mem_.m));
+    registerInterface(static_cast<ISnapshot *>(this));
+    mem_ = 0;
+    memsize_ = 0;
 }
 
 DDR::~DDR() {
-    MemBlockType *t = mem_.nxt;
-    MemBlockType *t2;
-    while (t) {
-        t2 = t->nxt;
-        delete t;
-        t = t2;
-    }
+    RISCV_memory_release(mem_, memsize_);
 }
 
+/**
+ * Whole bank is reserved at once: pages that the software never touches
+ * are not committed and read as zeros.
+ */
 void DDR::postinitService() {
+    memsize_ = length_.to_uint64();
+    mem_ = static_cast<uint8_t *>(RISCV_memory_reserve(memsize_));
+    written_.init(memsize_);
 }
 
 ETransStatus DDR::b_transport(Axi4TransactionType *trans) {
-    uint64_t off = trans->addr - getBaseAddress();
-    uint8_t *data = getpMem(off);
+    if (mem_ == 0) {
+        trans->response = MemResp_Error;
+        return TRANS_ERROR;
+    }
+    uint64_t off = (trans->addr - getBaseAddress()) % memsize_;
+    trans->response = MemResp_Valid;
     if (trans->action == MemAction_Read) {
-        memcpy(trans->rpayload.b8, data, trans->xsize);
+        memcpy(trans->rpayload.b8, &mem_[off], trans->xsize);
     } else {
-        memcpy(data, trans->wpayload.b8, trans->xsize);
+        memcpy(&mem_[off], trans->wpayload.b8, trans->xsize);
+        written_.setWritten(off, trans->xsize);
     }
     return TRANS_OK;
 }
 
-uint8_t *DDR::getpMem(uint64_t addr) {
-    MemBlockType *b = &mem_;
-    uint64_t bid = addr >> 10;
-    uint8_t *ret;
-    while (b->nxt && bid > b->bid) {
-        b = b->nxt;
-    }
-
-    if (b->bid < bid) {
-        MemBlockType *pnew = new MemBlockType;
-        pnew->bid = bid;
-        memset(pnew->m, 0, sizeof(pnew->m));
-        pnew->nxt = b->nxt;
-        pnew->prv = b;
-        b->nxt = pnew;
-        if (pnew->nxt) {
-            pnew->nxt->prv = pnew;
-        }
-        b = pnew;
-    } else if (b->bid == bid) {
-        // Do nothing
-    } else {
-        MemBlockType *pnew = new MemBlockType;
-        pnew->bid = bid;
-        memset(pnew->m, 0, sizeof(pnew->m));
-        pnew->prv = b->prv;
-        pnew->nxt = b;
-        b->prv = pnew;
-        if (pnew->prv) {
-            pnew->prv->nxt = pnew;
-        }
-        b = pnew;
-    }
-    ret = &b->m[addr & 0x3FF];
-    return ret;
-}
-
 }  // namespace debugger
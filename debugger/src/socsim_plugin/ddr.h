@@ -19,11 +19,13 @@
 #include "iclass.h"
 #include "iservice.h"
 #include "coreservices/imemop.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class DDR : public IService, 
-            public IMemoryOperation {
+            public IMemoryOperation,
+            public ISnapshot {
  public:
     explicit DDR(const char *name);
     virtual ~DDR();
@@ -33,19 +35,25 @@ class DDR : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
-
- private:
-    virtual uint8_t *getpMem(uint64_t addr);
+    virtual bool isThreadSafe() { return true; }
+
+    /** ISnapshot */
+    virtual void saveSnapshot(ISnapshotStream *s) {
+        s->writeImage(mem_, memsize_, &written_);
+        written_.reset(s->getSnapshotId());
+    }
+    virtual bool restoreSnapshot(ISnapshotStream *s) {
+        if (!s->mapImage(mem_, memsize_)) {
+            return false;
+        }
+        written_.reset(s->getSnapshotId());
+        return true;
+    }
 
  protected:
-    static const int BLOCK_SIZE = 1024*1024;
-
-    struct MemBlockType {
-        MemBlockType *nxt;
-        MemBlockType *prv;
-        uint64_t bid;
-        uint8_t m[BLOCK_SIZE];
-    } mem_;
+    uint8_t *mem_;              // lazily committed, see RISCV_memory_reserve
+    uint64_t memsize_;
+    SnapshotWriteTracker written_;
 };
 
 DECLARE_CLASS(DDR)
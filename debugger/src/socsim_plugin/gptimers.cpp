@@ -12,6 +12,7 @@ namespace debugger {
 
 GPTimers::GPTimers(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<IClockListener *>(this));
     registerAttribute("IrqControl", &irqctrl_);
     registerAttribute("ClkSource", &clksrc_);
 
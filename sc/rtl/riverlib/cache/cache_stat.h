@@ -0,0 +1,44 @@
+// 
+//  Copyright 2022 Sergey Khabarov, sergeykhbr@gmail.com
+// 
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+// 
+//      http://www.apache.org/licenses/LICENSE-2.0
+// 
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// 
+#pragma once
+
+#include <inttypes.h>
+
+namespace debugger {
+
+// @brief Simulation-only cache counters, not a part of the hardware.
+// @details Counters are updated in registers() on the clock edge, so the
+//          delta cycles of comb() don't change them. River keeps one
+//          outstanding miss per cache (no MSHR), so mem_stalls counts clocks
+//          spent waiting for the memory bus.
+struct CacheStatType {
+    uint64_t hits;                                          // lookups served from the cache
+    uint64_t misses;                                        // lookups served from the memory
+    uint64_t writebacks;                                    // dirty lines offloaded on eviction or flush
+    uint64_t snoop_hits;                                    // snoop requests that found a valid line
+    uint64_t mem_stalls;                                    // clocks waiting for grant or response
+};
+
+class ICacheStat {
+ public:
+    virtual ~ICacheStat() {}
+
+    virtual const CacheStatType *getCacheStat() = 0;
+    virtual void clearCacheStat() = 0;
+};
+
+}  // namespace debugger
+
@@ -81,7 +81,9 @@ CacheTop::CacheTop(sc_module_name name,
     i_flushi_addr("i_flushi_addr"),
     i_flushd_valid("i_flushd_valid"),
     i_flushd_addr("i_flushd_addr"),
-    o_flushd_end("o_flushd_end") {
+    o_flushd_end("o_flushd_end"),
+    o_icache_miss("o_icache_miss"),
+    o_dcache_miss("o_dcache_miss") {
 
     async_reset_ = async_reset;
     coherence_ena_ = coherence_ena;
@@ -121,6 +123,7 @@ CacheTop::CacheTop(sc_module_name name,
     i1->i_pmp_x(w_pmp_x);
     i1->i_flush_address(wb_i_flushi_addr);
     i1->i_flush_valid(i_flushi_valid);
+    i1->o_miss(o_icache_miss);
 
 
     d0 = new DCacheLru("d0", async_reset, dlog2_nways, dlog2_lines_per_way, coherence_ena);
@@ -165,6 +168,7 @@ CacheTop::CacheTop(sc_module_name name,
     d0->i_flush_address(wb_i_flushd_addr);
     d0->i_flush_valid(i_flushd_valid);
     d0->o_flush_end(o_flushd_end);
+    d0->o_miss(o_dcache_miss);
 
 
     pma0 = new PMA("pma0");
@@ -350,6 +354,8 @@ void CacheTop::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, i_flushd_valid, i_flushd_valid.name());
         sc_trace(o_vcd, i_flushd_addr, i_flushd_addr.name());
         sc_trace(o_vcd, o_flushd_end, o_flushd_end.name());
+        sc_trace(o_vcd, o_icache_miss, o_icache_miss.name());
+        sc_trace(o_vcd, o_dcache_miss, o_dcache_miss.name());
     }
 
     if (i1) {
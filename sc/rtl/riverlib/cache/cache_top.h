@@ -88,6 +88,9 @@ SC_MODULE(CacheTop) {
     sc_in<bool> i_flushd_valid;
     sc_in<sc_uint<RISCV_ARCH>> i_flushd_addr;
     sc_out<bool> o_flushd_end;
+    // Performance counters events:
+    sc_out<bool> o_icache_miss;                             // I$ line miss
+    sc_out<bool> o_dcache_miss;                             // D$ line miss
 
     void comb();
 
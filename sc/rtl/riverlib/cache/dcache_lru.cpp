@@ -16,6 +16,7 @@
 
 #include "dcache_lru.h"
 #include "api_core.h"
+#include <string.h>
 
 namespace debugger {
 
@@ -65,7 +66,8 @@ DCacheLru::DCacheLru(sc_module_name name,
     o_resp_snoop_flags("o_resp_snoop_flags"),
     i_flush_address("i_flush_address"),
     i_flush_valid("i_flush_valid"),
-    o_flush_end("o_flush_end") {
+    o_flush_end("o_flush_end"),
+    o_miss("o_miss") {
 
     async_reset_ = async_reset;
     waybits_ = waybits;
@@ -75,29 +77,19 @@ DCacheLru::DCacheLru(sc_module_name name,
     FLUSH_ALL_VALUE = ((1 << (ibits + waybits)) - 1);
     mem0 = 0;
 
-    mem0 = new TagMemNWay<abus,
-                          2,
-                          7,
-                          lnbits,
-                          flbits,
-                          1>("mem0", async_reset);
-    mem0->i_clk(i_clk);
-    mem0->i_nrst(i_nrst);
-    mem0->i_direct_access(line_direct_access_i);
-    mem0->i_invalidate(line_invalidate_i);
-    mem0->i_re(line_re_i);
-    mem0->i_we(line_we_i);
-    mem0->i_addr(line_addr_i);
-    mem0->i_wdata(line_wdata_i);
-    mem0->i_wstrb(line_wstrb_i);
-    mem0->i_wflags(line_wflags_i);
-    mem0->o_raddr(line_raddr_o);
-    mem0->o_rdata(line_rdata_o);
-    mem0->o_rflags(line_rflags_o);
-    mem0->o_hit(line_hit_o);
-    mem0->i_snoop_addr(line_snoop_addr_i);
-    mem0->o_snoop_ready(line_snoop_ready_o);
-    mem0->o_snoop_flags(line_snoop_flags_o);
+    mem0VCD_ = 0;
+    clearCacheStat();
+
+    // Tag memory is a template, instantiate the one requested at startup
+    switch (waybits) {
+    case 1: createTagMemWays<1>(ibits); break;
+    case 2: createTagMemWays<2>(ibits); break;
+    case 3: createTagMemWays<3>(ibits); break;
+    default:;
+    }
+    if (mem0 == 0) {
+        SC_REPORT_ERROR(this->name(), "Unsupported D$ geometry");
+    }
 
 
 
@@ -178,6 +170,98 @@ DCacheLru::~DCacheLru() {
     }
 }
 
+template<int waybits>
+void DCacheLru::createTagMemWays(uint32_t ibits) {
+    switch (ibits) {
+    case 6: createTagMem<waybits, 6>(); break;
+    case 7: createTagMem<waybits, 7>(); break;
+    case 8: createTagMem<waybits, 8>(); break;
+    case 9: createTagMem<waybits, 9>(); break;
+    default:;
+    }
+}
+
+template<int waybits, int ibits>
+void DCacheLru::createTagMem() {
+    TagMemNWay<abus, waybits, ibits, lnbits, flbits, 1> *p;
+    p = new TagMemNWay<abus, waybits, ibits, lnbits, flbits, 1>("mem0", async_reset_);
+    p->i_clk(i_clk);
+    p->i_nrst(i_nrst);
+    p->i_direct_access(line_direct_access_i);
+    p->i_invalidate(line_invalidate_i);
+    p->i_re(line_re_i);
+    p->i_we(line_we_i);
+    p->i_addr(line_addr_i);
+    p->i_wdata(line_wdata_i);
+    p->i_wstrb(line_wstrb_i);
+    p->i_wflags(line_wflags_i);
+    p->o_raddr(line_raddr_o);
+    p->o_rdata(line_rdata_o);
+    p->o_rflags(line_rflags_o);
+    p->o_hit(line_hit_o);
+    p->i_snoop_addr(line_snoop_addr_i);
+    p->o_snoop_ready(line_snoop_ready_o);
+    p->o_snoop_flags(line_snoop_flags_o);
+    mem0 = p;
+    mem0VCD_ = &DCacheLru::generateTagMemVCD<waybits, ibits>;
+}
+
+template<int waybits, int ibits>
+void DCacheLru::generateTagMemVCD(sc_module *mem, sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
+    static_cast<TagMemNWay<abus, waybits, ibits, lnbits, flbits, 1> *>(mem)->generateVCD(i_vcd, o_vcd);
+}
+
+void DCacheLru::clearCacheStat() {
+    memset(&stat_, 0, sizeof(stat_));
+    stat_miss_ = false;
+}
+
+void DCacheLru::updateCacheStat() {
+    if (i_nrst.read() == 0) {
+        stat_miss_ = false;
+        return;
+    }
+    switch (r.state.read()) {
+    case State_CheckHit:
+        if (line_hit_o.read() == 0) {
+            if (!stat_miss_) {
+                stat_.misses++;
+                stat_miss_ = true;
+            }
+        } else if (i_resp_ready.read() == 1) {
+            if (!stat_miss_) {
+                stat_.hits++;
+            }
+            stat_miss_ = false;
+        }
+        break;
+    case State_WaitGrant:
+        if ((i_req_mem_ready.read() == 1)
+                && ((r.write_first.read() == 1) || (r.write_flush.read() == 1))) {
+            stat_.writebacks++;
+        }
+        stat_.mem_stalls++;
+        break;
+    case State_WaitResp:
+    case State_WriteBus:
+        stat_.mem_stalls++;
+        break;
+    case State_SnoopReadData:
+        if (line_rflags_o.read()[TAG_FL_VALID] == 1) {
+            stat_.snoop_hits++;
+        }
+        break;
+    default:;
+    }
+    if ((r.snoop_flags_valid.read() == 1)
+            && (line_snoop_flags_o.read()[TAG_FL_VALID] == 1)) {
+        stat_.snoop_hits++;
+    }
+    if (v.state.read() == State_Idle) {
+        stat_miss_ = false;
+    }
+}
+
 void DCacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     std::string pn(name());
     if (o_vcd) {
@@ -220,6 +304,7 @@ void DCacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, i_flush_address, i_flush_address.name());
         sc_trace(o_vcd, i_flush_valid, i_flush_valid.name());
         sc_trace(o_vcd, o_flush_end, o_flush_end.name());
+        sc_trace(o_vcd, o_miss, o_miss.name());
         sc_trace(o_vcd, r.req_type, pn + ".r_req_type");
         sc_trace(o_vcd, r.req_addr, pn + ".r_req_addr");
         sc_trace(o_vcd, r.req_wdata, pn + ".r_req_wdata");
@@ -250,7 +335,7 @@ void DCacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     }
 
     if (mem0) {
-        mem0->generateVCD(i_vcd, o_vcd);
+        mem0VCD_(mem0, i_vcd, o_vcd);
     }
 }
 
@@ -284,6 +369,7 @@ void DCacheLru::comb() {
     bool v_resp_snoop_valid;
     sc_uint<CFG_CPU_ADDR_BITS> vb_addr_direct_next;
     sc_uint<MemopType_Total> t_req_type;
+    bool v_miss;
 
     vb_cache_line_i_modified = 0;
     vb_line_rdata_o_modified = 0;
@@ -314,6 +400,7 @@ void DCacheLru::comb() {
     v_resp_snoop_valid = 0;
     vb_addr_direct_next = 0;
     t_req_type = 0;
+    v_miss = 0;
 
     v = r;
 
@@ -433,6 +520,7 @@ void DCacheLru::comb() {
             }
         } else {
             // Miss
+            v_miss = 1;
             if ((r.req_type.read()[MemopType_Store] == 1)
                     && (r.req_type.read()[MemopType_Release] == 1)) {
                 vb_resp_data = 1;                           // return error. Cannot store into unreserved cache line
@@ -764,9 +852,13 @@ void DCacheLru::comb() {
     o_resp_snoop_flags = line_snoop_flags_o;
 
     o_flush_end = v_flush_end;
+    o_miss = v_miss;
 }
 
 void DCacheLru::registers() {
+    if (i_clk.posedge()) {
+        updateCacheStat();
+    }
     if (async_reset_ && i_nrst.read() == 0) {
         DCacheLru_r_reset(r);
     } else {
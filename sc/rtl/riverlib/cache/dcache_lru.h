@@ -18,10 +18,11 @@
 #include <systemc.h>
 #include "../river_cfg.h"
 #include "tagmemnway.h"
+#include "cache_stat.h"
 
 namespace debugger {
 
-SC_MODULE(DCacheLru) {
+SC_MODULE(DCacheLru), public ICacheStat {
  public:
     sc_in<bool> i_clk;                                      // CPU clock
     sc_in<bool> i_nrst;                                     // Reset: active LOW
@@ -69,6 +70,7 @@ SC_MODULE(DCacheLru) {
     sc_in<sc_uint<CFG_CPU_ADDR_BITS>> i_flush_address;
     sc_in<bool> i_flush_valid;
     sc_out<bool> o_flush_end;
+    sc_out<bool> o_miss;                                    // Line miss pulse (performance counter event)
 
     void comb();
     void registers();
@@ -84,6 +86,17 @@ SC_MODULE(DCacheLru) {
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
 
+    // ICacheStat
+    virtual const CacheStatType *getCacheStat() { return &stat_; }
+    virtual void clearCacheStat();
+
+ private:
+    template<int waybits> void createTagMemWays(uint32_t ibits);
+    template<int waybits, int ibits> void createTagMem();
+    template<int waybits, int ibits>
+    static void generateTagMemVCD(sc_module *mem, sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    void updateCacheStat();
+
  private:
     bool async_reset_;
     uint32_t waybits_;
@@ -190,7 +203,10 @@ SC_MODULE(DCacheLru) {
     sc_signal<bool> line_snoop_ready_o;
     sc_signal<sc_uint<DTAG_FL_TOTAL>> line_snoop_flags_o;
 
-    TagMemNWay<abus, 2, 7, lnbits, flbits, 1> *mem0;
+    sc_module *mem0;                                        // TagMemNWay of the selected geometry
+    void (*mem0VCD_)(sc_module *, sc_trace_file *, sc_trace_file *);
+    CacheStatType stat_;
+    bool stat_miss_;                                        // current lookup was counted as a miss
 
 };
 
@@ -16,6 +16,7 @@
 
 #include "icache_lru.h"
 #include "api_core.h"
+#include <string.h>
 
 namespace debugger {
 
@@ -48,7 +49,8 @@ ICacheLru::ICacheLru(sc_module_name name,
     i_pma_cached("i_pma_cached"),
     i_pmp_x("i_pmp_x"),
     i_flush_address("i_flush_address"),
-    i_flush_valid("i_flush_valid") {
+    i_flush_valid("i_flush_valid"),
+    o_miss("o_miss") {
 
     async_reset_ = async_reset;
     waybits_ = waybits;
@@ -57,26 +59,18 @@ ICacheLru::ICacheLru(sc_module_name name,
     FLUSH_ALL_VALUE = ((1 << (ibits + waybits)) - 1);
     mem0 = 0;
 
-    mem0 = new TagMemCoupled<abus,
-                             2,
-                             7,
-                             lnbits,
-                             flbits>("mem0", async_reset);
-    mem0->i_clk(i_clk);
-    mem0->i_nrst(i_nrst);
-    mem0->i_direct_access(line_direct_access_i);
-    mem0->i_invalidate(line_invalidate_i);
-    mem0->i_re(line_re_i);
-    mem0->i_we(line_we_i);
-    mem0->i_addr(line_addr_i);
-    mem0->i_wdata(line_wdata_i);
-    mem0->i_wstrb(line_wstrb_i);
-    mem0->i_wflags(line_wflags_i);
-    mem0->o_raddr(line_raddr_o);
-    mem0->o_rdata(line_rdata_o);
-    mem0->o_rflags(line_rflags_o);
-    mem0->o_hit(line_hit_o);
-    mem0->o_hit_next(line_hit_next_o);
+    clearCacheStat();
+
+    // Tag memory is a template, instantiate the one requested at startup
+    switch (waybits) {
+    case 1: createTagMemWays<1>(ibits); break;
+    case 2: createTagMemWays<2>(ibits); break;
+    case 3: createTagMemWays<3>(ibits); break;
+    default:;
+    }
+    if (mem0 == 0) {
+        SC_REPORT_ERROR(this->name(), "Unsupported I$ geometry");
+    }
 
 
 
@@ -133,6 +127,74 @@ ICacheLru::~ICacheLru() {
     }
 }
 
+template<int waybits>
+void ICacheLru::createTagMemWays(uint32_t ibits) {
+    switch (ibits) {
+    case 6: createTagMem<waybits, 6>(); break;
+    case 7: createTagMem<waybits, 7>(); break;
+    case 8: createTagMem<waybits, 8>(); break;
+    case 9: createTagMem<waybits, 9>(); break;
+    default:;
+    }
+}
+
+template<int waybits, int ibits>
+void ICacheLru::createTagMem() {
+    TagMemCoupled<abus, waybits, ibits, lnbits, flbits> *p;
+    p = new TagMemCoupled<abus, waybits, ibits, lnbits, flbits>("mem0", async_reset_);
+    p->i_clk(i_clk);
+    p->i_nrst(i_nrst);
+    p->i_direct_access(line_direct_access_i);
+    p->i_invalidate(line_invalidate_i);
+    p->i_re(line_re_i);
+    p->i_we(line_we_i);
+    p->i_addr(line_addr_i);
+    p->i_wdata(line_wdata_i);
+    p->i_wstrb(line_wstrb_i);
+    p->i_wflags(line_wflags_i);
+    p->o_raddr(line_raddr_o);
+    p->o_rdata(line_rdata_o);
+    p->o_rflags(line_rflags_o);
+    p->o_hit(line_hit_o);
+    p->o_hit_next(line_hit_next_o);
+    mem0 = p;
+}
+
+void ICacheLru::clearCacheStat() {
+    memset(&stat_, 0, sizeof(stat_));
+    stat_miss_ = false;
+}
+
+void ICacheLru::updateCacheStat() {
+    if (i_nrst.read() == 0) {
+        stat_miss_ = false;
+        return;
+    }
+    switch (r.state.read()) {
+    case State_CheckHit:
+        if ((line_hit_o.read() == 0) || (line_hit_next_o.read() == 0)) {
+            if (!stat_miss_) {
+                stat_.misses++;
+                stat_miss_ = true;
+            }
+        } else if (i_resp_ready.read() == 1) {
+            if (!stat_miss_) {
+                stat_.hits++;
+            }
+            stat_miss_ = false;
+        }
+        break;
+    case State_WaitGrant:
+    case State_WaitResp:
+        stat_.mem_stalls++;
+        break;
+    default:;
+    }
+    if (v.state.read() == State_Idle) {
+        stat_miss_ = false;
+    }
+}
+
 void ICacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     std::string pn(name());
     if (o_vcd) {
@@ -159,6 +221,7 @@ void ICacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, i_pmp_x, i_pmp_x.name());
         sc_trace(o_vcd, i_flush_address, i_flush_address.name());
         sc_trace(o_vcd, i_flush_valid, i_flush_valid.name());
+        sc_trace(o_vcd, o_miss, o_miss.name());
         sc_trace(o_vcd, r.req_addr, pn + ".r_req_addr");
         sc_trace(o_vcd, r.req_addr_next, pn + ".r_req_addr_next");
         sc_trace(o_vcd, r.write_addr, pn + ".r_write_addr");
@@ -198,6 +261,7 @@ void ICacheLru::comb() {
     int sel_uncached;
     bool v_ready_next;
     sc_uint<CFG_CPU_ADDR_BITS> vb_addr_direct_next;
+    bool v_miss;
 
     t_cache_line_i = 0;
     v_req_ready = 0;
@@ -218,6 +282,7 @@ void ICacheLru::comb() {
     sel_uncached = 0;
     v_ready_next = 0;
     vb_addr_direct_next = 0;
+    v_miss = 0;
 
     v = r;
 
@@ -264,6 +329,7 @@ void ICacheLru::comb() {
             }
         } else {
             // Miss
+            v_miss = 1;
             v.state = State_TranslateAddress;
         }
         break;
@@ -424,9 +490,13 @@ void ICacheLru::comb() {
     o_resp_addr = r.req_addr;
     o_resp_load_fault = v_resp_er_load_fault;
     o_mpu_addr = r.req_addr;
+    o_miss = v_miss;
 }
 
 void ICacheLru::registers() {
+    if (i_clk.posedge()) {
+        updateCacheStat();
+    }
     if (async_reset_ && i_nrst.read() == 0) {
         ICacheLru_r_reset(r);
     } else {
@@ -18,10 +18,11 @@
 #include <systemc.h>
 #include "../river_cfg.h"
 #include "tagmemcoupled.h"
+#include "cache_stat.h"
 
 namespace debugger {
 
-SC_MODULE(ICacheLru) {
+SC_MODULE(ICacheLru), public ICacheStat {
  public:
     sc_in<bool> i_clk;                                      // CPU clock
     sc_in<bool> i_nrst;                                     // Reset: active LOW
@@ -52,6 +53,7 @@ SC_MODULE(ICacheLru) {
     // Flush interface
     sc_in<sc_uint<CFG_CPU_ADDR_BITS>> i_flush_address;
     sc_in<bool> i_flush_valid;
+    sc_out<bool> o_miss;                                    // Line miss pulse (performance counter event)
 
     void comb();
     void registers();
@@ -66,6 +68,15 @@ SC_MODULE(ICacheLru) {
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
 
+    // ICacheStat
+    virtual const CacheStatType *getCacheStat() { return &stat_; }
+    virtual void clearCacheStat();
+
+ private:
+    template<int waybits> void createTagMemWays(uint32_t ibits);
+    template<int waybits, int ibits> void createTagMem();
+    void updateCacheStat();
+
  private:
     bool async_reset_;
     uint32_t waybits_;
@@ -141,7 +152,9 @@ SC_MODULE(ICacheLru) {
     sc_signal<bool> line_hit_o;
     sc_signal<bool> line_hit_next_o;
 
-    TagMemCoupled<abus, 2, 7, lnbits, flbits> *mem0;
+    sc_module *mem0;                                        // TagMemCoupled of the selected geometry
+    CacheStatType stat_;
+    bool stat_miss_;                                        // current lookup was counted as a miss
 
 };
 
@@ -49,6 +49,7 @@ CsrRegs::CsrRegs(sc_module_name name,
     i_m_idle("i_m_idle"),
     i_flushd_end("i_flushd_end"),
     i_mtimer("i_mtimer"),
+    i_hpm_events("i_hpm_events"),
     o_executed_cnt("o_executed_cnt"),
     o_step("o_step"),
     i_dbg_progbuf_ena("i_dbg_progbuf_ena"),
@@ -94,6 +95,7 @@ CsrRegs::CsrRegs(sc_module_name name,
     sensitive << i_m_idle;
     sensitive << i_flushd_end;
     sensitive << i_mtimer;
+    sensitive << i_hpm_events;
     sensitive << i_dbg_progbuf_ena;
     for (int i = 0; i < 4; i++) {
         sensitive << r.xmode[i].xepc;
@@ -116,6 +118,10 @@ CsrRegs::CsrRegs(sc_module_name name,
         sensitive << r.pmp[i].addr;
         sensitive << r.pmp[i].mask;
     }
+    for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+        sensitive << r.hpm[i].event;
+        sensitive << r.hpm[i].cnt;
+    }
     sensitive << r.state;
     sensitive << r.fencestate;
     sensitive << r.irq_pending;
@@ -202,6 +208,7 @@ void CsrRegs::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, i_m_idle, i_m_idle.name());
         sc_trace(o_vcd, i_flushd_end, i_flushd_end.name());
         sc_trace(o_vcd, i_mtimer, i_mtimer.name());
+        sc_trace(o_vcd, i_hpm_events, i_hpm_events.name());
         sc_trace(o_vcd, o_executed_cnt, o_executed_cnt.name());
         sc_trace(o_vcd, o_step, o_step.name());
         sc_trace(o_vcd, i_dbg_progbuf_ena, i_dbg_progbuf_ena.name());
@@ -265,6 +272,13 @@ void CsrRegs::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
             RISCV_sprintf(tstr, sizeof(tstr), "%s.r_pmp%d_mask", pn.c_str(), i);
             sc_trace(o_vcd, r.pmp[i].mask, tstr);
         }
+        for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+            char tstr[1024];
+            RISCV_sprintf(tstr, sizeof(tstr), "%s.r_hpm%d_event", pn.c_str(), i);
+            sc_trace(o_vcd, r.hpm[i].event, tstr);
+            RISCV_sprintf(tstr, sizeof(tstr), "%s.r_hpm%d_cnt", pn.c_str(), i);
+            sc_trace(o_vcd, r.hpm[i].cnt, tstr);
+        }
         sc_trace(o_vcd, r.state, pn + ".r_state");
         sc_trace(o_vcd, r.fencestate, pn + ".r_fencestate");
         sc_trace(o_vcd, r.irq_pending, pn + ".r_irq_pending");
@@ -358,6 +372,8 @@ void CsrRegs::comb() {
     bool v_napot_shift;
     int t_pmpdataidx;
     int t_pmpcfgidx;
+    sc_uint<HPM_EVENT_Total> vb_hpm_events;
+    int t_hpmidx;
 
     iM = PRV_M;
     iH = PRV_H;
@@ -394,6 +410,8 @@ void CsrRegs::comb() {
     v_napot_shift = 0;
     t_pmpdataidx = 0;
     t_pmpcfgidx = 0;
+    vb_hpm_events = 0;
+    t_hpmidx = 0;
 
     for (int i = 0; i < 4; i++) {
         v.xmode[i].xepc = r.xmode[i].xepc;
@@ -416,6 +434,10 @@ void CsrRegs::comb() {
         v.pmp[i].addr = r.pmp[i].addr;
         v.pmp[i].mask = r.pmp[i].mask;
     }
+    for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+        v.hpm[i].event = r.hpm[i].event;
+        v.hpm[i].cnt = r.hpm[i].cnt;
+    }
     v.state = r.state;
     v.fencestate = r.fencestate;
     v.irq_pending = r.irq_pending;
@@ -474,6 +496,8 @@ void CsrRegs::comb() {
     vb_pmp_upd_ena = r.pmp_upd_ena;
     t_pmpdataidx = (r.cmd_addr.read().to_int() - 0x3B0);
     t_pmpcfgidx = (8 * r.cmd_addr.read()(3, 1).to_int());
+    t_hpmidx = (r.cmd_addr.read()(4, 0).to_int() - 3);     // the same for mhpmevent, mhpmcounter and hpmcounter
+    vb_hpm_events = i_hpm_events;
     vb_pmp_napot_mask = 0x7;
 
     vb_xtvec_off_edeleg = r.xmode[iM].xtvec_off;
@@ -544,6 +568,7 @@ void CsrRegs::comb() {
     case State_Exception:
         v.state = State_Response;
         vb_e_emux[r.cmd_addr.read()(4, 0).to_int()] = 1;
+        vb_hpm_events[HPM_EVENT_Exception] = 1;
         vb_xtval = r.cmd_data;
         wb_trap_cause = r.cmd_addr.read()(4, 0);
         v.cmd_data = vb_xtvec_off_edeleg;
@@ -565,6 +590,7 @@ void CsrRegs::comb() {
             v.cmd_data = ~0ull;                             // signal to executor to switch into Debug Mode and halt
         } else {
             vb_e_emux[EXCEPTION_Breakpoint] = 1;
+            vb_hpm_events[HPM_EVENT_Exception] = 1;
             wb_trap_cause = r.cmd_addr.read()(4, 0);
             vb_xtval = i_e_pc;
             v.cmd_data = vb_xtvec_off_edeleg;               // Jump to exception handler
@@ -586,6 +612,7 @@ void CsrRegs::comb() {
     case State_Interrupt:
         v.state = State_Response;
         vb_e_imux[r.cmd_addr.read()(3, 0).to_int()] = 1;
+        vb_hpm_events[HPM_EVENT_Interrupt] = 1;
         wb_trap_cause = r.cmd_addr.read()(4, 0);
         v.cmd_data = vb_xtvec_off_ideleg;
         if (r.xmode[r.mode.read().to_int()].xtvec_mode.read() == 1) {
@@ -735,7 +762,7 @@ void CsrRegs::comb() {
         } else {
             vb_rdata = i_mtimer;
         }
-    } else if (r.cmd_addr.read() == 0xC03) {                // insret: [URO] User Instructions-retired counter for RDINSTRET pseudo-instruction
+    } else if (r.cmd_addr.read() == 0xC02) {                // insret: [URO] User Instructions-retired counter for RDINSTRET pseudo-instruction
         if ((r.mode.read() == PRV_U)
                 && ((r.xmode[iM].xcounteren.read()[2] == 0)
                         || (r.xmode[iS].xcounteren.read()[2] == 0))) {
@@ -748,6 +775,21 @@ void CsrRegs::comb() {
         } else {
             vb_rdata = r.minstret_cnt;                      // Read-only shadow of minstret
         }
+    } else if ((r.cmd_addr.read() >= 0xC03)
+                && (r.cmd_addr.read() <= 0xC1F)) {
+        // hpmcounter3..31: [URO] User performance-monitoring counters
+        if ((r.mode.read() == PRV_U)
+                && ((r.xmode[iM].xcounteren.read()[(t_hpmidx + 3)] == 0)
+                        || (r.xmode[iS].xcounteren.read()[(t_hpmidx + 3)] == 0))) {
+            // Available only if all more prv. bits HPMn are set
+            v.cmd_exception = 1;
+        } else if ((r.mode.read() == PRV_S)
+                    && (r.xmode[iM].xcounteren.read()[(t_hpmidx + 3)] == 0)) {
+            // Available only if bit HPMn is set
+            v.cmd_exception = 1;
+        } else if (t_hpmidx < CFG_HPM_TOTAL) {
+            vb_rdata = r.hpm[t_hpmidx].cnt;                 // Read-only shadow of mhpmcounter
+        }
     } else if (r.cmd_addr.read() == 0x100) {                // sstatus: [SRW] Supervisor status register
         // [0] WPRI
         vb_rdata[1] = r.xmode[iS].xie;
@@ -794,7 +836,7 @@ void CsrRegs::comb() {
     } else if (r.cmd_addr.read() == 0x106) {                // scounteren: [SRW] Supervisor counter enable
         vb_rdata = r.xmode[iS].xcounteren;
         if (v_csr_wena == 1) {
-            v.xmode[iS].xcounteren = r.cmd_data.read()(15, 0);
+            v.xmode[iS].xcounteren = r.cmd_data.read()(31, 0);
         }
     } else if (r.cmd_addr.read() == 0x10A) {                // senvcfg: [SRW] Supervisor environment configuration register
     } else if (r.cmd_addr.read() == 0x140) {                // sscratch: [SRW] Supervisor register for supervisor trap handlers
@@ -978,7 +1020,21 @@ void CsrRegs::comb() {
     } else if (r.cmd_addr.read() == 0x306) {                // mcounteren: [MRW] Machine counter enable
         vb_rdata = r.xmode[iM].xcounteren;
         if (v_csr_wena == 1) {
-            v.xmode[iM].xcounteren = r.cmd_data.read()(15, 0);
+            v.xmode[iM].xcounteren = r.cmd_data.read()(31, 0);
+        }
+    } else if (r.cmd_addr.read() == 0x320) {                // mcountinhibit: [MRW] Machine counter-inhibit register
+        vb_rdata = r.mcountinhibit;
+        if (v_csr_wena == 1) {
+            v.mcountinhibit = r.cmd_data.read()(31, 0);
+        }
+    } else if ((r.cmd_addr.read() >= 0x323)
+                && (r.cmd_addr.read() <= 0x33F)) {
+        // mhpmevent3..31: [MRW] Machine performance-monitoring event selector
+        if (t_hpmidx < CFG_HPM_TOTAL) {
+            vb_rdata = r.hpm[t_hpmidx].event;
+            if (v_csr_wena == 1) {
+                v.hpm[t_hpmidx].event = r.cmd_data.read()(7, 0);
+            }
         }
     } else if (r.cmd_addr.read() == 0x340) {                // mscratch: [MRW] Machine scratch register
         vb_rdata = r.xmode[iM].xscratch;
@@ -1052,14 +1108,15 @@ void CsrRegs::comb() {
         if (v_csr_wena) {
             v.minstret_cnt = r.cmd_data;
         }
-    } else if (r.cmd_addr.read() == 0x320) {                // mcountinhibit: [MRW] Machine counter-inhibit register
-        vb_rdata = r.mcountinhibit;
-        if (v_csr_wena == 1) {
-            v.mcountinhibit = r.cmd_data.read()(15, 0);
+    } else if ((r.cmd_addr.read() >= 0xB03)
+                && (r.cmd_addr.read() <= 0xB1F)) {
+        // mhpmcounter3..31: [MRW] Machine performance-monitoring counter
+        if (t_hpmidx < CFG_HPM_TOTAL) {
+            vb_rdata = r.hpm[t_hpmidx].cnt;
+            if (v_csr_wena == 1) {
+                v.hpm[t_hpmidx].cnt = r.cmd_data;
+            }
         }
-    } else if (r.cmd_addr.read() == 0x323) {                // mpevent3: [MRW] Machine performance-monitoring event selector
-    } else if (r.cmd_addr.read() == 0x324) {                // mpevent4: [MRW] Machine performance-monitoring event selector
-    } else if (r.cmd_addr.read() == 0x33F) {                // mpevent31: [MRW] Machine performance-monitoring event selector
     } else if (r.cmd_addr.read() == 0x7A0) {                // tselect: [MRW] Debug/Trace trigger register select
     } else if (r.cmd_addr.read() == 0x7A1) {                // tdata1: [MRW] First Debug/Trace trigger data register
     } else if (r.cmd_addr.read() == 0x7A2) {                // tdata2: [MRW] Second Debug/Trace trigger data register
@@ -1274,6 +1331,16 @@ void CsrRegs::comb() {
             && (r.mcountinhibit.read()[2] == 0)) {
         v.minstret_cnt = (r.minstret_cnt.read() + 1);
     }
+    for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+        if ((i_e_halted.read() == 0)
+                && (r.dcsr_stopcount.read() == 0)
+                && (r.mcountinhibit.read()[(i + 3)] == 0)
+                && (r.hpm[i].event.read() != HPM_EVENT_None)
+                && (r.hpm[i].event.read() < HPM_EVENT_Total)
+                && (vb_hpm_events[r.hpm[i].event.read().to_int()] == 1)) {
+            v.hpm[i].cnt = (r.hpm[i].cnt.read() + 1);
+        }
+    }
 
     if (!async_reset_ && i_nrst.read() == 0) {
         for (int i = 0; i < 4; i++) {
@@ -1297,6 +1364,10 @@ void CsrRegs::comb() {
             v.pmp[i].addr = 0ull;
             v.pmp[i].mask = 0ull;
         }
+        for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+            v.hpm[i].event = 0;
+            v.hpm[i].cnt = 0ull;
+        }
         v.state = State_Idle;
         v.fencestate = Fence_None;
         v.irq_pending = 0;
@@ -1407,6 +1478,10 @@ void CsrRegs::registers() {
             r.pmp[i].addr = 0ull;
             r.pmp[i].mask = 0ull;
         }
+        for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+            r.hpm[i].event = 0;
+            r.hpm[i].cnt = 0ull;
+        }
         r.state = State_Idle;
         r.fencestate = Fence_None;
         r.irq_pending = 0;
@@ -1482,6 +1557,10 @@ void CsrRegs::registers() {
             r.pmp[i].addr = v.pmp[i].addr;
             r.pmp[i].mask = v.pmp[i].mask;
         }
+        for (int i = 0; i < CFG_HPM_TOTAL; i++) {
+            r.hpm[i].event = v.hpm[i].event;
+            r.hpm[i].cnt = v.hpm[i].cnt;
+        }
         r.state = v.state;
         r.fencestate = v.fencestate;
         r.irq_pending = v.irq_pending;
@@ -48,6 +48,7 @@ SC_MODULE(CsrRegs) {
     sc_in<bool> i_m_idle;                                   // memaccess is in idle state, no memop in progress
     sc_in<bool> i_flushd_end;
     sc_in<sc_uint<64>> i_mtimer;                            // Read-only shadow value of memory-mapped mtimer register (see CLINT).
+    sc_in<sc_uint<HPM_EVENT_Total>> i_hpm_events;           // Performance counters events, bit index is the mhpmevent value
     sc_out<sc_uint<64>> o_executed_cnt;                     // Number of executed instructions
     
     sc_out<bool> o_step;                                    // Stepping enabled
@@ -136,10 +137,16 @@ SC_MODULE(CsrRegs) {
         sc_signal<sc_uint<RISCV_ARCH>> mask;                // NAPOT mask formed from address
     };
 
+    struct HpmItemType {
+        sc_signal<sc_uint<8>> event;                        // mhpmevent: selected event, 0=counter disabled
+        sc_signal<sc_uint<64>> cnt;                         // mhpmcounter
+    };
+
 
     struct CsrRegs_registers {
         RegModeType xmode[4];
         PmpItemType pmp[CFG_PMP_TBL_SIZE];
+        HpmItemType hpm[CFG_HPM_TOTAL];
         sc_signal<sc_uint<4>> state;
         sc_signal<sc_uint<3>> fencestate;
         sc_signal<sc_uint<IRQ_TOTAL>> irq_pending;
@@ -62,7 +62,8 @@ Mmu::Mmu(sc_module_name name,
     i_mxr("i_mxr"),
     i_sum("i_sum"),
     i_fence("i_fence"),
-    i_fence_addr("i_fence_addr") {
+    i_fence_addr("i_fence_addr"),
+    o_tlb_miss("o_tlb_miss") {
 
     async_reset_ = async_reset;
     tlb = 0;
@@ -186,6 +187,7 @@ void Mmu::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, i_sum, i_sum.name());
         sc_trace(o_vcd, i_fence, i_fence.name());
         sc_trace(o_vcd, i_fence_addr, i_fence_addr.name());
+        sc_trace(o_vcd, o_tlb_miss, o_tlb_miss.name());
         sc_trace(o_vcd, r.state, pn + ".r_state");
         sc_trace(o_vcd, r.req_x, pn + ".r_req_x");
         sc_trace(o_vcd, r.req_r, pn + ".r_req_r");
@@ -255,6 +257,7 @@ void Mmu::comb() {
     sc_uint<RISCV_ARCH> vb_tlb_pa_hit;
     sc_biguint<CFG_MMU_PTE_DWIDTH> t_tlb_wdata;
     int t_idx_lsb;
+    bool v_tlb_miss;
 
     v_core_req_x = 0;
     v_core_req_r = 0;
@@ -294,6 +297,7 @@ void Mmu::comb() {
     vb_tlb_pa_hit = 0;
     t_tlb_wdata = 0;
     t_idx_lsb = 0;
+    v_tlb_miss = 0;
 
     v = r;
 
@@ -535,6 +539,7 @@ void Mmu::comb() {
             v.req_pa = vb_tlb_pa_hit;
         } else {
             // TLB miss
+            v_tlb_miss = 1;
             if (i_mmu_sv39.read() == 1) {
                 v.tlb_level = 0x2;                          // Start page decoding sv39
                 v.tlb_page_size = 2;
@@ -701,6 +706,7 @@ void Mmu::comb() {
     o_mem_req_wstrb = vb_mem_req_wstrb;
     o_mem_req_size = vb_mem_req_size;
     o_mem_resp_ready = v_mem_resp_ready;
+    o_tlb_miss = v_tlb_miss;
 }
 
 void Mmu::registers() {
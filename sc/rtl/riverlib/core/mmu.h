@@ -64,6 +64,7 @@ SC_MODULE(Mmu) {
     sc_in<bool> i_sum;                                      // permit Supervisor User Mode access
     sc_in<bool> i_fence;                                    // reset TBL entries at specific address
     sc_in<sc_uint<RISCV_ARCH>> i_fence_addr;                // Fence address: 0=clean all TBL
+    sc_out<bool> o_tlb_miss;                                // TLB miss pulse: page table walk started
 
     void comb();
     void registers();
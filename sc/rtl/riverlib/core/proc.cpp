@@ -76,7 +76,9 @@ Processor::Processor(sc_module_name name,
     o_flushi_addr("o_flushi_addr"),
     o_flushd_valid("o_flushd_valid"),
     o_flushd_addr("o_flushd_addr"),
-    i_flushd_end("i_flushd_end") {
+    i_flushd_end("i_flushd_end"),
+    i_icache_miss("i_icache_miss"),
+    i_dcache_miss("i_dcache_miss") {
 
     async_reset_ = async_reset;
     hartid_ = hartid;
@@ -137,6 +139,7 @@ Processor::Processor(sc_module_name name,
     immu0->i_sum(csr.sum);
     immu0->i_fence(csr.flushmmu_valid);
     immu0->i_fence_addr(csr.flush_addr);
+    immu0->o_tlb_miss(immu.tlb_miss);
 
 
     fetch0 = new InstrFetch("fetch0", async_reset);
@@ -374,6 +377,7 @@ Processor::Processor(sc_module_name name,
     dmmu0->i_sum(csr.sum);
     dmmu0->i_fence(csr.flushmmu_valid);
     dmmu0->i_fence_addr(csr.flush_addr);
+    dmmu0->o_tlb_miss(dmmu.tlb_miss);
 
 
     predic0 = new BranchPredictor("predic0", async_reset);
@@ -507,6 +511,7 @@ Processor::Processor(sc_module_name name,
     csr0->i_m_idle(w.m.idle);
     csr0->i_flushd_end(i_flushd_end);
     csr0->i_mtimer(i_mtimer);
+    csr0->i_hpm_events(wb_hpm_events);
     csr0->o_executed_cnt(csr.executed_cnt);
     csr0->o_step(csr.step);
     csr0->i_dbg_progbuf_ena(dbg.progbuf_ena);
@@ -638,6 +643,8 @@ Processor::Processor(sc_module_name name,
     sensitive << i_dport_resp_ready;
     sensitive << i_progbuf;
     sensitive << i_flushd_end;
+    sensitive << i_icache_miss;
+    sensitive << i_dcache_miss;
     sensitive << w.f.instr_load_fault;
     sensitive << w.f.instr_page_fault_x;
     sensitive << w.f.requested_pc;
@@ -726,6 +733,7 @@ Processor::Processor(sc_module_name name,
     sensitive << immu.page_fault_x;
     sensitive << immu.page_fault_r;
     sensitive << immu.page_fault_w;
+    sensitive << immu.tlb_miss;
     sensitive << dmmu.req_ready;
     sensitive << dmmu.valid;
     sensitive << dmmu.addr;
@@ -735,6 +743,7 @@ Processor::Processor(sc_module_name name,
     sensitive << dmmu.page_fault_x;
     sensitive << dmmu.page_fault_r;
     sensitive << dmmu.page_fault_w;
+    sensitive << dmmu.tlb_miss;
     sensitive << ireg.rdata1;
     sensitive << ireg.rtag1;
     sensitive << ireg.rdata2;
@@ -848,6 +857,7 @@ Processor::Processor(sc_module_name name,
     sensitive << unused_immu_core_req_wstrb;
     sensitive << unused_immu_core_req_size;
     sensitive << unused_immu_mem_resp_store_fault;
+    sensitive << wb_hpm_events;
 }
 
 Processor::~Processor() {
@@ -939,6 +949,8 @@ void Processor::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
         sc_trace(o_vcd, o_flushd_valid, o_flushd_valid.name());
         sc_trace(o_vcd, o_flushd_addr, o_flushd_addr.name());
         sc_trace(o_vcd, i_flushd_end, i_flushd_end.name());
+        sc_trace(o_vcd, i_icache_miss, i_icache_miss.name());
+        sc_trace(o_vcd, i_dcache_miss, i_dcache_miss.name());
     }
 
     if (fetch0) {
@@ -980,6 +992,10 @@ void Processor::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
 }
 
 void Processor::comb() {
+    sc_uint<HPM_EVENT_Total> vb_hpm_events;
+
+    vb_hpm_events = 0;
+
     w_mem_resp_error = (i_resp_data_load_fault || i_resp_data_store_fault);
     w_writeback_ready = (!w.e.reg_wena);
     if (w.e.reg_wena.read() == 1) {
@@ -1008,6 +1024,26 @@ void Processor::comb() {
     o_flushd_addr = ~0ull;
     o_flushd_valid = w.m.flushd;
     o_halted = w.e.halted;
+
+    // Performance counters events
+    vb_hpm_events[HPM_EVENT_ICacheMiss] = i_icache_miss.read();
+    vb_hpm_events[HPM_EVENT_DCacheMiss] = i_dcache_miss.read();
+    // Executed instruction and the next decoded one isn't its successor
+    vb_hpm_events[HPM_EVENT_BranchMispredict] = ((w.e.valid.read() == 1)
+            && (w.d.pc.read() != w.e.npc.read())
+            && (w.d.pc.read() != w.e.pc.read()));
+    if ((w.e.memop_valid.read() == 1)
+            && (w.m.memop_ready.read() == 1)
+            && (w.e.memop_debug.read() == 0)) {
+        if (w.e.memop_type.read()[MemopType_Store] == 1) {
+            vb_hpm_events[HPM_EVENT_Store] = 1;
+        } else {
+            vb_hpm_events[HPM_EVENT_Load] = 1;
+        }
+    }
+    vb_hpm_events[HPM_EVENT_Stall] = ((w.e.valid.read() == 0) && (w.e.halted.read() == 0));
+    vb_hpm_events[HPM_EVENT_TlbMiss] = (immu.tlb_miss || dmmu.tlb_miss);
+    wb_hpm_events = vb_hpm_events;
 }
 
 }  // namespace debugger
@@ -89,6 +89,9 @@ SC_MODULE(Processor) {
     sc_out<bool> o_flushd_valid;                            // Remove address from D$ is valid
     sc_out<sc_uint<RISCV_ARCH>> o_flushd_addr;              // Address of instruction to remove from D$
     sc_in<bool> i_flushd_end;
+    // Performance counters events:
+    sc_in<bool> i_icache_miss;                              // I$ line miss
+    sc_in<bool> i_dcache_miss;                              // D$ line miss
 
     void comb();
 
@@ -131,6 +134,7 @@ SC_MODULE(Processor) {
         sc_signal<bool> page_fault_x;
         sc_signal<bool> page_fault_r;
         sc_signal<bool> page_fault_w;
+        sc_signal<bool> tlb_miss;                           // Page table walk started
     };
 
     struct InstructionDecodeType {
@@ -359,6 +363,7 @@ SC_MODULE(Processor) {
     sc_signal<sc_uint<8>> unused_immu_core_req_wstrb;
     sc_signal<sc_uint<2>> unused_immu_core_req_size;
     sc_signal<bool> unused_immu_mem_resp_store_fault;
+    sc_signal<sc_uint<HPM_EVENT_Total>> wb_hpm_events;      // Performance counters events except exceptions and interrupts
 
     InstrFetch *fetch0;
     InstrDecoder *dec0;
@@ -124,6 +124,9 @@ Tracer::Tracer(sc_module_name name,
             hartid_);
     trfilename = std::string(tstr);
     fl = fopen(trfilename.c_str(), "wb");
+    icosim_ = 0;
+    cosim_checked_ = false;
+    cosim_total_ = 0;
 
     // end initial
 
@@ -1258,6 +1261,34 @@ std::string Tracer::TraceOutput(sc_uint<TRACE_TBL_ABITS> rcnt) {
     return ostr;
 }
 
+void Tracer::CoSimOutput(sc_uint<TRACE_TBL_ABITS> rcnt) {
+    TraceBinRecordType *p = &cosim_rec_[cosim_total_++];
+    int ircnt = rcnt.to_int();
+    int cnt = 0;
+
+    p->step_cnt = r.trace_tbl[ircnt].exec_cnt.read().to_uint64();
+    p->pc = r.trace_tbl[ircnt].pc.read().to_uint64();
+    p->instr = r.trace_tbl[ircnt].instr.read().to_uint();
+    p->isize = 0;                               // don't compare instruction
+    for (int i = 0; i < r.trace_tbl[ircnt].memactioncnt.read().to_int(); i++) {
+        if (r.trace_tbl[ircnt].memaction[i].ignored.read() == 0 && cnt < 64) {
+            p->action[cnt].memop = true;
+            p->action[cnt].write = r.trace_tbl[ircnt].memaction[i].store.read();
+            p->action[cnt].addr = r.trace_tbl[ircnt].memaction[i].memaddr.read().to_uint64();
+            p->action[cnt].data = r.trace_tbl[ircnt].memaction[i].data.read().to_uint64();
+            p->action[cnt].size = 1 << r.trace_tbl[ircnt].memaction[i].size.read().to_int();
+            cnt++;
+        }
+    }
+    for (int i = 0; i < r.trace_tbl[ircnt].regactioncnt.read().to_int() && cnt < 64; i++) {
+        p->action[cnt].memop = false;
+        p->action[cnt].waddr = r.trace_tbl[ircnt].regaction[i].waddr.read().to_int();
+        p->action[cnt].data = r.trace_tbl[ircnt].regaction[i].wres.read().to_uint64();
+        cnt++;
+    }
+    p->action_cnt = cnt;
+}
+
 void Tracer::comb() {
     int wcnt;
     int xcnt;
@@ -1401,6 +1432,7 @@ void Tracer::comb() {
     entry_valid = 1;
     rcnt_inc = r.tr_rcnt;
     outstr = "";
+    cosim_total_ = 0;
     while ((entry_valid == 1) && (rcnt_inc != r.tr_wcnt.read())) {
         for (int i = 0; i < r.trace_tbl[rcnt_inc].memactioncnt.read().to_int(); i++) {
             if (r.trace_tbl[rcnt_inc].memaction[i].complete == 0) {
@@ -1410,6 +1442,9 @@ void Tracer::comb() {
         if (entry_valid == 1) {
             tracestr = TraceOutput(rcnt_inc);
             outstr += tracestr;
+            if (icosim_) {
+                CoSimOutput(rcnt_inc);
+            }
             rcnt_inc = (rcnt_inc + 1);
         }
     }
@@ -1509,6 +1544,25 @@ void Tracer::registers() {
         fwrite(outstr.c_str(), 1, outstr.size(), fl);
     }
     outstr = "";
+
+    if (!cosim_checked_) {
+        // Services are available only when simulation is started
+        AttributeType list;
+        RISCV_get_iface_list(IFACE_COSIMULATION, &list);
+        if (list.size()) {
+            icosim_ = static_cast<ICoSimulation *>(list[0u].to_iface());
+        }
+        cosim_checked_ = true;
+    }
+    for (int i = 0; i < cosim_total_; i++) {
+        if (!icosim_->retireReference(hartid_, &cosim_rec_[i])) {
+            // Mismatch: stop RTL simulation at the first divergence
+            icosim_ = 0;
+            sc_stop();
+            break;
+        }
+    }
+    cosim_total_ = 0;
 }
 
 }  // namespace debugger
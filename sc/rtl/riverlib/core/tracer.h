@@ -18,6 +18,7 @@
 #include <systemc.h>
 #include <string>
 #include "../river_cfg.h"
+#include "coreservices/icosim.h"
 
 namespace debugger {
 
@@ -68,6 +69,7 @@ SC_MODULE(Tracer) {
 
     std::string TaskDisassembler(sc_uint<32> instr);
     std::string TraceOutput(sc_uint<TRACE_TBL_ABITS> rcnt);
+    void CoSimOutput(sc_uint<TRACE_TBL_ABITS> rcnt);
 
     struct MemopActionType {
         sc_signal<bool> store;                              // 0=load;1=store
@@ -111,6 +113,12 @@ SC_MODULE(Tracer) {
     std::string tracestr;
     FILE *fl;
 
+    // Lock-step co-simulation with the functional model
+    ICoSimulation *icosim_;
+    bool cosim_checked_;
+    int cosim_total_;
+    TraceBinRecordType cosim_rec_[TRACE_TBL_SZ];
+
 
 };
 
@@ -16,6 +16,7 @@
 
 #include "l2cache_lru.h"
 #include "api_core.h"
+#include <string.h>
 
 namespace debugger {
 
@@ -61,29 +62,19 @@ L2CacheLru::L2CacheLru(sc_module_name name,
     FLUSH_ALL_VALUE = ((1 << (ibits + waybits)) - 1);
     mem0 = 0;
 
-    mem0 = new TagMemNWay<abus,
-                          4,
-                          9,
-                          lnbits,
-                          flbits,
-                          0>("mem0", async_reset);
-    mem0->i_clk(i_clk);
-    mem0->i_nrst(i_nrst);
-    mem0->i_direct_access(line_direct_access_i);
-    mem0->i_invalidate(line_invalidate_i);
-    mem0->i_re(line_re_i);
-    mem0->i_we(line_we_i);
-    mem0->i_addr(line_addr_i);
-    mem0->i_wdata(line_wdata_i);
-    mem0->i_wstrb(line_wstrb_i);
-    mem0->i_wflags(line_wflags_i);
-    mem0->o_raddr(line_raddr_o);
-    mem0->o_rdata(line_rdata_o);
-    mem0->o_rflags(line_rflags_o);
-    mem0->o_hit(line_hit_o);
-    mem0->i_snoop_addr(line_snoop_addr_i);
-    mem0->o_snoop_ready(line_snoop_ready_o);
-    mem0->o_snoop_flags(line_snoop_flags_o);
+    mem0VCD_ = 0;
+    clearCacheStat();
+
+    // Tag memory is a template, instantiate the one requested at startup
+    switch (waybits) {
+    case 2: createTagMemWays<2>(ibits); break;
+    case 3: createTagMemWays<3>(ibits); break;
+    case 4: createTagMemWays<4>(ibits); break;
+    default:;
+    }
+    if (mem0 == 0) {
+        SC_REPORT_ERROR(this->name(), "Unsupported L2 geometry");
+    }
 
 
 
@@ -152,6 +143,90 @@ L2CacheLru::~L2CacheLru() {
     }
 }
 
+template<int waybits>
+void L2CacheLru::createTagMemWays(uint32_t ibits) {
+    switch (ibits) {
+    case 7: createTagMem<waybits, 7>(); break;
+    case 8: createTagMem<waybits, 8>(); break;
+    case 9: createTagMem<waybits, 9>(); break;
+    case 10: createTagMem<waybits, 10>(); break;
+    case 11: createTagMem<waybits, 11>(); break;
+    default:;
+    }
+}
+
+template<int waybits, int ibits>
+void L2CacheLru::createTagMem() {
+    TagMemNWay<abus, waybits, ibits, lnbits, flbits, 0> *p;
+    p = new TagMemNWay<abus, waybits, ibits, lnbits, flbits, 0>("mem0", async_reset_);
+    p->i_clk(i_clk);
+    p->i_nrst(i_nrst);
+    p->i_direct_access(line_direct_access_i);
+    p->i_invalidate(line_invalidate_i);
+    p->i_re(line_re_i);
+    p->i_we(line_we_i);
+    p->i_addr(line_addr_i);
+    p->i_wdata(line_wdata_i);
+    p->i_wstrb(line_wstrb_i);
+    p->i_wflags(line_wflags_i);
+    p->o_raddr(line_raddr_o);
+    p->o_rdata(line_rdata_o);
+    p->o_rflags(line_rflags_o);
+    p->o_hit(line_hit_o);
+    p->i_snoop_addr(line_snoop_addr_i);
+    p->o_snoop_ready(line_snoop_ready_o);
+    p->o_snoop_flags(line_snoop_flags_o);
+    mem0 = p;
+    mem0VCD_ = &L2CacheLru::generateTagMemVCD<waybits, ibits>;
+}
+
+template<int waybits, int ibits>
+void L2CacheLru::generateTagMemVCD(sc_module *mem, sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
+    static_cast<TagMemNWay<abus, waybits, ibits, lnbits, flbits, 0> *>(mem)->generateVCD(i_vcd, o_vcd);
+}
+
+void L2CacheLru::clearCacheStat() {
+    memset(&stat_, 0, sizeof(stat_));
+    stat_miss_ = false;
+}
+
+void L2CacheLru::updateCacheStat() {
+    if (i_nrst.read() == 0) {
+        stat_miss_ = false;
+        return;
+    }
+    switch (r.state.read()) {
+    case State_CheckHit:
+        if (line_hit_o.read() == 0) {
+            if (!stat_miss_) {
+                stat_.misses++;
+                stat_miss_ = true;
+            }
+        } else {
+            if (!stat_miss_) {
+                stat_.hits++;
+            }
+            stat_miss_ = false;
+        }
+        break;
+    case State_WaitGrant:
+        if ((i_req_mem_ready.read() == 1)
+                && ((r.write_first.read() == 1) || (r.write_flush.read() == 1))) {
+            stat_.writebacks++;
+        }
+        stat_.mem_stalls++;
+        break;
+    case State_WaitResp:
+    case State_WriteBus:
+        stat_.mem_stalls++;
+        break;
+    default:;
+    }
+    if (v.state.read() == State_Idle) {
+        stat_miss_ = false;
+    }
+}
+
 void L2CacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     std::string pn(name());
     if (o_vcd) {
@@ -206,7 +281,7 @@ void L2CacheLru::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     }
 
     if (mem0) {
-        mem0->generateVCD(i_vcd, o_vcd);
+        mem0VCD_(mem0, i_vcd, o_vcd);
     }
 }
 
@@ -611,6 +686,9 @@ void L2CacheLru::comb() {
 }
 
 void L2CacheLru::registers() {
+    if (i_clk.posedge()) {
+        updateCacheStat();
+    }
     if (async_reset_ && i_nrst.read() == 0) {
         L2CacheLru_r_reset(r);
     } else {
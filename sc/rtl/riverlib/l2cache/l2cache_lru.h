@@ -18,10 +18,11 @@
 #include <systemc.h>
 #include "../river_cfg.h"
 #include "../cache/tagmemnway.h"
+#include "../cache/cache_stat.h"
 
 namespace debugger {
 
-SC_MODULE(L2CacheLru) {
+SC_MODULE(L2CacheLru), public ICacheStat {
  public:
     sc_in<bool> i_clk;                                      // CPU clock
     sc_in<bool> i_nrst;                                     // Reset: active LOW
@@ -68,6 +69,17 @@ SC_MODULE(L2CacheLru) {
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
 
+    // ICacheStat
+    virtual const CacheStatType *getCacheStat() { return &stat_; }
+    virtual void clearCacheStat();
+
+ private:
+    template<int waybits> void createTagMemWays(uint32_t ibits);
+    template<int waybits, int ibits> void createTagMem();
+    template<int waybits, int ibits>
+    static void generateTagMemVCD(sc_module *mem, sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    void updateCacheStat();
+
  private:
     bool async_reset_;
     uint32_t waybits_;
@@ -159,7 +171,10 @@ SC_MODULE(L2CacheLru) {
     sc_signal<bool> line_snoop_ready_o;
     sc_signal<sc_uint<L2TAG_FL_TOTAL>> line_snoop_flags_o;
 
-    TagMemNWay<abus, 4, 9, lnbits, flbits, 0> *mem0;
+    sc_module *mem0;                                        // TagMemNWay of the selected geometry
+    void (*mem0VCD_)(sc_module *, sc_trace_file *, sc_trace_file *);
+    CacheStatType stat_;
+    bool stat_miss_;                                        // current lookup was counted as a miss
 
 };
 
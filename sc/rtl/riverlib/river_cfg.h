@@ -119,6 +119,21 @@ static const int CFG_MMU_TLB_SIZE = (1 << CFG_MMU_TLB_AWIDTH);// Number of PTE e
 static const int CFG_MMU_PTE_DWIDTH = ((2 * RISCV_ARCH) - 12);// PTE entry size in bits
 static const int CFG_MMU_PTE_DBYTES = (CFG_MMU_PTE_DWIDTH / 8);// PTE entry size in bytes
 
+// Hardware performance-monitoring counters: mhpmcounter3..(3 + CFG_HPM_TOTAL - 1)
+static const int CFG_HPM_TOTAL = 8;                         // Number of implemented counters (max 29)
+// mhpmevent values. The same values are used by the functional model
+static const int HPM_EVENT_None = 0;                        // Counter doesn't count
+static const int HPM_EVENT_ICacheMiss = 1;                  // I$ line miss
+static const int HPM_EVENT_DCacheMiss = 2;                  // D$ line miss
+static const int HPM_EVENT_BranchMispredict = 3;            // Wrong path fetched after executed instruction
+static const int HPM_EVENT_Load = 4;                        // Load request accepted by memaccess
+static const int HPM_EVENT_Store = 5;                       // Store request accepted by memaccess
+static const int HPM_EVENT_Stall = 6;                       // Clock without executed instruction
+static const int HPM_EVENT_TlbMiss = 7;                     // I or D TLB miss
+static const int HPM_EVENT_Exception = 8;                   // Exception taken
+static const int HPM_EVENT_Interrupt = 9;                   // Interrupt taken
+static const int HPM_EVENT_Total = 10;
+
 
 static const uint8_t MEMOP_8B = 3;
 static const uint8_t MEMOP_4B = 2;
@@ -134,6 +134,8 @@ RiverTop::RiverTop(sc_module_name name,
     proc0->o_flushd_valid(w_flushd_valid);
     proc0->o_flushd_addr(wb_flushd_addr);
     proc0->i_flushd_end(w_flushd_end);
+    proc0->i_icache_miss(w_icache_miss);
+    proc0->i_dcache_miss(w_dcache_miss);
 
 
     cache0 = new CacheTop("cache0", async_reset, coherence_ena, ilog2_nways, ilog2_lines_per_way, dlog2_nways, dlog2_lines_per_way);
@@ -192,6 +194,8 @@ RiverTop::RiverTop(sc_module_name name,
     cache0->i_flushd_valid(w_flushd_valid);
     cache0->i_flushd_addr(wb_flushd_addr);
     cache0->o_flushd_end(w_flushd_end);
+    cache0->o_icache_miss(w_icache_miss);
+    cache0->o_dcache_miss(w_dcache_miss);
 
 
 
@@ -250,6 +254,8 @@ RiverTop::RiverTop(sc_module_name name,
     sensitive << w_flushd_valid;
     sensitive << wb_flushd_addr;
     sensitive << w_flushd_end;
+    sensitive << w_icache_miss;
+    sensitive << w_dcache_miss;
 }
 
 RiverTop::~RiverTop() {
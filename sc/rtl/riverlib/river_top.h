@@ -132,6 +132,8 @@ SC_MODULE(RiverTop) {
     sc_signal<bool> w_flushd_valid;
     sc_signal<sc_uint<RISCV_ARCH>> wb_flushd_addr;
     sc_signal<bool> w_flushd_end;
+    sc_signal<bool> w_icache_miss;
+    sc_signal<bool> w_dcache_miss;
 
     Processor *proc0;
     CacheTop *cache0;